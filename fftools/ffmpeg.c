@@ -126,8 +126,14 @@ typedef struct BenchmarkTimeStamps {
     int64_t sys_usec;
 } BenchmarkTimeStamps;
 
-static void do_video_stats(OutputStream *ost, int frame_size);
+static void do_video_stats(OutputStream *ost, int frame_size, int frame_number);
 static BenchmarkTimeStamps get_benchmark_time_stamps(void);
+static void print_stage_times(void);
+#if HAVE_THREADS
+static void free_decoder_threads(void);
+static void free_encoder_threads(void);
+static void free_mux_threads(void);
+#endif
 static int64_t getmaxrss(void);
 static int ifilter_has_all_input_formats(FilterGraph *fg);
 
@@ -138,6 +144,11 @@ static int nb_frames_drop = 0;
 static int64_t decode_error_stat[2];
 static unsigned nb_output_dumped = 0;
 
+/* wall clock time spent in each stage, for -benchmark; the time of the
+ * stages that may run in their own threads is accounted per file and
+ * per stream */
+static int64_t decode_time, filter_time;
+
 static int want_sdp = 1;
 
 static BenchmarkTimeStamps current_time;
@@ -499,8 +510,15 @@ static void ffmpeg_cleanup(int ret)
         av_log(NULL, AV_LOG_INFO, "bench: maxrss=%ikB\n", maxrss);
     }
 
+#if HAVE_THREADS
+    free_decoder_threads();
+    free_encoder_threads();
+    free_mux_threads();
+#endif
+
     for (i = 0; i < nb_filtergraphs; i++) {
         FilterGraph *fg = filtergraphs[i];
+        print_filter_profile(fg);
         avfilter_graph_free(&fg->graph);
         for (j = 0; j < fg->nb_inputs; j++) {
             InputFilter *ifilter = fg->inputs[j];
@@ -692,6 +710,17 @@ static void update_benchmark(const char *fmt, ...)
     }
 }
 
+static int64_t stage_start(void)
+{
+    return do_benchmark ? av_gettime_relative() : 0;
+}
+
+static void stage_end(int64_t *total, int64_t start)
+{
+    if (do_benchmark)
+        *total += av_gettime_relative() - start;
+}
+
 static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream, OSTFinished others)
 {
     int i;
@@ -701,10 +730,128 @@ static void close_all_output_streams(OutputStream *ost, OSTFinished this_stream,
     }
 }
 
+#if HAVE_THREADS
+static void *mux_thread(void *arg)
+{
+    OutputFile *of = arg;
+    AVFormatContext *s = of->ctx;
+    AVPacket pkt;
+    int64_t t;
+    int i, ret;
+
+    while (av_thread_message_queue_recv(of->mux_queue, &pkt, 0) >= 0) {
+        t = stage_start();
+        ret = av_interleaved_write_frame(s, &pkt);
+        stage_end(&of->mux_time, t);
+        if (ret < 0) {
+            print_error("av_interleaved_write_frame()", ret);
+            av_thread_message_queue_set_err_send(of->mux_queue, ret);
+            break;
+        }
+
+        /* the main thread reads these for the progress report and the
+         * -fs and -vstats options */
+        if (s->pb)
+            atomic_store(&of->mux_size, avio_tell(s->pb));
+        for (i = 0; i < s->nb_streams; i++)
+            atomic_store(&output_streams[of->ost_index + i]->mux_end_pts,
+                         av_stream_get_end_pts(s->streams[i]));
+    }
+
+    return NULL;
+}
+
+static int init_mux_thread(OutputFile *of)
+{
+    AVFormatContext *s = of->ctx;
+    int i, ret;
+
+    ret = av_thread_message_queue_alloc(&of->mux_queue, 64, sizeof(AVPacket));
+    if (ret < 0)
+        return ret;
+
+    atomic_init(&of->mux_size, s->pb ? avio_tell(s->pb) : AVERROR(EINVAL));
+    for (i = 0; i < s->nb_streams; i++)
+        atomic_init(&output_streams[of->ost_index + i]->mux_end_pts,
+                    av_stream_get_end_pts(s->streams[i]));
+
+    if ((ret = pthread_create(&of->mux_thread, NULL, mux_thread, of))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        av_thread_message_queue_free(&of->mux_queue);
+        return AVERROR(ret);
+    }
+
+    return 0;
+}
+
+/*
+ * Wait for the muxing thread of of to write the packets queued to it and
+ * stop it, so that the muxer may be used from the main thread again.
+ */
+static void free_mux_thread(OutputFile *of)
+{
+    AVPacket pkt;
+
+    if (!of->mux_queue)
+        return;
+    av_thread_message_queue_set_err_recv(of->mux_queue, AVERROR_EOF);
+    pthread_join(of->mux_thread, NULL);
+
+    while (av_thread_message_queue_recv(of->mux_queue, &pkt, 0) >= 0)
+        av_packet_unref(&pkt);
+    av_thread_message_queue_free(&of->mux_queue);
+}
+
+static void free_mux_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_output_files; i++)
+        if (output_files[i])
+            free_mux_thread(output_files[i]);
+}
+#endif
+
+/* number of bytes written to the output so far */
+static int64_t output_file_tell(OutputFile *of)
+{
+#if HAVE_THREADS
+    if (of->mux_queue)
+        return atomic_load(&of->mux_size);
+#endif
+    return avio_tell(of->ctx->pb);
+}
+
+/* size of the output written so far, or a negative value if unknown */
+static int64_t output_file_size(OutputFile *of)
+{
+    AVIOContext *pb = of->ctx->pb;
+    int64_t size;
+
+#if HAVE_THREADS
+    if (of->mux_queue)
+        return atomic_load(&of->mux_size);
+#endif
+    size = avio_size(pb);
+    if (size <= 0) // FIXME improve avio_size() so it works with non seekable output too
+        size = avio_tell(pb);
+    return size;
+}
+
+static int64_t output_stream_end_pts(OutputStream *ost)
+{
+#if HAVE_THREADS
+    if (output_files[ost->file_index]->mux_queue)
+        return atomic_load(&ost->mux_end_pts);
+#endif
+    return av_stream_get_end_pts(ost->st);
+}
+
 static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int unqueue)
 {
     AVFormatContext *s = of->ctx;
     AVStream *st = ost->st;
+    int64_t t;
     int ret;
 
     /*
@@ -835,7 +982,30 @@ static void write_packet(OutputFile *of, AVPacket *pkt, OutputStream *ost, int u
               );
     }
 
+#if HAVE_THREADS
+    if (of->mux_queue) {
+        ret = av_packet_make_refcounted(pkt);
+        if (ret < 0)
+            print_error("av_packet_make_refcounted()", ret);
+        else
+            ret = av_thread_message_queue_send(of->mux_queue, pkt, 0);
+        if (ret < 0) {
+            /* write errors have been reported by the muxing thread */
+            main_return_code = 1;
+            close_all_output_streams(ost, MUXER_FINISHED | ENCODER_FINISHED, ENCODER_FINISHED);
+            av_packet_unref(pkt);
+        } else {
+            av_init_packet(pkt);
+            pkt->data = NULL;
+            pkt->size = 0;
+        }
+        return;
+    }
+#endif
+
+    t = stage_start();
     ret = av_interleaved_write_frame(s, pkt);
+    stage_end(&of->mux_time, t);
     if (ret < 0) {
         print_error("av_interleaved_write_frame()", ret);
         main_return_code = 1;
@@ -973,11 +1143,230 @@ static int init_output_stream_wrapper(OutputStream *ost, AVFrame *frame,
     return ret;
 }
 
+#if HAVE_THREADS
+static void encoder_thread_signal(OutputStream *ost)
+{
+    pthread_mutex_lock(&ost->enc_lock);
+    ost->enc_events++;
+    pthread_cond_signal(&ost->enc_cond);
+    pthread_mutex_unlock(&ost->enc_lock);
+}
+
+static void *encoder_thread(void *arg)
+{
+    OutputStream *ost = arg;
+    AVCodecContext *enc = ost->enc_ctx;
+    AVFrame *frame;
+    AVPacket pkt;
+    int64_t t, pts;
+    int ret;
+
+    while ((ret = av_thread_message_queue_recv(ost->enc_frame_queue, &frame, 0)) >= 0) {
+        encoder_thread_signal(ost);
+
+        /* a NULL frame flushes the encoder */
+        pts = frame ? frame->pts : AV_NOPTS_VALUE;
+        t   = stage_start();
+        ret = avcodec_send_frame(enc, frame);
+        av_frame_free(&frame);
+
+        while (ret >= 0) {
+            av_init_packet(&pkt);
+            pkt.data = NULL;
+            pkt.size = 0;
+
+            ret = avcodec_receive_packet(enc, &pkt);
+            stage_end(&ost->encode_time, t);
+            if (ret < 0)
+                break;
+
+            if (enc->codec_type == AVMEDIA_TYPE_VIDEO &&
+                pkt.pts == AV_NOPTS_VALUE && !(enc->codec->capabilities & AV_CODEC_CAP_DELAY))
+                pkt.pts = pts;
+
+            /* if two pass, output log */
+            if (ost->logfile && enc->stats_out)
+                fprintf(ost->logfile, "%s", enc->stats_out);
+
+            ret = av_thread_message_queue_send(ost->enc_packet_queue, &pkt, 0);
+            if (ret < 0)
+                av_packet_unref(&pkt);
+            encoder_thread_signal(ost);
+            t = stage_start();
+        }
+        if (ret != AVERROR(EAGAIN))
+            break;
+    }
+
+    /* AVERROR_EOF once the encoder has been flushed */
+    av_thread_message_queue_set_err_send(ost->enc_frame_queue, ret);
+    av_thread_message_queue_set_err_recv(ost->enc_packet_queue, ret);
+    encoder_thread_signal(ost);
+
+    return NULL;
+}
+
+static int init_encoder_thread(OutputStream *ost)
+{
+    int ret;
+
+    ret = av_thread_message_queue_alloc(&ost->enc_frame_queue, 8, sizeof(AVFrame *));
+    if (ret < 0)
+        return ret;
+    ret = av_thread_message_queue_alloc(&ost->enc_packet_queue, 32, sizeof(AVPacket));
+    if (ret < 0)
+        goto fail;
+
+    pthread_mutex_init(&ost->enc_lock, NULL);
+    pthread_cond_init(&ost->enc_cond, NULL);
+    ost->enc_events = 0;
+
+    if ((ret = pthread_create(&ost->enc_thread, NULL, encoder_thread, ost))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        ret = AVERROR(ret);
+        pthread_mutex_destroy(&ost->enc_lock);
+        pthread_cond_destroy(&ost->enc_cond);
+        goto fail;
+    }
+
+    return 0;
+fail:
+    av_thread_message_queue_free(&ost->enc_frame_queue);
+    av_thread_message_queue_free(&ost->enc_packet_queue);
+    return ret;
+}
+
+static void free_encoder_thread(OutputStream *ost)
+{
+    AVFrame *frame;
+    AVPacket pkt;
+
+    if (!ost->enc_frame_queue)
+        return;
+    av_thread_message_queue_set_err_recv(ost->enc_frame_queue, AVERROR_EOF);
+    av_thread_message_queue_set_err_send(ost->enc_packet_queue, AVERROR_EOF);
+    pthread_join(ost->enc_thread, NULL);
+
+    while (av_thread_message_queue_recv(ost->enc_frame_queue, &frame, 0) >= 0)
+        av_frame_free(&frame);
+    while (av_thread_message_queue_recv(ost->enc_packet_queue, &pkt, 0) >= 0)
+        av_packet_unref(&pkt);
+    av_thread_message_queue_free(&ost->enc_frame_queue);
+    av_thread_message_queue_free(&ost->enc_packet_queue);
+    pthread_mutex_destroy(&ost->enc_lock);
+    pthread_cond_destroy(&ost->enc_cond);
+}
+
+static void free_encoder_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_output_streams; i++)
+        if (output_streams[i])
+            free_encoder_thread(output_streams[i]);
+}
+
+/*
+ * Mux the packets produced by the encoding thread of ost, waiting for the
+ * thread to finish if block is set.
+ *
+ * @return the number of packets muxed, or AVERROR_EOF once the encoder
+ *         has been flushed
+ */
+static int mux_encoded_packets(OutputStream *ost, int block)
+{
+    OutputFile *of = output_files[ost->file_index];
+    AVCodecContext *enc = ost->enc_ctx;
+    AVPacket pkt;
+    int ret, pkt_size, nb_packets = 0;
+
+    while ((ret = av_thread_message_queue_recv(ost->enc_packet_queue, &pkt,
+                                               block ? 0 : AV_THREAD_MESSAGE_NONBLOCK)) >= 0) {
+        nb_packets++;
+        if (ost->finished & MUXER_FINISHED) {
+            av_packet_unref(&pkt);
+            continue;
+        }
+
+        if (debug_ts) {
+            av_log(NULL, AV_LOG_INFO, "encoder -> type:%s "
+                   "pkt_pts:%s pkt_pts_time:%s pkt_dts:%s pkt_dts_time:%s\n",
+                   av_get_media_type_string(enc->codec_type),
+                   av_ts2str(pkt.pts), av_ts2timestr(pkt.pts, &enc->time_base),
+                   av_ts2str(pkt.dts), av_ts2timestr(pkt.dts, &enc->time_base));
+        }
+
+        av_packet_rescale_ts(&pkt, enc->time_base, ost->mux_timebase);
+        pkt_size = pkt.size;
+        output_packet(of, &pkt, ost, 0);
+        if (enc->codec_type == AVMEDIA_TYPE_VIDEO && vstats_filename)
+            do_video_stats(ost, pkt_size, ost->packets_written);
+    }
+    if (ret == AVERROR(EAGAIN))
+        return nb_packets;
+    if (ret != AVERROR_EOF) {
+        av_log(NULL, AV_LOG_FATAL, "%s encoding failed: %s\n",
+               av_get_media_type_string(enc->codec_type), av_err2str(ret));
+        exit_program(1);
+    }
+    return AVERROR_EOF;
+}
+
+/*
+ * Queue a frame, or NULL to flush, to the encoding thread of ost, which is
+ * started on the first call.
+ */
+static void enc_thread_send_frame(OutputStream *ost, AVFrame *frame)
+{
+    AVFrame *f = NULL;
+    unsigned events;
+    int ret;
+
+    if (!ost->enc_frame_queue && (ret = init_encoder_thread(ost)) < 0)
+        goto fail;
+
+    if (frame && !(f = av_frame_clone(frame))) {
+        ret = AVERROR(ENOMEM);
+        goto fail;
+    }
+
+    while (1) {
+        pthread_mutex_lock(&ost->enc_lock);
+        events = ost->enc_events;
+        pthread_mutex_unlock(&ost->enc_lock);
+
+        ret = av_thread_message_queue_send(ost->enc_frame_queue, &f,
+                                           AV_THREAD_MESSAGE_NONBLOCK);
+        if (ret != AVERROR(EAGAIN))
+            break;
+
+        /* the encoder may be waiting for its packets to be muxed */
+        if (mux_encoded_packets(ost, 0))
+            continue;
+
+        pthread_mutex_lock(&ost->enc_lock);
+        while (ost->enc_events == events)
+            pthread_cond_wait(&ost->enc_cond, &ost->enc_lock);
+        pthread_mutex_unlock(&ost->enc_lock);
+    }
+    if (ret < 0) {
+        av_frame_free(&f);
+        goto fail;
+    }
+    return;
+fail:
+    av_log(NULL, AV_LOG_FATAL, "%s encoding failed: %s\n",
+           av_get_media_type_string(ost->enc_ctx->codec_type), av_err2str(ret));
+    exit_program(1);
+}
+#endif
+
 static void do_audio_out(OutputFile *of, OutputStream *ost,
                          AVFrame *frame)
 {
     AVCodecContext *enc = ost->enc_ctx;
     AVPacket pkt;
+    int64_t t;
     int ret;
 
     av_init_packet(&pkt);
@@ -1004,12 +1393,21 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
                enc->time_base.num, enc->time_base.den);
     }
 
+#if HAVE_THREADS
+    if (do_pipeline) {
+        enc_thread_send_frame(ost, frame);
+        return;
+    }
+#endif
+
+    t = stage_start();
     ret = avcodec_send_frame(enc, frame);
     if (ret < 0)
         goto error;
 
     while (1) {
         ret = avcodec_receive_packet(enc, &pkt);
+        stage_end(&ost->encode_time, t);
         if (ret == AVERROR(EAGAIN))
             break;
         if (ret < 0)
@@ -1027,6 +1425,7 @@ static void do_audio_out(OutputFile *of, OutputStream *ost,
         }
 
         output_packet(of, &pkt, ost, 0);
+        t = stage_start();
     }
 
     return;
@@ -1131,6 +1530,7 @@ static void do_video_out(OutputFile *of,
     double duration = 0;
     double sync_ipts = AV_NOPTS_VALUE;
     int frame_size = 0;
+    int64_t t;
     InputStream *ist = NULL;
     AVFilterContext *filter = ost->filter->filter;
 
@@ -1343,6 +1743,18 @@ static void do_video_out(OutputFile *of,
 
         ost->frames_encoded++;
 
+#if HAVE_THREADS
+        if (do_pipeline) {
+            enc_thread_send_frame(ost, in_picture);
+            // Make sure Closed Captions will not be duplicated
+            av_frame_remove_side_data(in_picture, AV_FRAME_DATA_A53_CC);
+            ost->sync_opts++;
+            ost->frame_number++;
+            continue;
+        }
+#endif
+
+        t = stage_start();
         ret = avcodec_send_frame(enc, in_picture);
         if (ret < 0)
             goto error;
@@ -1351,6 +1763,7 @@ static void do_video_out(OutputFile *of,
 
         while (1) {
             ret = avcodec_receive_packet(enc, &pkt);
+            stage_end(&ost->encode_time, t);
             update_benchmark("encode_video %d.%d", ost->file_index, ost->index);
             if (ret == AVERROR(EAGAIN))
                 break;
@@ -1383,6 +1796,7 @@ static void do_video_out(OutputFile *of,
             if (ost->logfile && enc->stats_out) {
                 fprintf(ost->logfile, "%s", enc->stats_out);
             }
+            t = stage_start();
         }
         ost->sync_opts++;
         /*
@@ -1393,7 +1807,7 @@ static void do_video_out(OutputFile *of,
         ost->frame_number++;
 
         if (vstats_filename && frame_size)
-            do_video_stats(ost, frame_size);
+            do_video_stats(ost, frame_size, ost->st->nb_frames);
     }
 
     if (!ost->last_frame)
@@ -1415,10 +1829,9 @@ static double psnr(double d)
     return -10.0 * log10(d);
 }
 
-static void do_video_stats(OutputStream *ost, int frame_size)
+static void do_video_stats(OutputStream *ost, int frame_size, int frame_number)
 {
     AVCodecContext *enc;
-    int frame_number;
     double ti1, bitrate, avg_bitrate;
 
     /* this is executed just the first time do_video_stats is called */
@@ -1432,7 +1845,6 @@ static void do_video_stats(OutputStream *ost, int frame_size)
 
     enc = ost->enc_ctx;
     if (enc->codec_type == AVMEDIA_TYPE_VIDEO) {
-        frame_number = ost->st->nb_frames;
         if (vstats_version <= 1) {
             fprintf(vstats_file, "frame= %5d q= %2.1f ", frame_number,
                     ost->quality / (float)FF_QP2LAMBDA);
@@ -1446,7 +1858,7 @@ static void do_video_stats(OutputStream *ost, int frame_size)
 
         fprintf(vstats_file,"f_size= %6d ", frame_size);
         /* compute pts value */
-        ti1 = av_stream_get_end_pts(ost->st) * av_q2d(ost->st->time_base);
+        ti1 = output_stream_end_pts(ost) * av_q2d(ost->st->time_base);
         if (ti1 < 0.01)
             ti1 = 0.01;
 
@@ -1480,6 +1892,7 @@ static void finish_output_stream(OutputStream *ost)
 static int reap_filters(int flush)
 {
     AVFrame *filtered_frame = NULL;
+    int64_t t;
     int i;
 
     /* Reap all buffers present in the buffer sinks */
@@ -1512,8 +1925,10 @@ static int reap_filters(int flush)
         filtered_frame = ost->filtered_frame;
 
         while (1) {
+            t = stage_start();
             ret = av_buffersink_get_frame_flags(filter, filtered_frame,
                                                AV_BUFFERSINK_FLAG_NO_REQUEST);
+            stage_end(&filter_time, t);
             if (ret < 0) {
                 if (ret != AVERROR(EAGAIN) && ret != AVERROR_EOF) {
                     av_log(NULL, AV_LOG_WARNING,
@@ -1554,6 +1969,12 @@ static int reap_filters(int flush)
         }
     }
 
+#if HAVE_THREADS
+    for (i = 0; i < nb_output_streams; i++)
+        if (output_streams[i]->enc_packet_queue)
+            mux_encoded_packets(output_streams[i], 0);
+#endif
+
     return 0;
 }
 
@@ -1678,7 +2099,6 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
 {
     AVBPrint buf, buf_script;
     OutputStream *ost;
-    AVFormatContext *oc;
     int64_t total_size;
     AVCodecContext *enc;
     int frame_number, vid, i;
@@ -1709,11 +2129,7 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
     t = (cur_time-timer_start) / 1000000.0;
 
 
-    oc = output_files[0]->ctx;
-
-    total_size = avio_size(oc->pb);
-    if (total_size <= 0) // FIXME improve avio_size() so it works with non seekable output too
-        total_size = avio_tell(oc->pb);
+    total_size = output_file_size(output_files[0]);
 
     vid = 0;
     av_bprint_init(&buf, 0, AV_BPRINT_SIZE_AUTOMATIC);
@@ -1784,8 +2200,8 @@ static void print_report(int is_last_report, int64_t timer_start, int64_t cur_ti
             vid = 1;
         }
         /* compute min output value */
-        if (av_stream_get_end_pts(ost->st) != AV_NOPTS_VALUE) {
-            pts = FFMAX(pts, av_rescale_q(av_stream_get_end_pts(ost->st),
+        if (output_stream_end_pts(ost) != AV_NOPTS_VALUE) {
+            pts = FFMAX(pts, av_rescale_q(output_stream_end_pts(ost),
                                           ost->st->time_base, AV_TIME_BASE_Q));
             if (copy_ts) {
                 if (copy_ts_first_pts == AV_NOPTS_VALUE && pts > 1)
@@ -1901,6 +2317,13 @@ static void flush_encoders(void)
 {
     int i, ret;
 
+#if HAVE_THREADS
+    /* let the encoding threads flush concurrently */
+    for (i = 0; i < nb_output_streams; i++)
+        if (output_streams[i]->enc_frame_queue)
+            enc_thread_send_frame(output_streams[i], NULL);
+#endif
+
     for (i = 0; i < nb_output_streams; i++) {
         OutputStream   *ost = output_streams[i];
         AVCodecContext *enc = ost->enc_ctx;
@@ -1944,9 +2367,25 @@ static void flush_encoders(void)
         if (enc->codec_type != AVMEDIA_TYPE_VIDEO && enc->codec_type != AVMEDIA_TYPE_AUDIO)
             continue;
 
+#if HAVE_THREADS
+        if (ost->enc_frame_queue) {
+            AVPacket pkt;
+
+            mux_encoded_packets(ost, 1);
+            free_encoder_thread(ost);
+
+            av_init_packet(&pkt);
+            pkt.data = NULL;
+            pkt.size = 0;
+            output_packet(of, &pkt, ost, 1);
+            continue;
+        }
+#endif
+
         for (;;) {
             const char *desc = NULL;
             AVPacket pkt;
+            int64_t t;
             int pkt_size;
 
             switch (enc->codec_type) {
@@ -1966,6 +2405,7 @@ static void flush_encoders(void)
 
             update_benchmark(NULL);
 
+            t = stage_start();
             while ((ret = avcodec_receive_packet(enc, &pkt)) == AVERROR(EAGAIN)) {
                 ret = avcodec_send_frame(enc, NULL);
                 if (ret < 0) {
@@ -1975,6 +2415,7 @@ static void flush_encoders(void)
                     exit_program(1);
                 }
             }
+            stage_end(&ost->encode_time, t);
 
             update_benchmark("flush_%s %d.%d", desc, ost->file_index, ost->index);
             if (ret < 0 && ret != AVERROR_EOF) {
@@ -1998,7 +2439,7 @@ static void flush_encoders(void)
             pkt_size = pkt.size;
             output_packet(of, &pkt, ost, 0);
             if (ost->enc_ctx->codec_type == AVMEDIA_TYPE_VIDEO && vstats_filename) {
-                do_video_stats(ost, pkt_size);
+                do_video_stats(ost, pkt_size, ost->st->nb_frames);
             }
         }
     }
@@ -2154,6 +2595,7 @@ static int ifilter_has_all_input_formats(FilterGraph *fg)
 static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
 {
     FilterGraph *fg = ifilter->graph;
+    int64_t t;
     int need_reinit, ret, i;
 
     /* determine if the parameters for this input changed */
@@ -2218,7 +2660,9 @@ static int ifilter_send_frame(InputFilter *ifilter, AVFrame *frame)
         }
     }
 
+    t = stage_start();
     ret = av_buffersrc_add_frame_flags(ifilter->filter, frame, AV_BUFFERSRC_FLAG_PUSH);
+    stage_end(&filter_time, t);
     if (ret < 0) {
         if (ret != AVERROR_EOF)
             av_log(NULL, AV_LOG_ERROR, "Error while filtering: %s\n", av_err2str(ret));
@@ -2235,7 +2679,9 @@ static int ifilter_send_eof(InputFilter *ifilter, int64_t pts)
     ifilter->eof = 1;
 
     if (ifilter->filter) {
+        int64_t t = stage_start();
         ret = av_buffersrc_close(ifilter->filter, pts, AV_BUFFERSRC_FLAG_PUSH);
+        stage_end(&filter_time, t);
         if (ret < 0)
             return ret;
     } else {
@@ -2257,6 +2703,7 @@ static int ifilter_send_eof(InputFilter *ifilter, int64_t pts)
 // (pkt==NULL means get more output, pkt->size==0 is a flush/drain packet)
 static int decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame, AVPacket *pkt)
 {
+    int64_t t = stage_start();
     int ret;
 
     *got_frame = 0;
@@ -2265,11 +2712,14 @@ static int decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame, AVPacke
         ret = avcodec_send_packet(avctx, pkt);
         // In particular, we don't expect AVERROR(EAGAIN), because we read all
         // decoded frames with avcodec_receive_frame() until done.
-        if (ret < 0 && ret != AVERROR_EOF)
+        if (ret < 0 && ret != AVERROR_EOF) {
+            stage_end(&decode_time, t);
             return ret;
+        }
     }
 
     ret = avcodec_receive_frame(avctx, frame);
+    stage_end(&decode_time, t);
     if (ret < 0 && ret != AVERROR(EAGAIN))
         return ret;
     if (ret >= 0)
@@ -2278,6 +2728,259 @@ static int decode(AVCodecContext *avctx, AVFrame *frame, int *got_frame, AVPacke
     return 0;
 }
 
+#if HAVE_THREADS
+/* number of packets the decoding thread is let ahead of the frames returned
+ * to the main thread; the frames of a packet are only returned once that
+ * many packets have been sent after it, whatever the progress of the thread,
+ * so that the order of the frames across the streams stays deterministic */
+#define DECODER_THREAD_DELAY 4
+
+/* the decoder parameters the main thread reads after decoding */
+typedef struct DecoderParams {
+    int width, height;
+    int coded_width, coded_height;
+    enum AVPixelFormat pix_fmt;
+    AVRational sample_aspect_ratio;
+    AVRational framerate;
+    int ticks_per_frame;
+    int has_b_frames;
+    int bits_per_raw_sample;
+    int profile, level;
+    enum AVFieldOrder field_order;
+    enum AVColorRange color_range;
+    enum AVColorPrimaries color_primaries;
+    enum AVColorTransferCharacteristic color_trc;
+    enum AVColorSpace colorspace;
+    enum AVChromaLocation chroma_sample_location;
+} DecoderParams;
+
+typedef struct DecoderMessage {
+    AVFrame *frame;         /* decoded frame, or NULL after the last frame of a packet */
+    int ret;                /* decoding result of the packet when frame is NULL */
+    DecoderParams params;   /* parameters of the decoder after this message */
+} DecoderMessage;
+
+static void decoder_params_get(DecoderParams *p, const AVCodecContext *avctx)
+{
+    p->width                  = avctx->width;
+    p->height                 = avctx->height;
+    p->coded_width            = avctx->coded_width;
+    p->coded_height           = avctx->coded_height;
+    p->pix_fmt                = avctx->pix_fmt;
+    p->sample_aspect_ratio    = avctx->sample_aspect_ratio;
+    p->framerate              = avctx->framerate;
+    p->ticks_per_frame        = avctx->ticks_per_frame;
+    p->has_b_frames           = avctx->has_b_frames;
+    p->bits_per_raw_sample    = avctx->bits_per_raw_sample;
+    p->profile                = avctx->profile;
+    p->level                  = avctx->level;
+    p->field_order            = avctx->field_order;
+    p->color_range            = avctx->color_range;
+    p->color_primaries        = avctx->color_primaries;
+    p->color_trc              = avctx->color_trc;
+    p->colorspace             = avctx->colorspace;
+    p->chroma_sample_location = avctx->chroma_sample_location;
+}
+
+static void decoder_params_set(AVCodecContext *avctx, const DecoderParams *p)
+{
+    avctx->width                  = p->width;
+    avctx->height                 = p->height;
+    avctx->coded_width            = p->coded_width;
+    avctx->coded_height           = p->coded_height;
+    avctx->pix_fmt                = p->pix_fmt;
+    avctx->sample_aspect_ratio    = p->sample_aspect_ratio;
+    avctx->framerate              = p->framerate;
+    avctx->ticks_per_frame        = p->ticks_per_frame;
+    avctx->has_b_frames           = p->has_b_frames;
+    avctx->bits_per_raw_sample    = p->bits_per_raw_sample;
+    avctx->profile                = p->profile;
+    avctx->level                  = p->level;
+    avctx->field_order            = p->field_order;
+    avctx->color_range            = p->color_range;
+    avctx->color_primaries        = p->color_primaries;
+    avctx->color_trc              = p->color_trc;
+    avctx->colorspace             = p->colorspace;
+    avctx->chroma_sample_location = p->chroma_sample_location;
+}
+
+static void *decoder_thread(void *arg)
+{
+    InputStream *ist = arg;
+    AVCodecContext *avctx = ist->dec_thread_ctx;
+    DecoderMessage msg = { 0 };
+    AVPacket *pkt;
+    int64_t t;
+    int ret;
+
+    while (av_thread_message_queue_recv(ist->dec_pkt_queue, &pkt, 0) >= 0) {
+        /* a NULL packet drains the decoder */
+        t   = stage_start();
+        ret = avcodec_send_packet(avctx, pkt);
+        av_packet_free(&pkt);
+        if (ret == AVERROR_EOF)
+            ret = 0;
+
+        while (ret >= 0) {
+            msg.frame = av_frame_alloc();
+            if (!msg.frame) {
+                ret = AVERROR(ENOMEM);
+                break;
+            }
+            ret = avcodec_receive_frame(avctx, msg.frame);
+            stage_end(&ist->decode_time, t);
+            if (ret < 0) {
+                av_frame_free(&msg.frame);
+                break;
+            }
+
+            decoder_params_get(&msg.params, avctx);
+            if (av_thread_message_queue_send(ist->dec_frame_queue, &msg, 0) < 0) {
+                av_frame_free(&msg.frame);
+                goto finish;
+            }
+            t = stage_start();
+        }
+
+        msg.ret = ret == AVERROR(EAGAIN) ? 0 : ret;
+        decoder_params_get(&msg.params, avctx);
+        if (av_thread_message_queue_send(ist->dec_frame_queue, &msg, 0) < 0)
+            break;
+    }
+
+finish:
+    av_thread_message_queue_set_err_recv(ist->dec_frame_queue, AVERROR_EOF);
+    return NULL;
+}
+
+/*
+ * Move the opened decoder of ist to its own thread; ist->dec_ctx is replaced
+ * by an unopened context mirroring the parameters of the decoder.
+ */
+static int init_decoder_thread(InputStream *ist)
+{
+    AVCodecContext *avctx;
+    DecoderParams params;
+    int ret;
+
+    avctx = avcodec_alloc_context3(ist->dec);
+    if (!avctx)
+        return AVERROR(ENOMEM);
+    avctx->opaque       = ist;
+    avctx->pkt_timebase = ist->dec_ctx->pkt_timebase;
+    avctx->debug        = ist->dec_ctx->debug;
+    decoder_params_get(&params, ist->dec_ctx);
+    decoder_params_set(avctx, &params);
+
+    ret = av_thread_message_queue_alloc(&ist->dec_pkt_queue, DECODER_THREAD_DELAY + 4,
+                                        sizeof(AVPacket *));
+    if (ret < 0)
+        goto fail;
+    ret = av_thread_message_queue_alloc(&ist->dec_frame_queue, 8, sizeof(DecoderMessage));
+    if (ret < 0)
+        goto fail;
+
+    ist->dec_thread_ctx = ist->dec_ctx;
+    ist->dec_ctx        = avctx;
+
+    if ((ret = pthread_create(&ist->dec_thread, NULL, decoder_thread, ist))) {
+        av_log(NULL, AV_LOG_ERROR, "pthread_create failed: %s. Try to increase `ulimit -v` or decrease `ulimit -s`.\n", strerror(ret));
+        ret = AVERROR(ret);
+        ist->dec_ctx        = ist->dec_thread_ctx;
+        ist->dec_thread_ctx = NULL;
+        goto fail;
+    }
+
+    return 0;
+fail:
+    av_thread_message_queue_free(&ist->dec_pkt_queue);
+    av_thread_message_queue_free(&ist->dec_frame_queue);
+    avcodec_free_context(&avctx);
+    return ret;
+}
+
+static void free_decoder_thread(InputStream *ist)
+{
+    DecoderMessage msg;
+    AVPacket *pkt;
+
+    if (!ist->dec_pkt_queue)
+        return;
+    av_thread_message_queue_set_err_recv(ist->dec_pkt_queue, AVERROR_EOF);
+    av_thread_message_queue_set_err_send(ist->dec_frame_queue, AVERROR_EOF);
+    pthread_join(ist->dec_thread, NULL);
+
+    while (av_thread_message_queue_recv(ist->dec_pkt_queue, &pkt, 0) >= 0)
+        av_packet_free(&pkt);
+    while (av_thread_message_queue_recv(ist->dec_frame_queue, &msg, 0) >= 0)
+        av_frame_free(&msg.frame);
+    av_thread_message_queue_free(&ist->dec_pkt_queue);
+    av_thread_message_queue_free(&ist->dec_frame_queue);
+    avcodec_free_context(&ist->dec_thread_ctx);
+}
+
+static void free_decoder_threads(void)
+{
+    int i;
+
+    for (i = 0; i < nb_input_streams; i++)
+        if (input_streams[i])
+            free_decoder_thread(input_streams[i]);
+}
+
+/*
+ * Same as decode(), with the decoding done by the thread of ist.
+ */
+static int decoder_thread_decode(InputStream *ist, AVFrame *frame, int *got_frame, AVPacket *pkt)
+{
+    DecoderMessage msg;
+    int64_t last;
+    int ret;
+
+    *got_frame = 0;
+
+    if (pkt && !ist->dec_draining) {
+        AVPacket *p = NULL;
+
+        if (!pkt->size)
+            ist->dec_draining = 1;
+        else if (!(p = av_packet_clone(pkt)))
+            return AVERROR(ENOMEM);
+        ret = av_thread_message_queue_send(ist->dec_pkt_queue, &p, 0);
+        if (ret < 0) {
+            av_packet_free(&p);
+            return ret;
+        }
+        ist->dec_pkts_sent++;
+    }
+
+    /* the last packet the frames of which may be returned */
+    last = ist->dec_draining ? INT64_MAX : ist->dec_pkts_sent - 1 - DECODER_THREAD_DELAY;
+
+    while (!ist->dec_eof && ist->dec_pkts_done <= last) {
+        ret = av_thread_message_queue_recv(ist->dec_frame_queue, &msg, 0);
+        if (ret < 0)
+            return ret;
+
+        decoder_params_set(ist->dec_ctx, &msg.params);
+        if (msg.frame) {
+            av_frame_move_ref(frame, msg.frame);
+            av_frame_free(&msg.frame);
+            *got_frame = 1;
+            return 0;
+        }
+
+        ist->dec_pkts_done++;
+        if (msg.ret == AVERROR_EOF)
+            ist->dec_eof = 1;
+        else if (msg.ret < 0)
+            return msg.ret;
+    }
+
+    return ist->dec_eof ? AVERROR_EOF : 0;
+}
+#endif
+
 static int send_frame_to_filters(InputStream *ist, AVFrame *decoded_frame)
 {
     int i, ret;
@@ -2404,6 +3107,11 @@ static int decode_video(InputStream *ist, AVPacket *pkt, int *got_output, int64_
     }
 
     update_benchmark(NULL);
+#if HAVE_THREADS
+    if (ist->dec_thread_ctx)
+        ret = decoder_thread_decode(ist, decoded_frame, got_output, pkt ? &avpkt : NULL);
+    else
+#endif
     ret = decode(ist->dec_ctx, decoded_frame, got_output, pkt ? &avpkt : NULL);
     update_benchmark("decode_video %d.%d", ist->file_index, ist->st->index);
     if (ret < 0)
@@ -2974,6 +3682,19 @@ static int init_input_stream(int ist_index, char *error, int error_len)
             return ret;
         }
         assert_avoptions(ist->decoder_opts);
+
+#if HAVE_THREADS
+        if (do_pipeline && ist->dec_ctx->codec_type == AVMEDIA_TYPE_VIDEO &&
+            ist->hwaccel_id == HWACCEL_NONE && !ist->dec_ctx->hw_device_ctx &&
+            !input_files[ist->file_index]->loop &&
+            (ret = init_decoder_thread(ist)) < 0) {
+            snprintf(error, error_len,
+                     "Error while starting the decoding thread for input stream "
+                     "#%d:%d : %s",
+                     ist->file_index, ist->st->index, av_err2str(ret));
+            return ret;
+        }
+#endif
     }
 
     ist->next_pts = AV_NOPTS_VALUE;
@@ -3024,6 +3745,15 @@ static int check_init_output_file(OutputFile *of, int file_index)
     if (sdp_filename || want_sdp)
         print_sdp();
 
+#if HAVE_THREADS
+    if (do_pipeline && (ret = init_mux_thread(of)) < 0) {
+        av_log(NULL, AV_LOG_ERROR,
+               "Could not start the muxing thread for output file #%d: %s\n",
+               file_index, av_err2str(ret));
+        return ret;
+    }
+#endif
+
     /* flush the muxing queues */
     for (i = 0; i < of->ctx->nb_streams; i++) {
         OutputStream *ost = output_streams[of->ost_index + i];
@@ -3880,7 +4610,7 @@ static int need_output(void)
         AVFormatContext *os  = output_files[ost->file_index]->ctx;
 
         if (ost->finished ||
-            (os->pb && avio_tell(os->pb) >= of->limit_filesize))
+            (os->pb && output_file_tell(of) >= of->limit_filesize))
             continue;
         if (ost->frame_number >= ost->max_frames) {
             int j;
@@ -4065,7 +4795,9 @@ static void *input_thread(void *arg)
 
     while (1) {
         AVPacket pkt;
+        int64_t t = stage_start();
         ret = av_read_frame(f->ctx, &pkt);
+        stage_end(&f->demux_time, t);
 
         if (ret == AVERROR(EAGAIN)) {
             av_usleep(10000);
@@ -4128,7 +4860,7 @@ static int init_input_thread(int i)
     InputFile *f = input_files[i];
 
     if (f->thread_queue_size < 0)
-        f->thread_queue_size = (nb_input_files > 1 ? 8 : 0);
+        f->thread_queue_size = (nb_input_files > 1 || do_pipeline ? 8 : 0);
     if (!f->thread_queue_size)
         return 0;
 
@@ -4171,6 +4903,9 @@ static int get_input_packet_mt(InputFile *f, AVPacket *pkt)
 
 static int get_input_packet(InputFile *f, AVPacket *pkt)
 {
+    int64_t t;
+    int ret;
+
     if (f->rate_emu) {
         int i;
         for (i = 0; i < f->nb_streams; i++) {
@@ -4186,7 +4921,10 @@ static int get_input_packet(InputFile *f, AVPacket *pkt)
     if (f->thread_queue_size)
         return get_input_packet_mt(f, pkt);
 #endif
-    return av_read_frame(f->ctx, pkt);
+    t   = stage_start();
+    ret = av_read_frame(f->ctx, pkt);
+    stage_end(&f->demux_time, t);
+    return ret;
 }
 
 static int got_eagain(void)
@@ -4583,13 +5321,16 @@ discard_packet:
  */
 static int transcode_from_filter(FilterGraph *graph, InputStream **best_ist)
 {
+    int64_t t;
     int i, ret;
     int nb_requests, nb_requests_max = 0;
     InputFilter *ifilter;
     InputStream *ist;
 
     *best_ist = NULL;
+    t = stage_start();
     ret = avfilter_graph_request_oldest(graph->graph);
+    stage_end(&filter_time, t);
     if (ret >= 0)
         return reap_filters(0);
 
@@ -4782,6 +5523,9 @@ static int transcode(void)
     /* write the trailer if needed and close file */
     for (i = 0; i < nb_output_files; i++) {
         os = output_files[i]->ctx;
+#if HAVE_THREADS
+        free_mux_thread(output_files[i]);
+#endif
         if (!output_files[i]->header_written) {
             av_log(NULL, AV_LOG_ERROR,
                    "Nothing was written into output file %d (%s), because "
@@ -4821,6 +5565,9 @@ static int transcode(void)
     for (i = 0; i < nb_input_streams; i++) {
         ist = input_streams[i];
         if (ist->decoding_needed) {
+#if HAVE_THREADS
+            free_decoder_thread(ist);
+#endif
             avcodec_close(ist->dec_ctx);
             if (ist->hwaccel_uninit)
                 ist->hwaccel_uninit(ist->dec_ctx);
@@ -4861,6 +5608,32 @@ static int transcode(void)
     return ret;
 }
 
+static void print_stage_times(void)
+{
+    int64_t demux_time = 0, encode_time = 0, mux_time = 0;
+    int64_t dec_time = decode_time;
+    int i;
+
+    for (i = 0; i < nb_input_files; i++)
+        demux_time += input_files[i]->demux_time;
+    for (i = 0; i < nb_input_streams; i++)
+        dec_time += input_streams[i]->decode_time;
+    for (i = 0; i < nb_output_streams; i++) {
+        OutputStream *ost = output_streams[i];
+        if (!ost->encoding_needed)
+            continue;
+        encode_time += ost->encode_time;
+        av_log(NULL, AV_LOG_VERBOSE, "bench: encode %d:%d=%0.3fs\n",
+               ost->file_index, ost->index, ost->encode_time / 1000000.0);
+    }
+    for (i = 0; i < nb_output_files; i++)
+        mux_time += output_files[i]->mux_time;
+    av_log(NULL, AV_LOG_INFO,
+           "bench: demux=%0.3fs decode=%0.3fs filter=%0.3fs encode=%0.3fs mux=%0.3fs\n",
+           demux_time / 1000000.0, dec_time / 1000000.0, filter_time / 1000000.0,
+           encode_time / 1000000.0, mux_time / 1000000.0);
+}
+
 static BenchmarkTimeStamps get_benchmark_time_stamps(void)
 {
     BenchmarkTimeStamps time_stamps = { av_gettime_relative() };
@@ -4971,6 +5744,7 @@ int main(int argc, char **argv)
         av_log(NULL, AV_LOG_INFO,
                "bench: utime=%0.3fs stime=%0.3fs rtime=%0.3fs\n",
                utime / 1000000.0, stime / 1000000.0, rtime / 1000000.0);
+        print_stage_times();
     }
     av_log(NULL, AV_LOG_DEBUG, "%"PRIu64" frames successfully decoded, %"PRIu64" decoding errors\n",
            decode_error_stat[0], decode_error_stat[1]);
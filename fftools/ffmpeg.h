@@ -21,6 +21,7 @@
 
 #include "config.h"
 
+#include <stdatomic.h>
 #include <stdint.h>
 #include <stdio.h>
 #include <signal.h>
@@ -392,6 +393,22 @@ typedef struct InputStream {
     int nb_dts_buffer;
 
     int got_output;
+
+    /* time spent in the decoding thread, for -benchmark */
+    int64_t decode_time;
+
+#if HAVE_THREADS
+    /* -pipeline: packets sent to the decoding thread and frames sent back;
+     * dec_ctx then only mirrors the parameters of dec_thread_ctx */
+    AVCodecContext *dec_thread_ctx;
+    AVThreadMessageQueue *dec_pkt_queue;
+    AVThreadMessageQueue *dec_frame_queue;
+    pthread_t dec_thread;
+    int64_t dec_pkts_sent;      /* packets sent to the thread */
+    int64_t dec_pkts_done;      /* packets all the frames of which were returned */
+    int dec_draining;           /* the thread has been asked to drain the decoder */
+    int dec_eof;                /* the decoder has been drained */
+#endif
 } InputStream;
 
 typedef struct InputFile {
@@ -416,6 +433,8 @@ typedef struct InputFile {
     int rate_emu;
     int accurate_seek;
 
+    int64_t demux_time;   /* time spent reading packets, for -benchmark */
+
 #if HAVE_THREADS
     AVThreadMessageQueue *in_thread_queue;
     pthread_t thread;           /* thread reading from this file */
@@ -563,6 +582,24 @@ typedef struct OutputStream {
 
     /* frame encode sum of squared error values */
     int64_t error[4];
+
+    /* time spent in the encoder, for -benchmark */
+    int64_t encode_time;
+
+#if HAVE_THREADS
+    /* -pipeline: frames sent to the encoding thread and packets sent back */
+    AVThreadMessageQueue *enc_frame_queue;
+    AVThreadMessageQueue *enc_packet_queue;
+    pthread_t enc_thread;
+    /* signalled by the encoding thread whenever it takes a frame or
+     * returns a packet; enc_events counts those */
+    pthread_mutex_t enc_lock;
+    pthread_cond_t enc_cond;
+    unsigned enc_events;
+
+    /* end pts of the stream, as updated by the muxing thread */
+    atomic_int_least64_t mux_end_pts;
+#endif
 } OutputStream;
 
 typedef struct OutputFile {
@@ -576,6 +613,16 @@ typedef struct OutputFile {
     int shortest;
 
     int header_written;
+
+    /* time spent in the muxer, for -benchmark */
+    int64_t mux_time;
+
+#if HAVE_THREADS
+    /* -pipeline: packets sent to the muxing thread */
+    AVThreadMessageQueue *mux_queue;
+    pthread_t mux_thread;
+    atomic_int_least64_t mux_size;  /* bytes written so far */
+#endif
 } OutputFile;
 
 extern InputStream **input_streams;
@@ -604,6 +651,7 @@ extern int video_sync_method;
 extern float frame_drop_threshold;
 extern int do_benchmark;
 extern int do_benchmark_all;
+extern int do_pipeline;
 extern int do_deinterlace;
 extern int do_hex_dump;
 extern int do_pkt_dump;
@@ -626,6 +674,7 @@ extern int filter_nbthreads;
 extern int filter_complex_nbthreads;
 extern int vstats_version;
 extern int auto_conversion_filters;
+extern int filter_profile;
 
 extern const AVIOInterruptCB int_cb;
 
@@ -661,6 +710,7 @@ int ist_in_filtergraph(FilterGraph *fg, InputStream *ist);
 int filtergraph_is_simple(FilterGraph *fg);
 int init_simple_filtergraph(InputStream *ist, OutputStream *ost);
 int init_complex_filtergraph(FilterGraph *fg);
+void print_filter_profile(FilterGraph *fg);
 
 void sub2video_update(InputStream *ist, int64_t heartbeat_pts, AVSubtitle *sub);
 
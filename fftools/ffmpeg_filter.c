@@ -999,6 +999,51 @@ static int configure_input_filter(FilterGraph *fg, InputFilter *ifilter,
     }
 }
 
+void print_filter_profile(FilterGraph *fg)
+{
+    AVFilterGraph *graph = fg->graph;
+    int64_t total = 0;
+    unsigned i, j;
+
+    if (!filter_profile || !graph || !graph->nb_filters)
+        return;
+
+    for (i = 0; i < graph->nb_filters; i++)
+        total += avfilter_get_profile(graph->filters[i])->wall_time;
+
+    av_log(NULL, AV_LOG_INFO, "Filter profile of filtergraph #%d:\n", fg->index);
+    av_log(NULL, AV_LOG_INFO, "  %-32s %11s %8s %8s %10s %10s %6s\n",
+           "filter", "activations", "in", "out", "wall ms", "cpu ms", "wall");
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+        const AVFilterProfile *p = avfilter_get_profile(filter);
+
+        av_log(NULL, AV_LOG_INFO, "  %-32s %11"PRId64" %8"PRId64" %8"PRId64" %10.1f %10.1f %5.1f%%\n",
+               filter->name, p->nb_activations, p->frames_in, p->frames_out,
+               p->wall_time / 1000.0, p->cpu_time / 1000.0,
+               total ? 100.0 * p->wall_time / total : 0.0);
+    }
+
+    av_log(NULL, AV_LOG_INFO, "  links:\n");
+    for (i = 0; i < graph->nb_filters; i++) {
+        AVFilterContext *filter = graph->filters[i];
+        for (j = 0; j < filter->nb_outputs; j++) {
+            AVFilterLink *link = filter->outputs[j];
+            const AVFilterLinkProfile *lp;
+
+            if (!link)
+                continue;
+            lp = avfilter_link_get_profile(link);
+            av_log(NULL, AV_LOG_INFO, "  %s:%s -> %s:%s: frames %"PRId64", "
+                   "queued mean %.2f max %d\n",
+                   link->src->name, avfilter_pad_get_name(link->srcpad, 0),
+                   link->dst->name, avfilter_pad_get_name(link->dstpad, 0),
+                   lp->nb_frames, lp->nb_frames ? (double)lp->queued_sum / lp->nb_frames : 0.0,
+                   lp->max_queued);
+        }
+    }
+}
+
 static void cleanup_filtergraph(FilterGraph *fg)
 {
     int i;
@@ -1006,6 +1051,7 @@ static void cleanup_filtergraph(FilterGraph *fg)
         fg->outputs[i]->filter = (AVFilterContext *)NULL;
     for (i = 0; i < fg->nb_inputs; i++)
         fg->inputs[i]->filter = (AVFilterContext *)NULL;
+    print_filter_profile(fg);
     avfilter_graph_free(&fg->graph);
 }
 
@@ -1060,6 +1106,8 @@ int configure_filtergraph(FilterGraph *fg)
         fg->graph->nb_threads = filter_complex_nbthreads;
     }
 
+    fg->graph->profile = filter_profile;
+
     if ((ret = avfilter_graph_parse2(fg->graph, graph_desc, &inputs, &outputs)) < 0)
         goto fail;
 
@@ -404,6 +404,10 @@ typedef struct AACEncContext {
     float lambda_sum;                            ///< sum(lambda), for Qvg reporting
     int lambda_count;                            ///< count(lambda), for Qvg reporting
     enum RawDataBlockType cur_type;              ///< channel group type cur_channel belongs to
+    int elem_start_ch[MAX_ELEM_ID];              ///< first channel of each channel element
+    uint8_t ch_elem[MAX_CHANNELS];               ///< channel element each channel belongs to
+    struct AACEncContext *slice_ctx;             ///< per-thread coder contexts for slice threading
+    int nb_slice_ctx;                            ///< number of allocated slice contexts
 
     AudioFrameQueue afq;
     DECLARE_ALIGNED(16, int,   qcoefs)[96];      ///< quantized coefficients
@@ -126,6 +126,15 @@ typedef struct FlacEncodeContext {
 
     int flushed;
     int64_t next_pts;
+
+    struct FlacEncodeContext *slice_ctx; ///< per-frame contexts of a batch encoded in parallel
+    int nb_slice_ctx;
+    int nb_queued;                       ///< frames waiting in slice_ctx for the next batch
+    int nb_encoded;                      ///< number of packets in the current batch
+    int next_out;                        ///< next packet of the current batch to return
+    AVFrame *slice_frame;                ///< input frame of a batch slot
+    AVPacket *slice_pkt;                 ///< output packet of a batch slot
+    int slice_ret;                       ///< encoding result of a batch slot
 } FlacEncodeContext;
 
 
@@ -236,6 +245,43 @@ static av_cold void dprint_compression_options(FlacEncodeContext *s)
 }
 
 
+/**
+ * Allocate one context per thread when slice threading is active. Frames
+ * are then encoded in batches of one frame per context.
+ */
+static av_cold int alloc_slice_contexts(AVCodecContext *avctx, FlacEncodeContext *s)
+{
+    int i, ret;
+
+    if (!(avctx->active_thread_type & FF_THREAD_SLICE) || avctx->thread_count < 2)
+        return 0;
+
+    s->slice_ctx = av_mallocz_array(avctx->thread_count, sizeof(*s->slice_ctx));
+    if (!s->slice_ctx)
+        return AVERROR(ENOMEM);
+    for (i = 0; i < avctx->thread_count; i++) {
+        FlacEncodeContext *sc = &s->slice_ctx[i];
+
+        memcpy(sc, s, sizeof(*sc));
+        sc->md5ctx          = NULL;
+        sc->md5_buffer      = NULL;
+        sc->md5_buffer_size = 0;
+        sc->slice_ctx       = NULL;
+        sc->nb_slice_ctx    = 0;
+        s->nb_slice_ctx     = i + 1;
+        ret = ff_lpc_init(&sc->lpc_ctx, avctx->frame_size,
+                          s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+        if (ret < 0)
+            return ret;
+        sc->slice_frame = av_frame_alloc();
+        sc->slice_pkt   = av_packet_alloc();
+        if (!sc->slice_frame || !sc->slice_pkt)
+            return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+
+
 static av_cold int flac_encode_init(AVCodecContext *avctx)
 {
     int freq = avctx->sample_rate;
@@ -456,6 +502,8 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
     ret = ff_lpc_init(&s->lpc_ctx, avctx->frame_size,
                       s->options.max_prediction_order, FF_LPC_TYPE_LEVINSON);
+    if (ret < 0)
+        return ret;
 
     ff_bswapdsp_init(&s->bdsp);
     ff_flacdsp_init(&s->flac_dsp, avctx->sample_fmt, channels,
@@ -463,7 +511,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
 
     dprint_compression_options(s);
 
-    return ret;
+    return alloc_slice_contexts(avctx, s);
 }
 
 
@@ -1356,6 +1404,120 @@ static int update_md5_sum(FlacEncodeContext *s, const void *samples)
 }
 
 
+/**
+ * Encode the samples of a frame into s->frame.
+ * @return the size of the coded frame in bytes
+ */
+static int encode_block(FlacEncodeContext *s, const AVFrame *frame)
+{
+    int frame_bytes;
+
+    init_frame(s, frame->nb_samples);
+
+    copy_samples(s, frame->data[0]);
+
+    channel_decorrelation(s);
+
+    remove_wasted_bits(s);
+
+    frame_bytes = encode_frame(s);
+
+    /* Fall back on verbatim mode if the compressed frame is larger than it
+       would be if encoded uncompressed. */
+    if (frame_bytes < 0 || frame_bytes > s->max_framesize) {
+        s->frame.verbatim_only = 1;
+        frame_bytes = encode_frame(s);
+        if (frame_bytes < 0) {
+            av_log(s->avctx, AV_LOG_ERROR, "Bad frame count\n");
+            return frame_bytes;
+        }
+    }
+    return frame_bytes;
+}
+
+
+static int encode_batch_frame(AVCodecContext *avctx, void *arg,
+                              int jobnr, int threadnr)
+{
+    FlacEncodeContext *s  = avctx->priv_data;
+    FlacEncodeContext *sc = &s->slice_ctx[jobnr];
+    AVFrame *frame = sc->slice_frame;
+    int ret;
+
+    ret = encode_block(sc, frame);
+    if (ret >= 0 && (ret = av_new_packet(sc->slice_pkt, ret)) >= 0) {
+        av_shrink_packet(sc->slice_pkt, write_frame(sc, sc->slice_pkt));
+        sc->slice_pkt->pts      = frame->pts;
+        sc->slice_pkt->duration = ff_samples_to_time_base(avctx, frame->nb_samples);
+    }
+    av_frame_unref(frame);
+    sc->slice_ret = ret;
+    return ret;
+}
+
+
+/**
+ * Queue a frame for the next batch and return the next packet of the
+ * current one. A batch is encoded in parallel once it holds a frame for
+ * every context, or when flushing. The frame number, the frame size
+ * limit and the MD5 sum depend on the previous frames and are updated
+ * in input order, so the bitstream does not depend on the thread count.
+ */
+static int flac_encode_frame_batch(AVCodecContext *avctx, AVPacket *avpkt,
+                                   const AVFrame *frame, int *got_packet_ptr)
+{
+    FlacEncodeContext *s = avctx->priv_data;
+    FlacEncodeContext *sc;
+    int ret;
+
+    if (frame) {
+        sc = &s->slice_ctx[s->nb_queued];
+
+        /* change max_framesize for small final frame */
+        if (frame->nb_samples < s->frame.blocksize) {
+            s->max_framesize = ff_flac_get_max_frame_size(frame->nb_samples,
+                                                          s->channels,
+                                                          avctx->bits_per_raw_sample);
+        }
+        init_frame(s, frame->nb_samples);
+        if ((ret = update_md5_sum(s, frame->data[0])) < 0) {
+            av_log(avctx, AV_LOG_ERROR, "Error updating MD5 checksum\n");
+            return ret;
+        }
+        if ((ret = av_frame_ref(sc->slice_frame, frame)) < 0)
+            return ret;
+        sc->frame_count   = s->frame_count++;
+        sc->max_framesize = s->max_framesize;
+        s->sample_count  += frame->nb_samples;
+        s->nb_queued++;
+    }
+
+    if (s->next_out == s->nb_encoded &&
+        (s->nb_queued == s->nb_slice_ctx || (!frame && s->nb_queued))) {
+        avctx->execute2(avctx, encode_batch_frame, NULL, NULL, s->nb_queued);
+        s->nb_encoded = s->nb_queued;
+        s->nb_queued  = 0;
+        s->next_out   = 0;
+    }
+    if (s->next_out == s->nb_encoded)
+        return 0;
+
+    sc = &s->slice_ctx[s->next_out++];
+    if (sc->slice_ret < 0)
+        return sc->slice_ret;
+    av_packet_move_ref(avpkt, sc->slice_pkt);
+    if (avpkt->size > s->max_encoded_framesize)
+        s->max_encoded_framesize = avpkt->size;
+    if (avpkt->size < s->min_framesize)
+        s->min_framesize = avpkt->size;
+
+    s->next_pts = avpkt->pts + avpkt->duration;
+
+    *got_packet_ptr = 1;
+    return 0;
+}
+
+
 static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
                              const AVFrame *frame, int *got_packet_ptr)
 {
@@ -1364,6 +1526,10 @@ static int flac_encode_frame(AVCodecContext *avctx, AVPacket *avpkt,
 
     s = avctx->priv_data;
 
+    if (s->nb_slice_ctx &&
+        (frame || s->nb_queued || s->next_out < s->nb_encoded))
+        return flac_encode_frame_batch(avctx, avpkt, frame, got_packet_ptr);
+
     /* when the last block is reached, update the header in extradata */
     if (!frame) {
         s->max_framesize = s->max_encoded_framesize;
@@ -1399,26 +1565,9 @@ FF_ENABLE_DEPRECATION_WARNINGS
                                                       avctx->bits_per_raw_sample);
     }
 
-    init_frame(s, frame->nb_samples);
-
-    copy_samples(s, frame->data[0]);
-
-    channel_decorrelation(s);
-
-    remove_wasted_bits(s);
-
-    frame_bytes = encode_frame(s);
-
-    /* Fall back on verbatim mode if the compressed frame is larger than it
-       would be if encoded uncompressed. */
-    if (frame_bytes < 0 || frame_bytes > s->max_framesize) {
-        s->frame.verbatim_only = 1;
-        frame_bytes = encode_frame(s);
-        if (frame_bytes < 0) {
-            av_log(avctx, AV_LOG_ERROR, "Bad frame count\n");
-            return frame_bytes;
-        }
-    }
+    frame_bytes = encode_block(s, frame);
+    if (frame_bytes < 0)
+        return frame_bytes;
 
     if ((ret = ff_alloc_packet2(avctx, avpkt, frame_bytes, 0)) < 0)
         return ret;
@@ -1451,6 +1600,15 @@ static av_cold int flac_encode_close(AVCodecContext *avctx)
 {
     if (avctx->priv_data) {
         FlacEncodeContext *s = avctx->priv_data;
+        int i;
+
+        for (i = 0; i < s->nb_slice_ctx; i++) {
+            FlacEncodeContext *sc = &s->slice_ctx[i];
+            ff_lpc_end(&sc->lpc_ctx);
+            av_frame_free(&sc->slice_frame);
+            av_packet_free(&sc->slice_pkt);
+        }
+        av_freep(&s->slice_ctx);
         av_freep(&s->md5ctx);
         av_freep(&s->md5_buffer);
         ff_lpc_end(&s->lpc_ctx);
@@ -1508,9 +1666,11 @@ AVCodec ff_flac_encoder = {
     .init           = flac_encode_init,
     .encode2        = flac_encode_frame,
     .close          = flac_encode_close,
-    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY,
+    .capabilities   = AV_CODEC_CAP_SMALL_LAST_FRAME | AV_CODEC_CAP_DELAY |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .sample_fmts    = (const enum AVSampleFormat[]){ AV_SAMPLE_FMT_S16,
                                                      AV_SAMPLE_FMT_S32,
                                                      AV_SAMPLE_FMT_NONE },
     .priv_class     = &flac_encoder_class,
+    .caps_internal  = FF_CODEC_CAP_INIT_CLEANUP,
 };
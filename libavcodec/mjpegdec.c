@@ -46,6 +46,7 @@
 #include "jpeglsdec.h"
 #include "profiles.h"
 #include "put_bits.h"
+#include "thread.h"
 #include "tiff.h"
 #include "exif.h"
 #include "bytestream.h"
@@ -328,6 +329,7 @@ int ff_mjpeg_decode_dht(MJpegDecodeContext *s)
 
 int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
 {
+    ThreadFrame frame = { .f = s->picture_ptr };
     int len, nb_components, i, width, height, bits, ret, size_change;
     unsigned pix_fmt_id;
     int h_count[MAX_COMPONENTS] = { 0 };
@@ -734,7 +736,7 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
                 s->avctx->pix_fmt,
                 AV_PIX_FMT_NONE,
             };
-            s->hwaccel_pix_fmt = ff_get_format(s->avctx, pix_fmts);
+            s->hwaccel_pix_fmt = ff_thread_get_format(s->avctx, pix_fmts);
             if (s->hwaccel_pix_fmt < 0)
                 return AVERROR(EINVAL);
 
@@ -750,7 +752,7 @@ int ff_mjpeg_decode_sof(MJpegDecodeContext *s)
         }
 
         av_frame_unref(s->picture_ptr);
-        if (ff_get_buffer(s->avctx, s->picture_ptr, AV_GET_BUFFER_FLAG_REF) < 0)
+        if (ff_thread_get_buffer(s->avctx, &frame, AV_GET_BUFFER_FLAG_REF) < 0)
             return -1;
         s->picture_ptr->pict_type = AV_PICTURE_TYPE_I;
         s->picture_ptr->key_frame = 1;
@@ -1440,6 +1442,157 @@ static void shift_output(MJpegDecodeContext *s, uint8_t *ptr, int linesize)
     }
 }
 
+typedef struct MJpegScanSlices {
+    MJpegDecodeContext *s;
+    int nb_components;
+    uint8_t *data[MAX_COMPONENTS];
+    int linesize[MAX_COMPONENTS];
+    int chroma_width, chroma_height;
+    int start;          ///< byte offset of the entropy coded data in s->gb
+    int nb_intervals;
+    int nb_jobs;
+    int end_bits;       ///< bit position in s->gb after the last interval
+} MJpegScanSlices;
+
+static int decode_mcu_sequential(MJpegDecodeContext *s, const MJpegScanSlices *sl,
+                                 int mb_x, int mb_y)
+{
+    int bytes_per_pixel = 1 + (s->bits > 8);
+    int i, j;
+
+    for (i = 0; i < sl->nb_components; i++) {
+        int n = s->nb_blocks[i];
+        int c = s->comp_index[i];
+        int h = s->h_scount[i];
+        int v = s->v_scount[i];
+        int x = 0, y = 0;
+
+        for (j = 0; j < n; j++) {
+            int block_offset = (((sl->linesize[c] * (v * mb_y + y) * 8) +
+                                 (h * mb_x + x) * 8 * bytes_per_pixel) >> s->avctx->lowres);
+
+            s->bdsp.clear_block(s->block);
+            if (decode_block(s, s->block, i,
+                             s->dc_index[i], s->ac_index[i],
+                             s->quant_matrixes[s->quant_sindex[i]]) < 0) {
+                av_log(s->avctx, AV_LOG_ERROR, "error y=%d x=%d\n", mb_y, mb_x);
+                return AVERROR_INVALIDDATA;
+            }
+            if (   8*(h * mb_x + x) < ((c == 1) || (c == 2) ? sl->chroma_width  : s->width)
+                && 8*(v * mb_y + y) < ((c == 1) || (c == 2) ? sl->chroma_height : s->height)) {
+                uint8_t *ptr = sl->data[c] + block_offset;
+                s->idsp.idct_put(ptr, sl->linesize[c], s->block);
+                if (s->bits & 7)
+                    shift_output(s, ptr, sl->linesize[c]);
+            }
+            if (++x == h) {
+                x = 0;
+                y++;
+            }
+        }
+    }
+    return 0;
+}
+
+static int decode_scan_slice(AVCodecContext *avctx, void *arg,
+                             int jobnr, int threadnr)
+{
+    MJpegScanSlices *sl = arg;
+    const MJpegDecodeContext *s = sl->s;
+    MJpegDecodeContext *sc = &s->slice_ctx[threadnr];
+    const uint8_t *buf = s->gb.buffer;
+    int nb_mbs = s->mb_width * s->mb_height;
+    int first  = (int64_t)sl->nb_intervals *  jobnr      / sl->nb_jobs;
+    int last   = (int64_t)sl->nb_intervals * (jobnr + 1) / sl->nb_jobs;
+    int i, n, ret = 0;
+
+    memcpy(sc, s, sizeof(*sc));
+
+    for (i = first; i < last && !ret; i++) {
+        int start  = i ? s->rst_pos[i - 1] + 2 : sl->start;
+        int end    = i < s->nb_rst ? s->rst_pos[i] : s->gb.buffer_end - buf;
+        int mb_end = FFMIN((i + 1) * s->restart_interval, nb_mbs);
+
+        if ((ret = init_get_bits8(&sc->gb, buf + start, end - start)) < 0)
+            break;
+        for (n = 0; n < sl->nb_components; n++)
+            sc->last_dc[n] = (4 << s->bits);
+
+        for (n = i * s->restart_interval; n < mb_end; n++) {
+            if (get_bits_left(&sc->gb) < 0) {
+                av_log(avctx, AV_LOG_ERROR, "overread %d\n",
+                       -get_bits_left(&sc->gb));
+                ret = AVERROR_INVALIDDATA;
+                break;
+            }
+            if ((ret = decode_mcu_sequential(sc, sl, n % s->mb_width,
+                                             n / s->mb_width)) < 0)
+                break;
+        }
+        if (i == sl->nb_intervals - 1)
+            sl->end_bits = 8 * start + get_bits_count(&sc->gb);
+    }
+
+    emms_c();
+    return ret;
+}
+
+/**
+ * Decode a sequential scan with restart markers by splitting it into runs
+ * of restart intervals that are decoded in parallel.
+ * @return 0 or a negative error code, 1 if the scan cannot be split
+ */
+static int mjpeg_decode_scan_slices(MJpegDecodeContext *s, int nb_components,
+                                    uint8_t *data[MAX_COMPONENTS],
+                                    const int linesize[MAX_COMPONENTS],
+                                    int chroma_width, int chroma_height)
+{
+    AVCodecContext *avctx = s->avctx;
+    MJpegScanSlices sl = { .s = s, .nb_components = nb_components,
+                           .chroma_width = chroma_width,
+                           .chroma_height = chroma_height };
+    int nb_mbs = s->mb_width * s->mb_height;
+    int i, ret, *rets;
+
+    if (!s->restart_interval || s->nb_rst <= 0 || s->interlaced ||
+        !(avctx->active_thread_type & FF_THREAD_SLICE) || avctx->thread_count <= 1)
+        return 1;
+
+    sl.start        = get_bits_count(&s->gb) >> 3;
+    sl.nb_intervals = (nb_mbs + s->restart_interval - 1) / s->restart_interval;
+    sl.nb_jobs      = FFMIN(sl.nb_intervals, 4 * avctx->thread_count);
+    /* every interval but the last must be terminated by a marker */
+    if (sl.nb_intervals < 2 || s->nb_rst < sl.nb_intervals - 1 ||
+        s->rst_pos[0] < sl.start || get_bits_count(&s->gb) & 7)
+        return 1;
+
+    if (!s->slice_ctx) {
+        s->slice_ctx = av_malloc_array(avctx->thread_count, sizeof(*s->slice_ctx));
+        if (!s->slice_ctx)
+            return AVERROR(ENOMEM);
+    }
+    rets = av_malloc_array(sl.nb_jobs, sizeof(*rets));
+    if (!rets)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < nb_components; i++) {
+        int c = s->comp_index[i];
+        sl.data[c]     = data[c];
+        sl.linesize[c] = linesize[c];
+    }
+    sl.end_bits = get_bits_count(&s->gb);
+
+    avctx->execute2(avctx, decode_scan_slice, &sl, rets, sl.nb_jobs);
+
+    ret = 0;
+    for (i = 0; i < sl.nb_jobs && !ret; i++)
+        ret = rets[i];
+    av_free(rets);
+
+    skip_bits_long(&s->gb, sl.end_bits - get_bits_count(&s->gb));
+    return ret;
+}
+
 static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
                              int Al, const uint8_t *mb_bitmask,
                              int mb_bitmask_size,
@@ -1475,6 +1628,13 @@ static int mjpeg_decode_scan(MJpegDecodeContext *s, int nb_components, int Ah,
         s->coefs_finished[c] |= 1;
     }
 
+    if (!mb_bitmask && !s->progressive && s->avctx->codec_id != AV_CODEC_ID_THP) {
+        int ret = mjpeg_decode_scan_slices(s, nb_components, data, linesize,
+                                           chroma_width, chroma_height);
+        if (ret <= 0)
+            return ret;
+    }
+
     for (mb_y = 0; mb_y < s->mb_height; mb_y++) {
         for (mb_x = 0; mb_x < s->mb_width; mb_x++) {
             const int copy_mb = mb_bitmask && !get_bits1(&mb_bitmask_gb);
@@ -2247,9 +2407,13 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
             }                                         \
         } while (0)
 
+        s->nb_rst          = 0;
+        s->scan_end_marker = -1;
+
         if (s->avctx->codec_id == AV_CODEC_ID_THP) {
             ptr = buf_end;
             copy_data_segment(0);
+            s->nb_rst = -1;
         } else {
             while (ptr < buf_end) {
                 uint8_t x = *(ptr++);
@@ -2273,8 +2437,21 @@ int ff_mjpeg_find_marker(MJpegDecodeContext *s,
 
                     if (x < RST0 || x > RST7) {
                         copy_data_segment(1);
-                        if (x)
+                        if (x) {
+                            s->scan_end_marker = x;
                             break;
+                        }
+                    } else if (s->nb_rst >= 0) {
+                        /* remember where the marker ends up in the unescaped
+                         * data, so that restart intervals can be decoded
+                         * independently */
+                        int *pos = av_fast_realloc(s->rst_pos, &s->rst_pos_size,
+                                                   (s->nb_rst + 1) * sizeof(*s->rst_pos));
+                        if (pos) {
+                            s->rst_pos = pos;
+                            s->rst_pos[s->nb_rst++] = (dst - s->buffer) + (ptr - src) - 2;
+                        } else
+                            s->nb_rst = -1;
                     }
                 }
             }
@@ -2414,7 +2591,8 @@ static int mjpeg_get_packet(AVCodecContext *avctx)
     return 0;
 }
 
-int ff_mjpeg_receive_frame(AVCodecContext *avctx, AVFrame *frame)
+static int mjpeg_decode_packet(AVCodecContext *avctx, AVFrame *frame,
+                               const AVPacket *pkt)
 {
     MJpegDecodeContext *s = avctx->priv_data;
     const uint8_t *buf_end, *buf_ptr;
@@ -2426,9 +2604,6 @@ int ff_mjpeg_receive_frame(AVCodecContext *avctx, AVFrame *frame)
     int ret = 0;
     int is16bit;
 
-    if (avctx->codec_id == AV_CODEC_ID_SMVJPEG && s->smv_next_frame > 0)
-        return smv_process_frame(avctx, frame);
-
     av_dict_free(&s->exif_metadata);
     av_freep(&s->stereo3d);
     s->adobe_transform = -1;
@@ -2436,12 +2611,8 @@ int ff_mjpeg_receive_frame(AVCodecContext *avctx, AVFrame *frame)
     if (s->iccnum != 0)
         reset_icc_profile(s);
 
-    ret = mjpeg_get_packet(avctx);
-    if (ret < 0)
-        return ret;
-
-    buf_ptr = s->pkt->data;
-    buf_end = s->pkt->data + s->pkt->size;
+    buf_ptr = pkt->data;
+    buf_end = pkt->data + pkt->size;
     while (buf_ptr < buf_end) {
         /* find start next marker */
         start_code = ff_mjpeg_find_marker(s, &buf_ptr, buf_end,
@@ -2453,7 +2624,7 @@ int ff_mjpeg_receive_frame(AVCodecContext *avctx, AVFrame *frame)
         } else if (unescaped_buf_size > INT_MAX / 8) {
             av_log(avctx, AV_LOG_ERROR,
                    "MJPEG packet 0x%x too big (%d/%d), corrupt data?\n",
-                   start_code, unescaped_buf_size, s->pkt->size);
+                   start_code, unescaped_buf_size, pkt->size);
             return AVERROR_INVALIDDATA;
         }
         av_log(avctx, AV_LOG_DEBUG, "marker=%x avail_size_in_buf=%"PTRDIFF_SPECIFIER"\n",
@@ -2604,7 +2775,7 @@ eoi_parser:
                 return ret;
             s->got_picture = 0;
 
-            frame->pkt_dts = s->pkt->dts;
+            frame->pkt_dts = pkt->dts;
 
             if (!s->lossless) {
                 int qp = FFMAX3(s->qscale[0],
@@ -2632,6 +2803,12 @@ eoi_parser:
                 break;
             }
 
+            /* Nothing but EOI follows the last scan of a frame, so the state
+             * the next frame depends on is final. Interlaced pictures are
+             * only complete once both fields have been decoded. */
+            if (s->scan_end_marker == EOI && !s->interlaced)
+                ff_thread_finish_setup(avctx);
+
             if ((ret = ff_mjpeg_decode_sos(s, NULL, 0, NULL)) < 0 &&
                 (avctx->err_recognition & AV_EF_EXPLODE))
                 goto fail;
@@ -2906,6 +3083,127 @@ the_end_no_picture:
     return ret;
 }
 
+int ff_mjpeg_receive_frame(AVCodecContext *avctx, AVFrame *frame)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    int ret;
+
+    if (avctx->codec_id == AV_CODEC_ID_SMVJPEG && s->smv_next_frame > 0)
+        return smv_process_frame(avctx, frame);
+
+    ret = mjpeg_get_packet(avctx);
+    if (ret < 0)
+        return ret;
+
+    return mjpeg_decode_packet(avctx, frame, s->pkt);
+}
+
+#if CONFIG_MJPEG_DECODER
+static int mjpeg_decode_frame(AVCodecContext *avctx, void *data,
+                              int *got_frame, AVPacket *avpkt)
+{
+    MJpegDecodeContext *s = avctx->priv_data;
+    int ret;
+
+    s->buf_size = avpkt->size;
+
+    ret = mjpeg_decode_packet(avctx, data, avpkt);
+    if (ret == AVERROR(EAGAIN))
+        return avpkt->size;
+    if (ret < 0)
+        return ret;
+
+    *got_frame = 1;
+    return avpkt->size;
+}
+
+#if HAVE_THREADS
+static int mjpeg_update_thread_context(AVCodecContext *dst,
+                                       const AVCodecContext *src)
+{
+    MJpegDecodeContext *d = dst->priv_data;
+    const MJpegDecodeContext *s = src->priv_data;
+    int i, j, n, ret;
+
+    if (d == s)
+        return 0;
+
+    memcpy(d->quant_matrixes, s->quant_matrixes, sizeof(d->quant_matrixes));
+    memcpy(d->qscale,         s->qscale,         sizeof(d->qscale));
+
+    /* rebuild the Huffman tables that changed */
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 4; j++) {
+            const uint8_t *lengths = s->raw_huffman_lengths[i][j];
+            uint8_t bits_table[17] = { 0 };
+
+            for (n = 0; n < 16; n++)
+                bits_table[0] += lengths[n];
+            n = bits_table[0];
+            if (!memcmp(d->raw_huffman_lengths[i][j], lengths, 16) &&
+                !memcmp(d->raw_huffman_values[i][j], s->raw_huffman_values[i][j], n))
+                continue;
+
+            memcpy(bits_table + 1, lengths, 16);
+            ff_free_vlc(&d->vlcs[i][j]);
+            if ((ret = build_vlc(&d->vlcs[i][j], bits_table,
+                                 s->raw_huffman_values[i][j], n, i > 0, dst)) < 0)
+                return ret;
+            if (i > 0) {
+                ff_free_vlc(&d->vlcs[2][j]);
+                if ((ret = build_vlc(&d->vlcs[2][j], bits_table,
+                                     s->raw_huffman_values[i][j], n, 0, dst)) < 0)
+                    return ret;
+            }
+            memcpy(d->raw_huffman_lengths[i][j], lengths, 16);
+            memcpy(d->raw_huffman_values[i][j], s->raw_huffman_values[i][j], n);
+        }
+    }
+
+    if (d->bits != s->bits)
+        init_idct(dst);
+
+    d->width         = s->width;
+    d->height        = s->height;
+    d->bits          = s->bits;
+    memcpy(d->h_count, s->h_count, sizeof(d->h_count));
+    memcpy(d->v_count, s->v_count, sizeof(d->v_count));
+    d->first_picture = s->first_picture;
+    d->interlaced    = s->interlaced;
+    d->rgb           = s->rgb;
+    d->rct           = s->rct;
+    d->pegasus_rct   = s->pegasus_rct;
+    d->colr          = s->colr;
+    d->xfrm          = s->xfrm;
+    d->buggy_avid    = s->buggy_avid;
+    d->cs_itu601     = s->cs_itu601;
+    d->multiscope    = s->multiscope;
+    d->flipped       = s->flipped;
+    d->hwaccel_pix_fmt    = s->hwaccel_pix_fmt;
+    d->hwaccel_sw_pix_fmt = s->hwaccel_sw_pix_fmt;
+
+    /* setup of interlaced pictures is finished at the end of the packet,
+     * so a picture with only its first field decoded can be passed on */
+    if (s->interlaced) {
+        d->bottom_field = s->bottom_field;
+        d->got_picture  = s->got_picture;
+        if (s->got_picture && s->bottom_field == !s->interlace_polarity) {
+            av_frame_unref(d->picture_ptr);
+            if ((ret = av_frame_ref(d->picture_ptr, s->picture_ptr)) < 0)
+                return ret;
+            d->nb_components = s->nb_components;
+            d->h_max         = s->h_max;
+            d->v_max         = s->v_max;
+            d->pix_desc      = s->pix_desc;
+            memcpy(d->linesize, s->linesize, sizeof(d->linesize));
+        }
+    }
+
+    return 0;
+}
+#endif
+#endif
+
 /* mxpeg may call the following function (with a blank MJpegDecodeContext)
  * even without having called ff_mjpeg_decode_init(). */
 av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
@@ -2928,6 +3226,8 @@ av_cold int ff_mjpeg_decode_end(AVCodecContext *avctx)
     av_frame_free(&s->smv_frame);
 
     av_freep(&s->buffer);
+    av_freep(&s->rst_pos);
+    av_freep(&s->slice_ctx);
     av_freep(&s->stereo3d);
     av_freep(&s->ljpeg_buffer);
     s->ljpeg_buffer_size = 0;
@@ -2982,9 +3282,11 @@ AVCodec ff_mjpeg_decoder = {
     .priv_data_size = sizeof(MJpegDecodeContext),
     .init           = ff_mjpeg_decode_init,
     .close          = ff_mjpeg_decode_end,
-    .receive_frame  = ff_mjpeg_receive_frame,
+    .decode         = mjpeg_decode_frame,
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(mjpeg_update_thread_context),
     .flush          = decode_flush,
-    .capabilities   = AV_CODEC_CAP_DR1,
+    .capabilities   = AV_CODEC_CAP_DR1 | AV_CODEC_CAP_FRAME_THREADS |
+                      AV_CODEC_CAP_SLICE_THREADS,
     .max_lowres     = 3,
     .priv_class     = &mjpegdec_class,
     .profiles       = NULL_IF_CONFIG_SMALL(ff_mjpeg_profiles),
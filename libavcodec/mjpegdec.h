@@ -117,6 +117,11 @@ typedef struct MJpegDecodeContext {
 
     int restart_interval;
     int restart_count;
+    int *rst_pos;            ///< offsets of the RSTn markers in the unescaped scan
+    unsigned int rst_pos_size;
+    int nb_rst;              ///< number of entries in rst_pos, -1 if unknown
+    int scan_end_marker;     ///< marker following the entropy coded data of the last SOS
+    struct MJpegDecodeContext *slice_ctx; ///< per-thread copies for slice threaded scans
 
     int buggy_avid;
     int cs_itu601;
@@ -1091,8 +1091,51 @@ static int mpeg_decode_update_thread_context(AVCodecContext *avctx,
     if (err)
         return err;
 
-    if (!ctx->mpeg_enc_ctx_allocated)
-        memcpy(s + 1, s1 + 1, sizeof(Mpeg1Context) - sizeof(MpegEncContext));
+    /* Sequence, GOP and quant matrix headers are only parsed by the thread
+     * whose packet carries them, so pass their state down the chain. */
+    ctx->mpeg_enc_ctx_allocated = ctx_from->mpeg_enc_ctx_allocated;
+    ctx->repeat_field           = ctx_from->repeat_field;
+    ctx->pan_scan               = ctx_from->pan_scan;
+    ctx->save_aspect            = ctx_from->save_aspect;
+    ctx->save_width             = ctx_from->save_width;
+    ctx->save_height            = ctx_from->save_height;
+    ctx->save_progressive_seq   = ctx_from->save_progressive_seq;
+    ctx->rc_buffer_size         = ctx_from->rc_buffer_size;
+    ctx->frame_rate_ext         = ctx_from->frame_rate_ext;
+    ctx->sync                   = ctx_from->sync;
+    ctx->tmpgexs                = ctx_from->tmpgexs;
+    ctx->extradata_decoded      = ctx_from->extradata_decoded;
+
+    /* Side data still pending in the source belongs to the next picture. */
+    ctx->stereo3d     = ctx_from->stereo3d;
+    ctx->has_stereo3d = ctx_from->has_stereo3d;
+    ctx->afd          = ctx_from->afd;
+    ctx->has_afd      = ctx_from->has_afd;
+    av_buffer_unref(&ctx->a53_buf_ref);
+    if (ctx_from->a53_buf_ref) {
+        ctx->a53_buf_ref = av_buffer_ref(ctx_from->a53_buf_ref);
+        if (!ctx->a53_buf_ref)
+            return AVERROR(ENOMEM);
+    }
+
+    s->codec_id          = s1->codec_id;
+    s->out_format        = s1->out_format;
+    s->swap_uv           = s1->swap_uv;
+    s->aspect_ratio_info = s1->aspect_ratio_info;
+    s->frame_rate_index  = s1->frame_rate_index;
+    s->bit_rate          = s1->bit_rate;
+    s->closed_gop        = s1->closed_gop;
+    avctx->codec_id      = avctx_from->codec_id;
+    memcpy(s->intra_matrix,        s1->intra_matrix,        sizeof(s->intra_matrix));
+    memcpy(s->inter_matrix,        s1->inter_matrix,        sizeof(s->inter_matrix));
+    memcpy(s->chroma_intra_matrix, s1->chroma_intra_matrix, sizeof(s->chroma_intra_matrix));
+    memcpy(s->chroma_inter_matrix, s1->chroma_inter_matrix, sizeof(s->chroma_inter_matrix));
+
+    /* The source thread attaches a pending GOP timecode to the picture it
+     * outputs; only carry it over if that packet has nothing to output. */
+    if (!s1->first_field &&
+        (s1->pict_type == AV_PICTURE_TYPE_B || s1->low_delay || s1->last_picture_ptr))
+        s->timecode_frame_start = -1;
 
     if (!(s->pict_type == AV_PICTURE_TYPE_B || s->low_delay))
         s->picture_number++;
@@ -1659,7 +1702,10 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
             s1->has_afd = 0;
         }
 
-        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME))
+        /* With field pictures the next thread must not start before the
+         * second field has been set up, or it would inherit first_field. */
+        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME) &&
+            s->picture_structure == PICT_FRAME)
             ff_thread_finish_setup(avctx);
     } else { // second field
         int i;
@@ -1669,6 +1715,9 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
             return AVERROR_INVALIDDATA;
         }
 
+        if (HAVE_THREADS && (avctx->active_thread_type & FF_THREAD_FRAME))
+            ff_thread_finish_setup(avctx);
+
         if (s->avctx->hwaccel) {
             if ((ret = s->avctx->hwaccel->end_frame(s->avctx)) < 0) {
                 av_log(avctx, AV_LOG_ERROR,
@@ -1693,6 +1742,22 @@ static int mpeg_field_start(MpegEncContext *s, const uint8_t *buf, int buf_size)
     return 0;
 }
 
+/**
+ * Report the frame MB rows that are complete to frame threads waiting on
+ * the current picture.
+ */
+static void report_decode_progress(MpegEncContext *s)
+{
+    if (s->picture_structure == PICT_FRAME) {
+        ff_mpv_report_decode_progress(s);
+    } else if (!s->first_field && s->pict_type != AV_PICTURE_TYPE_B &&
+               !s->er.error_occurred) {
+        /* A field MB row covers two frame MB rows; both are complete once
+         * the second field has reached it. */
+        ff_thread_report_progress(&s->current_picture_ptr->tf, s->mb_y | 1, 0);
+    }
+}
+
 #define DECODE_SLICE_ERROR -1
 #define DECODE_SLICE_OK     0
 
@@ -1854,7 +1919,7 @@ static int mpeg_decode_slice(MpegEncContext *s, int mb_y,
             int left;
 
             ff_mpeg_draw_horiz_band(s, mb_size * (s->mb_y >> field_pic), mb_size);
-            ff_mpv_report_decode_progress(s);
+            report_decode_progress(s);
 
             s->mb_x  = 0;
             s->mb_y += 1 << field_pic;
@@ -2932,12 +2997,14 @@ AVCodec ff_mpeg2video_decoder = {
     .decode         = mpeg_decode_frame,
     .capabilities   = AV_CODEC_CAP_DRAW_HORIZ_BAND | AV_CODEC_CAP_DR1 |
                       AV_CODEC_CAP_TRUNCATED | AV_CODEC_CAP_DELAY |
-                      AV_CODEC_CAP_SLICE_THREADS,
+                      AV_CODEC_CAP_SLICE_THREADS | AV_CODEC_CAP_FRAME_THREADS,
     .caps_internal  = FF_CODEC_CAP_INIT_THREADSAFE | FF_CODEC_CAP_INIT_CLEANUP |
-                      FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM,
+                      FF_CODEC_CAP_SKIP_FRAME_FILL_PARAM |
+                      FF_CODEC_CAP_ALLOCATE_PROGRESS,
     .flush          = flush,
     .max_lowres     = 3,
     .profiles       = NULL_IF_CONFIG_SMALL(ff_mpeg2_video_profiles),
+    .update_thread_context = ONLY_IF_THREADS_ENABLED(mpeg_decode_update_thread_context),
     .hw_configs     = (const AVCodecHWConfigInternal *const []) {
 #if CONFIG_MPEG2_DXVA2_HWACCEL
                         HWACCEL_DXVA2(mpeg2),
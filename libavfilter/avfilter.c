@@ -19,6 +19,8 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include <time.h>
+
 #include "libavutil/avassert.h"
 #include "libavutil/avstring.h"
 #include "libavutil/buffer.h"
@@ -33,6 +35,7 @@
 #include "libavutil/rational.h"
 #include "libavutil/samplefmt.h"
 #include "libavutil/thread.h"
+#include "libavutil/time.h"
 
 #define FF_INTERNAL_FIELDS 1
 #include "framequeue.h"
@@ -42,6 +45,7 @@
 #include "filters.h"
 #include "formats.h"
 #include "internal.h"
+#include "thread.h"
 
 #include "libavutil/ffversion.h"
 const char av_filter_ffversion[] = "FFmpeg version " FFMPEG_VERSION;
@@ -192,7 +196,18 @@ int avfilter_link_get_channels(AVFilterLink *link)
 
 void ff_filter_set_ready(AVFilterContext *filter, unsigned priority)
 {
-    filter->ready = FFMAX(filter->ready, priority);
+    AVFilterGraph *graph = filter->graph;
+
+    if (!graph) {
+        filter->ready = FFMAX(filter->ready, priority);
+        return;
+    }
+    ff_filter_graph_lock(graph);
+    if (priority > filter->ready) {
+        filter->ready = priority;
+        ff_filter_graph_update_ready(graph, filter);
+    }
+    ff_filter_graph_unlock(graph);
 }
 
 /**
@@ -532,8 +547,11 @@ void ff_update_link_current_pts(AVFilterLink *link, int64_t pts)
     link->current_pts = pts;
     link->current_pts_us = av_rescale_q(pts, link->time_base, AV_TIME_BASE_Q);
     /* TODO use duration */
-    if (link->graph && link->age_index >= 0)
+    if (link->graph && link->age_index >= 0) {
+        ff_filter_graph_lock(link->graph);
         ff_avfilter_graph_update_heap(link->graph, link);
+        ff_filter_graph_unlock(link->graph);
+    }
 }
 
 int avfilter_process_command(AVFilterContext *filter, const char *cmd, const char *arg, char *res, int res_len, int flags)
@@ -622,8 +640,9 @@ static const AVClass *filter_child_class_iterate(void **iter)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM
 static const AVOption avfilter_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
-        { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, FLAGS, "thread_type" },
+        { .i64 = AVFILTER_THREAD_SLICE | AVFILTER_THREAD_FRAME }, 0, INT_MAX, FLAGS, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = FLAGS, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = FLAGS, .unit = "thread_type" },
     { "enable", "set enable expression", OFFSET(enable_str), AV_OPT_TYPE_STRING, {.str=NULL}, .flags = FLAGS },
     { "threads", "Allowed number of threads", OFFSET(nb_threads), AV_OPT_TYPE_INT,
         { .i64 = 0 }, 0, INT_MAX, FLAGS },
@@ -793,6 +812,7 @@ void avfilter_free(AVFilterContext *filter)
     av_expr_free(filter->enable);
     filter->enable = NULL;
     av_freep(&filter->var_values);
+    ff_filter_frame_thread_free(filter);
     av_freep(&filter->internal);
     av_free(filter);
 }
@@ -905,9 +925,22 @@ int avfilter_init_dict(AVFilterContext *ctx, AVDictionary **options)
         return ret;
     }
 
-    if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
-        ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_SLICE &&
+    ret = 0;
+    if (ctx->filter->flags & AVFILTER_FLAG_FRAME_THREADS &&
+        ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_FRAME &&
         ctx->graph->internal->thread_execute) {
+        av_assert0(ctx->nb_inputs == 1 && ctx->nb_outputs == 1 &&
+                   ctx->input_pads[0].type == AVMEDIA_TYPE_VIDEO &&
+                   !ctx->filter->activate);
+        ret = ff_filter_frame_thread_init(ctx);
+        if (ret < 0)
+            return ret;
+    }
+    if (ret > 0) {
+        ctx->thread_type = AVFILTER_THREAD_FRAME;
+    } else if (ctx->filter->flags & AVFILTER_FLAG_SLICE_THREADS &&
+               ctx->thread_type & ctx->graph->thread_type & AVFILTER_THREAD_SLICE &&
+               ctx->graph->internal->thread_execute) {
         ctx->thread_type       = AVFILTER_THREAD_SLICE;
         ctx->internal->execute = ctx->graph->internal->thread_execute;
     } else {
@@ -1042,6 +1075,28 @@ fail:
     return ret;
 }
 
+const AVFilterProfile *avfilter_get_profile(AVFilterContext *filter)
+{
+    AVFilterProfile *p = &filter->internal->profile;
+    unsigned i;
+
+    p->frames_in = p->frames_out = 0;
+    for (i = 0; i < filter->nb_inputs; i++)
+        if (filter->inputs[i])
+            p->frames_in += filter->inputs[i]->frame_count_out;
+    for (i = 0; i < filter->nb_outputs; i++)
+        if (filter->outputs[i])
+            p->frames_out += filter->outputs[i]->frame_count_in;
+    return p;
+}
+
+const AVFilterLinkProfile *avfilter_link_get_profile(AVFilterLink *link)
+{
+    link->profile.nb_frames = link->frame_count_in;
+    link->profile.queued    = ff_framequeue_queued_frames(&link->fifo);
+    return &link->profile;
+}
+
 const char *avfilter_pad_get_name(const AVFilterPad *pads, int pad_idx)
 {
     return pads[pad_idx].name;
@@ -1123,6 +1178,12 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
         }
     }
 
+    if (link->src->internal->frame_thread) {
+        ret = ff_filter_frame_thread_output(link, frame);
+        if (ret)
+            return FFMIN(ret, 0);
+    }
+
     link->frame_blocked_in = link->frame_wanted_out = 0;
     link->frame_count_in++;
     filter_unblock(link->dst);
@@ -1131,6 +1192,11 @@ int ff_filter_frame(AVFilterLink *link, AVFrame *frame)
         av_frame_free(&frame);
         return ret;
     }
+    if (link->graph && link->graph->profile) {
+        size_t queued = ff_framequeue_queued_frames(&link->fifo);
+        link->profile.queued_sum += queued;
+        link->profile.max_queued  = FFMAX(link->profile.max_queued, queued);
+    }
     ff_filter_set_ready(link->dst, 300);
     return 0;
 
@@ -1238,6 +1304,40 @@ static int ff_filter_frame_to_filter(AVFilterLink *link)
     return ret;
 }
 
+/*
+ * Frame threaded filters wait for as many frames as they have jobs, then
+ * filter them concurrently. The remaining frames at EOF, frames sent while
+ * commands are pending or a timeline is set, and single frames are filtered
+ * by ff_filter_frame_to_filter() as usual.
+ */
+static int ff_filter_frames_to_filter_threaded(AVFilterContext *filter)
+{
+    AVFilterLink *link = filter->inputs[0];
+    unsigned nb_frames = ff_framequeue_queued_frames(&link->fifo);
+    int ret;
+
+    if (!nb_frames || filter->enable || filter->command_queue)
+        return FFERROR_NOT_READY;
+    if (nb_frames < filter->internal->nb_frame_jobs && !link->status_in) {
+        if (filter->outputs[0]->status_in)
+            return FFERROR_NOT_READY;
+        if (!link->frame_wanted_out)
+            ff_inlink_request_frame(link);
+        return 0;
+    }
+    nb_frames = FFMIN(nb_frames, filter->internal->nb_frame_jobs);
+    if (nb_frames < 2)
+        return FFERROR_NOT_READY;
+
+    filter_unblock(filter);
+    ret = ff_filter_frame_thread_execute(filter, nb_frames);
+    if (ret < 0 && ret != link->status_out)
+        ff_avfilter_link_set_out_status(link, ret, AV_NOPTS_VALUE);
+    else
+        ff_filter_set_ready(filter, 300);
+    return ret;
+}
+
 static int forward_status_change(AVFilterContext *filter, AVFilterLink *in)
 {
     unsigned out = 0, progress = 0;
@@ -1274,6 +1374,11 @@ static int ff_filter_activate_default(AVFilterContext *filter)
 {
     unsigned i;
 
+    if (filter->internal->frame_thread) {
+        int ret = ff_filter_frames_to_filter_threaded(filter);
+        if (ret != FFERROR_NOT_READY)
+            return ret;
+    }
     for (i = 0; i < filter->nb_inputs; i++) {
         if (samples_ready(filter->inputs[i], filter->inputs[i]->min_samples)) {
             return ff_filter_frame_to_filter(filter->inputs[i]);
@@ -1364,7 +1469,9 @@ static int ff_filter_activate_default(AVFilterContext *filter)
      ff_avfilter_link_set_out_status().
 
    Filters are activated according to the ready field, set using the
-   ff_filter_set_ready(). Eventually, a priority queue will be used.
+   ff_filter_set_ready(), which keeps the graph ready queue up to date; the
+   filter with the highest priority, and the first one in graph order among
+   equal priorities, is activated next.
    ff_filter_set_ready() is called whenever anything could cause progress to
    be possible. Marking a filter ready when it is not is not a problem,
    except for the small overhead it causes.
@@ -1426,16 +1533,45 @@ static int ff_filter_activate_default(AVFilterContext *filter)
      [buffersrc1][testsrc1][buffersrc2][testsrc2]concat=v=2).
  */
 
+static int64_t thread_cpu_time(void)
+{
+#if HAVE_CLOCK_GETTIME && defined(CLOCK_THREAD_CPUTIME_ID)
+    struct timespec ts;
+    if (!clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts))
+        return ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+#endif
+    return 0;
+}
+
 int ff_filter_activate(AVFilterContext *filter)
 {
+    int profile = filter->graph && filter->graph->profile;
+    int64_t wall_start = 0, cpu_start = 0;
     int ret;
 
     /* Generic timeline support is not yet implemented but should be easy */
     av_assert1(!(filter->filter->flags & AVFILTER_FLAG_SUPPORT_TIMELINE_GENERIC &&
                  filter->filter->activate));
-    filter->ready = 0;
+    if (filter->graph) {
+        ff_filter_graph_lock(filter->graph);
+        filter->ready = 0;
+        ff_filter_graph_update_ready(filter->graph, filter);
+        ff_filter_graph_unlock(filter->graph);
+    } else {
+        filter->ready = 0;
+    }
+    if (profile) {
+        wall_start = av_gettime_relative();
+        cpu_start  = thread_cpu_time();
+    }
     ret = filter->filter->activate ? filter->filter->activate(filter) :
           ff_filter_activate_default(filter);
+    if (profile) {
+        AVFilterProfile *p = &filter->internal->profile;
+        p->nb_activations++;
+        p->wall_time += av_gettime_relative() - wall_start;
+        p->cpu_time  += thread_cpu_time() - cpu_start;
+    }
     if (ret == FFERROR_NOT_READY)
         ret = 0;
     return ret;
@@ -115,6 +115,15 @@ enum AVMediaType avfilter_pad_get_type(const AVFilterPad *pads, int pad_idx);
  * and processing them concurrently.
  */
 #define AVFILTER_FLAG_SLICE_THREADS         (1 << 2)
+/**
+ * The filter supports multithreading by filtering several frames
+ * concurrently. The filter must have a single video input and a single
+ * output, use filter_frame() and not activate(), and keep no state from one
+ * frame to the next: filter_frame() may be called for several frames at once
+ * and must output at most one frame per call with ff_filter_frame(). The
+ * output frames are sent to the next filter in input order.
+ */
+#define AVFILTER_FLAG_FRAME_THREADS         (1 << 3)
 /**
  * Some filters support a generic "enable" expression option that can be used
  * to enable or disable a filter in the timeline. Filters supporting this
@@ -334,6 +343,18 @@ typedef struct AVFilter {
  * Process multiple parts of the frame concurrently.
  */
 #define AVFILTER_THREAD_SLICE (1 << 0)
+/**
+ * Activate filters of a graph that do not share any link concurrently.
+ * Only meaningful in AVFilterGraph.thread_type; each filter is still never
+ * activated on more than one thread at a time.
+ */
+#define AVFILTER_THREAD_GRAPH (1 << 1)
+/**
+ * Filter several frames concurrently, see AVFILTER_FLAG_FRAME_THREADS. A
+ * filter using frame threading does not use slice threading in addition.
+ * Not set in AVFilterGraph.thread_type by default.
+ */
+#define AVFILTER_THREAD_FRAME (1 << 2)
 
 typedef struct AVFilterInternal AVFilterInternal;
 
@@ -456,6 +477,44 @@ typedef struct AVFilterFormatsConfig {
 
 } AVFilterFormatsConfig;
 
+/**
+ * Statistics collected for a filter while profiling is enabled on its
+ * graph, see AVFilterGraph.profile.
+ *
+ * sizeof(AVFilterProfile) is not a part of the public ABI, new fields may
+ * be added to the end with a minor version bump.
+ */
+typedef struct AVFilterProfile {
+    int64_t nb_activations;     ///< number of times the filter was activated
+    int64_t frames_in;          ///< frames consumed from all the inputs
+    int64_t frames_out;         ///< frames sent to all the outputs
+    int64_t wall_time;          ///< wall clock time spent in the filter, in microseconds
+    /**
+     * CPU time spent in the filter, in microseconds. Only the time spent in
+     * the thread activating the filter is accounted, 0 if not supported on
+     * the platform.
+     */
+    int64_t cpu_time;
+} AVFilterProfile;
+
+/**
+ * Statistics collected for a link while profiling is enabled on its graph,
+ * see AVFilterGraph.profile.
+ *
+ * sizeof(AVFilterLinkProfile) is not a part of the public ABI, new fields
+ * may be added to the end with a minor version bump.
+ */
+typedef struct AVFilterLinkProfile {
+    int64_t nb_frames;          ///< frames sent over the link
+    /**
+     * Sum of the number of frames queued on the link, sampled each time a
+     * frame is sent over it. Divide by nb_frames for the mean queue depth.
+     */
+    int64_t queued_sum;
+    int     max_queued;         ///< largest number of frames queued on the link
+    int     queued;             ///< number of frames currently queued on the link
+} AVFilterLinkProfile;
+
 /**
  * A link between two filters. This contains pointers to the source and
  * destination filters between which this link exists, and the indexes of
@@ -657,6 +716,11 @@ struct AVFilterLink {
      */
     int status_out;
 
+    /**
+     * Profiling statistics, see avfilter_link_get_profile().
+     */
+    AVFilterLinkProfile profile;
+
 #endif /* FF_INTERNAL_FIELDS */
 
 };
@@ -678,6 +742,28 @@ int avfilter_link(AVFilterContext *src, unsigned srcpad,
  */
 void avfilter_link_free(AVFilterLink **link);
 
+/**
+ * Get the profiling statistics of a filter.
+ *
+ * The statistics are only collected while AVFilterGraph.profile is set on
+ * the graph containing the filter.
+ *
+ * @return a pointer to statistics owned by the filter, valid until the next
+ *         call to this function or until the filter is freed
+ */
+const AVFilterProfile *avfilter_get_profile(AVFilterContext *filter);
+
+/**
+ * Get the profiling statistics of a link.
+ *
+ * The statistics are only collected while AVFilterGraph.profile is set on
+ * the graph containing the link.
+ *
+ * @return a pointer to statistics owned by the link, valid until the next
+ *         call to this function or until the link is freed
+ */
+const AVFilterLinkProfile *avfilter_link_get_profile(AVFilterLink *link);
+
 #if FF_API_FILTER_GET_SET
 /**
  * Get the number of channels of a link.
@@ -867,7 +953,8 @@ typedef struct AVFilterGraph {
      * of AVFILTER_THREAD_* flags.
      *
      * May be set by the caller at any point, the setting will apply to all
-     * filters initialized after that. The default is allowing everything.
+     * filters initialized after that. The default is AVFILTER_THREAD_SLICE;
+     * the other types have to be requested explicitly.
      *
      * When a filter in this graph is initialized, this field is combined using
      * bit AND with AVFilterContext.thread_type to get the final mask used for
@@ -911,6 +998,15 @@ typedef struct AVFilterGraph {
 
     char *aresample_swr_opts; ///< swr options to use for the auto-inserted aresample filters, Access ONLY through AVOptions
 
+    /**
+     * If set, collect per-filter and per-link statistics while the graph
+     * runs, see avfilter_get_profile() and avfilter_link_get_profile().
+     *
+     * May be set by the caller at any point, the statistics are accumulated
+     * while it is set.
+     */
+    int profile;
+
     /**
      * Private fields
      *
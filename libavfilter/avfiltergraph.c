@@ -50,12 +50,16 @@ static const AVOption filtergraph_options[] = {
     { "thread_type", "Allowed thread types", OFFSET(thread_type), AV_OPT_TYPE_FLAGS,
         { .i64 = AVFILTER_THREAD_SLICE }, 0, INT_MAX, F|V|A, "thread_type" },
         { "slice", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_SLICE }, .flags = F|V|A, .unit = "thread_type" },
+        { "frame", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_FRAME }, .flags = F|V|A, .unit = "thread_type" },
+        { "graph", NULL, 0, AV_OPT_TYPE_CONST, { .i64 = AVFILTER_THREAD_GRAPH }, .flags = F|V|A, .unit = "thread_type" },
     { "threads",     "Maximum number of threads", OFFSET(nb_threads),
         AV_OPT_TYPE_INT,   { .i64 = 0 }, 0, INT_MAX, F|V|A },
     {"scale_sws_opts"       , "default scale filter options"        , OFFSET(scale_sws_opts)        ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|V },
     {"aresample_swr_opts"   , "default aresample filter options"    , OFFSET(aresample_swr_opts)    ,
         AV_OPT_TYPE_STRING, {.str = NULL}, 0, 0, F|A },
+    { "profile",     "Collect per-filter statistics", OFFSET(profile),
+        AV_OPT_TYPE_BOOL,  { .i64 = 0 }, 0, 1, F|V|A },
     { NULL },
 };
 
@@ -78,6 +82,52 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     graph->nb_threads  = 1;
     return 0;
 }
+
+int ff_graph_activate_init(AVFilterGraph *graph)
+{
+    graph->thread_type &= ~AVFILTER_THREAD_GRAPH;
+    return 0;
+}
+
+int ff_graph_activate_execute(AVFilterGraph *graph, AVFilterContext **filters,
+                              int nb_filters)
+{
+    int i, ret = 0;
+
+    for (i = 0; i < nb_filters; i++) {
+        int r = ff_filter_activate(filters[i]);
+        if (r < 0 && ret >= 0)
+            ret = r;
+    }
+    return ret;
+}
+
+int ff_filter_frame_thread_init(AVFilterContext *ctx)
+{
+    return 0;
+}
+
+void ff_filter_frame_thread_free(AVFilterContext *ctx)
+{
+}
+
+int ff_filter_frame_thread_execute(AVFilterContext *ctx, int nb_frames)
+{
+    return AVERROR_BUG;
+}
+
+int ff_filter_frame_thread_output(AVFilterLink *link, AVFrame *frame)
+{
+    return 0;
+}
+
+void ff_filter_frame_thread_lock(AVFilterContext *ctx)
+{
+}
+
+void ff_filter_frame_thread_unlock(AVFilterContext *ctx)
+{
+}
 #endif
 
 AVFilterGraph *avfilter_graph_alloc(void)
@@ -99,14 +149,95 @@ AVFilterGraph *avfilter_graph_alloc(void)
     return ret;
 }
 
+/**
+ * Tell if filter a must be activated before filter b.
+ */
+static int ready_before(const AVFilterContext *a, const AVFilterContext *b)
+{
+    if (a->ready != b->ready)
+        return a->ready > b->ready;
+    return a->internal->graph_index < b->internal->graph_index;
+}
+
+static void ready_heap_set(AVFilterGraphInternal *gi, unsigned pos,
+                           AVFilterContext *filter)
+{
+    gi->ready_heap[pos] = filter;
+    filter->internal->ready_pos = pos + 1;
+}
+
+static void ready_heap_sift(AVFilterGraphInternal *gi, unsigned pos)
+{
+    AVFilterContext *filter = gi->ready_heap[pos];
+
+    while (pos) {
+        unsigned parent = (pos - 1) >> 1;
+        if (!ready_before(filter, gi->ready_heap[parent]))
+            break;
+        ready_heap_set(gi, pos, gi->ready_heap[parent]);
+        pos = parent;
+    }
+    while (1) {
+        unsigned child = 2 * pos + 1;
+        if (child >= gi->nb_ready)
+            break;
+        if (child + 1 < gi->nb_ready &&
+            ready_before(gi->ready_heap[child + 1], gi->ready_heap[child]))
+            child++;
+        if (!ready_before(gi->ready_heap[child], filter))
+            break;
+        ready_heap_set(gi, pos, gi->ready_heap[child]);
+        pos = child;
+    }
+    ready_heap_set(gi, pos, filter);
+}
+
+static void ready_heap_remove(AVFilterGraphInternal *gi, AVFilterContext *filter)
+{
+    unsigned pos = filter->internal->ready_pos - 1;
+    AVFilterContext *last = gi->ready_heap[--gi->nb_ready];
+
+    filter->internal->ready_pos = 0;
+    if (last == filter)
+        return;
+    ready_heap_set(gi, pos, last);
+    ready_heap_sift(gi, pos);
+}
+
+void ff_filter_graph_update_ready(AVFilterGraph *graph, AVFilterContext *filter)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    unsigned pos = filter->internal->ready_pos;
+
+    if (!filter->ready) {
+        if (pos)
+            ready_heap_remove(gi, filter);
+        return;
+    }
+    if (!pos) {
+        av_assert0(gi->nb_ready < graph->nb_filters);
+        pos = ++gi->nb_ready;
+        ready_heap_set(gi, pos - 1, filter);
+    }
+    ready_heap_sift(gi, pos - 1);
+}
+
 void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter)
 {
     int i, j;
     for (i = 0; i < graph->nb_filters; i++) {
         if (graph->filters[i] == filter) {
+            if (filter->internal->ready_pos)
+                ready_heap_remove(graph->internal, filter);
             FFSWAP(AVFilterContext*, graph->filters[i],
                    graph->filters[graph->nb_filters - 1]);
             graph->nb_filters--;
+            if (i < graph->nb_filters) {
+                AVFilterInternal *moved = graph->filters[i]->internal;
+                moved->graph_index = i;
+                if (moved->ready_pos)
+                    ready_heap_sift(graph->internal, moved->ready_pos - 1);
+            }
             filter->graph = NULL;
             for (j = 0; j<filter->nb_outputs; j++)
                 if (filter->outputs[j])
@@ -135,6 +266,7 @@ void avfilter_graph_free(AVFilterGraph **graph)
     av_freep(&(*graph)->resample_lavr_opts);
 #endif
     av_freep(&(*graph)->filters);
+    av_freep(&(*graph)->internal->ready_heap);
     av_freep(&(*graph)->internal);
     av_freep(graph);
 }
@@ -171,9 +303,10 @@ AVFilterContext *avfilter_graph_alloc_filter(AVFilterGraph *graph,
                                              const AVFilter *filter,
                                              const char *name)
 {
-    AVFilterContext **filters, *s;
+    AVFilterContext **filters, **ready_heap, *s;
 
-    if (graph->thread_type && !graph->internal->thread_execute) {
+    if (graph->thread_type & (AVFILTER_THREAD_SLICE | AVFILTER_THREAD_FRAME) &&
+        !graph->internal->thread_execute) {
         if (graph->execute) {
             graph->internal->thread_execute = graph->execute;
         } else {
@@ -196,9 +329,21 @@ AVFilterContext *avfilter_graph_alloc_filter(AVFilterGraph *graph,
     }
 
     graph->filters = filters;
+
+    ready_heap = av_realloc_array(graph->internal->ready_heap,
+                                  graph->nb_filters + 1, sizeof(*ready_heap));
+    if (!ready_heap) {
+        avfilter_free(s);
+        return NULL;
+    }
+    graph->internal->ready_heap = ready_heap;
+
+    s->internal->graph_index = graph->nb_filters;
     graph->filters[graph->nb_filters++] = s;
 
     s->graph = graph;
+    if (s->ready)
+        ff_filter_graph_update_ready(graph, s);
 
     return s;
 }
@@ -1230,6 +1375,12 @@ int avfilter_graph_config(AVFilterGraph *graphctx, void *log_ctx)
     if ((ret = graph_config_pointers(graphctx, log_ctx)))
         return ret;
 
+    if (graphctx->thread_type & AVFILTER_THREAD_GRAPH && !graphctx->execute &&
+        !graphctx->internal->activate_thread) {
+        if ((ret = ff_graph_activate_init(graphctx)) < 0)
+            return ret;
+    }
+
     return 0;
 }
 
@@ -1388,17 +1539,76 @@ int avfilter_graph_request_oldest(AVFilterGraph *graph)
     return 0;
 }
 
-int ff_filter_graph_run_once(AVFilterGraph *graph)
+/**
+ * Tell if activating filter a may touch the links of filter b.
+ * Besides its own links, activating a filter clears frame_blocked_in on the
+ * outputs of the filters it sends frames or status changes to, so filters
+ * sharing an output neighbour or two links apart conflict too.
+ */
+static int filters_conflict(const AVFilterContext *a, const AVFilterContext *b)
 {
-    AVFilterContext *filter;
-    unsigned i;
+    unsigned i, j;
+
+    for (i = 0; i < a->nb_inputs; i++)
+        if (a->inputs[i] && a->inputs[i]->src == b)
+            return 1;
+    for (i = 0; i < a->nb_outputs; i++) {
+        const AVFilterContext *dst = a->outputs[i] ? a->outputs[i]->dst : NULL;
+        if (!dst)
+            continue;
+        if (dst == b)
+            return 1;
+        for (j = 0; j < dst->nb_outputs; j++)
+            if (dst->outputs[j] && dst->outputs[j]->dst == b)
+                return 1;
+        for (j = 0; j < b->nb_outputs; j++)
+            if (b->outputs[j] && b->outputs[j]->dst == dst)
+                return 1;
+    }
+    return 0;
+}
 
+/**
+ * Activate the ready filter with the highest priority together with as
+ * many other ready filters not conflicting with it or with each other as
+ * there are worker threads.
+ */
+static int run_once_concurrent(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    AVFilterContext **jobs    = gi->activate_jobs;
+    AVFilterContext **skipped = gi->activate_jobs + gi->nb_activate_jobs;
+    int max_skipped = 3 * gi->nb_activate_jobs;
+    int nb_jobs = 0, nb_skipped = 0, i, j;
+
+    while (gi->nb_ready && nb_jobs < gi->nb_activate_jobs &&
+           nb_skipped < max_skipped) {
+        AVFilterContext *filter = gi->ready_heap[0];
+
+        ready_heap_remove(gi, filter);
+        for (j = 0; j < nb_jobs; j++)
+            if (filters_conflict(filter, jobs[j]) ||
+                filters_conflict(jobs[j], filter))
+                break;
+        if (j < nb_jobs)
+            skipped[nb_skipped++] = filter;
+        else
+            jobs[nb_jobs++] = filter;
+    }
+    for (i = 0; i < nb_skipped; i++)
+        ff_filter_graph_update_ready(graph, skipped[i]);
+
+    if (nb_jobs == 1)
+        return ff_filter_activate(jobs[0]);
+    return ff_graph_activate_execute(graph, jobs, nb_jobs);
+}
+
+int ff_filter_graph_run_once(AVFilterGraph *graph)
+{
     av_assert0(graph->nb_filters);
-    filter = graph->filters[0];
-    for (i = 1; i < graph->nb_filters; i++)
-        if (graph->filters[i]->ready > filter->ready)
-            filter = graph->filters[i];
-    if (!filter->ready)
+    if (!graph->internal->nb_ready)
         return AVERROR(EAGAIN);
-    return ff_filter_activate(filter);
+    if (graph->internal->activate_thread && graph->internal->nb_ready > 1)
+        return run_once_concurrent(graph);
+    return ff_filter_activate(graph->internal->ready_heap[0]);
 }
@@ -25,6 +25,7 @@
 
 #include "dnn_backend_native.h"
 #include "libavutil/avassert.h"
+#include "libavutil/time.h"
 #include "dnn_backend_native_layer_conv2d.h"
 #include "dnn_backend_native_layers.h"
 #include "dnn_io_proc.h"
@@ -32,7 +33,10 @@
 #define OFFSET(x) offsetof(NativeContext, x)
 #define FLAGS AV_OPT_FLAG_FILTERING_PARAM
 static const AVOption dnn_native_options[] = {
-    { "conv2d_threads", "threads num for conv2d layer", OFFSET(options.conv2d_threads), AV_OPT_TYPE_INT,  { .i64 = 0 }, INT_MIN, INT_MAX, FLAGS },
+    { "threads",        "threads num for the layers",   OFFSET(options.threads),        AV_OPT_TYPE_INT,  { .i64 = 0 }, 0, INT_MAX, FLAGS },
+    { "conv2d_threads", "deprecated, use threads",      OFFSET(options.threads),        AV_OPT_TYPE_INT,  { .i64 = 0 }, 0, INT_MAX, FLAGS },
+    { "batch_size",     "frames per model run in async mode", OFFSET(options.batch_size), AV_OPT_TYPE_INT, { .i64 = 1 }, 1, 1024, FLAGS },
+    { "layer_timing",   "log the time spent in each layer", OFFSET(options.layer_timing), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, FLAGS },
     { NULL },
 };
 
@@ -44,10 +48,22 @@ const AVClass dnn_native_class = {
     .category   = AV_CLASS_CATEGORY_FILTER,
 };
 
-static DNNReturnType execute_model_native(const DNNModel *model, const char *input_name, AVFrame *in_frame,
-                                          const char **output_names, uint32_t nb_output, AVFrame *out_frame,
+typedef struct TaskItem {
+    const char *input_name;
+    AVFrame *in_frame;
+    const char *output_name;
+    AVFrame *out_frame;
+} TaskItem;
+
+static DNNReturnType execute_model_native(NativeModel *native_model, TaskItem **tasks, int nb_tasks,
                                           int do_ioproc);
 
+static void dnn_native_worker(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    NativeContext *ctx = priv;
+    ctx->job_func(ctx->job_arg, jobnr, nb_jobs);
+}
+
 static DNNReturnType get_input_native(void *model, DNNData *input, const char *input_name)
 {
     NativeModel *native_model = (NativeModel *)model;
@@ -82,6 +98,7 @@ static DNNReturnType get_output_native(void *model, const char *input_name, int
     NativeContext *ctx = &native_model->ctx;
     AVFrame *in_frame = av_frame_alloc();
     AVFrame *out_frame = NULL;
+    TaskItem task, *tasks = &task;
 
     if (!in_frame) {
         av_log(ctx, AV_LOG_ERROR, "Could not allocate memory for input frame\n");
@@ -99,7 +116,11 @@ static DNNReturnType get_output_native(void *model, const char *input_name, int
     in_frame->width = input_width;
     in_frame->height = input_height;
 
-    ret = execute_model_native(native_model->model, input_name, in_frame, &output_name, 1, out_frame, 0);
+    task.input_name = input_name;
+    task.in_frame = in_frame;
+    task.output_name = output_name;
+    task.out_frame = out_frame;
+    ret = execute_model_native(native_model, &tasks, 1, 0);
     *output_width = out_frame->width;
     *output_height = out_frame->height;
 
@@ -121,7 +142,7 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename, const char *optio
     int version, header_size, major_version_expected = 1;
     NativeModel *native_model = NULL;
     AVIOContext *model_file_context;
-    int file_size, dnn_size, parsed_size;
+    int file_size, dnn_size, parsed_size, ret;
     int32_t layer;
     DNNLayerType layer_type;
 
@@ -171,17 +192,31 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename, const char *optio
 
     native_model->ctx.class = &dnn_native_class;
     model->options = options;
+    av_opt_set_defaults(&native_model->ctx);
     if (av_opt_set_from_string(&native_model->ctx, model->options, NULL, "=", "&") < 0)
         goto fail;
     model->model = (void *)native_model;
     native_model->model = model;
 
-#if !HAVE_PTHREAD_CANCEL
-    if (native_model->ctx.options.conv2d_threads > 1){
-        av_log(&native_model->ctx, AV_LOG_WARNING, "'conv2d_threads' option was set but it is not supported "
-                       "on this build (pthread support is required)\n");
+    ret = avpriv_slicethread_create(&native_model->ctx.slicethread, &native_model->ctx,
+                                    dnn_native_worker, NULL, native_model->ctx.options.threads);
+    if (ret == AVERROR(ENOSYS)) {
+        if (native_model->ctx.options.threads > 1)
+            av_log(&native_model->ctx, AV_LOG_WARNING, "'threads' option was set but it is not supported "
+                           "on this build (pthread support is required)\n");
+        ret = 1;
+    } else if (ret < 0) {
+        goto fail;
     }
-#endif
+    native_model->ctx.nb_threads = ret;
+    if (native_model->ctx.nb_threads <= 1)
+        avpriv_slicethread_free(&native_model->ctx.slicethread);
+
+    native_model->pending_tasks = av_malloc_array(native_model->ctx.options.batch_size,
+                                                  sizeof(*native_model->pending_tasks));
+    native_model->task_queue = ff_queue_create();
+    if (!native_model->pending_tasks || !native_model->task_queue)
+        goto fail;
 
     avio_seek(model_file_context, file_size - 8, SEEK_SET);
     native_model->layers_num = (int32_t)avio_rl32(model_file_context);
@@ -265,15 +300,15 @@ fail:
     return NULL;
 }
 
-static DNNReturnType execute_model_native(const DNNModel *model, const char *input_name, AVFrame *in_frame,
-                                          const char **output_names, uint32_t nb_output, AVFrame *out_frame,
+static DNNReturnType execute_model_native(NativeModel *native_model, TaskItem **tasks, int nb_tasks,
                                           int do_ioproc)
 {
-    NativeModel *native_model = (NativeModel *)model->model;
     NativeContext *ctx = &native_model->ctx;
+    const AVFrame *in_frame = tasks[0]->in_frame;
     int32_t layer;
     DNNData input, output;
     DnnOperand *oprd = NULL;
+    int32_t frame_length;
 
     if (native_model->layers_num <= 0 || native_model->operands_num <= 0) {
         av_log(ctx, AV_LOG_ERROR, "No operands or layers in model\n");
@@ -282,9 +317,9 @@ static DNNReturnType execute_model_native(const DNNModel *model, const char *inp
 
     for (int i = 0; i < native_model->operands_num; ++i) {
         oprd = &native_model->operands[i];
-        if (strcmp(oprd->name, input_name) == 0) {
+        if (strcmp(oprd->name, tasks[0]->input_name) == 0) {
             if (oprd->type != DOT_INPUT) {
-                av_log(ctx, AV_LOG_ERROR, "Found \"%s\" in model, but it is not input node\n", input_name);
+                av_log(ctx, AV_LOG_ERROR, "Found \"%s\" in model, but it is not input node\n", tasks[0]->input_name);
                 return DNN_ERROR;
             }
             break;
@@ -292,47 +327,48 @@ static DNNReturnType execute_model_native(const DNNModel *model, const char *inp
         oprd = NULL;
     }
     if (!oprd) {
-        av_log(ctx, AV_LOG_ERROR, "Could not find \"%s\" in model\n", input_name);
+        av_log(ctx, AV_LOG_ERROR, "Could not find \"%s\" in model\n", tasks[0]->input_name);
         return DNN_ERROR;
     }
 
+    // the frames of a batch are stacked along the first dimension
+    oprd->dims[0] = nb_tasks;
     oprd->dims[1] = in_frame->height;
     oprd->dims[2] = in_frame->width;
 
-    av_freep(&oprd->data);
     oprd->length = calculate_operand_data_length(oprd);
     if (oprd->length <= 0) {
         av_log(ctx, AV_LOG_ERROR, "The input data length overflow\n");
         return DNN_ERROR;
     }
-    oprd->data = av_malloc(oprd->length);
-    if (!oprd->data) {
+    if (dnn_native_realloc_operand(oprd) < 0) {
         av_log(ctx, AV_LOG_ERROR, "Failed to malloc memory for input data\n");
         return DNN_ERROR;
     }
+    frame_length = oprd->length / nb_tasks;
 
     input.height = oprd->dims[1];
     input.width = oprd->dims[2];
     input.channels = oprd->dims[3];
-    input.data = oprd->data;
     input.dt = oprd->data_type;
-    if (do_ioproc) {
-        if (native_model->model->pre_proc != NULL) {
-            native_model->model->pre_proc(in_frame, &input, native_model->model->filter_ctx);
-        } else {
-            proc_from_frame_to_dnn(in_frame, &input, ctx);
+    for (int i = 0; i < nb_tasks; ++i) {
+        if (tasks[i]->in_frame->width != in_frame->width || tasks[i]->in_frame->height != in_frame->height) {
+            av_log(ctx, AV_LOG_ERROR, "Frames of different sizes in the same batch\n");
+            return DNN_ERROR;
+        }
+        input.data = (uint8_t *)oprd->data + i * frame_length;
+        if (do_ioproc) {
+            if (native_model->model->pre_proc != NULL) {
+                native_model->model->pre_proc(tasks[i]->in_frame, &input, native_model->model->filter_ctx);
+            } else {
+                proc_from_frame_to_dnn(tasks[i]->in_frame, &input, ctx);
+            }
         }
-    }
-
-    if (nb_output != 1) {
-        // currently, the filter does not need multiple outputs,
-        // so we just pending the support until we really need it.
-        av_log(ctx, AV_LOG_ERROR, "do not support multiple outputs\n");
-        return DNN_ERROR;
     }
 
     for (layer = 0; layer < native_model->layers_num; ++layer){
         DNNLayerType layer_type = native_model->layers[layer].type;
+        int64_t start = ctx->options.layer_timing ? av_gettime_relative() : 0;
         if (layer_funcs[layer_type].pf_exec(native_model->operands,
                                             native_model->layers[layer].input_operand_indexes,
                                             native_model->layers[layer].output_operand_index,
@@ -341,28 +377,38 @@ static DNNReturnType execute_model_native(const DNNModel *model, const char *inp
             av_log(ctx, AV_LOG_ERROR, "Failed to execuet model\n");
             return DNN_ERROR;
         }
+        if (ctx->options.layer_timing)
+            native_model->layers[layer].exec_time += av_gettime_relative() - start;
     }
-
-    for (uint32_t i = 0; i < nb_output; ++i) {
-        DnnOperand *oprd = NULL;
-        const char *output_name = output_names[i];
-        for (int j = 0; j < native_model->operands_num; ++j) {
-            if (strcmp(native_model->operands[j].name, output_name) == 0) {
-                oprd = &native_model->operands[j];
-                break;
-            }
+    native_model->nb_runs++;
+    // the model itself describes a single frame
+    oprd->dims[0] = 1;
+
+    oprd = NULL;
+    for (int j = 0; j < native_model->operands_num; ++j) {
+        if (strcmp(native_model->operands[j].name, tasks[0]->output_name) == 0) {
+            oprd = &native_model->operands[j];
+            break;
         }
+    }
 
-        if (oprd == NULL) {
-            av_log(ctx, AV_LOG_ERROR, "Could not find output in model\n");
-            return DNN_ERROR;
-        }
+    if (oprd == NULL) {
+        av_log(ctx, AV_LOG_ERROR, "Could not find output in model\n");
+        return DNN_ERROR;
+    }
+    if (oprd->dims[0] != nb_tasks) {
+        av_log(ctx, AV_LOG_ERROR, "The model output does not have one entry per input frame\n");
+        return DNN_ERROR;
+    }
+    frame_length = oprd->length / nb_tasks;
 
-        output.data = oprd->data;
-        output.height = oprd->dims[1];
-        output.width = oprd->dims[2];
-        output.channels = oprd->dims[3];
-        output.dt = oprd->data_type;
+    output.height = oprd->dims[1];
+    output.width = oprd->dims[2];
+    output.channels = oprd->dims[3];
+    output.dt = oprd->data_type;
+    for (int i = 0; i < nb_tasks; ++i) {
+        AVFrame *out_frame = tasks[i]->out_frame;
+        output.data = (uint8_t *)oprd->data + i * frame_length;
 
         if (do_ioproc) {
             if (native_model->model->post_proc != NULL) {
@@ -384,6 +430,7 @@ DNNReturnType ff_dnn_execute_model_native(const DNNModel *model, const char *inp
 {
     NativeModel *native_model = (NativeModel *)model->model;
     NativeContext *ctx = &native_model->ctx;
+    TaskItem task, *tasks = &task;
 
     if (!in_frame) {
         av_log(ctx, AV_LOG_ERROR, "in frame is NULL when execute model.\n");
@@ -395,7 +442,110 @@ DNNReturnType ff_dnn_execute_model_native(const DNNModel *model, const char *inp
         return DNN_ERROR;
     }
 
-    return execute_model_native(model, input_name, in_frame, output_names, nb_output, out_frame, 1);
+    if (nb_output != 1) {
+        // currently, the filter does not need multiple outputs,
+        // so we just pending the support until we really need it.
+        av_log(ctx, AV_LOG_ERROR, "do not support multiple outputs\n");
+        return DNN_ERROR;
+    }
+
+    task.input_name = input_name;
+    task.in_frame = in_frame;
+    task.output_name = output_names[0];
+    task.out_frame = out_frame;
+    return execute_model_native(native_model, &tasks, 1, 1);
+}
+
+static void free_task(TaskItem **task)
+{
+    av_frame_free(&(*task)->in_frame);
+    av_frame_free(&(*task)->out_frame);
+    av_freep(task);
+}
+
+static DNNReturnType execute_pending_tasks(NativeModel *native_model)
+{
+    DNNReturnType ret;
+    int i;
+
+    ret = execute_model_native(native_model, native_model->pending_tasks,
+                               native_model->nb_pending_tasks, 1);
+    for (i = 0; i < native_model->nb_pending_tasks; i++) {
+        if (ret == DNN_SUCCESS && ff_queue_push_back(native_model->task_queue,
+                                                     native_model->pending_tasks[i]) < 0) {
+            av_log(&native_model->ctx, AV_LOG_ERROR, "unable to push back task_queue.\n");
+            ret = DNN_ERROR;
+        }
+        if (ret != DNN_SUCCESS)
+            free_task(&native_model->pending_tasks[i]);
+    }
+    native_model->nb_pending_tasks = 0;
+    return ret;
+}
+
+DNNReturnType ff_dnn_execute_model_async_native(const DNNModel *model, const char *input_name, AVFrame *in_frame,
+                                                const char **output_names, uint32_t nb_output, AVFrame *out_frame)
+{
+    NativeModel *native_model = (NativeModel *)model->model;
+    NativeContext *ctx = &native_model->ctx;
+    TaskItem *task;
+
+    if (!in_frame) {
+        av_log(ctx, AV_LOG_ERROR, "in frame is NULL when async execute model.\n");
+        return DNN_ERROR;
+    }
+
+    if (!out_frame) {
+        av_log(ctx, AV_LOG_ERROR, "out frame is NULL when async execute model.\n");
+        return DNN_ERROR;
+    }
+
+    if (nb_output != 1) {
+        av_log(ctx, AV_LOG_ERROR, "do not support multiple outputs\n");
+        return DNN_ERROR;
+    }
+
+    task = av_malloc(sizeof(*task));
+    if (!task) {
+        av_log(ctx, AV_LOG_ERROR, "unable to alloc memory for task item.\n");
+        return DNN_ERROR;
+    }
+    task->input_name = input_name;
+    task->in_frame = in_frame;
+    task->output_name = output_names[0];
+    task->out_frame = out_frame;
+
+    // the frames are kept until a whole batch can be run at once
+    native_model->pending_tasks[native_model->nb_pending_tasks++] = task;
+    if (native_model->nb_pending_tasks < ctx->options.batch_size)
+        return DNN_SUCCESS;
+
+    return execute_pending_tasks(native_model);
+}
+
+DNNAsyncStatusType ff_dnn_get_async_result_native(const DNNModel *model, AVFrame **in, AVFrame **out)
+{
+    NativeModel *native_model = (NativeModel *)model->model;
+    TaskItem *task = ff_queue_pop_front(native_model->task_queue);
+
+    if (!task)
+        return native_model->nb_pending_tasks ? DAST_NOT_READY : DAST_EMPTY_QUEUE;
+
+    *in = task->in_frame;
+    *out = task->out_frame;
+    av_freep(&task);
+
+    return DAST_SUCCESS;
+}
+
+DNNReturnType ff_dnn_flush_native(const DNNModel *model)
+{
+    NativeModel *native_model = (NativeModel *)model->model;
+
+    if (!native_model->nb_pending_tasks)
+        return DNN_SUCCESS;
+
+    return execute_pending_tasks(native_model);
 }
 
 int32_t calculate_operand_dims_count(const DnnOperand *oprd)
@@ -419,6 +569,58 @@ int32_t calculate_operand_data_length(const DnnOperand* oprd)
     return len;
 }
 
+int dnn_native_realloc_operand(DnnOperand *oprd)
+{
+    if (oprd->data && oprd->capacity >= oprd->length)
+        return 0;
+
+    av_freep(&oprd->data);
+    oprd->capacity = 0;
+    oprd->data = av_malloc(oprd->length);
+    if (!oprd->data)
+        return AVERROR(ENOMEM);
+    oprd->capacity = oprd->length;
+    return 0;
+}
+
+int dnn_native_get_nb_jobs(const NativeContext *ctx, int nb_units)
+{
+    if (!ctx || !ctx->slicethread)
+        return 1;
+    return av_clip(nb_units, 1, ctx->nb_threads);
+}
+
+void dnn_native_execute_jobs(NativeContext *ctx, DNNNativeJobFunc func, void *arg, int nb_jobs)
+{
+    if (!ctx || !ctx->slicethread || nb_jobs <= 1) {
+        for (int i = 0; i < nb_jobs; i++)
+            func(arg, i, nb_jobs);
+        return;
+    }
+
+    ctx->job_func = func;
+    ctx->job_arg = arg;
+    avpriv_slicethread_execute(ctx->slicethread, nb_jobs, 0);
+}
+
+static void log_layer_timing(NativeModel *native_model)
+{
+    NativeContext *ctx = &native_model->ctx;
+    int64_t total = 0;
+
+    for (int layer = 0; layer < native_model->layers_num; ++layer)
+        total += native_model->layers[layer].exec_time;
+
+    av_log(ctx, AV_LOG_INFO, "%"PRId64" runs, %.3f ms per run\n", native_model->nb_runs,
+           total / 1000.0 / native_model->nb_runs);
+    for (int layer = 0; layer < native_model->layers_num; ++layer) {
+        const Layer *l = &native_model->layers[layer];
+        av_log(ctx, AV_LOG_INFO, "layer %d %-12s %10.3f ms per run %6.2f%%\n", layer,
+               layer_funcs[l->type].name, l->exec_time / 1000.0 / native_model->nb_runs,
+               total ? 100.0 * l->exec_time / total : 0.0);
+    }
+}
+
 void ff_dnn_free_model_native(DNNModel **model)
 {
     NativeModel *native_model;
@@ -429,12 +631,15 @@ void ff_dnn_free_model_native(DNNModel **model)
     {
         if ((*model)->model) {
             native_model = (NativeModel *)(*model)->model;
+            if (native_model->ctx.options.layer_timing && native_model->nb_runs && native_model->layers)
+                log_layer_timing(native_model);
             if (native_model->layers) {
                 for (layer = 0; layer < native_model->layers_num; ++layer){
                     if (native_model->layers[layer].type == DLT_CONV2D){
                         conv_params = (ConvolutionalParams *)native_model->layers[layer].params;
                         av_freep(&conv_params->kernel);
                         av_freep(&conv_params->biases);
+                        dnn_uninit_layer_conv2d(conv_params);
                     }
                     av_freep(&native_model->layers[layer].params);
                 }
@@ -447,6 +652,19 @@ void ff_dnn_free_model_native(DNNModel **model)
                 av_freep(&native_model->operands);
             }
 
+            for (int i = 0; i < native_model->nb_pending_tasks; i++)
+                free_task(&native_model->pending_tasks[i]);
+            av_freep(&native_model->pending_tasks);
+            if (native_model->task_queue) {
+                while (ff_queue_size(native_model->task_queue) != 0) {
+                    TaskItem *task = ff_queue_pop_front(native_model->task_queue);
+                    free_task(&task);
+                }
+                ff_queue_destroy(native_model->task_queue);
+            }
+
+            avpriv_slicethread_free(&native_model->ctx.slicethread);
+
             av_freep(&native_model);
         }
         av_freep(model);
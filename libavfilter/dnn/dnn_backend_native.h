@@ -30,6 +30,8 @@
 #include "../dnn_interface.h"
 #include "libavformat/avio.h"
 #include "libavutil/opt.h"
+#include "libavutil/slicethread.h"
+#include "queue.h"
 
 /**
  * the enum value of DNNLayerType should not be changed,
@@ -63,6 +65,9 @@ typedef struct Layer{
     int32_t input_operand_indexes[4];
     int32_t output_operand_index;
     void *params;
+
+    // accumulated execution time in microseconds, if layer_timing is set
+    int64_t exec_time;
 } Layer;
 
 typedef struct DnnOperand{
@@ -103,6 +108,12 @@ typedef struct DnnOperand{
     void *data;
     int32_t length;
     int32_t usedNumbersLeft;
+
+    /**
+     * allocated size of data in bytes, only valid if data is not NULL.
+     * the buffer only grows, so that it is reused between frames.
+     */
+    int32_t capacity;
 }DnnOperand;
 
 typedef struct InputParams{
@@ -110,12 +121,25 @@ typedef struct InputParams{
 } InputParams;
 
 typedef struct NativeOptions{
-    uint32_t conv2d_threads;
+    uint32_t threads;
+    uint32_t batch_size;
+    int layer_timing;
 } NativeOptions;
 
+/**
+ * function run by the worker pool, processing job jobnr out of nb_jobs.
+ */
+typedef void (*DNNNativeJobFunc)(void *arg, int jobnr, int nb_jobs);
+
 typedef struct NativeContext {
     const AVClass *class;
     NativeOptions options;
+
+    // worker pool shared by all layers, NULL if the layers run in the caller thread
+    AVSliceThread *slicethread;
+    int nb_threads;
+    DNNNativeJobFunc job_func;
+    void *job_arg;
 } NativeContext;
 
 // Represents simple feed-forward convolutional network.
@@ -126,6 +150,12 @@ typedef struct NativeModel{
     int32_t layers_num;
     DnnOperand *operands;
     int32_t operands_num;
+    int64_t nb_runs;
+
+    /* for async execution */
+    struct TaskItem **pending_tasks;  // tasks waiting for a full batch
+    int nb_pending_tasks;
+    FFQueue *task_queue;              // executed tasks, holds TaskItem
 } NativeModel;
 
 DNNModel *ff_dnn_load_model_native(const char *model_filename, const char *options, AVFilterContext *filter_ctx);
@@ -133,10 +163,38 @@ DNNModel *ff_dnn_load_model_native(const char *model_filename, const char *optio
 DNNReturnType ff_dnn_execute_model_native(const DNNModel *model, const char *input_name, AVFrame *in_frame,
                                           const char **output_names, uint32_t nb_output, AVFrame *out_frame);
 
+DNNReturnType ff_dnn_execute_model_async_native(const DNNModel *model, const char *input_name, AVFrame *in_frame,
+                                                const char **output_names, uint32_t nb_output, AVFrame *out_frame);
+
+DNNAsyncStatusType ff_dnn_get_async_result_native(const DNNModel *model, AVFrame **in, AVFrame **out);
+
+DNNReturnType ff_dnn_flush_native(const DNNModel *model);
+
 void ff_dnn_free_model_native(DNNModel **model);
 
 // NOTE: User must check for error (return value <= 0) to handle
 // case like integer overflow.
 int32_t calculate_operand_data_length(const DnnOperand *oprd);
 int32_t calculate_operand_dims_count(const DnnOperand *oprd);
+
+/**
+ * Make sure the data of the operand can hold length bytes, reusing the
+ * current buffer if it is large enough. The content is not preserved.
+ *
+ * @return 0 on success, a negative AVERROR on failure
+ */
+int dnn_native_realloc_operand(DnnOperand *oprd);
+
+/**
+ * Get the number of jobs to split work made of nb_units independent units
+ * into, which is 1 if ctx is NULL or has no worker pool.
+ */
+int dnn_native_get_nb_jobs(const NativeContext *ctx, int nb_units);
+
+/**
+ * Run func for the jobs 0 to nb_jobs - 1 on the worker pool of ctx and wait
+ * for them to finish. The jobs are run in the caller thread if ctx is NULL
+ * or has no worker pool.
+ */
+void dnn_native_execute_jobs(NativeContext *ctx, DNNNativeJobFunc func, void *arg, int nb_jobs);
 #endif
@@ -55,21 +55,72 @@ int dnn_load_layer_avg_pool(Layer *layer, AVIOContext *model_file_context, int f
     return dnn_size;
 }
 
+typedef struct AvgPoolThreadParam {
+    const AvgPoolParams *avgpool_params;
+    const float *input;
+    float *output;
+    int number, height, width, channel;
+    int height_radius, width_radius;
+    int output_height, output_width;
+} AvgPoolThreadParam;
+
+static void avg_pool_thread(void *arg, int jobnr, int nb_jobs)
+{
+    const AvgPoolThreadParam *thread_param = arg;
+    const AvgPoolParams *avgpool_params = thread_param->avgpool_params;
+    int kernel_strides = avgpool_params->strides;
+    int height = thread_param->height;
+    int width = thread_param->width;
+    int channel = thread_param->channel;
+    int src_linesize = width * channel;
+    int output_height = thread_param->output_height;
+    int output_width = thread_param->output_width;
+    int row_start = thread_param->number * output_height * jobnr / nb_jobs;
+    int row_end = thread_param->number * output_height * (jobnr + 1) / nb_jobs;
+    float *output = thread_param->output + row_start * output_width * channel;
+    int kernel_area;
+
+    for (int row = row_start; row < row_end; ++row) {
+        const float *input = thread_param->input + row / output_height * height * src_linesize;
+        int y = row % output_height * kernel_strides;
+        for (int x = 0; x < output_width * kernel_strides; x += kernel_strides) {
+            for (int n_channel = 0; n_channel < channel; ++n_channel) {
+                output[n_channel] = 0.0;
+                kernel_area = 0;
+                for (int kernel_y = 0; kernel_y < avgpool_params->kernel_size; ++kernel_y) {
+                    for (int kernel_x = 0; kernel_x < avgpool_params->kernel_size; ++kernel_x) {
+                        float input_pel;
+                        int y_pos = y + (kernel_y - thread_param->height_radius);
+                        int x_pos = x + (kernel_x - thread_param->width_radius);
+                        if (x_pos < 0 || x_pos >= width || y_pos < 0 || y_pos >= height) {
+                            input_pel = 0.0;
+                        } else {
+                            kernel_area++;
+                            input_pel = input[y_pos * src_linesize + x_pos * channel + n_channel];
+                        }
+                        output[n_channel] += input_pel;
+                    }
+                }
+                output[n_channel] /= kernel_area;
+            }
+            output += channel;
+        }
+    }
+}
+
 int dnn_execute_layer_avg_pool(DnnOperand *operands, const int32_t *input_operand_indexes,
                              int32_t output_operand_index, const void *parameters, NativeContext *ctx)
 {
-    float *output;
-    int height_end, width_end, height_radius, width_radius, output_height, output_width, kernel_area;
+    AvgPoolThreadParam thread_param;
+    int height_radius, width_radius, output_height, output_width;
     int32_t input_operand_index = input_operand_indexes[0];
     int number = operands[input_operand_index].dims[0];
     int height = operands[input_operand_index].dims[1];
     int width = operands[input_operand_index].dims[2];
     int channel = operands[input_operand_index].dims[3];
-    const float *input = operands[input_operand_index].data;
     const AvgPoolParams *avgpool_params = (const AvgPoolParams *)parameters;
 
     int kernel_strides = avgpool_params->strides;
-    int src_linesize = width * channel;
     DnnOperand *output_operand = &operands[output_operand_index];
 
     /**
@@ -82,8 +133,6 @@ int dnn_execute_layer_avg_pool(DnnOperand *operands, const int32_t *input_operan
      *                       and 7 - 2 - 2 = 3 lines after the last line of input image.
      */
     if (avgpool_params->padding_method == SAME) {
-        height_end = height;
-        width_end = width;
         height_radius = avgpool_params->kernel_size - ((height - 1) % kernel_strides + 1);
         width_radius = avgpool_params->kernel_size - ((width - 1) % kernel_strides + 1);
         height_radius = height_radius < 0 ? 0 : height_radius >> 1;
@@ -92,8 +141,6 @@ int dnn_execute_layer_avg_pool(DnnOperand *operands, const int32_t *input_operan
         output_width = ceil(width / (kernel_strides * 1.0));
     } else {
         av_assert0(avgpool_params->padding_method == VALID);
-        height_end = height - avgpool_params->kernel_size + 1;
-        width_end = width - avgpool_params->kernel_size + 1;
         height_radius = 0;
         width_radius = 0;
         output_height = ceil((height - avgpool_params->kernel_size + 1) / (kernel_strides * 1.0));
@@ -111,37 +158,24 @@ int dnn_execute_layer_avg_pool(DnnOperand *operands, const int32_t *input_operan
         av_log(ctx, AV_LOG_ERROR, "The output data length overflow\n");
         return DNN_ERROR;
     }
-    output_operand->data = av_realloc(output_operand->data, output_operand->length);
-    if (!output_operand->data) {
+    if (dnn_native_realloc_operand(output_operand) < 0) {
         av_log(ctx, AV_LOG_ERROR, "Failed to reallocate memory for output\n");
         return DNN_ERROR;
     }
-    output = output_operand->data;
-
-    for (int y = 0; y < height_end; y += kernel_strides) {
-        for (int x = 0; x < width_end; x += kernel_strides) {
-            for (int n_channel = 0; n_channel < channel; ++n_channel) {
-                output[n_channel] = 0.0;
-                kernel_area = 0;
-                for (int kernel_y = 0; kernel_y < avgpool_params->kernel_size; ++kernel_y) {
-                    for (int kernel_x = 0; kernel_x < avgpool_params->kernel_size; ++kernel_x) {
-                        float input_pel;
-                        int y_pos = y + (kernel_y - height_radius);
-                        int x_pos = x + (kernel_x - width_radius);
-                        if (x_pos < 0 || x_pos >= width || y_pos < 0 || y_pos >= height) {
-                            input_pel = 0.0;
-                        } else {
-                            kernel_area++;
-                            input_pel = input[y_pos * src_linesize + x_pos * channel + n_channel];
-                        }
-                        output[n_channel] += input_pel;
-                    }
-                }
-                output[n_channel] /= kernel_area;
-            }
-            output += channel;
-        }
-    }
+    // the output rows of all the frames of the batch are split among the jobs
+    thread_param.avgpool_params = avgpool_params;
+    thread_param.input = operands[input_operand_index].data;
+    thread_param.output = output_operand->data;
+    thread_param.number = number;
+    thread_param.height = height;
+    thread_param.width = width;
+    thread_param.channel = channel;
+    thread_param.height_radius = height_radius;
+    thread_param.width_radius = width_radius;
+    thread_param.output_height = output_height;
+    thread_param.output_width = output_width;
+    dnn_native_execute_jobs(ctx, avg_pool_thread, &thread_param,
+                            dnn_native_get_nb_jobs(ctx, number * output_height));
 
     return 0;
 }
@@ -18,13 +18,15 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 
+#include "libavutil/attributes.h"
 #include "libavutil/avassert.h"
-#include "libavutil/thread.h"
-#include "libavutil/cpu.h"
 #include "dnn_backend_native_layer_conv2d.h"
 
 #define CLAMP_TO_EDGE(x, w) ((x) < 0 ? 0 : ((x) >= (w) ? (w - 1) : (x)))
 
+// number of output pixels whose patches are gathered before each gemm call
+#define GEMM_TILE 64
+
 //struct to pass parameters
 typedef struct thread_common_param{
     DnnOperand *operands;
@@ -33,12 +35,77 @@ typedef struct thread_common_param{
     const void *parameters;
     NativeContext *ctx;
     float *output_data;
+
+    // per job space for GEMM_TILE patches followed by GEMM_TILE gemm outputs
+    float *scratch;
+    int scratch_size;
 } thread_common_param;
 
-typedef struct thread_param{
-    thread_common_param *thread_common_param;
-    int thread_start, thread_end;
-} thread_param;
+static void conv2d_gemm_c(float *dst, const float *patches, const float *kernel, const float *bias,
+                          int nb_pixels, int patch_size, int output_num)
+{
+    for (int p = 0; p < nb_pixels; ++p) {
+        for (int n = 0; n < output_num; ++n)
+            dst[n] = bias[n];
+        for (int k = 0; k < patch_size; ++k) {
+            const float pel = patches[k];
+            const float *kernel_row = kernel + k * output_num;
+            for (int n = 0; n < output_num; ++n)
+                dst[n] += pel * kernel_row[n];
+        }
+        dst += output_num;
+        patches += patch_size;
+    }
+}
+
+av_cold void ff_dnn_conv2d_dsp_init(DNNConv2DDSPContext *dsp)
+{
+    dsp->gemm = conv2d_gemm_c;
+
+    if (ARCH_AARCH64)
+        ff_dnn_conv2d_dsp_init_aarch64(dsp);
+    if (ARCH_X86)
+        ff_dnn_conv2d_dsp_init_x86(dsp);
+}
+
+int dnn_init_layer_conv2d(ConvolutionalParams *conv_params)
+{
+    int patch_size = conv_params->kernel_size * conv_params->kernel_size * conv_params->input_num;
+    int output_num_aligned = FFALIGN(conv_params->output_num, 8);
+    float *gemm_biases;
+
+    conv_params->patch_size = patch_size;
+    conv_params->output_num_aligned = output_num_aligned;
+    conv_params->scratch = NULL;
+    conv_params->scratch_size = 0;
+
+    // the kernel is stored as output_num filters of patch_size values
+    conv_params->gemm_kernel = av_malloc_array((size_t)(patch_size + 1) * output_num_aligned,
+                                               sizeof(*conv_params->gemm_kernel));
+    if (!conv_params->gemm_kernel)
+        return AVERROR(ENOMEM);
+    gemm_biases = conv_params->gemm_kernel + patch_size * output_num_aligned;
+    for (int k = 0; k < patch_size; ++k) {
+        for (int n_filter = 0; n_filter < output_num_aligned; ++n_filter) {
+            conv_params->gemm_kernel[k * output_num_aligned + n_filter] = n_filter < conv_params->output_num ?
+                conv_params->kernel[n_filter * patch_size + k] : 0.f;
+        }
+    }
+    for (int n_filter = 0; n_filter < output_num_aligned; ++n_filter) {
+        gemm_biases[n_filter] = conv_params->has_bias && n_filter < conv_params->output_num ?
+                                conv_params->biases[n_filter] : 0.f;
+    }
+
+    ff_dnn_conv2d_dsp_init(&conv_params->dsp);
+    return 0;
+}
+
+void dnn_uninit_layer_conv2d(ConvolutionalParams *conv_params)
+{
+    av_freep(&conv_params->gemm_kernel);
+    av_freep(&conv_params->scratch);
+    conv_params->scratch_size = 0;
+}
 
 int dnn_load_layer_conv2d(Layer *layer, AVIOContext *model_file_context, int file_size, int operands_num)
 {
@@ -92,6 +159,13 @@ int dnn_load_layer_conv2d(Layer *layer, AVIOContext *model_file_context, int fil
         }
     }
 
+    if (dnn_init_layer_conv2d(conv_params) < 0) {
+        av_freep(&conv_params->biases);
+        av_freep(&conv_params->kernel);
+        av_freep(&conv_params);
+        return 0;
+    }
+
     layer->params = conv_params;
 
     layer->input_operand_indexes[0] = (int32_t)avio_rl32(model_file_context);
@@ -105,100 +179,108 @@ int dnn_load_layer_conv2d(Layer *layer, AVIOContext *model_file_context, int fil
     return dnn_size;
 }
 
-static void * dnn_execute_layer_conv2d_thread(void *threadarg)
+static void dnn_execute_layer_conv2d_thread(void *arg, int jobnr, int nb_jobs)
 {
     //pass parameters
-    thread_param *thread_param = (struct thread_param *)threadarg;
-    thread_common_param *thread_common_param = thread_param->thread_common_param;
+    thread_common_param *thread_common_param = arg;
     DnnOperand *operands = thread_common_param->operands;
     int32_t input_operand_index = thread_common_param->input_operand_indexes[0];
+    int number = operands[input_operand_index].dims[0];
     int height = operands[input_operand_index].dims[1];
     int width = operands[input_operand_index].dims[2];
     int channel = operands[input_operand_index].dims[3];
-    const float *input = operands[input_operand_index].data;
     const ConvolutionalParams *conv_params = (const ConvolutionalParams *)(thread_common_param->parameters);
 
     int radius = conv_params->kernel_size >> 1;
     int src_linesize = width * conv_params->input_num;
-    int filter_linesize = conv_params->kernel_size * conv_params->input_num;
-    int filter_size = conv_params->kernel_size * filter_linesize;
     int pad_size = (conv_params->padding_method == VALID) ? (conv_params->kernel_size - 1) / 2 * conv_params->dilation : 0;
+    int output_height = height - pad_size * 2;
+    int output_linesize = (width - pad_size * 2) * conv_params->output_num;
+    int patch_size = conv_params->patch_size;
+    int output_num_aligned = conv_params->output_num_aligned;
+    float *patches = thread_common_param->scratch + jobnr * thread_common_param->scratch_size;
+    float *gemm_output = patches + GEMM_TILE * patch_size;
 
-    float *output = thread_common_param->output_data;
-    output += (conv_params->output_num) * (width - 2 * pad_size) * (thread_param->thread_start - pad_size);
+    // the output rows of all the frames of the batch are split among the jobs
+    int row_start = number * output_height * jobnr / nb_jobs;
+    int row_end = number * output_height * (jobnr + 1) / nb_jobs;
 
     av_assert0(channel == conv_params->input_num);
 
-    for (int y = thread_param->thread_start; y < thread_param->thread_end; ++y) {
-        for (int x = pad_size; x < width - pad_size; ++x) {
-            for (int n_filter = 0; n_filter < conv_params->output_num; ++n_filter) {
-                if (conv_params->has_bias)
-                    output[n_filter] = conv_params->biases[n_filter];
-                else
-                    output[n_filter] = 0.f;
-
-                for (int ch = 0; ch < conv_params->input_num; ++ch) {
-                    for (int kernel_y = 0; kernel_y < conv_params->kernel_size; ++kernel_y) {
-                        for (int kernel_x = 0; kernel_x < conv_params->kernel_size; ++kernel_x) {
-                            float input_pel;
-                            if (conv_params->padding_method == SAME_CLAMP_TO_EDGE) {
-                                int y_pos = CLAMP_TO_EDGE(y + (kernel_y - radius) * conv_params->dilation, height);
-                                int x_pos = CLAMP_TO_EDGE(x + (kernel_x - radius) * conv_params->dilation, width);
-                                input_pel = input[y_pos * src_linesize + x_pos * conv_params->input_num + ch];
-                            } else {
-                                int y_pos = y + (kernel_y - radius) * conv_params->dilation;
-                                int x_pos = x + (kernel_x - radius) * conv_params->dilation;
-                                input_pel = (x_pos < 0 || x_pos >= width || y_pos < 0 || y_pos >= height) ? 0.0 :
-                                                   input[y_pos * src_linesize + x_pos * conv_params->input_num + ch];
-                            }
-
-
-                            output[n_filter] += input_pel * conv_params->kernel[n_filter * filter_size + kernel_y * filter_linesize +
-                                                                                kernel_x * conv_params->input_num + ch];
+    for (int row = row_start; row < row_end; ++row) {
+        const float *input = (const float *)operands[input_operand_index].data +
+                             row / output_height * height * src_linesize;
+        float *output = thread_common_param->output_data + row * output_linesize;
+        int y = row % output_height + pad_size;
+
+        for (int x_start = pad_size; x_start < width - pad_size; x_start += GEMM_TILE) {
+            int nb_pixels = FFMIN(GEMM_TILE, width - pad_size - x_start);
+            float *patch = patches;
+
+            // im2col: gather the input of each output pixel in kernel order
+            for (int x = x_start; x < x_start + nb_pixels; ++x) {
+                for (int kernel_y = 0; kernel_y < conv_params->kernel_size; ++kernel_y) {
+                    for (int kernel_x = 0; kernel_x < conv_params->kernel_size; ++kernel_x) {
+                        int y_pos = y + (kernel_y - radius) * conv_params->dilation;
+                        int x_pos = x + (kernel_x - radius) * conv_params->dilation;
+                        if (conv_params->padding_method == SAME_CLAMP_TO_EDGE) {
+                            y_pos = CLAMP_TO_EDGE(y_pos, height);
+                            x_pos = CLAMP_TO_EDGE(x_pos, width);
                         }
+                        if (x_pos < 0 || x_pos >= width || y_pos < 0 || y_pos >= height)
+                            memset(patch, 0, conv_params->input_num * sizeof(*patch));
+                        else
+                            memcpy(patch, input + y_pos * src_linesize + x_pos * conv_params->input_num,
+                                   conv_params->input_num * sizeof(*patch));
+                        patch += conv_params->input_num;
                     }
                 }
-                switch (conv_params->activation){
-                case RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0);
-                    break;
-                case TANH:
-                    output[n_filter] = 2.0f  / (1.0f + exp(-2.0f * output[n_filter])) - 1.0f;
-                    break;
-                case SIGMOID:
-                    output[n_filter] = 1.0f / (1.0f + exp(-output[n_filter]));
-                    break;
-                case NONE:
-                    break;
-                case LEAKY_RELU:
-                    output[n_filter] = FFMAX(output[n_filter], 0.0) + 0.2 * FFMIN(output[n_filter], 0.0);
+            }
+
+            conv_params->dsp.gemm(gemm_output, patches, conv_params->gemm_kernel,
+                                  conv_params->gemm_kernel + patch_size * output_num_aligned,
+                                  nb_pixels, patch_size, output_num_aligned);
+
+            for (int p = 0; p < nb_pixels; ++p) {
+                const float *src = gemm_output + p * output_num_aligned;
+                for (int n_filter = 0; n_filter < conv_params->output_num; ++n_filter) {
+                    switch (conv_params->activation){
+                    case RELU:
+                        output[n_filter] = FFMAX(src[n_filter], 0.0);
+                        break;
+                    case TANH:
+                        output[n_filter] = 2.0f  / (1.0f + exp(-2.0f * src[n_filter])) - 1.0f;
+                        break;
+                    case SIGMOID:
+                        output[n_filter] = 1.0f / (1.0f + exp(-src[n_filter]));
+                        break;
+                    case NONE:
+                        output[n_filter] = src[n_filter];
+                        break;
+                    case LEAKY_RELU:
+                        output[n_filter] = FFMAX(src[n_filter], 0.0) + 0.2 * FFMIN(src[n_filter], 0.0);
+                    }
                 }
+                output += conv_params->output_num;
             }
-            output += conv_params->output_num;
         }
     }
-    return (void *)DNN_SUCCESS;
 }
 
 
 int dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_operand_indexes,
                              int32_t output_operand_index, const void *parameters, NativeContext *ctx)
 {
-    int thread_num = (ctx->options.conv2d_threads <= 0 || ctx->options.conv2d_threads > av_cpu_count())
-        ? (av_cpu_count() + 1) : (ctx->options.conv2d_threads);
-#if HAVE_PTHREAD_CANCEL
-    pthread_t *thread_id = av_malloc(thread_num * sizeof(pthread_t));
-    int thread_stride;
-#endif
-    thread_param **thread_param = av_malloc(thread_num * sizeof(*thread_param));
     thread_common_param thread_common_param;
-    const ConvolutionalParams *conv_params = (const ConvolutionalParams *)(parameters);
+    ConvolutionalParams *conv_params = (ConvolutionalParams *)(parameters);
+    int number = operands[input_operand_indexes[0]].dims[0];
     int height = operands[input_operand_indexes[0]].dims[1];
     int width = operands[input_operand_indexes[0]].dims[2];
     int pad_size = (conv_params->padding_method == VALID) ? (conv_params->kernel_size - 1) / 2 * conv_params->dilation : 0;
     DnnOperand *output_operand = &operands[output_operand_index];
+    int nb_jobs;
 
-    output_operand->dims[0] = operands[input_operand_indexes[0]].dims[0];
+    output_operand->dims[0] = number;
     output_operand->dims[1] = height - pad_size * 2;
     output_operand->dims[2] = width - pad_size * 2;
     output_operand->dims[3] = conv_params->output_num;
@@ -208,11 +290,22 @@ int dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_operand_
         av_log(ctx, AV_LOG_ERROR, "The output data length overflow\n");
         return DNN_ERROR;
     }
-    output_operand->data = av_realloc(output_operand->data, output_operand->length);
-    if (!output_operand->data) {
+    if (dnn_native_realloc_operand(output_operand) < 0) {
         av_log(ctx, AV_LOG_ERROR, "Failed to reallocate memory for output\n");
         return DNN_ERROR;
     }
+
+    nb_jobs = dnn_native_get_nb_jobs(ctx, number * output_operand->dims[1]);
+    thread_common_param.scratch_size = GEMM_TILE * (conv_params->patch_size + conv_params->output_num_aligned);
+
+    av_fast_malloc(&conv_params->scratch, &conv_params->scratch_size,
+                   (size_t)nb_jobs * thread_common_param.scratch_size * sizeof(*conv_params->scratch));
+    if (!conv_params->scratch) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to allocate memory for the patches\n");
+        return DNN_ERROR;
+    }
+
+    thread_common_param.scratch = conv_params->scratch;
     thread_common_param.output_data = output_operand->data;
     thread_common_param.operands = operands;
     thread_common_param.input_operand_indexes = input_operand_indexes;
@@ -220,37 +313,7 @@ int dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_operand_
     thread_common_param.parameters = parameters;
     thread_common_param.ctx = ctx;
 
-#if HAVE_PTHREAD_CANCEL
-    thread_stride = (height - pad_size * 2) / thread_num;
-    //create threads
-    for (int i = 0; i < thread_num; i++){
-        thread_param[i] = av_malloc(sizeof(**thread_param));
-        thread_param[i]->thread_common_param = &thread_common_param;
-        thread_param[i]->thread_start = thread_stride * i + pad_size;
-        thread_param[i]->thread_end = (i == thread_num - 1) ? (height - pad_size) : (thread_param[i]->thread_start + thread_stride);
-        pthread_create(&thread_id[i], NULL, dnn_execute_layer_conv2d_thread, (void *)thread_param[i]);
-    }
-
-    //join threads, res gets function return
-    for (int i = 0; i < thread_num; i++){
-        pthread_join(thread_id[i], NULL);
-    }
+    dnn_native_execute_jobs(ctx, dnn_execute_layer_conv2d_thread, &thread_common_param, nb_jobs);
 
-    //release memory
-    av_free(thread_id);
-
-    for (int i = 0; i < thread_num; i++){
-        av_free(thread_param[i]);
-    }
-#else
-    thread_param[0] = av_malloc(sizeof(**thread_param));
-    thread_param[0]->thread_common_param = &thread_common_param;
-    thread_param[0]->thread_start = pad_size;
-    thread_param[0]->thread_end = height - pad_size;
-    dnn_execute_layer_conv2d_thread((void *)thread_param[0]);
-    av_free(thread_param[0]);
-#endif
-
-    av_free(thread_param);
     return DNN_SUCCESS;
 }
@@ -24,6 +24,19 @@
 #include "dnn_backend_native.h"
 
 
+typedef struct DNNConv2DDSPContext {
+    /**
+     * Multiply nb_pixels input patches of patch_size values, laid out one
+     * after the other as built by im2col, by the kernel and add the biases:
+     * dst[p * output_num + n] = bias[n] +
+     *     sum(patches[p * patch_size + k] * kernel[k * output_num + n]) for k < patch_size
+     *
+     * output_num is a multiple of 8, dst, kernel and bias are aligned to 32 bytes.
+     */
+    void (*gemm)(float *dst, const float *patches, const float *kernel, const float *bias,
+                 int nb_pixels, int patch_size, int output_num);
+} DNNConv2DDSPContext;
+
 typedef struct ConvolutionalParams{
     int32_t input_num, output_num, kernel_size;
     DNNActivationFunc activation;
@@ -32,8 +45,23 @@ typedef struct ConvolutionalParams{
     int32_t has_bias;
     float *kernel;
     float *biases;
+
+    /* set up by dnn_init_layer_conv2d() */
+    DNNConv2DDSPContext dsp;
+    int patch_size, output_num_aligned;
+    // kernel transposed to patch_size rows of output_num_aligned values, followed by the biases
+    float *gemm_kernel;
+    // per job space for the patches and gemm outputs, grown as needed
+    float *scratch;
+    unsigned int scratch_size;
 } ConvolutionalParams;
 
+void ff_dnn_conv2d_dsp_init(DNNConv2DDSPContext *dsp);
+void ff_dnn_conv2d_dsp_init_aarch64(DNNConv2DDSPContext *dsp);
+void ff_dnn_conv2d_dsp_init_x86(DNNConv2DDSPContext *dsp);
+
+int dnn_init_layer_conv2d(ConvolutionalParams *conv_params);
+void dnn_uninit_layer_conv2d(ConvolutionalParams *conv_params);
 int dnn_load_layer_conv2d(Layer *layer, AVIOContext *model_file_context, int file_size, int operands_num);
 int dnn_execute_layer_conv2d(DnnOperand *operands, const int32_t *input_operand_indexes,
                              int32_t output_operand_index, const void *parameters, NativeContext *ctx);
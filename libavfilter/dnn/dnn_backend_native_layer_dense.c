@@ -82,41 +82,25 @@ int dnn_load_layer_dense(Layer *layer, AVIOContext *model_file_context, int file
     return dnn_size;
 }
 
-int dnn_execute_layer_dense(DnnOperand *operands, const int32_t *input_operand_indexes,
-                             int32_t output_operand_index, const void *parameters, NativeContext *ctx)
-{
+typedef struct DenseThreadParam {
+    const DenseParams *dense_params;
+    const float *input;
     float *output;
-    int32_t input_operand_index = input_operand_indexes[0];
-    int number = operands[input_operand_index].dims[0];
-    int height = operands[input_operand_index].dims[1];
-    int width = operands[input_operand_index].dims[2];
-    int channel = operands[input_operand_index].dims[3];
-    const float *input = operands[input_operand_index].data;
-    const DenseParams *dense_params = (const DenseParams *)parameters;
-
-    int src_linesize = width * channel;
-    DnnOperand *output_operand = &operands[output_operand_index];
-    output_operand->dims[0] = number;
-    output_operand->dims[1] = height;
-    output_operand->dims[2] = width;
-    output_operand->dims[3] = dense_params->output_num;
-    output_operand->data_type = operands[input_operand_index].data_type;
-    output_operand->length = calculate_operand_data_length(output_operand);
-    if (output_operand->length <= 0) {
-        av_log(ctx, AV_LOG_ERROR, "The output data length overflow\n");
-        return DNN_ERROR;
-    }
-    output_operand->data = av_realloc(output_operand->data, output_operand->length);
-    if (!output_operand->data) {
-        av_log(ctx, AV_LOG_ERROR, "Failed to reallocate memory for output\n");
-        return DNN_ERROR;
-    }
-    output = output_operand->data;
+    int rows;
+    int width;
+} DenseThreadParam;
 
-    av_assert0(channel == dense_params->input_num);
-
-    for (int y = 0; y < height; ++y) {
-        for (int x = 0; x < width; ++x) {
+static void dense_thread(void *arg, int jobnr, int nb_jobs)
+{
+    const DenseThreadParam *thread_param = arg;
+    const DenseParams *dense_params = thread_param->dense_params;
+    int src_linesize = thread_param->width * dense_params->input_num;
+    int row_start = thread_param->rows * jobnr / nb_jobs;
+    int row_end = thread_param->rows * (jobnr + 1) / nb_jobs;
+    float *output = thread_param->output + row_start * thread_param->width * dense_params->output_num;
+
+    for (int y = row_start; y < row_end; ++y) {
+        for (int x = 0; x < thread_param->width; ++x) {
             for (int n_filter = 0; n_filter < dense_params->output_num; ++n_filter) {
                 if (dense_params->has_bias)
                     output[n_filter] = dense_params->biases[n_filter];
@@ -125,7 +109,7 @@ int dnn_execute_layer_dense(DnnOperand *operands, const int32_t *input_operand_i
 
                 for (int ch = 0; ch < dense_params->input_num; ++ch) {
                     float input_pel;
-                    input_pel = input[y * src_linesize + x * dense_params->input_num + ch];
+                    input_pel = thread_param->input[y * src_linesize + x * dense_params->input_num + ch];
                     output[n_filter] += input_pel * dense_params->kernel[n_filter*dense_params->input_num + ch];
                 }
                 switch (dense_params->activation){
@@ -147,5 +131,44 @@ int dnn_execute_layer_dense(DnnOperand *operands, const int32_t *input_operand_i
             output += dense_params->output_num;
         }
     }
+}
+
+int dnn_execute_layer_dense(DnnOperand *operands, const int32_t *input_operand_indexes,
+                             int32_t output_operand_index, const void *parameters, NativeContext *ctx)
+{
+    DenseThreadParam thread_param;
+    int32_t input_operand_index = input_operand_indexes[0];
+    int number = operands[input_operand_index].dims[0];
+    int height = operands[input_operand_index].dims[1];
+    int width = operands[input_operand_index].dims[2];
+    int channel = operands[input_operand_index].dims[3];
+    const DenseParams *dense_params = (const DenseParams *)parameters;
+
+    DnnOperand *output_operand = &operands[output_operand_index];
+    output_operand->dims[0] = number;
+    output_operand->dims[1] = height;
+    output_operand->dims[2] = width;
+    output_operand->dims[3] = dense_params->output_num;
+    output_operand->data_type = operands[input_operand_index].data_type;
+    output_operand->length = calculate_operand_data_length(output_operand);
+    if (output_operand->length <= 0) {
+        av_log(ctx, AV_LOG_ERROR, "The output data length overflow\n");
+        return DNN_ERROR;
+    }
+    if (dnn_native_realloc_operand(output_operand) < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to reallocate memory for output\n");
+        return DNN_ERROR;
+    }
+
+    av_assert0(channel == dense_params->input_num);
+
+    // every pixel is processed on its own, so the rows of all frames are split among the jobs
+    thread_param.dense_params = dense_params;
+    thread_param.input = operands[input_operand_index].data;
+    thread_param.output = output_operand->data;
+    thread_param.rows = number * height;
+    thread_param.width = width;
+    dnn_native_execute_jobs(ctx, dense_thread, &thread_param,
+                            dnn_native_get_nb_jobs(ctx, thread_param.rows));
     return 0;
 }
@@ -49,10 +49,50 @@ int dnn_load_layer_depth2space(Layer *layer, AVIOContext *model_file_context, in
     return dnn_size;
 }
 
+typedef struct DepthToSpaceThreadParam {
+    const float *input;
+    float *output;
+    int rows;
+    int width;
+    int channels;
+    int block_size;
+} DepthToSpaceThreadParam;
+
+static void depth2space_thread(void *arg, int jobnr, int nb_jobs)
+{
+    const DepthToSpaceThreadParam *thread_param = arg;
+    int block_size = thread_param->block_size;
+    int width = thread_param->width;
+    int channels = thread_param->channels;
+    int x, by, bx, ch;
+    int new_channels = channels / (block_size * block_size);
+    int output_linesize = width * channels;
+    int by_linesize = output_linesize / block_size;
+    int x_linesize = new_channels * block_size;
+    int row_start = thread_param->rows * jobnr / nb_jobs;
+    int row_end = thread_param->rows * (jobnr + 1) / nb_jobs;
+    const float *input = thread_param->input + row_start * output_linesize;
+    float *output = thread_param->output + row_start * output_linesize;
+
+    for (int y = row_start; y < row_end; ++y){
+        for (x = 0; x < width; ++x){
+            for (by = 0; by < block_size; ++by){
+                for (bx = 0; bx < block_size; ++bx){
+                    for (ch = 0; ch < new_channels; ++ch){
+                        output[by * by_linesize + x * x_linesize + bx * new_channels + ch] = input[ch];
+                    }
+                    input += new_channels;
+                }
+            }
+        }
+        output += output_linesize;
+    }
+}
+
 int dnn_execute_layer_depth2space(DnnOperand *operands, const int32_t *input_operand_indexes,
                                   int32_t output_operand_index, const void *parameters, NativeContext *ctx)
 {
-    float *output;
+    DepthToSpaceThreadParam thread_param;
     const DepthToSpaceParams *params = (const DepthToSpaceParams *)parameters;
     int block_size = params->block_size;
     int32_t input_operand_index = input_operand_indexes[0];
@@ -60,13 +100,7 @@ int dnn_execute_layer_depth2space(DnnOperand *operands, const int32_t *input_ope
     int height = operands[input_operand_index].dims[1];
     int width = operands[input_operand_index].dims[2];
     int channels = operands[input_operand_index].dims[3];
-    const float *input = operands[input_operand_index].data;
-
-    int y, x, by, bx, ch;
     int new_channels = channels / (block_size * block_size);
-    int output_linesize = width * channels;
-    int by_linesize = output_linesize / block_size;
-    int x_linesize = new_channels * block_size;
 
     DnnOperand *output_operand = &operands[output_operand_index];
     output_operand->dims[0] = number;
@@ -79,25 +113,19 @@ int dnn_execute_layer_depth2space(DnnOperand *operands, const int32_t *input_ope
         av_log(ctx, AV_LOG_ERROR, "The output data length overflow\n");
         return DNN_ERROR;
     }
-    output_operand->data = av_realloc(output_operand->data, output_operand->length);
-    if (!output_operand->data) {
+    if (dnn_native_realloc_operand(output_operand) < 0) {
         av_log(ctx, AV_LOG_ERROR, "Failed to reallocate memory for output\n");
         return DNN_ERROR;
     }
-    output = output_operand->data;
 
-    for (y = 0; y < height; ++y){
-        for (x = 0; x < width; ++x){
-            for (by = 0; by < block_size; ++by){
-                for (bx = 0; bx < block_size; ++bx){
-                    for (ch = 0; ch < new_channels; ++ch){
-                        output[by * by_linesize + x * x_linesize + bx * new_channels + ch] = input[ch];
-                    }
-                    input += new_channels;
-                }
-            }
-        }
-        output += output_linesize;
-    }
+    // each input row maps to block_size whole output rows, also across the frames of a batch
+    thread_param.input = operands[input_operand_index].data;
+    thread_param.output = output_operand->data;
+    thread_param.rows = number * height;
+    thread_param.width = width;
+    thread_param.channels = channels;
+    thread_param.block_size = block_size;
+    dnn_native_execute_jobs(ctx, depth2space_thread, &thread_param,
+                            dnn_native_get_nb_jobs(ctx, thread_param.rows));
     return 0;
 }
@@ -55,46 +55,57 @@ static float floormod(float src0, float src1)
     return (float)((int)(src0) % (int)(src1));
 }
 
-static void math_binary_commutative(FunType pfun, const DnnLayerMathBinaryParams *params, const DnnOperand *input, DnnOperand *output, DnnOperand *operands, const int32_t *input_operand_indexes)
-{
-    int dims_count;
+typedef struct MathBinaryThreadParam {
+    FunType pfun;
+    const DnnLayerMathBinaryParams *params;
     const float *src;
+    const float *src1;
     float *dst;
-    dims_count = calculate_operand_dims_count(output);
-    src = input->data;
-    dst = output->data;
+    int dims_count;
+} MathBinaryThreadParam;
+
+static void math_binary_commutative(void *arg, int jobnr, int nb_jobs)
+{
+    const MathBinaryThreadParam *thread_param = arg;
+    const DnnLayerMathBinaryParams *params = thread_param->params;
+    FunType pfun = thread_param->pfun;
+    const float *src = thread_param->src;
+    float *dst = thread_param->dst;
+    int start = thread_param->dims_count * (int64_t)jobnr / nb_jobs;
+    int end = thread_param->dims_count * (int64_t)(jobnr + 1) / nb_jobs;
+
     if (params->input0_broadcast || params->input1_broadcast) {
-        for (int i = 0; i < dims_count; ++i) {
+        for (int i = start; i < end; ++i) {
             dst[i] = pfun(params->v, src[i]);
         }
     } else {
-        const DnnOperand *input1 = &operands[input_operand_indexes[1]];
-        const float *src1 = input1->data;
-        for (int i = 0; i < dims_count; ++i) {
+        const float *src1 = thread_param->src1;
+        for (int i = start; i < end; ++i) {
             dst[i] = pfun(src[i], src1[i]);
         }
     }
 }
-static void math_binary_not_commutative(FunType pfun, const DnnLayerMathBinaryParams *params, const DnnOperand *input, DnnOperand *output, DnnOperand *operands, const int32_t *input_operand_indexes)
+static void math_binary_not_commutative(void *arg, int jobnr, int nb_jobs)
 {
-    int dims_count;
-    const float *src;
-    float *dst;
-    dims_count = calculate_operand_dims_count(output);
-    src = input->data;
-    dst = output->data;
+    const MathBinaryThreadParam *thread_param = arg;
+    const DnnLayerMathBinaryParams *params = thread_param->params;
+    FunType pfun = thread_param->pfun;
+    const float *src = thread_param->src;
+    float *dst = thread_param->dst;
+    int start = thread_param->dims_count * (int64_t)jobnr / nb_jobs;
+    int end = thread_param->dims_count * (int64_t)(jobnr + 1) / nb_jobs;
+
     if (params->input0_broadcast) {
-        for (int i = 0; i < dims_count; ++i) {
+        for (int i = start; i < end; ++i) {
             dst[i] = pfun(params->v, src[i]);
         }
     } else if (params->input1_broadcast) {
-        for (int i = 0; i < dims_count; ++i) {
+        for (int i = start; i < end; ++i) {
             dst[i] = pfun(src[i], params->v);
         }
     } else {
-        const DnnOperand *input1 = &operands[input_operand_indexes[1]];
-        const float *src1 = input1->data;
-        for (int i = 0; i < dims_count; ++i) {
+        const float *src1 = thread_param->src1;
+        for (int i = start; i < end; ++i) {
             dst[i] = pfun(src[i], src1[i]);
         }
     }
@@ -154,6 +165,8 @@ int dnn_execute_layer_math_binary(DnnOperand *operands, const int32_t *input_ope
     const DnnOperand *input = &operands[input_operand_indexes[0]];
     DnnOperand *output = &operands[output_operand_index];
     const DnnLayerMathBinaryParams *params = (const DnnLayerMathBinaryParams *)parameters;
+    MathBinaryThreadParam thread_param;
+    int nb_jobs;
 
     for (int i = 0; i < 4; ++i)
         output->dims[i] = input->dims[i];
@@ -164,30 +177,43 @@ int dnn_execute_layer_math_binary(DnnOperand *operands, const int32_t *input_ope
         av_log(ctx, AV_LOG_ERROR, "The output data length overflow\n");
         return DNN_ERROR;
     }
-    output->data = av_realloc(output->data, output->length);
-    if (!output->data) {
+    if (dnn_native_realloc_operand(output) < 0) {
         av_log(ctx, AV_LOG_ERROR, "Failed to reallocate memory for output\n");
         return DNN_ERROR;
     }
 
+    thread_param.params = params;
+    thread_param.src = input->data;
+    thread_param.src1 = params->input0_broadcast || params->input1_broadcast ? NULL :
+                        operands[input_operand_indexes[1]].data;
+    thread_param.dst = output->data;
+    thread_param.dims_count = calculate_operand_dims_count(output);
+    nb_jobs = dnn_native_get_nb_jobs(ctx, thread_param.dims_count);
+
     switch (params->bin_op) {
     case DMBO_SUB:
-        math_binary_not_commutative(sub, params, input, output, operands, input_operand_indexes);
+        thread_param.pfun = sub;
+        dnn_native_execute_jobs(ctx, math_binary_not_commutative, &thread_param, nb_jobs);
         return 0;
     case DMBO_ADD:
-        math_binary_commutative(add, params, input, output, operands, input_operand_indexes);
+        thread_param.pfun = add;
+        dnn_native_execute_jobs(ctx, math_binary_commutative, &thread_param, nb_jobs);
         return 0;
     case DMBO_MUL:
-        math_binary_commutative(mul, params, input, output, operands, input_operand_indexes);
+        thread_param.pfun = mul;
+        dnn_native_execute_jobs(ctx, math_binary_commutative, &thread_param, nb_jobs);
         return 0;
     case DMBO_REALDIV:
-        math_binary_not_commutative(realdiv, params, input, output, operands, input_operand_indexes);
+        thread_param.pfun = realdiv;
+        dnn_native_execute_jobs(ctx, math_binary_not_commutative, &thread_param, nb_jobs);
         return 0;
     case DMBO_MINIMUM:
-        math_binary_commutative(minimum, params, input, output, operands, input_operand_indexes);
+        thread_param.pfun = minimum;
+        dnn_native_execute_jobs(ctx, math_binary_commutative, &thread_param, nb_jobs);
         return 0;
     case DMBO_FLOORMOD:
-        math_binary_not_commutative(floormod, params, input, output, operands, input_operand_indexes);
+        thread_param.pfun = floormod;
+        dnn_native_execute_jobs(ctx, math_binary_not_commutative, &thread_param, nb_jobs);
         return 0;
     default:
         av_log(ctx, AV_LOG_ERROR, "Unmatch math binary operator\n");
@@ -52,102 +52,123 @@ int dnn_load_layer_math_unary(Layer *layer, AVIOContext *model_file_context, int
 
 }
 
-int dnn_execute_layer_math_unary(DnnOperand *operands, const int32_t *input_operand_indexes,
-                                int32_t output_operand_index, const void *parameters, NativeContext *ctx)
-{
-    const DnnOperand *input = &operands[input_operand_indexes[0]];
-    DnnOperand *output = &operands[output_operand_index];
-    const DnnLayerMathUnaryParams *params = (const DnnLayerMathUnaryParams *)parameters;
-    int dims_count;
+typedef struct MathUnaryThreadParam {
+    DNNMathUnaryOperation un_op;
     const float *src;
     float *dst;
+    int dims_count;
+} MathUnaryThreadParam;
 
-    for (int i = 0; i < 4; ++i)
-        output->dims[i] = input->dims[i];
-
-    output->data_type = input->data_type;
-    output->length = calculate_operand_data_length(output);
-    if (output->length <= 0) {
-        av_log(ctx, AV_LOG_ERROR, "The output data length overflow\n");
-        return DNN_ERROR;
-    }
-    output->data = av_realloc(output->data, output->length);
-    if (!output->data) {
-        av_log(ctx, AV_LOG_ERROR, "Failed to reallocate memory for output\n");
-        return DNN_ERROR;
-    }
-
-    dims_count = calculate_operand_dims_count(output);
-    src = input->data;
-    dst = output->data;
+static void math_unary_thread(void *arg, int jobnr, int nb_jobs)
+{
+    const MathUnaryThreadParam *thread_param = arg;
+    const float *src = thread_param->src;
+    float *dst = thread_param->dst;
+    int start = thread_param->dims_count * (int64_t)jobnr / nb_jobs;
+    int end = thread_param->dims_count * (int64_t)(jobnr + 1) / nb_jobs;
 
-    switch (params->un_op) {
+    switch (thread_param->un_op) {
     case DMUO_ABS:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = FFABS(src[i]);
-        return 0;
+        return;
     case DMUO_SIN:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = sin(src[i]);
-        return 0;
+        return;
     case DMUO_COS:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = cos(src[i]);
-        return 0;
+        return;
     case DMUO_TAN:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = tan(src[i]);
-        return 0;
+        return;
     case DMUO_ASIN:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = asin(src[i]);
-        return 0;
+        return;
     case DMUO_ACOS:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = acos(src[i]);
-        return 0;
+        return;
     case DMUO_ATAN:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = atan(src[i]);
-        return 0;
+        return;
     case DMUO_SINH:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = sinh(src[i]);
-        return 0;
+        return;
     case DMUO_COSH:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = cosh(src[i]);
-        return 0;
+        return;
     case DMUO_TANH:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = tanh(src[i]);
-        return 0;
+        return;
     case DMUO_ASINH:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = asinh(src[i]);
-        return 0;
+        return;
     case DMUO_ACOSH:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = acosh(src[i]);
-        return 0;
+        return;
     case DMUO_ATANH:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = atanh(src[i]);
-        return 0;
+        return;
     case DMUO_CEIL:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = ceil(src[i]);
-        return 0;
+        return;
     case DMUO_FLOOR:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = floor(src[i]);
-        return 0;
+        return;
     case DMUO_ROUND:
-        for (int i = 0; i < dims_count; ++i)
+        for (int i = start; i < end; ++i)
             dst[i] = round(src[i]);
-        return 0;
+        return;
     default:
+        av_assert0(0);
+    }
+}
+
+int dnn_execute_layer_math_unary(DnnOperand *operands, const int32_t *input_operand_indexes,
+                                int32_t output_operand_index, const void *parameters, NativeContext *ctx)
+{
+    const DnnOperand *input = &operands[input_operand_indexes[0]];
+    DnnOperand *output = &operands[output_operand_index];
+    const DnnLayerMathUnaryParams *params = (const DnnLayerMathUnaryParams *)parameters;
+    MathUnaryThreadParam thread_param;
+
+    for (int i = 0; i < 4; ++i)
+        output->dims[i] = input->dims[i];
+
+    output->data_type = input->data_type;
+    output->length = calculate_operand_data_length(output);
+    if (output->length <= 0) {
+        av_log(ctx, AV_LOG_ERROR, "The output data length overflow\n");
+        return DNN_ERROR;
+    }
+    if (dnn_native_realloc_operand(output) < 0) {
+        av_log(ctx, AV_LOG_ERROR, "Failed to reallocate memory for output\n");
+        return DNN_ERROR;
+    }
+
+    if (params->un_op < 0 || params->un_op >= DMUO_COUNT) {
         av_log(ctx, AV_LOG_ERROR, "Unmatch math unary operator\n");
         return DNN_ERROR;
     }
+
+    thread_param.un_op = params->un_op;
+    thread_param.src = input->data;
+    thread_param.dst = output->data;
+    thread_param.dims_count = calculate_operand_dims_count(output);
+    dnn_native_execute_jobs(ctx, math_unary_thread, &thread_param,
+                            dnn_native_get_nb_jobs(ctx, thread_param.dims_count));
+    return 0;
 }
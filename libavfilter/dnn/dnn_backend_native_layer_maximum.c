@@ -49,15 +49,30 @@ int dnn_load_layer_maximum(Layer *layer, AVIOContext *model_file_context, int fi
     return dnn_size;
 }
 
+typedef struct MaximumThreadParam {
+    const float *src;
+    float *dst;
+    float y;
+    int dims_count;
+} MaximumThreadParam;
+
+static void maximum_thread(void *arg, int jobnr, int nb_jobs)
+{
+    const MaximumThreadParam *thread_param = arg;
+    int start = thread_param->dims_count * (int64_t)jobnr / nb_jobs;
+    int end = thread_param->dims_count * (int64_t)(jobnr + 1) / nb_jobs;
+
+    for (int i = start; i < end; ++i)
+        thread_param->dst[i] = FFMAX(thread_param->src[i], thread_param->y);
+}
+
 int dnn_execute_layer_maximum(DnnOperand *operands, const int32_t *input_operand_indexes,
                               int32_t output_operand_index, const void *parameters, NativeContext *ctx)
 {
     const DnnOperand *input = &operands[input_operand_indexes[0]];
     DnnOperand *output = &operands[output_operand_index];
     const DnnLayerMaximumParams *params = (const DnnLayerMaximumParams *)parameters;
-    int dims_count;
-    const float *src;
-    float *dst;
+    MaximumThreadParam thread_param;
 
     for (int i = 0; i < 4; ++i)
         output->dims[i] = input->dims[i];
@@ -68,17 +83,17 @@ int dnn_execute_layer_maximum(DnnOperand *operands, const int32_t *input_operand
         av_log(ctx, AV_LOG_ERROR, "The output data length overflow\n");
         return DNN_ERROR;
     }
-    output->data = av_realloc(output->data, output->length);
-    if (!output->data) {
+    if (dnn_native_realloc_operand(output) < 0) {
         av_log(ctx, AV_LOG_ERROR, "Failed to reallocate memory for output\n");
         return DNN_ERROR;
     }
 
-    dims_count = calculate_operand_dims_count(output);
-    src = input->data;
-    dst = output->data;
-    for (int i = 0; i < dims_count; ++i)
-        dst[i] = FFMAX(src[i], params->val.y);
+    thread_param.src = input->data;
+    thread_param.dst = output->data;
+    thread_param.y = params->val.y;
+    thread_param.dims_count = calculate_operand_dims_count(output);
+    dnn_native_execute_jobs(ctx, maximum_thread, &thread_param,
+                            dnn_native_get_nb_jobs(ctx, thread_param.dims_count));
 
     return 0;
 }
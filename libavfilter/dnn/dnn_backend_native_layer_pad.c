@@ -115,8 +115,7 @@ int dnn_execute_layer_pad(DnnOperand *operands, const int32_t *input_operand_ind
         av_log(ctx, AV_LOG_ERROR, "The output data length overflow\n");
         return DNN_ERROR;
     }
-    output_operand->data = av_realloc(output_operand->data, output_operand->length);
-    if (!output_operand->data) {
+    if (dnn_native_realloc_operand(output_operand) < 0) {
         av_log(ctx, AV_LOG_ERROR, "Failed to reallocate memory for output\n");
         return DNN_ERROR;
     }
@@ -30,13 +30,13 @@
 #include "dnn_backend_native_layer_dense.h"
 
 const LayerFunc layer_funcs[DLT_COUNT] = {
-    {NULL, NULL},
-    {dnn_execute_layer_conv2d,      dnn_load_layer_conv2d},
-    {dnn_execute_layer_depth2space, dnn_load_layer_depth2space},
-    {dnn_execute_layer_pad,         dnn_load_layer_pad},
-    {dnn_execute_layer_maximum,     dnn_load_layer_maximum},
-    {dnn_execute_layer_math_binary, dnn_load_layer_math_binary},
-    {dnn_execute_layer_math_unary,  dnn_load_layer_math_unary},
-    {dnn_execute_layer_avg_pool,  dnn_load_layer_avg_pool},
-    {dnn_execute_layer_dense,  dnn_load_layer_dense},
+    {NULL, NULL, NULL},
+    {dnn_execute_layer_conv2d,      dnn_load_layer_conv2d,      "conv2d"},
+    {dnn_execute_layer_depth2space, dnn_load_layer_depth2space, "depth2space"},
+    {dnn_execute_layer_pad,         dnn_load_layer_pad,         "pad"},
+    {dnn_execute_layer_maximum,     dnn_load_layer_maximum,     "maximum"},
+    {dnn_execute_layer_math_binary, dnn_load_layer_math_binary, "mathbinary"},
+    {dnn_execute_layer_math_unary,  dnn_load_layer_math_unary,  "mathunary"},
+    {dnn_execute_layer_avg_pool,    dnn_load_layer_avg_pool,    "avgpool"},
+    {dnn_execute_layer_dense,       dnn_load_layer_dense,       "dense"},
 };
@@ -31,6 +31,7 @@ typedef int (*LAYER_LOAD_FUNC)(Layer *layer, AVIOContext *model_file_context, in
 typedef struct LayerFunc {
     LAYER_EXEC_FUNC pf_exec;
     LAYER_LOAD_FUNC pf_load;
+    const char *name;
 }LayerFunc;
 
 extern const LayerFunc layer_funcs[DLT_COUNT];
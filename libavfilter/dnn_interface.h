@@ -82,6 +82,9 @@ typedef struct DNNModule{
                                          const char **output_names, uint32_t nb_output, AVFrame *out_frame);
     // Retrieve inference result.
     DNNAsyncStatusType (*get_async_result)(const DNNModel *model, AVFrame **in, AVFrame **out);
+    // Executes the asynchronous inferences still waiting to be batched with later frames, their results
+    // are available from get_async_result when it returns. Can be NULL.
+    DNNReturnType (*flush)(const DNNModel *model);
     // Frees memory allocated for model.
     void (*free_model)(DNNModel **model);
 } DNNModule;
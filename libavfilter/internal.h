@@ -25,6 +25,7 @@
  */
 
 #include "libavutil/internal.h"
+#include "libavutil/thread.h"
 #include "avfilter.h"
 #include "formats.h"
 #include "framepool.h"
@@ -130,10 +131,56 @@ struct AVFilterGraphInternal {
     void *thread;
     avfilter_execute_func *thread_execute;
     FFFrameQueueGlobal frame_queues;
+
+    /**
+     * Binary max-heap of the filters with a non-zero ready field, ordered
+     * by ready priority and then by position in the graph.
+     */
+    AVFilterContext **ready_heap;
+    unsigned nb_ready;
+
+    /**
+     * Worker pool activating independent filters concurrently, only
+     * allocated with AVFILTER_THREAD_GRAPH.
+     */
+    void *activate_thread;
+    /**
+     * Maximum number of filters activated concurrently, and room for
+     * four times as many filters examined in one round.
+     */
+    int nb_activate_jobs;
+    AVFilterContext **activate_jobs;
+    /**
+     * Protects the ready queue and the sink links heap while filters are
+     * activated concurrently.
+     */
+    AVMutex sched_lock;
 };
 
 struct AVFilterInternal {
     avfilter_execute_func *execute;
+
+    /**
+     * Index of the filter in graph->filters.
+     */
+    unsigned graph_index;
+
+    /**
+     * Position in the graph ready heap plus one, 0 if not queued.
+     */
+    unsigned ready_pos;
+
+    /**
+     * Frame threading state and maximum number of frames filtered
+     * concurrently, only set with AVFILTER_THREAD_FRAME.
+     */
+    void *frame_thread;
+    int nb_frame_jobs;
+
+    /**
+     * Profiling statistics, see avfilter_get_profile().
+     */
+    AVFilterProfile profile;
 };
 
 /**
@@ -332,6 +379,24 @@ int ff_filter_activate(AVFilterContext *filter);
  */
 void ff_filter_graph_remove_filter(AVFilterGraph *graph, AVFilterContext *filter);
 
+/**
+ * Update the position of a filter in the graph ready queue after its
+ * ready field has changed.
+ */
+void ff_filter_graph_update_ready(AVFilterGraph *graph, AVFilterContext *filter);
+
+static inline void ff_filter_graph_lock(AVFilterGraph *graph)
+{
+    if (graph->internal->activate_thread)
+        ff_mutex_lock(&graph->internal->sched_lock);
+}
+
+static inline void ff_filter_graph_unlock(AVFilterGraph *graph)
+{
+    if (graph->internal->activate_thread)
+        ff_mutex_unlock(&graph->internal->sched_lock);
+}
+
 /**
  * The filter is aware of hardware frames, and any hardware frame context
  * should not be automatically propagated through it.
@@ -23,6 +23,7 @@
 
 #include "config.h"
 
+#include "libavutil/avassert.h"
 #include "libavutil/common.h"
 #include "libavutil/cpu.h"
 #include "libavutil/mem.h"
@@ -30,6 +31,7 @@
 #include "libavutil/slicethread.h"
 
 #include "avfilter.h"
+#include "filters.h"
 #include "internal.h"
 #include "thread.h"
 
@@ -44,6 +46,17 @@ typedef struct ThreadContext {
     int   *rets;
 } ThreadContext;
 
+typedef struct ActivateThreadContext {
+    AVSliceThread *thread;
+
+    /* serializes slice jobs issued by filters activated concurrently */
+    AVMutex execute_lock;
+
+    /* per-execute parameters */
+    AVFilterContext **filters;
+    int *rets;
+} ActivateThreadContext;
+
 static void worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
 {
     ThreadContext *c = priv;
@@ -61,15 +74,20 @@ static int thread_execute(AVFilterContext *ctx, avfilter_action_func *func,
                           void *arg, int *ret, int nb_jobs)
 {
     ThreadContext *c = ctx->graph->internal->thread;
+    ActivateThreadContext *ac = ctx->graph->internal->activate_thread;
 
     if (nb_jobs <= 0)
         return 0;
+    if (ac)
+        ff_mutex_lock(&ac->execute_lock);
     c->ctx         = ctx;
     c->arg         = arg;
     c->func        = func;
     c->rets        = ret;
 
     avpriv_slicethread_execute(c->thread, nb_jobs, 0);
+    if (ac)
+        ff_mutex_unlock(&ac->execute_lock);
     return 0;
 }
 
@@ -108,9 +126,285 @@ int ff_graph_thread_init(AVFilterGraph *graph)
     return 0;
 }
 
+static void activate_worker_func(void *priv, int jobnr, int threadnr, int nb_jobs, int nb_threads)
+{
+    ActivateThreadContext *c = priv;
+    c->rets[jobnr] = ff_filter_activate(c->filters[jobnr]);
+}
+
+int ff_graph_activate_init(AVFilterGraph *graph)
+{
+    AVFilterGraphInternal *gi = graph->internal;
+    ActivateThreadContext *c;
+    int nb_threads;
+
+    c = av_mallocz(sizeof(*c));
+    if (!c)
+        return AVERROR(ENOMEM);
+
+    nb_threads = avpriv_slicethread_create(&c->thread, c, activate_worker_func,
+                                           NULL, graph->nb_threads);
+    if (nb_threads <= 1) {
+        avpriv_slicethread_free(&c->thread);
+        av_free(c);
+        graph->thread_type &= ~AVFILTER_THREAD_GRAPH;
+        return (nb_threads < 0) ? nb_threads : 0;
+    }
+
+    c->rets           = av_malloc_array(nb_threads, sizeof(*c->rets));
+    gi->activate_jobs = av_malloc_array(4 * nb_threads, sizeof(*gi->activate_jobs));
+    if (!c->rets || !gi->activate_jobs) {
+        avpriv_slicethread_free(&c->thread);
+        av_freep(&c->rets);
+        av_freep(&gi->activate_jobs);
+        av_free(c);
+        return AVERROR(ENOMEM);
+    }
+    ff_mutex_init(&c->execute_lock, NULL);
+    ff_mutex_init(&gi->sched_lock, NULL);
+
+    gi->nb_activate_jobs = nb_threads;
+    gi->activate_thread  = c;
+
+    return 0;
+}
+
+int ff_graph_activate_execute(AVFilterGraph *graph, AVFilterContext **filters,
+                              int nb_filters)
+{
+    ActivateThreadContext *c = graph->internal->activate_thread;
+    int i, ret = 0;
+
+    c->filters = filters;
+    avpriv_slicethread_execute(c->thread, nb_filters, 0);
+
+    for (i = 0; i < nb_filters; i++)
+        if (c->rets[i] < 0) {
+            ret = c->rets[i];
+            break;
+        }
+    return ret;
+}
+
+#if HAVE_PTHREADS
+typedef struct FrameThreadJob {
+    AVFrame *in;
+    /* frames output while filtering in */
+    AVFrame **out;
+    int nb_out;
+    int ret;
+
+    /* thread filtering in, valid while running is set */
+    pthread_t thread;
+    int running;
+} FrameThreadJob;
+
+typedef struct FrameThreadContext {
+    FrameThreadJob *jobs;
+    int nb_jobs;
+
+    /* set while frames are filtered concurrently */
+    int active;
+    /* protects the running jobs lookup and buffer allocations */
+    AVMutex lock;
+} FrameThreadContext;
+
+static int frame_thread_worker(AVFilterContext *ctx, void *arg, int jobnr, int nb_jobs)
+{
+    FrameThreadContext *c = arg;
+    FrameThreadJob *job   = &c->jobs[jobnr];
+    AVFilterLink *inlink  = ctx->inputs[0];
+
+    if (!job->in)
+        return 0;
+
+    ff_mutex_lock(&c->lock);
+    job->thread  = pthread_self();
+    job->running = 1;
+    ff_mutex_unlock(&c->lock);
+
+    job->ret = inlink->dstpad->filter_frame(inlink, job->in);
+    job->in  = NULL;
+
+    ff_mutex_lock(&c->lock);
+    job->running = 0;
+    ff_mutex_unlock(&c->lock);
+    return 0;
+}
+
+/* job run by the calling thread, NULL outside of the jobs */
+static FrameThreadJob *frame_thread_current_job(FrameThreadContext *c)
+{
+    pthread_t self = pthread_self();
+    FrameThreadJob *job = NULL;
+    int i;
+
+    ff_mutex_lock(&c->lock);
+    for (i = 0; i < c->nb_jobs; i++) {
+        if (c->jobs[i].running && pthread_equal(c->jobs[i].thread, self)) {
+            job = &c->jobs[i];
+            break;
+        }
+    }
+    ff_mutex_unlock(&c->lock);
+    return job;
+}
+
+int ff_filter_frame_thread_init(AVFilterContext *ctx)
+{
+    FrameThreadContext *c;
+    int nb_jobs = ff_filter_get_nb_threads(ctx);
+
+    if (nb_jobs <= 1)
+        return 0;
+
+    c = av_mallocz(sizeof(*c));
+    if (!c)
+        return AVERROR(ENOMEM);
+    c->jobs = av_mallocz_array(nb_jobs, sizeof(*c->jobs));
+    if (!c->jobs) {
+        av_free(c);
+        return AVERROR(ENOMEM);
+    }
+    c->nb_jobs = nb_jobs;
+    ff_mutex_init(&c->lock, NULL);
+
+    ctx->internal->frame_thread  = c;
+    ctx->internal->nb_frame_jobs = nb_jobs;
+    return 1;
+}
+
+void ff_filter_frame_thread_free(AVFilterContext *ctx)
+{
+    FrameThreadContext *c = ctx->internal ? ctx->internal->frame_thread : NULL;
+    int i;
+
+    if (!c)
+        return;
+    for (i = 0; i < c->nb_jobs; i++)
+        av_freep(&c->jobs[i].out);
+    av_freep(&c->jobs);
+    ff_mutex_destroy(&c->lock);
+    av_freep(&ctx->internal->frame_thread);
+}
+
+int ff_filter_frame_thread_execute(AVFilterContext *ctx, int nb_frames)
+{
+    FrameThreadContext *c = ctx->internal->frame_thread;
+    AVFilterLink *inlink  = ctx->inputs[0];
+    AVFilterLink *outlink = ctx->outputs[0];
+    int i, j, ret = 0;
+
+    av_assert1(nb_frames <= c->nb_jobs);
+    for (i = 0; i < nb_frames; i++) {
+        FrameThreadJob *job = &c->jobs[i];
+
+        job->nb_out = 0;
+        job->ret    = ff_inlink_consume_frame(inlink, &job->in);
+        if (job->ret > 0 && inlink->dstpad->needs_writable)
+            job->ret = ff_inlink_make_frame_writable(inlink, &job->in);
+        if (job->ret < 0)
+            av_frame_free(&job->in);
+    }
+
+    c->active = 1;
+    ctx->graph->internal->thread_execute(ctx, frame_thread_worker, c, NULL, nb_frames);
+    c->active = 0;
+
+    for (i = 0; i < nb_frames; i++) {
+        FrameThreadJob *job = &c->jobs[i];
+
+        for (j = 0; j < job->nb_out; j++) {
+            if (ret >= 0)
+                ret = ff_filter_frame(outlink, job->out[j]);
+            else
+                av_frame_free(&job->out[j]);
+        }
+        if (ret >= 0 && job->ret < 0)
+            ret = job->ret;
+    }
+    return ret;
+}
+
+int ff_filter_frame_thread_output(AVFilterLink *link, AVFrame *frame)
+{
+    FrameThreadContext *c = link->src->internal->frame_thread;
+    FrameThreadJob *job;
+    int ret;
+
+    if (!c || !c->active)
+        return 0;
+
+    job = frame_thread_current_job(c);
+    if (!job) {
+        av_frame_free(&frame);
+        return AVERROR_BUG;
+    }
+    ret = av_dynarray_add_nofree(&job->out, &job->nb_out, frame);
+    if (ret < 0) {
+        av_frame_free(&frame);
+        return ret;
+    }
+    return 1;
+}
+
+void ff_filter_frame_thread_lock(AVFilterContext *ctx)
+{
+    FrameThreadContext *c = ctx->internal->frame_thread;
+    if (c && c->active)
+        ff_mutex_lock(&c->lock);
+}
+
+void ff_filter_frame_thread_unlock(AVFilterContext *ctx)
+{
+    FrameThreadContext *c = ctx->internal->frame_thread;
+    if (c && c->active)
+        ff_mutex_unlock(&c->lock);
+}
+#else
+int ff_filter_frame_thread_init(AVFilterContext *ctx)
+{
+    return 0;
+}
+
+void ff_filter_frame_thread_free(AVFilterContext *ctx)
+{
+}
+
+int ff_filter_frame_thread_execute(AVFilterContext *ctx, int nb_frames)
+{
+    return AVERROR_BUG;
+}
+
+int ff_filter_frame_thread_output(AVFilterLink *link, AVFrame *frame)
+{
+    return 0;
+}
+
+void ff_filter_frame_thread_lock(AVFilterContext *ctx)
+{
+}
+
+void ff_filter_frame_thread_unlock(AVFilterContext *ctx)
+{
+}
+#endif /* HAVE_PTHREADS */
+
 void ff_graph_thread_free(AVFilterGraph *graph)
 {
-    if (graph->internal->thread)
-        slice_thread_uninit(graph->internal->thread);
-    av_freep(&graph->internal->thread);
+    AVFilterGraphInternal *gi = graph->internal;
+    ActivateThreadContext *c  = gi->activate_thread;
+
+    if (gi->thread)
+        slice_thread_uninit(gi->thread);
+    av_freep(&gi->thread);
+
+    if (c) {
+        avpriv_slicethread_free(&c->thread);
+        ff_mutex_destroy(&c->execute_lock);
+        ff_mutex_destroy(&gi->sched_lock);
+        av_freep(&c->rets);
+        av_freep(&gi->activate_thread);
+    }
+    av_freep(&gi->activate_jobs);
 }
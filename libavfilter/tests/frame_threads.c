@@ -0,0 +1,159 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Run chains of frame threaded filters with slice threading and with frame
+ * threading, and check that the outputs are identical and in order. When
+ * run with "bench" as argument, use larger frames and also print the
+ * wall-clock time of both runs.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/time.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+
+#define NB_THREADS 4
+
+static const char *const chains[] = {
+    "lutrgb=r=negval,colorchannelmixer=.3:.4:.3:0:0:.8,lut3d",
+    "colorbalance=rs=.3:bh=-.2:enable='between(t,0.4,0.6)',lut1d,negate",
+    "v360=e:c3x2",
+};
+
+typedef struct ChainOutput {
+    int nb_frames;
+    int ordered;
+    unsigned long checksum;
+} ChainOutput;
+
+static unsigned long frame_checksum(unsigned long checksum, const AVFrame *frame)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    int plane, y;
+
+    for (plane = 0; plane < 4 && frame->data[plane]; plane++) {
+        int h = plane == 1 || plane == 2 ?
+                AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h) : frame->height;
+        int linesize = av_image_get_linesize(frame->format, frame->width, plane);
+        for (y = 0; y < h; y++)
+            checksum = av_adler32_update(checksum,
+                                         frame->data[plane] + y * frame->linesize[plane],
+                                         linesize);
+    }
+    return checksum;
+}
+
+static int run_chain(const char *chain, int w, int h, int duration,
+                     int thread_type, ChainOutput *output)
+{
+    AVFilterGraph *graph;
+    AVFilterContext *sink;
+    AVFilterInOut *inputs = NULL, *outputs = NULL;
+    AVFrame *frame = NULL;
+    int64_t last_pts = AV_NOPTS_VALUE;
+    char desc[512];
+    int ret;
+
+    memset(output, 0, sizeof(*output));
+    output->ordered = 1;
+
+    graph = avfilter_graph_alloc();
+    if (!graph)
+        return AVERROR(ENOMEM);
+    graph->thread_type = thread_type;
+    graph->nb_threads  = NB_THREADS;
+
+    snprintf(desc, sizeof(desc), "testsrc2=size=%dx%d:rate=25:duration=%d,%s,buffersink@out",
+             w, h, duration, chain);
+    ret = avfilter_graph_parse2(graph, desc, &inputs, &outputs);
+    if (ret < 0)
+        goto end;
+    if (inputs || outputs) {
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+    ret = avfilter_graph_config(graph, NULL);
+    if (ret < 0)
+        goto end;
+    sink = avfilter_graph_get_filter(graph, "buffersink@out");
+
+    frame = av_frame_alloc();
+    if (!frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    while ((ret = av_buffersink_get_frame(sink, frame)) >= 0) {
+        if (last_pts != AV_NOPTS_VALUE && frame->pts <= last_pts)
+            output->ordered = 0;
+        last_pts = frame->pts;
+        output->nb_frames++;
+        output->checksum = frame_checksum(output->checksum, frame);
+        av_frame_unref(frame);
+    }
+    if (ret == AVERROR_EOF)
+        ret = 0;
+
+end:
+    av_frame_free(&frame);
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    static const int thread_types[] = {
+        AVFILTER_THREAD_SLICE,
+        AVFILTER_THREAD_SLICE | AVFILTER_THREAD_FRAME,
+    };
+    int bench = argc > 1 && !strcmp(argv[1], "bench");
+    ChainOutput outputs[2];
+    int64_t t[2];
+    int i, j, ret;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(chains); i++) {
+        for (j = 0; j < FF_ARRAY_ELEMS(thread_types); j++) {
+            t[j] = av_gettime_relative();
+            ret = bench ? run_chain(chains[i], 1920, 1080, 4, thread_types[j], &outputs[j]) :
+                          run_chain(chains[i],  128,   64, 1, thread_types[j], &outputs[j]);
+            t[j] = av_gettime_relative() - t[j];
+            if (ret < 0) {
+                fprintf(stderr, "Chain %d failed: %s\n", i, av_err2str(ret));
+                return 1;
+            }
+        }
+        printf("chain %d: frames %d, %s, %s", i, outputs[1].nb_frames,
+               outputs[1].ordered ? "ordered" : "reordered",
+               outputs[0].nb_frames == outputs[1].nb_frames &&
+               outputs[0].checksum  == outputs[1].checksum ? "identical" : "different");
+        if (bench)
+            printf(", %"PRId64" us slice threads, %"PRId64" us frame threads, speedup %.2f",
+                   t[0], t[1], t[0] / (double)FFMAX(t[1], 1));
+        printf("\n");
+    }
+
+    return 0;
+}
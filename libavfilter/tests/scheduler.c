@@ -0,0 +1,264 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Drive chains of null filters through the graph scheduler and count the
+ * activations, then run a split->N*scale ladder with and without
+ * AVFILTER_THREAD_GRAPH and check that every output is identical. When run
+ * with "bench" as argument, also print the number of activations per second
+ * for increasing filter counts and the wall-clock time of the ladders.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/time.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/filters.h"
+#include "libavfilter/internal.h"
+
+static int run_chain(int nb_nulls, int duration,
+                     int64_t *nb_activations, int64_t *nb_frames)
+{
+    AVFilterGraph *graph;
+    AVFilterContext *prev, *cur, *sink;
+    AVFrame *frame = NULL;
+    char args[64];
+    int i, ret;
+
+    *nb_activations = *nb_frames = 0;
+
+    graph = avfilter_graph_alloc();
+    if (!graph)
+        return AVERROR(ENOMEM);
+
+    snprintf(args, sizeof(args), "size=16x16:rate=25:duration=%d", duration);
+    ret = avfilter_graph_create_filter(&prev, avfilter_get_by_name("nullsrc"),
+                                       "src", args, NULL, graph);
+    if (ret < 0)
+        goto end;
+    for (i = 0; i < nb_nulls; i++) {
+        snprintf(args, sizeof(args), "null%d", i);
+        ret = avfilter_graph_create_filter(&cur, avfilter_get_by_name("null"),
+                                           args, NULL, NULL, graph);
+        if (ret < 0 || (ret = avfilter_link(prev, 0, cur, 0)) < 0)
+            goto end;
+        prev = cur;
+    }
+    ret = avfilter_graph_create_filter(&sink, avfilter_get_by_name("buffersink"),
+                                       "sink", NULL, NULL, graph);
+    if (ret < 0 || (ret = avfilter_link(prev, 0, sink, 0)) < 0)
+        goto end;
+    ret = avfilter_graph_config(graph, NULL);
+    if (ret < 0)
+        goto end;
+
+    frame = av_frame_alloc();
+    if (!frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    while (1) {
+        ret = av_buffersink_get_frame_flags(sink, frame,
+                                            AV_BUFFERSINK_FLAG_NO_REQUEST);
+        if (ret >= 0) {
+            (*nb_frames)++;
+            av_frame_unref(frame);
+            continue;
+        }
+        if (ret == AVERROR_EOF) {
+            ret = 0;
+            break;
+        }
+        if (ret != AVERROR(EAGAIN))
+            break;
+        ff_inlink_request_frame(sink->inputs[0]);
+        ret = ff_filter_graph_run_once(graph);
+        if (ret < 0)
+            break;
+        (*nb_activations)++;
+    }
+
+end:
+    av_frame_free(&frame);
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+#define MAX_OUTPUTS 8
+
+typedef struct LadderOutput {
+    int w, h;
+    int nb_frames;
+    unsigned long checksum;
+} LadderOutput;
+
+static unsigned long frame_checksum(unsigned long checksum, const AVFrame *frame)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    int plane, y;
+
+    for (plane = 0; plane < 4 && frame->data[plane]; plane++) {
+        int h = plane == 1 || plane == 2 ?
+                AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h) : frame->height;
+        int linesize = av_image_get_linesize(frame->format, frame->width, plane);
+        for (y = 0; y < h; y++)
+            checksum = av_adler32_update(checksum,
+                                         frame->data[plane] + y * frame->linesize[plane],
+                                         linesize);
+    }
+    return checksum;
+}
+
+static int run_ladder(int nb_outputs, int w, int h, int duration,
+                      int thread_type, LadderOutput *outputs)
+{
+    AVFilterGraph *graph;
+    AVFilterContext *src, *split, *scale, *sinks[MAX_OUTPUTS];
+    AVFrame *frame = NULL;
+    char args[64];
+    int i, ret, nb_eof = 0, eof[MAX_OUTPUTS] = { 0 };
+
+    graph = avfilter_graph_alloc();
+    if (!graph)
+        return AVERROR(ENOMEM);
+    graph->thread_type = thread_type;
+    graph->nb_threads  = nb_outputs;
+
+    snprintf(args, sizeof(args), "size=%dx%d:rate=25:duration=%d", w, h, duration);
+    ret = avfilter_graph_create_filter(&src, avfilter_get_by_name("testsrc2"),
+                                       "src", args, NULL, graph);
+    if (ret < 0)
+        goto end;
+    snprintf(args, sizeof(args), "%d", nb_outputs);
+    ret = avfilter_graph_create_filter(&split, avfilter_get_by_name("split"),
+                                       "split", args, NULL, graph);
+    if (ret < 0 || (ret = avfilter_link(src, 0, split, 0)) < 0)
+        goto end;
+    for (i = 0; i < nb_outputs; i++) {
+        outputs[i].w = (w * (nb_outputs - i) / (nb_outputs + 1)) & ~1;
+        outputs[i].h = (h * (nb_outputs - i) / (nb_outputs + 1)) & ~1;
+        outputs[i].nb_frames = 0;
+        outputs[i].checksum  = 0;
+        snprintf(args, sizeof(args), "%d:%d", outputs[i].w, outputs[i].h);
+        ret = avfilter_graph_create_filter(&scale, avfilter_get_by_name("scale"),
+                                           NULL, args, NULL, graph);
+        if (ret < 0 || (ret = avfilter_link(split, i, scale, 0)) < 0)
+            goto end;
+        ret = avfilter_graph_create_filter(&sinks[i], avfilter_get_by_name("buffersink"),
+                                           NULL, NULL, NULL, graph);
+        if (ret < 0 || (ret = avfilter_link(scale, 0, sinks[i], 0)) < 0)
+            goto end;
+    }
+    ret = avfilter_graph_config(graph, NULL);
+    if (ret < 0)
+        goto end;
+
+    frame = av_frame_alloc();
+    if (!frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+
+    while (nb_eof < nb_outputs) {
+        for (i = 0; i < nb_outputs; i++) {
+            if (eof[i])
+                continue;
+            ret = av_buffersink_get_frame(sinks[i], frame);
+            if (ret == AVERROR_EOF) {
+                eof[i] = 1;
+                nb_eof++;
+                continue;
+            }
+            if (ret < 0)
+                goto end;
+            outputs[i].nb_frames++;
+            outputs[i].checksum = frame_checksum(outputs[i].checksum, frame);
+            av_frame_unref(frame);
+        }
+    }
+    ret = 0;
+
+end:
+    av_frame_free(&frame);
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    static const int nb_nulls[] = { 1, 4, 16, 64, 256, 1024 };
+    static const int thread_types[] = {
+        AVFILTER_THREAD_SLICE,
+        AVFILTER_THREAD_SLICE | AVFILTER_THREAD_GRAPH,
+    };
+    LadderOutput outputs[2][MAX_OUTPUTS];
+    int bench = argc > 1 && !strcmp(argv[1], "bench");
+    int nb_outputs = bench ? 6 : 4;
+    int64_t nb_activations, nb_frames, t, ladder_time[2];
+    int i, ret;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(nb_nulls); i++) {
+        t = av_gettime_relative();
+        ret = run_chain(nb_nulls[i], bench ? 20 : 1, &nb_activations, &nb_frames);
+        t = av_gettime_relative() - t;
+        if (ret < 0) {
+            fprintf(stderr, "Chain of %d filters failed: %s\n",
+                    nb_nulls[i], av_err2str(ret));
+            return 1;
+        }
+        printf("filters %4d frames %3"PRId64" activations %7"PRId64,
+               nb_nulls[i] + 2, nb_frames, nb_activations);
+        if (bench)
+            printf(" %10.0f activations/s", nb_activations * 1000000.0 / FFMAX(t, 1));
+        printf("\n");
+    }
+
+    for (i = 0; i < FF_ARRAY_ELEMS(thread_types); i++) {
+        t = av_gettime_relative();
+        ret = bench ? run_ladder(nb_outputs, 1920, 1080, 4, thread_types[i], outputs[i]) :
+                      run_ladder(nb_outputs,  128,   72, 1, thread_types[i], outputs[i]);
+        ladder_time[i] = av_gettime_relative() - t;
+        if (ret < 0) {
+            fprintf(stderr, "Ladder failed: %s\n", av_err2str(ret));
+            return 1;
+        }
+    }
+    for (i = 0; i < nb_outputs; i++) {
+        printf("output %d %dx%d frames %d checksum %08lx\n", i,
+               outputs[0][i].w, outputs[0][i].h,
+               outputs[0][i].nb_frames, outputs[0][i].checksum);
+        if (outputs[1][i].nb_frames != outputs[0][i].nb_frames ||
+            outputs[1][i].checksum  != outputs[0][i].checksum) {
+            fprintf(stderr, "Output %d differs with graph threading\n", i);
+            return 1;
+        }
+    }
+    if (bench)
+        printf("ladder: %"PRId64" us serial, %"PRId64" us graph threads, speedup %.2f\n",
+               ladder_time[0], ladder_time[1],
+               ladder_time[0] / (double)FFMAX(ladder_time[1], 1));
+
+    return 0;
+}
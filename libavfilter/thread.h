@@ -25,4 +25,58 @@ int ff_graph_thread_init(AVFilterGraph *graph);
 
 void ff_graph_thread_free(AVFilterGraph *graph);
 
+/**
+ * Start the worker pool used to activate independent filters concurrently.
+ * Clears AVFILTER_THREAD_GRAPH from the graph thread type if fewer than two
+ * threads are available.
+ */
+int ff_graph_activate_init(AVFilterGraph *graph);
+
+/**
+ * Activate filters concurrently on the graph worker pool. The filters must
+ * not conflict with each other, i.e. not touch each other's links.
+ *
+ * @return the first negative value returned by an activation, 0 otherwise
+ */
+int ff_graph_activate_execute(AVFilterGraph *graph, AVFilterContext **filters,
+                              int nb_filters);
+
+/**
+ * Set up frame threading for a filter with AVFILTER_FLAG_FRAME_THREADS.
+ *
+ * @return 1 if frame threading is used, 0 if it is not available, a
+ *         negative error code on failure
+ */
+int ff_filter_frame_thread_init(AVFilterContext *ctx);
+
+void ff_filter_frame_thread_free(AVFilterContext *ctx);
+
+/**
+ * Consume nb_frames frames from the input of a frame threaded filter, pass
+ * them concurrently to its filter_frame() callback, then send the frames it
+ * output in input order. All the frames are consumed before filtering, so
+ * filter_frame() must not rely on the frame count or current pts of the
+ * input link.
+ *
+ * @return the first negative value returned by filter_frame() in input
+ *         order, 0 otherwise
+ */
+int ff_filter_frame_thread_execute(AVFilterContext *ctx, int nb_frames);
+
+/**
+ * Keep a frame output on link while frames are filtered concurrently by
+ * link->src, to send it once all of them are filtered.
+ *
+ * @return 1 if the frame was kept, 0 if link->src is not filtering frames
+ *         concurrently, a negative error code on failure
+ */
+int ff_filter_frame_thread_output(AVFilterLink *link, AVFrame *frame);
+
+/**
+ * Serialize buffer allocations made by the filter_frame() calls of a filter
+ * filtering frames concurrently; no-op otherwise.
+ */
+void ff_filter_frame_thread_lock(AVFilterContext *ctx);
+void ff_filter_frame_thread_unlock(AVFilterContext *ctx);
+
 #endif /* AVFILTER_THREAD_H */
@@ -369,6 +369,36 @@ static int activate_sync(AVFilterContext *filter_ctx)
     return FFERROR_NOT_READY;
 }
 
+static int flush_frames(AVFilterContext *filter_ctx)
+{
+    AVFilterLink *outlink = filter_ctx->outputs[0];
+    DnnProcessingContext *ctx = (DnnProcessingContext *)filter_ctx->priv;
+    int async_state, ret;
+
+    // run the inferences still waiting for a full batch, their results are
+    // ready once flush returns
+    if (ctx->dnn_module->flush && (ctx->dnn_module->flush)(ctx->model) != DNN_SUCCESS) {
+        av_log(ctx, AV_LOG_ERROR, "failed to execute model\n");
+        return AVERROR(EIO);
+    }
+
+    do {
+        AVFrame *in_frame = NULL;
+        AVFrame *out_frame = NULL;
+        async_state = (ctx->dnn_module->get_async_result)(ctx->model, &in_frame, &out_frame);
+        if (out_frame) {
+            if (isPlanarYUV(in_frame->format))
+                copy_uv_planes(ctx, out_frame, in_frame);
+            av_frame_free(&in_frame);
+            ret = ff_filter_frame(outlink, out_frame);
+            if (ret < 0)
+                return ret;
+        }
+    } while (async_state == DAST_SUCCESS);
+
+    return 0;
+}
+
 static int activate_async(AVFilterContext *filter_ctx)
 {
     AVFilterLink *inlink = filter_ctx->inputs[0];
@@ -396,7 +426,8 @@ static int activate_async(AVFilterContext *filter_ctx)
             av_frame_copy_props(out, in);
             if ((ctx->dnn_module->execute_model_async)(ctx->model, ctx->model_inputname, in,
                                                        (const char **)&ctx->model_outputname, 1, out) != DNN_SUCCESS) {
-                return FFERROR_NOT_READY;
+                av_log(ctx, AV_LOG_ERROR, "failed to execute model\n");
+                return AVERROR(EIO);
             }
         }
     } while (ret > 0);
@@ -423,6 +454,7 @@ static int activate_async(AVFilterContext *filter_ctx)
 
     if (ff_inlink_acknowledge_status(inlink, &status, &pts)) {
         if (status == AVERROR_EOF) {
+            ret = flush_frames(filter_ctx);
             ff_outlink_set_status(outlink, status, pts);
             return ret;
         }
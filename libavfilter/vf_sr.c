@@ -39,6 +39,7 @@ typedef struct SRContext {
 
     char *model_filename;
     DNNBackendType backend_type;
+    char *backend_options;
     DNNModule *dnn_module;
     DNNModel *model;
     int scale_factor;
@@ -57,6 +58,7 @@ static const AVOption sr_options[] = {
 #endif
     { "scale_factor", "scale factor for SRCNN model", OFFSET(scale_factor), AV_OPT_TYPE_INT, { .i64 = 2 }, 2, 4, FLAGS },
     { "model", "path to model file specifying network architecture and its parameters", OFFSET(model_filename), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
+    { "options", "backend options", OFFSET(backend_options), AV_OPT_TYPE_STRING, {.str=NULL}, 0, 0, FLAGS },
     { NULL }
 };
 
@@ -80,7 +82,7 @@ static av_cold int init(AVFilterContext *context)
         av_log(context, AV_LOG_ERROR, "load_model for network was not specified\n");
         return AVERROR(EIO);
     }
-    sr_context->model = (sr_context->dnn_module->load_model)(sr_context->model_filename, NULL, NULL);
+    sr_context->model = (sr_context->dnn_module->load_model)(sr_context->model_filename, sr_context->backend_options, NULL);
     if (!sr_context->model){
         av_log(context, AV_LOG_ERROR, "could not load DNN model\n");
         return AVERROR(EIO);
@@ -4775,6 +4775,6 @@ AVFilter ff_vf_v360 = {
     .inputs        = inputs,
     .outputs       = outputs,
     .priv_class    = &v360_class,
-    .flags         = AVFILTER_FLAG_SLICE_THREADS,
+    .flags         = AVFILTER_FLAG_SLICE_THREADS | AVFILTER_FLAG_FRAME_THREADS,
     .process_command = process_command,
 };
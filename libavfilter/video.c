@@ -31,6 +31,7 @@
 
 #include "avfilter.h"
 #include "internal.h"
+#include "thread.h"
 #include "video.h"
 
 #define BUFFER_ALIGN 32
@@ -102,11 +103,15 @@ AVFrame *ff_get_video_buffer(AVFilterLink *link, int w, int h)
 
     FF_TPRINTF_START(NULL, get_video_buffer); ff_tlog_link(NULL, link, 0);
 
+    ff_filter_frame_thread_lock(link->src);
+
     if (link->dstpad->get_video_buffer)
         ret = link->dstpad->get_video_buffer(link, w, h);
 
     if (!ret)
         ret = ff_default_get_video_buffer(link, w, h);
 
+    ff_filter_frame_thread_unlock(link->src);
+
     return ret;
 }
@@ -0,0 +1,95 @@
+;*****************************************************************************
+;* x86-optimized functions for the native DNN backend conv2d layer
+;*
+;* This file is part of FFmpeg.
+;*
+;* FFmpeg is free software; you can redistribute it and/or
+;* modify it under the terms of the GNU Lesser General Public
+;* License as published by the Free Software Foundation; either
+;* version 2.1 of the License, or (at your option) any later version.
+;*
+;* FFmpeg is distributed in the hope that it will be useful,
+;* but WITHOUT ANY WARRANTY; without even the implied warranty of
+;* MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+;* Lesser General Public License for more details.
+;*
+;* You should have received a copy of the GNU Lesser General Public
+;* License along with FFmpeg; if not, write to the Free Software
+;* Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+;******************************************************************************
+
+%include "libavutil/x86/x86util.asm"
+
+SECTION .text
+
+%macro BROADCASTSS 2
+%if cpuflag(avx)
+    vbroadcastss %1, %2
+%else
+    movss        %1, %2
+    shufps       %1, %1, 0
+%endif
+%endmacro
+
+;------------------------------------------------------------------------------
+; void ff_dnn_conv2d_gemm(float *dst, const float *patches, const float *kernel,
+;                         const float *bias, int nb_pixels, int patch_size,
+;                         int output_num)
+;------------------------------------------------------------------------------
+
+%macro CONV2D_GEMM 0
+cglobal dnn_conv2d_gemm, 7, 11, 4, dst, patches, kernel, bias, pixels, size, num, off, k, kptr, pptr
+    movsxdifnidn sizeq, sized
+    movsxdifnidn  numq, numd
+    shl           numq, 2
+.pixel_loop:
+    xor           offq, offq
+.col_loop:
+    mova            m0, [biasq + offq]
+    xorps           m1, m1
+    lea          kptrq, [kernelq + offq]
+    mov          pptrq, patchesq
+    mov             kq, sizeq
+    sub             kq, 2
+    jl .k_tail
+.k_loop:
+    ; two accumulators to hide the latency of the multiply-adds
+    BROADCASTSS     m2, [pptrq]
+    FMULADD_PS      m0, m2, [kptrq], m0, m2
+    BROADCASTSS     m3, [pptrq + 4]
+    FMULADD_PS      m1, m3, [kptrq + numq], m1, m3
+    add          pptrq, 8
+    lea          kptrq, [kptrq + numq * 2]
+    sub             kq, 2
+    jge .k_loop
+.k_tail:
+    cmp             kq, -1
+    jne .k_done
+    BROADCASTSS     m2, [pptrq]
+    FMULADD_PS      m0, m2, [kptrq], m0, m2
+.k_done:
+    addps           m0, m1
+    mova [dstq + offq], m0
+    add           offq, mmsize
+    cmp           offq, numq
+    jl .col_loop
+
+    add           dstq, numq
+    lea       patchesq, [patchesq + sizeq * 4]
+    dec        pixelsd
+    jg .pixel_loop
+    RET
+%endmacro
+
+%if ARCH_X86_64
+INIT_XMM sse
+CONV2D_GEMM
+%if HAVE_AVX_EXTERNAL
+INIT_YMM avx
+CONV2D_GEMM
+%endif
+%if HAVE_FMA3_EXTERNAL
+INIT_YMM fma3
+CONV2D_GEMM
+%endif
+%endif
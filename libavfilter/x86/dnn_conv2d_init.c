@@ -0,0 +1,44 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include "config.h"
+#include "libavutil/attributes.h"
+#include "libavutil/cpu.h"
+#include "libavutil/x86/cpu.h"
+#include "libavfilter/dnn/dnn_backend_native_layer_conv2d.h"
+
+void ff_dnn_conv2d_gemm_sse(float *dst, const float *patches, const float *kernel,
+                            const float *bias, int nb_pixels, int patch_size, int output_num);
+void ff_dnn_conv2d_gemm_avx(float *dst, const float *patches, const float *kernel,
+                            const float *bias, int nb_pixels, int patch_size, int output_num);
+void ff_dnn_conv2d_gemm_fma3(float *dst, const float *patches, const float *kernel,
+                             const float *bias, int nb_pixels, int patch_size, int output_num);
+
+av_cold void ff_dnn_conv2d_dsp_init_x86(DNNConv2DDSPContext *dsp)
+{
+#if ARCH_X86_64
+    int cpu_flags = av_get_cpu_flags();
+
+    if (EXTERNAL_SSE(cpu_flags))
+        dsp->gemm = ff_dnn_conv2d_gemm_sse;
+    if (EXTERNAL_AVX_FAST(cpu_flags))
+        dsp->gemm = ff_dnn_conv2d_gemm_avx;
+    if (EXTERNAL_FMA3_FAST(cpu_flags))
+        dsp->gemm = ff_dnn_conv2d_gemm_fma3;
+#endif
+}
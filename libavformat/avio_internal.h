@@ -83,6 +83,17 @@ uint64_t ffio_read_varlen(AVIOContext *bc);
  */
 int ffio_read_size(AVIOContext *s, unsigned char *buf, int size);
 
+/**
+ * Read size bytes from AVIOContext as a reference to memory owned by the
+ * underlying protocol, e.g. a memory mapped file, without copying them.
+ * The reference is followed by AV_INPUT_BUFFER_PADDING_SIZE zero bytes.
+ *
+ * @return size on success, AVERROR(ENOSYS) if the data cannot be referenced,
+ * in which case nothing was read and the data has to be read with
+ * avio_read() instead
+ */
+int ffio_read_buffer_ref(AVIOContext *s, int size, AVBufferRef **buf);
+
 /** @warning must be called before any I/O */
 int ffio_set_buf_size(AVIOContext *s, int buf_size);
 
@@ -693,6 +693,36 @@ int ffio_read_size(AVIOContext *s, unsigned char *buf, int size)
     return AVERROR_INVALIDDATA;
 }
 
+int ffio_read_buffer_ref(AVIOContext *s, int size, AVBufferRef **buf)
+{
+    URLContext *h = ffio_geturlcontext(s);
+    int64_t pos, res;
+    int ret;
+
+    if (!h || s->write_flag || s->update_checksum)
+        return AVERROR(ENOSYS);
+
+    pos = s->pos - (s->buf_end - s->buf_ptr);
+    ret = ffurl_get_buffer(h, pos, size, buf);
+    if (ret < 0)
+        return ret;
+
+    if (s->buf_end - s->buf_ptr >= size) {
+        s->buf_ptr += size;
+    } else {
+        /* skip the data without filling the buffer with it */
+        if ((res = s->seek(s->opaque, pos + size, SEEK_SET)) < 0) {
+            av_buffer_unref(buf);
+            return res;
+        }
+        s->buf_end =
+        s->buf_ptr = s->buffer;
+        s->pos = pos + size;
+        s->eof_reached = 0;
+    }
+    return size;
+}
+
 int ffio_read_indirect(AVIOContext *s, unsigned char *buf, int size, const unsigned char **data)
 {
     if (s->buf_end - s->buf_ptr >= size && !s->write_flag) {
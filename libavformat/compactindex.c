@@ -0,0 +1,405 @@
+/*
+ * Compact index entry storage
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#include <limits.h>
+#include <string.h>
+
+#include "libavutil/avassert.h"
+#include "libavutil/mem.h"
+
+#include "compactindex.h"
+#include "internal.h"
+
+static inline uint64_t zigzag(int64_t v)
+{
+    return ((uint64_t)v << 1) ^ (uint64_t)(v >> 63);
+}
+
+static inline int64_t unzigzag(uint64_t v)
+{
+    return (int64_t)(v >> 1) ^ -(int64_t)(v & 1);
+}
+
+static uint8_t *put_varint(uint8_t *p, uint64_t v)
+{
+    while (v >= 0x80) {
+        *p++ = v | 0x80;
+        v  >>= 7;
+    }
+    *p++ = v;
+    return p;
+}
+
+static uint64_t get_varint(const uint8_t **pp)
+{
+    const uint8_t *p = *pp;
+    uint64_t v = 0;
+    int shift  = 0;
+
+    while (*p & 0x80) {
+        v     |= (uint64_t)(*p++ & 0x7F) << shift;
+        shift += 7;
+    }
+    v  |= (uint64_t)*p++ << shift;
+    *pp = p;
+    return v;
+}
+
+FFCompactIndex *ff_compact_index_alloc(void)
+{
+    FFCompactIndex *ci = av_mallocz(sizeof(*ci));
+
+    if (ci)
+        ci->cached_block = -1;
+    return ci;
+}
+
+void ff_compact_index_free(FFCompactIndex **pci)
+{
+    FFCompactIndex *ci = *pci;
+    int i;
+
+    if (!ci)
+        return;
+    for (i = 0; i < ci->nb_blocks; i++)
+        av_free(ci->blocks[i].data);
+    av_free(ci->blocks);
+    av_freep(pci);
+}
+
+size_t ff_compact_index_size(const FFCompactIndex *ci)
+{
+    return sizeof(*ci) + ci->blocks_allocated_size + ci->data_size;
+}
+
+static int block_append(FFCompactIndex *ci, FFCompactIndexBlock *b,
+                        int64_t pos, int64_t timestamp,
+                        int size, int distance, int flags)
+{
+    uint8_t buf[4 * 10], *p = buf;
+    unsigned int allocated_size = b->allocated_size;
+
+    p = put_varint(p, zigzag((uint64_t)timestamp - b->last_timestamp));
+    p = put_varint(p, zigzag((uint64_t)pos - b->last_pos - b->last_size));
+    p = put_varint(p, (unsigned)size << 2 | (flags & 3));
+    p = put_varint(p, zigzag(distance));
+
+    if (b->size + (p - buf) > b->allocated_size) {
+        uint8_t *data = av_fast_realloc(b->data, &b->allocated_size,
+                                        b->size + (p - buf));
+        if (!data) {
+            b->allocated_size = allocated_size;
+            return AVERROR(ENOMEM);
+        }
+        b->data        = data;
+        ci->data_size += b->allocated_size - allocated_size;
+    }
+    memcpy(b->data + b->size, buf, p - buf);
+    b->size += p - buf;
+
+    if (!b->nb_entries)
+        b->timestamp = timestamp;
+    b->nb_entries++;
+    b->last_timestamp = timestamp;
+    b->last_pos       = pos;
+    b->last_size      = size;
+    return 0;
+}
+
+static void decode_block(FFCompactIndex *ci, int k)
+{
+    const FFCompactIndexBlock *b = &ci->blocks[k];
+    const uint8_t *p = b->data;
+    uint64_t timestamp = 0, pos = 0;
+    int size = 0, i;
+
+    if (ci->cached_block == k)
+        return;
+
+    for (i = 0; i < b->nb_entries; i++) {
+        AVIndexEntry *e = &ci->cache[i];
+        unsigned v;
+
+        timestamp += unzigzag(get_varint(&p));
+        pos       += size + unzigzag(get_varint(&p));
+        v          = get_varint(&p);
+        size       = v >> 2;
+
+        e->pos          = pos;
+        e->timestamp    = timestamp;
+        e->flags        = v & 3;
+        e->size         = size;
+        e->min_distance = unzigzag(get_varint(&p));
+    }
+    ci->cached_block = k;
+}
+
+static int find_block(const FFCompactIndex *ci, int index)
+{
+    int lo = 0, hi = ci->nb_blocks;
+
+    while (hi - lo > 1) {
+        int mid = (lo + hi) >> 1;
+        if (ci->blocks[mid].first <= index)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+static int grow_blocks(FFCompactIndex *ci)
+{
+    FFCompactIndexBlock *blocks;
+
+    if ((unsigned)ci->nb_blocks + 1 >= UINT_MAX / sizeof(*blocks))
+        return AVERROR(ENOMEM);
+    blocks = av_fast_realloc(ci->blocks, &ci->blocks_allocated_size,
+                             (ci->nb_blocks + 1) * sizeof(*blocks));
+    if (!blocks)
+        return AVERROR(ENOMEM);
+    ci->blocks = blocks;
+    return 0;
+}
+
+/**
+ * Append an entry with a timestamp larger than all the others.
+ */
+static int index_append(FFCompactIndex *ci, int64_t pos, int64_t timestamp,
+                        int size, int distance, int flags)
+{
+    FFCompactIndexBlock *b = ci->nb_blocks ? &ci->blocks[ci->nb_blocks - 1] : NULL;
+    int ret;
+
+    if (!b || b->nb_entries >= FF_COMPACT_INDEX_BLOCK_SIZE) {
+        if (b && b->allocated_size > b->size) {
+            /* the block is full, it will only be rewritten on insertion */
+            uint8_t *data = av_realloc(b->data, b->size);
+            if (data) {
+                ci->data_size    -= b->allocated_size - b->size;
+                b->data           = data;
+                b->allocated_size = b->size;
+            }
+        }
+        if ((ret = grow_blocks(ci)) < 0)
+            return ret;
+        b = &ci->blocks[ci->nb_blocks];
+        memset(b, 0, sizeof(*b));
+        b->first = ci->nb_entries;
+        if ((ret = block_append(ci, b, pos, timestamp, size, distance, flags)) < 0)
+            return ret;
+        ci->nb_blocks++;
+    } else {
+        if ((ret = block_append(ci, b, pos, timestamp, size, distance, flags)) < 0)
+            return ret;
+        if (ci->cached_block == ci->nb_blocks - 1) {
+            AVIndexEntry *e = &ci->cache[b->nb_entries - 1];
+            e->pos          = pos;
+            e->timestamp    = timestamp;
+            e->flags        = flags;
+            e->size         = size;
+            e->min_distance = distance;
+        }
+    }
+    return ci->nb_entries++;
+}
+
+/**
+ * Replace block k with the nb_entries entries in the cache, splitting it
+ * in two if there are too many.
+ */
+static int store_block(FFCompactIndex *ci, int k, int nb_entries)
+{
+    FFCompactIndexBlock tmp[2] = { { 0 } };
+    FFCompactIndexBlock *b;
+    int nb_blocks = nb_entries > FF_COMPACT_INDEX_BLOCK_SIZE ? 2 : 1;
+    int split     = nb_blocks > 1 ? nb_entries / 2 : nb_entries;
+    int delta, i, j, ret = 0;
+
+    for (i = 0; i < nb_entries && ret >= 0; i++) {
+        const AVIndexEntry *e = &ci->cache[i];
+        ret = block_append(ci, &tmp[i >= split], e->pos, e->timestamp,
+                           e->size, e->min_distance, e->flags);
+    }
+    if (ret >= 0 && nb_blocks > 1)
+        ret = grow_blocks(ci);
+    if (ret < 0) {
+        for (j = 0; j < 2; j++) {
+            ci->data_size -= tmp[j].allocated_size;
+            av_free(tmp[j].data);
+        }
+        ci->cached_block = -1;
+        return ret;
+    }
+
+    b              = &ci->blocks[k];
+    delta          = nb_entries - b->nb_entries;
+    tmp[0].first   = b->first;
+    ci->data_size -= b->allocated_size;
+    av_free(b->data);
+    *b = tmp[0];
+    if (nb_blocks > 1) {
+        memmove(b + 2, b + 1, (ci->nb_blocks - k - 1) * sizeof(*b));
+        tmp[1].first = tmp[0].first + split;
+        b[1]         = tmp[1];
+        ci->nb_blocks++;
+    }
+    for (i = k + nb_blocks; i < ci->nb_blocks; i++)
+        ci->blocks[i].first += delta;
+    ci->nb_entries  += delta;
+    /* the first entries of the cache are still those of block k */
+    ci->cached_block = k;
+    return 0;
+}
+
+int ff_compact_index_add(FFCompactIndex *ci, int64_t pos, int64_t timestamp,
+                         int size, int distance, int flags)
+{
+    const FFCompactIndexBlock *b;
+    AVIndexEntry *ie;
+    int index, k, i, nb_entries, ret;
+
+    if ((unsigned)ci->nb_entries + 1 >= INT_MAX)
+        return -1;
+
+    if (size < 0 || size > 0x3FFFFFFF)
+        return AVERROR(EINVAL);
+
+    if (!ci->nb_blocks || ci->blocks[ci->nb_blocks - 1].last_timestamp < timestamp)
+        return index_append(ci, pos, timestamp, size, distance, flags);
+
+    index = ff_compact_index_search(ci, timestamp, AVSEEK_FLAG_ANY);
+    av_assert0(index >= 0);
+    k = find_block(ci, index);
+    decode_block(ci, k);
+    b          = &ci->blocks[k];
+    nb_entries = b->nb_entries;
+    i          = index - b->first;
+    ie         = &ci->cache[i];
+
+    if (ie->timestamp != timestamp) {
+        if (ie->timestamp <= timestamp)
+            return -1;
+        memmove(ie + 1, ie, sizeof(*ie) * (nb_entries - i));
+        nb_entries++;
+    } else if (ie->pos == pos && distance < ie->min_distance)
+        // do not reduce the distance
+        distance = ie->min_distance;
+
+    ie->pos          = pos;
+    ie->timestamp    = timestamp;
+    ie->min_distance = distance;
+    ie->size         = size;
+    ie->flags        = flags;
+
+    if ((ret = store_block(ci, k, nb_entries)) < 0)
+        return ret;
+    return index;
+}
+
+const AVIndexEntry *ff_compact_index_get(FFCompactIndex *ci, int index)
+{
+    int k = ci->cached_block;
+
+    if (index < 0 || index >= ci->nb_entries)
+        return NULL;
+
+    if (k < 0 || index <  ci->blocks[k].first ||
+                 index >= ci->blocks[k].first + ci->blocks[k].nb_entries) {
+        k = find_block(ci, index);
+        decode_block(ci, k);
+    }
+    return &ci->cache[index - ci->blocks[k].first];
+}
+
+int ff_compact_index_search(FFCompactIndex *ci, int64_t wanted_timestamp,
+                            int flags)
+{
+    const FFCompactIndexBlock *b;
+    int lo = 0, hi = ci->nb_blocks, m;
+
+    if (!ci->nb_entries)
+        return -1;
+
+    /* last block starting at or before the wanted timestamp */
+    while (hi - lo > 1) {
+        int mid = (lo + hi) >> 1;
+        if (ci->blocks[mid].timestamp <= wanted_timestamp)
+            lo = mid;
+        else
+            hi = mid;
+    }
+    decode_block(ci, lo);
+    b = &ci->blocks[lo];
+    m = ff_index_search_timestamp(ci->cache, b->nb_entries, wanted_timestamp,
+                                  flags | AVSEEK_FLAG_ANY);
+    if (m >= 0) {
+        m += b->first;
+    } else if (flags & AVSEEK_FLAG_BACKWARD) {
+        return -1;
+    } else {
+        /* the next block starts after the wanted timestamp */
+        m = b->first + b->nb_entries;
+    }
+
+    if (!(flags & AVSEEK_FLAG_ANY))
+        while (m >= 0 && m < ci->nb_entries &&
+               !(ff_compact_index_get(ci, m)->flags & AVINDEX_KEYFRAME))
+            m += (flags & AVSEEK_FLAG_BACKWARD) ? -1 : 1;
+
+    if (m == ci->nb_entries)
+        return -1;
+    return m;
+}
+
+int ff_compact_index_reduce(FFCompactIndex *ci)
+{
+    FFCompactIndex *reduced = ff_compact_index_alloc();
+    int k, i, ret = 0;
+
+    if (!reduced)
+        return AVERROR(ENOMEM);
+
+    for (k = 0; k < ci->nb_blocks && ret >= 0; k++) {
+        const FFCompactIndexBlock *b = &ci->blocks[k];
+        decode_block(ci, k);
+        for (i = b->first & 1; i < b->nb_entries && ret >= 0; i += 2) {
+            const AVIndexEntry *e = &ci->cache[i];
+            ret = index_append(reduced, e->pos, e->timestamp,
+                               e->size, e->min_distance, e->flags);
+        }
+    }
+    if (ret < 0) {
+        ff_compact_index_free(&reduced);
+        return ret;
+    }
+
+    for (k = 0; k < ci->nb_blocks; k++)
+        av_free(ci->blocks[k].data);
+    av_free(ci->blocks);
+    ci->blocks                = reduced->blocks;
+    ci->nb_blocks             = reduced->nb_blocks;
+    ci->blocks_allocated_size = reduced->blocks_allocated_size;
+    ci->nb_entries            = reduced->nb_entries;
+    ci->data_size             = reduced->data_size;
+    ci->cached_block          = -1;
+    av_free(reduced);
+    return 0;
+}
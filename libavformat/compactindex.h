@@ -0,0 +1,103 @@
+/*
+ * Compact index entry storage
+ *
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+#ifndef AVFORMAT_COMPACTINDEX_H
+#define AVFORMAT_COMPACTINDEX_H
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "avformat.h"
+
+/**
+ * Maximum number of entries per block. Inserting into a full block
+ * splits it in two.
+ */
+#define FF_COMPACT_INDEX_BLOCK_SIZE 128
+
+typedef struct FFCompactIndexBlock {
+    int first;              ///< index of the first entry of the block
+    int nb_entries;
+    int64_t timestamp;      ///< timestamp of the first entry
+    /* last entry, the next appended entry is coded relative to it */
+    int64_t last_timestamp;
+    int64_t last_pos;
+    int last_size;
+    /**
+     * Variable length coded entries: timestamp delta, position relative
+     * to the end of the previous entry, size and flags, min_distance.
+     */
+    uint8_t *data;
+    unsigned int size;
+    unsigned int allocated_size;
+} FFCompactIndexBlock;
+
+/**
+ * Index entries of a stream, stored as delta coded blocks sorted by
+ * timestamp. It has the same semantics as an array of AVIndexEntry
+ * maintained with ff_add_index_entry(), at a fraction of the memory.
+ */
+typedef struct FFCompactIndex {
+    FFCompactIndexBlock *blocks;
+    int nb_blocks;
+    unsigned int blocks_allocated_size;
+    int nb_entries;
+    size_t data_size;       ///< allocated size of all the block data
+
+    int cached_block;       ///< block decoded into cache, -1 if none
+    AVIndexEntry cache[FF_COMPACT_INDEX_BLOCK_SIZE + 1];
+} FFCompactIndex;
+
+FFCompactIndex *ff_compact_index_alloc(void);
+
+void ff_compact_index_free(FFCompactIndex **ci);
+
+/**
+ * Add an entry, with the same semantics as ff_add_index_entry().
+ *
+ * @return the index of the entry or a negative value on error
+ */
+int ff_compact_index_add(FFCompactIndex *ci, int64_t pos, int64_t timestamp,
+                         int size, int distance, int flags);
+
+/**
+ * Same as ff_index_search_timestamp().
+ */
+int ff_compact_index_search(FFCompactIndex *ci, int64_t wanted_timestamp,
+                            int flags);
+
+/**
+ * Get an entry. The returned pointer is valid until the next call using ci.
+ *
+ * @return the entry or NULL if index is out of range
+ */
+const AVIndexEntry *ff_compact_index_get(FFCompactIndex *ci, int index);
+
+/**
+ * Drop every other entry, like ff_reduce_index() does for arrays.
+ */
+int ff_compact_index_reduce(FFCompactIndex *ci);
+
+/**
+ * @return the memory used by the index, in bytes
+ */
+size_t ff_compact_index_size(const FFCompactIndex *ci);
+
+#endif /* AVFORMAT_COMPACTINDEX_H */
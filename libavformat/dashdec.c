@@ -20,10 +20,12 @@
  * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
  */
 #include <libxml/parser.h>
+#include "libavutil/avassert.h"
 #include "libavutil/intreadwrite.h"
 #include "libavutil/opt.h"
 #include "libavutil/time.h"
 #include "libavutil/parseutils.h"
+#include "libavutil/thread.h"
 #include "internal.h"
 #include "avio_internal.h"
 #include "dash.h"
@@ -31,6 +33,7 @@
 #define INITIAL_BUFFER_SIZE 32768
 #define MAX_BPRINT_READ_SIZE (UINT_MAX - 1)
 #define DEFAULT_MANIFEST_SIZE 8 * 1024
+#define FETCH_CHUNK_SIZE 65536
 
 struct fragment {
     int64_t url_offset;
@@ -69,6 +72,9 @@ struct timeline {
     int64_t duration;
 };
 
+struct fetch_queue;
+struct fetch_entry;
+
 /*
  * Each playlist has its own demuxer. If it is currently active,
  * it has an opened AVIOContext too, and potentially an AVPacket
@@ -116,6 +122,10 @@ struct representation {
     uint32_t init_sec_buf_read_offset;
     int64_t cur_timestamp;
     int is_restart_needed;
+
+    /* fragments downloaded ahead by the fetch worker, if any */
+    struct fetch_queue *fetch;
+    struct fetch_entry *fetch_cur; /* fragment being read, replaces input */
 };
 
 typedef struct DASHContext {
@@ -156,6 +166,15 @@ typedef struct DASHContext {
     int is_init_section_common_video;
     int is_init_section_common_audio;
 
+    /* fetch workers, shared by all the representations */
+    int fetch_fragments;
+    int64_t fetch_max_size;
+    int64_t fetch_buffered;
+    int fetch_initialized;
+#if HAVE_THREADS
+    pthread_mutex_t fetch_lock;
+    pthread_cond_t fetch_cond;
+#endif
 } DASHContext;
 
 static int ishttp(char *url)
@@ -344,8 +363,11 @@ static void free_timelines_list(struct representation *pls)
     pls->n_timelines = 0;
 }
 
+static void fetch_free(struct representation *pls);
+
 static void free_representation(struct representation *pls)
 {
+    fetch_free(pls);
     free_fragment_list(pls);
     free_timelines_list(pls);
     free_fragment(&pls->cur_seg);
@@ -1572,6 +1594,25 @@ finish:
     return ret;
 }
 
+static char *get_template_url(struct representation *pls, int64_t seq_no)
+{
+    DASHContext *c = pls->parent->priv_data;
+    char *url, *tmpfilename = av_mallocz(c->max_url_size);
+
+    if (!tmpfilename)
+        return NULL;
+    ff_dash_fill_tmpl_params(tmpfilename, c->max_url_size, pls->url_template, 0, seq_no, 0, get_segment_start_time_based_on_timeline(pls, seq_no));
+    url = av_strireplace(pls->url_template, pls->url_template, tmpfilename);
+    if (!url) {
+        av_log(pls->parent, AV_LOG_WARNING, "Unable to resolve template url '%s', try to use origin template\n", pls->url_template);
+        url = av_strdup(pls->url_template);
+        if (!url)
+            av_log(pls->parent, AV_LOG_ERROR, "Cannot resolve template url '%s'\n", pls->url_template);
+    }
+    av_free(tmpfilename);
+    return url;
+}
+
 static struct fragment *get_current_fragment(struct representation *pls)
 {
     int64_t min_seq_no = 0;
@@ -1625,28 +1666,422 @@ static struct fragment *get_current_fragment(struct representation *pls)
         }
     }
     if (seg) {
-        char *tmpfilename= av_mallocz(c->max_url_size);
-        if (!tmpfilename) {
-            return NULL;
-        }
-        ff_dash_fill_tmpl_params(tmpfilename, c->max_url_size, pls->url_template, 0, pls->cur_seq_no, 0, get_segment_start_time_based_on_timeline(pls, pls->cur_seq_no));
-        seg->url = av_strireplace(pls->url_template, pls->url_template, tmpfilename);
+        seg->url = get_template_url(pls, pls->cur_seq_no);
         if (!seg->url) {
-            av_log(pls->parent, AV_LOG_WARNING, "Unable to resolve template url '%s', try to use origin template\n", pls->url_template);
-            seg->url = av_strdup(pls->url_template);
-            if (!seg->url) {
-                av_log(pls->parent, AV_LOG_ERROR, "Cannot resolve template url '%s'\n", pls->url_template);
-                av_free(tmpfilename);
-                return NULL;
-            }
+            av_free(seg);
+            return NULL;
         }
-        av_free(tmpfilename);
         seg->size = -1;
     }
 
     return seg;
 }
 
+/*
+ * Fetch workers: for on-demand presentations, each representation gets a
+ * thread downloading its next fetch_fragments fragments into memory, so that
+ * the fragments of all the representations are downloaded concurrently and
+ * ahead of dash_read_packet(). The fragment being read by a representation
+ * may always grow, while the others stop downloading once fetch_max_size
+ * bytes are buffered in total by all the representations.
+ */
+struct fetch_entry {
+    int64_t seq_no;
+    uint8_t *buf;
+    unsigned int buf_size;
+    int data_len;
+    int read_pos;
+    int done;
+    int error;  /* set when done: AVERROR_EOF or the download error */
+    int abort;  /* dropped while downloading, freed by the worker */
+    struct fetch_entry *next;
+};
+
+struct fetch_queue {
+#if HAVE_THREADS
+    pthread_t thread;
+#endif
+    struct fetch_entry *first, *last;
+    struct fetch_entry *downloading;
+    int nb_entries;
+    int64_t next_seq_no;
+    AVDictionary *avio_opts;
+    int active;
+    int error;
+    int exit;
+};
+
+#if HAVE_THREADS
+static int fetch_fragment_exists(struct representation *pls, int64_t seq_no)
+{
+    return pls->n_fragments ? seq_no < pls->n_fragments : seq_no <= pls->last_seq_no;
+}
+
+static struct fragment *get_fragment(struct representation *pls, int64_t seq_no)
+{
+    struct fragment *seg = av_mallocz(sizeof(*seg));
+
+    if (!seg)
+        return NULL;
+    if (pls->n_fragments) {
+        seg->url        = av_strdup(pls->fragments[seq_no]->url);
+        seg->size       = pls->fragments[seq_no]->size;
+        seg->url_offset = pls->fragments[seq_no]->url_offset;
+    } else {
+        seg->url  = get_template_url(pls, seq_no);
+        seg->size = -1;
+    }
+    if (!seg->url)
+        av_freep(&seg);
+    return seg;
+}
+
+static void fetch_free_entry(DASHContext *c, struct fetch_entry *entry)
+{
+    c->fetch_buffered -= entry->data_len;
+    av_free(entry->buf);
+    av_free(entry);
+}
+
+/**
+ * Copy the cookies set by the servers in opts back to the options shared by
+ * all the requests, which the fetch workers access under fetch_lock.
+ */
+static void fetch_merge_cookies(DASHContext *c, AVDictionary *opts)
+{
+    AVDictionaryEntry *cookies = av_dict_get(opts, "cookies", NULL, 0);
+
+    if (!cookies)
+        return;
+    if (c->fetch_initialized)
+        pthread_mutex_lock(&c->fetch_lock);
+    av_dict_set(&c->avio_opts, "cookies", cookies->value, 0);
+    if (c->fetch_initialized)
+        pthread_mutex_unlock(&c->fetch_lock);
+}
+
+static int fetch_copy_opts(DASHContext *c, AVDictionary **dst)
+{
+    int ret;
+
+    if (c->fetch_initialized)
+        pthread_mutex_lock(&c->fetch_lock);
+    ret = av_dict_copy(dst, c->avio_opts, 0);
+    if (c->fetch_initialized)
+        pthread_mutex_unlock(&c->fetch_lock);
+    return ret;
+}
+
+/* Drop all the queued fragments, must be called with fetch_lock held. */
+static void fetch_flush(DASHContext *c, struct fetch_queue *f)
+{
+    while (f->first) {
+        struct fetch_entry *entry = f->first;
+        f->first = entry->next;
+        if (entry == f->downloading)
+            entry->abort = 1;
+        else
+            fetch_free_entry(c, entry);
+    }
+    f->last = NULL;
+    f->nb_entries = 0;
+}
+
+static int fetch_download(struct representation *pls, struct fetch_entry *entry,
+                          uint8_t *chunk)
+{
+    DASHContext *c = pls->parent->priv_data;
+    struct fetch_queue *f = pls->fetch;
+    struct fragment *seg = get_fragment(pls, entry->seq_no);
+    AVDictionary *opts = NULL;
+    AVIOContext *in = NULL;
+    char *url = av_mallocz(c->max_url_size);
+    int ret;
+
+    if (!seg || !url) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    if (seg->size >= 0) {
+        av_dict_set_int(&opts, "offset", seg->url_offset, 0);
+        av_dict_set_int(&opts, "end_offset", seg->url_offset + seg->size, 0);
+    }
+    ff_make_absolute_url(url, c->max_url_size, c->base_url, seg->url);
+    av_log(pls->parent, AV_LOG_VERBOSE, "DASH fetch for url '%s', offset %"PRId64"\n",
+           url, seg->url_offset);
+    ret = open_url(pls->parent, &in, url, &f->avio_opts, opts, NULL);
+    fetch_merge_cookies(c, f->avio_opts);
+
+    while (ret >= 0) {
+        int size = FETCH_CHUNK_SIZE;
+
+        pthread_mutex_lock(&c->fetch_lock);
+        while (!f->exit && !entry->abort && entry != f->first &&
+               c->fetch_buffered && c->fetch_buffered + size > c->fetch_max_size)
+            pthread_cond_wait(&c->fetch_cond, &c->fetch_lock);
+        if (f->exit || entry->abort)
+            ret = AVERROR_EXIT;
+        pthread_mutex_unlock(&c->fetch_lock);
+        if (ret < 0)
+            break;
+
+        if (seg->size >= 0)
+            size = FFMIN(size, seg->size - entry->data_len);
+        if (size <= 0) {
+            ret = AVERROR_EOF;
+            break;
+        }
+        ret = avio_read(in, chunk, size);
+        if (ret <= 0) {
+            ret = ret ? ret : AVERROR_EOF;
+            break;
+        }
+
+        pthread_mutex_lock(&c->fetch_lock);
+        if (entry->data_len > INT_MAX - ret) {
+            ret = AVERROR(ENOMEM);
+        } else {
+            uint8_t *buf = av_fast_realloc(entry->buf, &entry->buf_size, entry->data_len + ret);
+            if (buf) {
+                entry->buf = buf;
+                memcpy(entry->buf + entry->data_len, chunk, ret);
+                entry->data_len   += ret;
+                c->fetch_buffered += ret;
+            } else {
+                ret = AVERROR(ENOMEM);
+            }
+        }
+        pthread_cond_broadcast(&c->fetch_cond);
+        pthread_mutex_unlock(&c->fetch_lock);
+    }
+
+end:
+    ff_format_io_close(pls->parent, &in);
+    av_dict_free(&opts);
+    av_free(url);
+    free_fragment(&seg);
+    return ret;
+}
+
+static void *fetch_worker(void *arg)
+{
+    struct representation *pls = arg;
+    DASHContext *c = pls->parent->priv_data;
+    struct fetch_queue *f = pls->fetch;
+    uint8_t *chunk = av_malloc(FETCH_CHUNK_SIZE);
+
+    pthread_mutex_lock(&c->fetch_lock);
+    while (!f->exit) {
+        struct fetch_entry *entry;
+        int ret;
+
+        if (!f->active || f->error || f->nb_entries >= c->fetch_fragments ||
+            !fetch_fragment_exists(pls, f->next_seq_no) ||
+            (f->first && c->fetch_buffered >= c->fetch_max_size)) {
+            pthread_cond_wait(&c->fetch_cond, &c->fetch_lock);
+            continue;
+        }
+
+        entry = av_mallocz(sizeof(*entry));
+        if (!entry || !chunk) {
+            av_free(entry);
+            f->error = AVERROR(ENOMEM);
+            pthread_cond_broadcast(&c->fetch_cond);
+            continue;
+        }
+        entry->seq_no = f->next_seq_no++;
+        if (f->last)
+            f->last->next = entry;
+        else
+            f->first = entry;
+        f->last = entry;
+        f->nb_entries++;
+        f->downloading = entry;
+        pthread_mutex_unlock(&c->fetch_lock);
+
+        ret = fetch_download(pls, entry, chunk);
+
+        pthread_mutex_lock(&c->fetch_lock);
+        f->downloading = NULL;
+        if (entry->abort) {
+            fetch_free_entry(c, entry);
+        } else {
+            if (ret != AVERROR_EOF && ret != AVERROR_EXIT)
+                av_log(pls->parent, AV_LOG_WARNING,
+                       "Failed to fetch fragment %"PRId64" of representation '%s': %s\n",
+                       entry->seq_no, pls->id, av_err2str(ret));
+            entry->done  = 1;
+            entry->error = ret;
+        }
+        pthread_cond_broadcast(&c->fetch_cond);
+    }
+    pthread_mutex_unlock(&c->fetch_lock);
+
+    av_free(chunk);
+    return NULL;
+}
+
+static void fetch_free(struct representation *pls)
+{
+    struct fetch_queue *f = pls->fetch;
+    DASHContext *c;
+
+    if (!f)
+        return;
+    /* the queue is only created by fetch_start(), on a representation of
+     * the context, which also initializes fetch_lock */
+    c = pls->parent->priv_data;
+    av_assert0(c->fetch_initialized);
+
+    pthread_mutex_lock(&c->fetch_lock);
+    f->exit = 1;
+    pthread_cond_broadcast(&c->fetch_cond);
+    pthread_mutex_unlock(&c->fetch_lock);
+    pthread_join(f->thread, NULL);
+
+    fetch_flush(c, f);
+    av_dict_free(&f->avio_opts);
+    av_freep(&pls->fetch);
+    pls->fetch_cur = NULL;
+}
+
+/**
+ * Start the fetch worker of a representation of an on-demand presentation.
+ * Representations made of a list of fragments without an initialization
+ * section are skipped, as their input must remain seekable.
+ */
+static int fetch_start(AVFormatContext *s, struct representation *pls)
+{
+    DASHContext *c = s->priv_data;
+    struct fetch_queue *f;
+    int ret;
+
+    if (!c->fetch_initialized) {
+        pthread_mutex_init(&c->fetch_lock, NULL);
+        pthread_cond_init(&c->fetch_cond, NULL);
+        c->fetch_initialized = 1;
+    }
+    if (c->is_live || (pls->n_fragments && !pls->init_section))
+        return 0;
+
+    f = pls->fetch = av_mallocz(sizeof(*f));
+    if (!f)
+        return AVERROR(ENOMEM);
+    if ((ret = fetch_copy_opts(c, &f->avio_opts)) < 0) {
+        av_freep(&pls->fetch);
+        return ret;
+    }
+    f->next_seq_no = pls->cur_seq_no;
+    f->active      = 1;
+
+    ret = pthread_create(&f->thread, NULL, fetch_worker, pls);
+    if (ret) {
+        av_log(s, AV_LOG_ERROR, "Failed to create fetch thread: %s\n",
+               av_err2str(AVERROR(ret)));
+        av_dict_free(&f->avio_opts);
+        av_freep(&pls->fetch);
+        return AVERROR(ret);
+    }
+    return 0;
+}
+
+/**
+ * Start reading the current fragment of a representation from its fetch
+ * queue, restarting the queue there if it holds other fragments.
+ */
+static int fetch_open(DASHContext *c, struct representation *pls)
+{
+    struct fetch_queue *f = pls->fetch;
+    int ret = 0;
+
+    pthread_mutex_lock(&c->fetch_lock);
+    if (!f->active || (f->first ? f->first->seq_no : f->next_seq_no) != pls->cur_seq_no) {
+        fetch_flush(c, f);
+        f->next_seq_no = pls->cur_seq_no;
+        f->active      = 1;
+        pthread_cond_broadcast(&c->fetch_cond);
+    }
+    while (!f->first && !f->error)
+        pthread_cond_wait(&c->fetch_cond, &c->fetch_lock);
+    if (f->first)
+        pls->fetch_cur = f->first;
+    else
+        ret = f->error;
+    pthread_mutex_unlock(&c->fetch_lock);
+
+    pls->cur_seg_offset = 0;
+    pls->cur_seg_size   = pls->cur_seg ? pls->cur_seg->size : -1;
+    return ret;
+}
+
+static int fetch_read(DASHContext *c, struct representation *pls,
+                      uint8_t *buf, int buf_size)
+{
+    struct fetch_entry *entry = pls->fetch_cur;
+    int ret;
+
+    pthread_mutex_lock(&c->fetch_lock);
+    while (entry->read_pos == entry->data_len && !entry->done)
+        pthread_cond_wait(&c->fetch_cond, &c->fetch_lock);
+    if (entry->read_pos < entry->data_len) {
+        ret = FFMIN(buf_size, entry->data_len - entry->read_pos);
+        memcpy(buf, entry->buf + entry->read_pos, ret);
+        entry->read_pos += ret;
+    } else {
+        ret = entry->error;
+    }
+    pthread_mutex_unlock(&c->fetch_lock);
+    return ret;
+}
+
+/**
+ * Stop reading the current fragment of a representation, and stop its fetch
+ * worker and drop all the fragments it fetched too if all is set.
+ */
+static void fetch_release(struct representation *pls, int all)
+{
+    DASHContext *c = pls->parent->priv_data;
+    struct fetch_queue *f = pls->fetch;
+
+    if (!f)
+        return;
+
+    pthread_mutex_lock(&c->fetch_lock);
+    if (pls->fetch_cur) {
+        struct fetch_entry *entry = f->first;
+        av_assert0(entry == pls->fetch_cur);
+        f->first = entry->next;
+        if (!f->first)
+            f->last = NULL;
+        f->nb_entries--;
+        if (entry == f->downloading)
+            entry->abort = 1;
+        else
+            fetch_free_entry(c, entry);
+        pls->fetch_cur = NULL;
+    }
+    if (all) {
+        fetch_flush(c, f);
+        f->active = 0;
+    }
+    pthread_cond_broadcast(&c->fetch_cond);
+    pthread_mutex_unlock(&c->fetch_lock);
+}
+#else
+static void fetch_merge_cookies(DASHContext *c, AVDictionary *opts)
+{
+    AVDictionaryEntry *cookies = av_dict_get(opts, "cookies", NULL, 0);
+    if (cookies)
+        av_dict_set(&c->avio_opts, "cookies", cookies->value, 0);
+}
+static int fetch_copy_opts(DASHContext *c, AVDictionary **dst) { return av_dict_copy(dst, c->avio_opts, 0); }
+static void fetch_free(struct representation *pls) { }
+static int fetch_start(AVFormatContext *s, struct representation *pls) { return 0; }
+static int fetch_open(DASHContext *c, struct representation *pls) { return AVERROR_BUG; }
+static int fetch_read(DASHContext *c, struct representation *pls, uint8_t *buf, int buf_size) { return AVERROR_BUG; }
+static void fetch_release(struct representation *pls, int all) { }
+#endif
+
 static int read_from_url(struct representation *pls, struct fragment *seg,
                          uint8_t *buf, int buf_size)
 {
@@ -1656,7 +2091,10 @@ static int read_from_url(struct representation *pls, struct fragment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, pls->cur_seg_size - pls->cur_seg_offset);
 
-    ret = avio_read(pls->input, buf, buf_size);
+    if (pls->fetch_cur)
+        ret = fetch_read(pls->parent->priv_data, pls, buf, buf_size);
+    else
+        ret = avio_read(pls->input, buf, buf_size);
     if (ret > 0)
         pls->cur_seg_offset += ret;
 
@@ -1665,7 +2103,7 @@ static int read_from_url(struct representation *pls, struct fragment *seg,
 
 static int open_input(DASHContext *c, struct representation *pls, struct fragment *seg)
 {
-    AVDictionary *opts = NULL;
+    AVDictionary *opts = NULL, *avio_opts = NULL;
     char *url = NULL;
     int ret = 0;
 
@@ -1674,6 +2112,8 @@ static int open_input(DASHContext *c, struct representation *pls, struct fragmen
         ret = AVERROR(ENOMEM);
         goto cleanup;
     }
+    if ((ret = fetch_copy_opts(c, &avio_opts)) < 0)
+        goto cleanup;
 
     if (seg->size >= 0) {
         /* try to restrict the HTTP request to the part we want
@@ -1685,10 +2125,12 @@ static int open_input(DASHContext *c, struct representation *pls, struct fragmen
     ff_make_absolute_url(url, c->max_url_size, c->base_url, seg->url);
     av_log(pls->parent, AV_LOG_VERBOSE, "DASH request for url '%s', offset %"PRId64"\n",
            url, seg->url_offset);
-    ret = open_url(pls->parent, &pls->input, url, &c->avio_opts, opts, NULL);
+    ret = open_url(pls->parent, &pls->input, url, &avio_opts, opts, NULL);
+    fetch_merge_cookies(c, avio_opts);
 
 cleanup:
     av_free(url);
+    av_dict_free(&avio_opts);
     av_dict_free(&opts);
     pls->cur_seg_offset = 0;
     pls->cur_seg_size = seg->size;
@@ -1758,7 +2200,7 @@ static int read_data(void *opaque, uint8_t *buf, int buf_size)
     DASHContext *c = v->parent->priv_data;
 
 restart:
-    if (!v->input) {
+    if (!v->input && !v->fetch_cur) {
         free_fragment(&v->cur_seg);
         v->cur_seg = get_current_fragment(v);
         if (!v->cur_seg) {
@@ -1771,7 +2213,10 @@ restart:
         if (ret)
             goto end;
 
-        ret = open_input(c, v, v->cur_seg);
+        if (v->fetch)
+            ret = fetch_open(c, v);
+        else
+            ret = open_input(c, v, v->cur_seg);
         if (ret < 0) {
             if (ff_check_interrupt(c->interrupt_callback)) {
                 ret = AVERROR_EXIT;
@@ -2041,6 +2486,30 @@ static int dash_read_header(AVFormatContext *s)
         av_dict_set(&c->avio_opts, "seekable", "0", 0);
     }
 
+    if (!HAVE_THREADS && c->fetch_fragments) {
+        av_log(s, AV_LOG_WARNING, "Fetch workers require threads, disabling them\n");
+        c->fetch_fragments = 0;
+    }
+
+    /* Start downloading all the representations before probing them */
+    if (c->fetch_fragments) {
+        struct representation **reps[] = { c->videos, c->audios, c->subtitles };
+        int nb_reps[] = { c->n_videos, c->n_audios, c->n_subtitles };
+        int j;
+
+        for (i = 0; i < FF_ARRAY_ELEMS(reps); i++) {
+            for (j = 0; j < nb_reps[i]; j++) {
+                rep = reps[i][j];
+                rep->parent     = s;
+                rep->cur_seq_no = calc_cur_seg_no(s, rep);
+                if (!rep->last_seq_no)
+                    rep->last_seq_no = calc_max_seg_no(rep, c);
+                if ((ret = fetch_start(s, rep)) < 0)
+                    goto fail;
+            }
+        }
+    }
+
     if(c->n_videos)
         c->is_init_section_common_video = is_common_init_section_exist(c->videos, c->n_videos);
 
@@ -2168,6 +2637,7 @@ static void recheck_discard_flags(AVFormatContext *s, struct representation **p,
         } else if (!needed && pls->ctx) {
             close_demux_for_component(pls);
             ff_format_io_close(pls->parent, &pls->input);
+            fetch_release(pls, 1);
             av_log(s, AV_LOG_INFO, "No longer receiving stream_index %d\n", pls->stream_index);
         }
     }
@@ -2229,6 +2699,7 @@ static int dash_read_packet(AVFormatContext *s, AVPacket *pkt)
             cur->cur_seg_offset = 0;
             cur->init_sec_buf_read_offset = 0;
             ff_format_io_close(cur->parent, &cur->input);
+            fetch_release(cur, 0);
             ret = reopen_demux_for_component(s, cur);
             cur->is_restart_needed = 0;
         }
@@ -2244,6 +2715,13 @@ static int dash_close(AVFormatContext *s)
     free_subtitle_list(c);
     av_dict_free(&c->avio_opts);
     av_freep(&c->base_url);
+#if HAVE_THREADS
+    if (c->fetch_initialized) {
+        pthread_cond_destroy(&c->fetch_cond);
+        pthread_mutex_destroy(&c->fetch_lock);
+        c->fetch_initialized = 0;
+    }
+#endif
     return 0;
 }
 
@@ -2268,6 +2746,7 @@ static int dash_seek(AVFormatContext *s, struct representation *pls, int64_t see
     }
 
     ff_format_io_close(pls->parent, &pls->input);
+    fetch_release(pls, 1);
 
     // find the nearest fragment
     if (pls->n_timelines > 0 && pls->fragment_timescale > 0) {
@@ -2365,6 +2844,10 @@ static const AVOption dash_options[] = {
         OFFSET(allowed_extensions), AV_OPT_TYPE_STRING,
         {.str = "aac,m4a,m4s,m4v,mov,mp4,webm,ts"},
         INT_MIN, INT_MAX, FLAGS},
+    {"fetch_fragments", "Number of fragments of each representation to download ahead in a separate thread",
+        OFFSET(fetch_fragments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, FLAGS},
+    {"fetch_max_size", "Maximum number of bytes downloaded ahead by all the representations",
+        OFFSET(fetch_max_size), AV_OPT_TYPE_INT64, {.i64 = 32 << 20}, 0, INT64_MAX, FLAGS},
     {NULL}
 };
 
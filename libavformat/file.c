@@ -22,6 +22,7 @@
 #include "libavutil/avstring.h"
 #include "libavutil/internal.h"
 #include "libavutil/opt.h"
+#include "libavcodec/avcodec.h"
 #include "avformat.h"
 #if HAVE_DIRENT_H
 #include <dirent.h>
@@ -30,6 +31,9 @@
 #if HAVE_IO_H
 #include <io.h>
 #endif
+#if HAVE_MMAP
+#include <sys/mman.h>
+#endif
 #if HAVE_UNISTD_H
 #include <unistd.h>
 #endif
@@ -74,6 +78,12 @@ typedef struct FileContext {
     int blocksize;
     int follow;
     int seekable;
+    int use_mmap;
+    AVBufferRef *map; ///< whole file when mapped, then read from instead of fd
+    int64_t map_size;
+    int64_t map_end;  ///< end of the readable mapping, zero-filled past map_size
+    int64_t map_pos;
+    long page_size;
 #if HAVE_DIRENT_H
     DIR *dir;
 #endif
@@ -84,6 +94,7 @@ static const AVOption file_options[] = {
     { "blocksize", "set I/O operation maximum block size", offsetof(FileContext, blocksize), AV_OPT_TYPE_INT, { .i64 = INT_MAX }, 1, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM },
     { "follow", "Follow a file as it is being written", offsetof(FileContext, follow), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { "seekable", "Sets if the file is seekable", offsetof(FileContext, seekable), AV_OPT_TYPE_INT, { .i64 = -1 }, -1, 0, AV_OPT_FLAG_DECODING_PARAM | AV_OPT_FLAG_ENCODING_PARAM },
+    { "mmap", "map files opened for reading into memory, so demuxed packets can reference it", offsetof(FileContext, use_mmap), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, AV_OPT_FLAG_DECODING_PARAM },
     { NULL }
 };
 
@@ -111,6 +122,14 @@ static int file_read(URLContext *h, unsigned char *buf, int size)
     FileContext *c = h->priv_data;
     int ret;
     size = FFMIN(size, c->blocksize);
+    if (c->map) {
+        if (c->map_pos >= c->map_size)
+            return AVERROR_EOF;
+        size = FFMIN(size, c->map_size - c->map_pos);
+        memcpy(buf, c->map->data + c->map_pos, size);
+        c->map_pos += size;
+        return size;
+    }
     ret = read(c->fd, buf, size);
     if (ret == 0 && c->follow)
         return AVERROR(EAGAIN);
@@ -205,6 +224,80 @@ static int file_move(URLContext *h_src, URLContext *h_dst)
 
 #if CONFIG_FILE_PROTOCOL
 
+#if HAVE_MMAP
+#define MAP_MIN_PAGES 4
+
+static void file_unmap(void *opaque, uint8_t *data)
+{
+    long page_size = sysconf(_SC_PAGESIZE);
+    size_t offset  = page_size > 0 ? (uintptr_t)data % page_size : 0;
+
+    munmap(data - offset, (size_t)opaque + offset);
+}
+
+/* Map the file privately, so that demuxers modifying packet data in place
+ * write to their own copy of the pages and never to the file. */
+static void file_map(URLContext *h, int64_t size)
+{
+    FileContext *c = h->priv_data;
+    long page_size = sysconf(_SC_PAGESIZE);
+    void *data;
+
+    if (size <= 0 || size > SIZE_MAX || page_size <= 0)
+        return;
+    data = mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, c->fd, 0);
+    if (data == MAP_FAILED) {
+        av_log(h, AV_LOG_VERBOSE, "mmap() failed: %s, reading the file instead\n",
+               av_err2str(AVERROR(errno)));
+        return;
+    }
+    c->map = av_buffer_create(data, FFMIN(size, INT_MAX), file_unmap,
+                              (void *)(size_t)size, AV_BUFFER_FLAG_READONLY);
+    if (!c->map) {
+        munmap(data, size);
+        return;
+    }
+    c->map_size  = size;
+    c->map_end   = FFALIGN(size, page_size);
+    c->map_pos   = 0;
+    c->page_size = page_size;
+}
+
+/* Each referenced range gets a private mapping of its own, whose padding is
+ * then zeroed in place. Only the pages holding the padding are copied by the
+ * kernel, the rest are shared with the page cache. */
+static int file_get_buffer(URLContext *h, int64_t pos, int size, AVBufferRef **buf)
+{
+    FileContext *c = h->priv_data;
+    int64_t offset = pos - pos % FFMAX(c->page_size, 1);
+    size_t len;
+    uint8_t *data;
+
+    /* smaller ranges are cheaper to copy than to map, and pages wholly past
+     * the end of the file cannot be accessed */
+    if (!c->map || pos < 0 || size < MAP_MIN_PAGES * c->page_size ||
+        pos + size > c->map_size ||
+        pos + size + AV_INPUT_BUFFER_PADDING_SIZE > c->map_end)
+        return AVERROR(ENOSYS);
+
+    len  = pos - offset + size + AV_INPUT_BUFFER_PADDING_SIZE;
+    data = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, c->fd, offset);
+    if (data == MAP_FAILED)
+        return AVERROR(ENOSYS);
+    data += pos - offset;
+    memset(data + size, 0, AV_INPUT_BUFFER_PADDING_SIZE);
+
+    *buf = av_buffer_create(data, size, file_unmap,
+                            (void *)(size_t)(size + AV_INPUT_BUFFER_PADDING_SIZE),
+                            AV_BUFFER_FLAG_READONLY);
+    if (!*buf) {
+        munmap(data - (pos - offset), len);
+        return AVERROR(ENOMEM);
+    }
+    return 0;
+}
+#endif
+
 static int file_open(URLContext *h, const char *filename, int flags)
 {
     FileContext *c = h->priv_data;
@@ -243,6 +336,12 @@ static int file_open(URLContext *h, const char *filename, int flags)
     if (c->seekable >= 0)
         h->is_streamed = !c->seekable;
 
+#if HAVE_MMAP
+    if (c->use_mmap && !(flags & AVIO_FLAG_WRITE) && !c->follow &&
+        !h->is_streamed && !fstat(fd, &st) && S_ISREG(st.st_mode))
+        file_map(h, st.st_size);
+#endif
+
     return 0;
 }
 
@@ -258,6 +357,18 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
         return ret < 0 ? AVERROR(errno) : (S_ISFIFO(st.st_mode) ? 0 : st.st_size);
     }
 
+    if (c->map) {
+        if (whence == SEEK_CUR)
+            pos += c->map_pos;
+        else if (whence == SEEK_END)
+            pos += c->map_size;
+        else if (whence != SEEK_SET)
+            return AVERROR(EINVAL);
+        if (pos < 0)
+            return AVERROR(EINVAL);
+        return c->map_pos = pos;
+    }
+
     ret = lseek(c->fd, pos, whence);
 
     return ret < 0 ? AVERROR(errno) : ret;
@@ -266,6 +377,8 @@ static int64_t file_seek(URLContext *h, int64_t pos, int whence)
 static int file_close(URLContext *h)
 {
     FileContext *c = h->priv_data;
+    /* packets referencing the file keep their own mappings */
+    av_buffer_unref(&c->map);
     return close(c->fd);
 }
 
@@ -361,6 +474,9 @@ const URLProtocol ff_file_protocol = {
     .url_seek            = file_seek,
     .url_close           = file_close,
     .url_get_file_handle = file_get_handle,
+#if HAVE_MMAP
+    .url_get_buffer      = file_get_buffer,
+#endif
     .url_check           = file_check,
     .url_delete          = file_delete,
     .url_move            = file_move,
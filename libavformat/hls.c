@@ -33,6 +33,7 @@
 #include "libavutil/mathematics.h"
 #include "libavutil/opt.h"
 #include "libavutil/dict.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "avformat.h"
 #include "internal.h"
@@ -47,6 +48,8 @@
 #define MPEG_TIME_BASE 90000
 #define MPEG_TIME_BASE_Q (AVRational){1, MPEG_TIME_BASE}
 
+#define PREFETCH_CHUNK_SIZE 65536
+
 /*
  * An apple http stream consists of a playlist with media segment files,
  * played sequentially. There may be several playlists with the same
@@ -78,6 +81,8 @@ struct segment {
 };
 
 struct rendition;
+struct prefetch;
+struct prefetch_slot;
 
 enum PlaylistType {
     PLS_TYPE_UNSPECIFIED,
@@ -98,6 +103,8 @@ struct playlist {
     int input_read_done;
     AVIOContext *input_next;
     int input_next_requested;
+    struct prefetch *prefetch;
+    struct prefetch_slot *prefetch_cur; /* prefetched segment being read, replaces input */
     AVFormatContext *parent;
     int index;
     AVFormatContext *ctx;
@@ -207,11 +214,14 @@ typedef struct HLSContext {
     int64_t cur_timestamp;
     AVIOInterruptCB *interrupt_callback;
     AVDictionary *avio_opts;
+    AVMutex prefetch_lock;      /* protects avio_opts from the prefetch workers */
     char *allowed_extensions;
     int max_reload;
     int http_persistent;
     int http_multiple;
     int http_seekable;
+    int prefetch_segments;
+    int64_t prefetch_max_size;
     AVIOContext *playlist_pb;
 } HLSContext;
 
@@ -243,6 +253,8 @@ static void free_init_section_list(struct playlist *pls)
     pls->n_init_sections = 0;
 }
 
+static void prefetch_free(struct playlist *pls);
+
 static void free_playlist_list(HLSContext *c)
 {
     int i;
@@ -258,6 +270,7 @@ static void free_playlist_list(HLSContext *c)
         av_freep(&pls->init_sec_buf);
         av_packet_unref(&pls->pkt);
         av_freep(&pls->pb.buffer);
+        prefetch_free(pls);
         ff_format_io_close(c->ctx, &pls->input);
         pls->input_read_done = 0;
         ff_format_io_close(c->ctx, &pls->input_next);
@@ -701,6 +714,406 @@ static int open_url(AVFormatContext *s, AVIOContext **pb, const char *url,
     return ret;
 }
 
+/*
+ * Segment prefetching: the next prefetch_segments segments of a playlist are
+ * downloaded concurrently into memory by a pool of worker threads, one per
+ * slot of the window, so that reading a segment does not wait for a full
+ * request round-trip at every segment boundary. The segment being read may
+ * always grow, while the others stop downloading once prefetch_max_size bytes
+ * are buffered in total.
+ */
+enum PrefetchSlotState {
+    PREFETCH_SLOT_FREE,
+    PREFETCH_SLOT_PENDING,
+    PREFETCH_SLOT_RUNNING,
+    PREFETCH_SLOT_DONE,
+};
+
+struct prefetch_slot {
+    enum PrefetchSlotState state;
+    int seq_no;
+    char *url;
+    int64_t url_offset;
+    int64_t size;
+    AVDictionary *avio_opts;
+
+    uint8_t *buf;
+    unsigned int buf_size;
+    int data_len;
+    int read_pos;
+    int error;  /* set when done: AVERROR_EOF or the download error */
+    int abort;  /* dropped while running, cleared by its worker */
+};
+
+struct prefetch {
+#if HAVE_THREADS
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+#endif
+    int nb_threads;
+    struct prefetch_slot *slots;
+    int nb_slots;
+    int cur_seq_no;     /* segment being read, exempt from the memory limit */
+    int64_t buffered;   /* bytes held by all the slots */
+    int64_t max_size;
+    int exit;
+};
+
+/**
+ * Copy the cookies set by the servers in opts back to the options shared by
+ * all the requests.
+ */
+static void merge_cookies(HLSContext *c, AVDictionary *opts)
+{
+    AVDictionaryEntry *cookies = av_dict_get(opts, "cookies", NULL, 0);
+
+    if (!cookies)
+        return;
+    ff_mutex_lock(&c->prefetch_lock);
+    av_dict_set(&c->avio_opts, "cookies", cookies->value, 0);
+    ff_mutex_unlock(&c->prefetch_lock);
+}
+
+static int copy_avio_opts(HLSContext *c, AVDictionary **dst)
+{
+    int ret;
+
+    ff_mutex_lock(&c->prefetch_lock);
+    ret = av_dict_copy(dst, c->avio_opts, 0);
+    ff_mutex_unlock(&c->prefetch_lock);
+    return ret;
+}
+
+#if HAVE_THREADS
+static void prefetch_slot_clear(struct prefetch *p, struct prefetch_slot *slot)
+{
+    p->buffered -= slot->data_len;
+    av_freep(&slot->url);
+    av_freep(&slot->buf);
+    av_dict_free(&slot->avio_opts);
+    memset(slot, 0, sizeof(*slot));
+}
+
+static void prefetch_slot_drop(struct prefetch *p, struct prefetch_slot *slot)
+{
+    if (slot->state == PREFETCH_SLOT_RUNNING)
+        slot->abort = 1;
+    else if (slot->state != PREFETCH_SLOT_FREE)
+        prefetch_slot_clear(p, slot);
+}
+
+static int prefetch_open_input(struct playlist *pls, struct prefetch_slot *slot,
+                               AVIOContext **in)
+{
+    AVDictionary *opts = NULL;
+    int is_http = 0, ret;
+
+    if (slot->size >= 0) {
+        av_dict_set_int(&opts, "offset", slot->url_offset, 0);
+        av_dict_set_int(&opts, "end_offset", slot->url_offset + slot->size, 0);
+    }
+
+    av_log(pls->parent, AV_LOG_VERBOSE, "HLS prefetch for url '%s', offset %"PRId64", playlist %d\n",
+           slot->url, slot->url_offset, pls->index);
+
+    ret = open_url(pls->parent, in, slot->url, &slot->avio_opts, opts, &is_http);
+    if (ret >= 0 && !is_http && slot->url_offset) {
+        int64_t seekret = avio_seek(*in, slot->url_offset, SEEK_SET);
+        if (seekret < 0) {
+            ret = seekret;
+            ff_format_io_close(pls->parent, in);
+        }
+    }
+    av_dict_free(&opts);
+    return ret;
+}
+
+static int prefetch_download(struct playlist *pls, struct prefetch_slot *slot,
+                             uint8_t *chunk)
+{
+    struct prefetch *p = pls->prefetch;
+    AVIOContext *in = NULL;
+    int ret = prefetch_open_input(pls, slot, &in);
+
+    while (ret >= 0) {
+        int size = PREFETCH_CHUNK_SIZE;
+
+        pthread_mutex_lock(&p->lock);
+        while (!p->exit && !slot->abort && slot->seq_no != p->cur_seq_no &&
+               p->buffered && p->buffered + size > p->max_size)
+            pthread_cond_wait(&p->cond, &p->lock);
+        if (p->exit || slot->abort)
+            ret = AVERROR_EXIT;
+        pthread_mutex_unlock(&p->lock);
+        if (ret < 0)
+            break;
+
+        if (slot->size >= 0)
+            size = FFMIN(size, slot->size - slot->data_len);
+        if (size <= 0) {
+            ret = AVERROR_EOF;
+            break;
+        }
+        ret = avio_read(in, chunk, size);
+        if (ret <= 0) {
+            ret = ret ? ret : AVERROR_EOF;
+            break;
+        }
+
+        pthread_mutex_lock(&p->lock);
+        if (slot->data_len > INT_MAX - ret) {
+            ret = AVERROR(ENOMEM);
+        } else {
+            uint8_t *buf = av_fast_realloc(slot->buf, &slot->buf_size, slot->data_len + ret);
+            if (buf) {
+                slot->buf = buf;
+                memcpy(slot->buf + slot->data_len, chunk, ret);
+                slot->data_len += ret;
+                p->buffered    += ret;
+            } else {
+                ret = AVERROR(ENOMEM);
+            }
+        }
+        pthread_cond_broadcast(&p->cond);
+        pthread_mutex_unlock(&p->lock);
+    }
+
+    ff_format_io_close(pls->parent, &in);
+    return ret;
+}
+
+static void *prefetch_worker(void *arg)
+{
+    struct playlist *pls = arg;
+    struct prefetch *p = pls->prefetch;
+    uint8_t *chunk = av_malloc(PREFETCH_CHUNK_SIZE);
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->exit) {
+        struct prefetch_slot *slot = NULL;
+        int i, ret;
+
+        for (i = 0; i < p->nb_slots; i++) {
+            if (p->slots[i].state == PREFETCH_SLOT_PENDING &&
+                (!slot || p->slots[i].seq_no < slot->seq_no))
+                slot = &p->slots[i];
+        }
+        if (!slot) {
+            pthread_cond_wait(&p->cond, &p->lock);
+            continue;
+        }
+        slot->state = PREFETCH_SLOT_RUNNING;
+        pthread_mutex_unlock(&p->lock);
+
+        ret = chunk ? prefetch_download(pls, slot, chunk) : AVERROR(ENOMEM);
+        merge_cookies(pls->parent->priv_data, slot->avio_opts);
+
+        pthread_mutex_lock(&p->lock);
+        if (slot->abort) {
+            prefetch_slot_clear(p, slot);
+        } else {
+            if (ret != AVERROR_EOF && ret != AVERROR_EXIT)
+                av_log(pls->parent, AV_LOG_WARNING,
+                       "Failed to prefetch segment %d of playlist %d: %s\n",
+                       slot->seq_no, pls->index, av_err2str(ret));
+            slot->state = PREFETCH_SLOT_DONE;
+            slot->error = ret;
+        }
+        pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    av_free(chunk);
+    return NULL;
+}
+
+static void prefetch_free(struct playlist *pls)
+{
+    struct prefetch *p = pls->prefetch;
+    int i;
+
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    p->exit = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+    for (i = 0; i < p->nb_threads; i++)
+        pthread_join(p->threads[i], NULL);
+
+    for (i = 0; i < p->nb_slots; i++)
+        prefetch_slot_clear(p, &p->slots[i]);
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->lock);
+    av_freep(&p->threads);
+    av_freep(&p->slots);
+    av_freep(&pls->prefetch);
+    pls->prefetch_cur = NULL;
+}
+
+static int prefetch_init(HLSContext *c, struct playlist *pls)
+{
+    struct prefetch *p;
+    int ret;
+
+    p = pls->prefetch = av_mallocz(sizeof(*p));
+    if (!p)
+        return AVERROR(ENOMEM);
+    p->slots   = av_mallocz_array(c->prefetch_segments, sizeof(*p->slots));
+    p->threads = av_mallocz_array(c->prefetch_segments, sizeof(*p->threads));
+    if (!p->slots || !p->threads) {
+        av_freep(&p->slots);
+        av_freep(&p->threads);
+        av_freep(&pls->prefetch);
+        return AVERROR(ENOMEM);
+    }
+    p->nb_slots = c->prefetch_segments;
+    p->max_size = c->prefetch_max_size;
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+
+    for (; p->nb_threads < p->nb_slots; p->nb_threads++) {
+        ret = pthread_create(&p->threads[p->nb_threads], NULL, prefetch_worker, pls);
+        if (ret) {
+            av_log(pls->parent, AV_LOG_ERROR, "Failed to create prefetch thread: %s\n",
+                   av_err2str(AVERROR(ret)));
+            prefetch_free(pls);
+            return AVERROR(ret);
+        }
+    }
+    return 0;
+}
+
+/**
+ * Move the prefetch window to the current segment of the playlist, dropping
+ * the slots that fell out of it and queueing the segments that entered it.
+ * Encrypted segments are not prefetched.
+ */
+static void prefetch_schedule(HLSContext *c, struct playlist *pls)
+{
+    struct prefetch *p = pls->prefetch;
+    int i, seq_no, end = FFMIN(pls->cur_seq_no + p->nb_slots,
+                               pls->start_seq_no + pls->n_segments);
+
+    pthread_mutex_lock(&p->lock);
+    p->cur_seq_no = pls->cur_seq_no;
+    for (i = 0; i < p->nb_slots; i++) {
+        struct prefetch_slot *slot = &p->slots[i];
+        if (slot->state != PREFETCH_SLOT_FREE && !slot->abort &&
+            (slot->seq_no < pls->cur_seq_no || slot->seq_no >= end))
+            prefetch_slot_drop(p, slot);
+    }
+
+    for (seq_no = pls->cur_seq_no; seq_no < end; seq_no++) {
+        struct segment *seg = pls->segments[seq_no - pls->start_seq_no];
+        struct prefetch_slot *slot = NULL;
+
+        if (seg->key_type != KEY_NONE)
+            continue;
+        for (i = 0; i < p->nb_slots; i++) {
+            if (p->slots[i].state != PREFETCH_SLOT_FREE && !p->slots[i].abort &&
+                p->slots[i].seq_no == seq_no)
+                break;
+            if (!slot && p->slots[i].state == PREFETCH_SLOT_FREE)
+                slot = &p->slots[i];
+        }
+        if (i < p->nb_slots)
+            continue;
+        if (!slot)
+            break;
+
+        slot->url = av_strdup(seg->url);
+        if (!slot->url || copy_avio_opts(c, &slot->avio_opts) < 0) {
+            prefetch_slot_clear(p, slot);
+            break;
+        }
+        slot->seq_no     = seq_no;
+        slot->url_offset = seg->url_offset;
+        slot->size       = seg->size;
+        slot->state      = PREFETCH_SLOT_PENDING;
+    }
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+}
+
+/**
+ * Start reading the current segment of the playlist from its prefetch slot.
+ *
+ * @return 1 if the segment is prefetched, 0 if it must be opened directly
+ */
+static int prefetch_open(HLSContext *c, struct playlist *pls)
+{
+    struct prefetch *p = pls->prefetch;
+    int i;
+
+    prefetch_schedule(c, pls);
+
+    pthread_mutex_lock(&p->lock);
+    for (i = 0; i < p->nb_slots; i++) {
+        struct prefetch_slot *slot = &p->slots[i];
+        if (slot->state != PREFETCH_SLOT_FREE && !slot->abort &&
+            slot->seq_no == pls->cur_seq_no) {
+            pls->prefetch_cur = slot;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&p->lock);
+
+    pls->cur_seg_offset = 0;
+    return !!pls->prefetch_cur;
+}
+
+static int prefetch_read(struct playlist *pls, uint8_t *buf, int buf_size)
+{
+    struct prefetch *p = pls->prefetch;
+    struct prefetch_slot *slot = pls->prefetch_cur;
+    int ret;
+
+    pthread_mutex_lock(&p->lock);
+    while (slot->read_pos == slot->data_len && slot->state != PREFETCH_SLOT_DONE)
+        pthread_cond_wait(&p->cond, &p->lock);
+    if (slot->read_pos < slot->data_len) {
+        ret = FFMIN(buf_size, slot->data_len - slot->read_pos);
+        memcpy(buf, slot->buf + slot->read_pos, ret);
+        slot->read_pos += ret;
+    } else {
+        ret = slot->error;
+    }
+    pthread_mutex_unlock(&p->lock);
+    return ret;
+}
+
+/**
+ * Stop reading from the prefetch slot of the current segment, and drop all
+ * the other prefetched segments too if all is set.
+ */
+static void prefetch_release(struct playlist *pls, int all)
+{
+    struct prefetch *p = pls->prefetch;
+    int i;
+
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    if (pls->prefetch_cur)
+        prefetch_slot_drop(p, pls->prefetch_cur);
+    pls->prefetch_cur = NULL;
+    for (i = 0; all && i < p->nb_slots; i++)
+        prefetch_slot_drop(p, &p->slots[i]);
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+}
+#else
+static void prefetch_free(struct playlist *pls) { }
+static int prefetch_init(HLSContext *c, struct playlist *pls) { return AVERROR(ENOSYS); }
+static int prefetch_open(HLSContext *c, struct playlist *pls) { return 0; }
+static int prefetch_read(struct playlist *pls, uint8_t *buf, int buf_size) { return AVERROR_BUG; }
+static void prefetch_release(struct playlist *pls, int all) { }
+#endif
+
 static int parse_playlist(HLSContext *c, const char *url,
                           struct playlist *pls, AVIOContext *in)
 {
@@ -740,7 +1153,7 @@ static int parse_playlist(HLSContext *c, const char *url,
 
     if (!in) {
         AVDictionary *opts = NULL;
-        av_dict_copy(&opts, c->avio_opts, 0);
+        copy_avio_opts(c, &opts);
 
         if (c->http_persistent)
             av_dict_set(&opts, "multiple_requests", "1", 0);
@@ -1006,7 +1419,10 @@ static int read_from_url(struct playlist *pls, struct segment *seg,
     if (seg->size >= 0)
         buf_size = FFMIN(buf_size, seg->size - pls->cur_seg_offset);
 
-    ret = avio_read(pls->input, buf, buf_size);
+    if (pls->prefetch_cur)
+        ret = prefetch_read(pls, buf, buf_size);
+    else
+        ret = avio_read(pls->input, buf, buf_size);
     if (ret > 0)
         pls->cur_seg_offset += ret;
 
@@ -1213,10 +1629,13 @@ static void intercept_id3(struct playlist *pls, uint8_t *buf,
 
 static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg, AVIOContext **in)
 {
-    AVDictionary *opts = NULL;
+    AVDictionary *opts = NULL, *avio_opts = NULL;
     int ret;
     int is_http = 0;
 
+    if ((ret = copy_avio_opts(c, &avio_opts)) < 0)
+        return ret;
+
     if (c->http_persistent)
         av_dict_set(&opts, "multiple_requests", "1", 0);
 
@@ -1231,12 +1650,12 @@ static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg,
            seg->url, seg->url_offset, pls->index);
 
     if (seg->key_type == KEY_NONE) {
-        ret = open_url(pls->parent, in, seg->url, &c->avio_opts, opts, &is_http);
+        ret = open_url(pls->parent, in, seg->url, &avio_opts, opts, &is_http);
     } else if (seg->key_type == KEY_AES_128) {
         char iv[33], key[33], url[MAX_URL_SIZE];
         if (strcmp(seg->key, pls->key_url)) {
             AVIOContext *pb = NULL;
-            if (open_url(pls->parent, &pb, seg->key, &c->avio_opts, opts, NULL) == 0) {
+            if (open_url(pls->parent, &pb, seg->key, &avio_opts, opts, NULL) == 0) {
                 ret = avio_read(pb, pls->key, sizeof(pls->key));
                 if (ret != sizeof(pls->key)) {
                     av_log(pls->parent, AV_LOG_ERROR, "Unable to read key file %s\n",
@@ -1260,7 +1679,7 @@ static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg,
         av_dict_set(&opts, "key", key, 0);
         av_dict_set(&opts, "iv", iv, 0);
 
-        ret = open_url(pls->parent, in, url, &c->avio_opts, opts, &is_http);
+        ret = open_url(pls->parent, in, url, &avio_opts, opts, &is_http);
         if (ret < 0) {
             goto cleanup;
         }
@@ -1293,6 +1712,8 @@ static int open_input(HLSContext *c, struct playlist *pls, struct segment *seg,
     }
 
 cleanup:
+    merge_cookies(c, avio_opts);
+    av_dict_free(&avio_opts);
     av_dict_free(&opts);
     pls->cur_seg_offset = 0;
     return ret;
@@ -1421,7 +1842,7 @@ restart:
     if (!v->needed)
         return AVERROR_EOF;
 
-    if (!v->input || (c->http_persistent && v->input_read_done)) {
+    if ((!v->input && !v->prefetch_cur) || (c->http_persistent && v->input_read_done)) {
         int64_t reload_interval;
 
         /* Check that the playlist is still needed before opening a new
@@ -1492,7 +1913,15 @@ reload:
         if (ret)
             return ret;
 
-        if (c->http_multiple == 1 && v->input_next_requested) {
+        if (c->prefetch_segments && !v->prefetch) {
+            ret = prefetch_init(c, v);
+            if (ret < 0)
+                return ret;
+        }
+
+        if (v->prefetch && prefetch_open(c, v)) {
+            ret = 0;
+        } else if (c->http_multiple == 1 && v->input_next_requested) {
             FFSWAP(AVIOContext *, v->input, v->input_next);
             v->cur_seg_offset = 0;
             v->input_next_requested = 0;
@@ -1512,7 +1941,7 @@ reload:
         just_opened = 1;
     }
 
-    if (c->http_multiple == -1) {
+    if (c->http_multiple == -1 && v->input) {
         uint8_t *http_version_opt = NULL;
         int r = av_opt_get(v->input, "http_version", AV_OPT_SEARCH_CHILDREN, &http_version_opt);
         if (r >= 0) {
@@ -1522,7 +1951,7 @@ reload:
     }
 
     seg = next_segment(v);
-    if (c->http_multiple == 1 && !v->input_next_requested &&
+    if (c->http_multiple == 1 && !v->prefetch && !v->input_next_requested &&
         seg && seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         ret = open_input(c, v, seg, &v->input_next);
         if (ret < 0) {
@@ -1555,8 +1984,10 @@ reload:
 
         return ret;
     }
-    if (c->http_persistent &&
-        seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
+    if (v->prefetch_cur) {
+        prefetch_release(v, 0);
+    } else if (c->http_persistent &&
+               seg->key_type == KEY_NONE && av_strstart(seg->url, "http", NULL)) {
         v->input_read_done = 1;
     } else {
         ff_format_io_close(v->parent, &v->input);
@@ -1836,6 +2267,7 @@ static int hls_close(AVFormatContext *s)
 
     av_dict_free(&c->avio_opts);
     ff_format_io_close(c->ctx, &c->playlist_pb);
+    ff_mutex_destroy(&c->prefetch_lock);
 
     return 0;
 }
@@ -1848,6 +2280,7 @@ static int hls_read_header(AVFormatContext *s)
 
     c->ctx                = s;
     c->interrupt_callback = &s->interrupt_callback;
+    ff_mutex_init(&c->prefetch_lock, NULL);
 
     c->first_packet = 1;
     c->first_timestamp = AV_NOPTS_VALUE;
@@ -1861,6 +2294,11 @@ static int hls_read_header(AVFormatContext *s)
        the range header */
     av_dict_set_int(&c->avio_opts, "seekable", c->http_seekable, 0);
 
+    if (!HAVE_THREADS && c->prefetch_segments) {
+        av_log(s, AV_LOG_WARNING, "Segment prefetching requires threads, disabling it\n");
+        c->prefetch_segments = 0;
+    }
+
     if ((ret = parse_playlist(c, s->url, NULL, s->pb)) < 0)
         goto fail;
 
@@ -2083,6 +2521,7 @@ static int recheck_discard_flags(AVFormatContext *s, int first)
             pls->input_read_done = 0;
             ff_format_io_close(pls->parent, &pls->input_next);
             pls->input_next_requested = 0;
+            prefetch_release(pls, 1);
             pls->needed = 0;
             changed = 1;
             av_log(s, AV_LOG_INFO, "No longer receiving playlist %d\n", i);
@@ -2323,6 +2762,7 @@ static int hls_read_seek(AVFormatContext *s, int stream_index,
         pls->input_read_done = 0;
         ff_format_io_close(pls->parent, &pls->input_next);
         pls->input_next_requested = 0;
+        prefetch_release(pls, 1);
         av_packet_unref(&pls->pkt);
         pls->pb.eof_reached = 0;
         /* Clear any buffered data */
@@ -2384,6 +2824,10 @@ static const AVOption hls_options[] = {
         OFFSET(http_multiple), AV_OPT_TYPE_BOOL, {.i64 = -1}, -1, 1, FLAGS},
     {"http_seekable", "Use HTTP partial requests, 0 = disable, 1 = enable, -1 = auto",
         OFFSET(http_seekable), AV_OPT_TYPE_BOOL, { .i64 = -1}, -1, 1, FLAGS},
+    {"prefetch_segments", "Number of segments of each playlist to download ahead concurrently",
+        OFFSET(prefetch_segments), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, FLAGS},
+    {"prefetch_max_size", "Maximum number of bytes buffered ahead by the segment prefetching of each playlist",
+        OFFSET(prefetch_max_size), AV_OPT_TYPE_INT64, {.i64 = 16 << 20}, 0, INT64_MAX, FLAGS},
     {NULL}
 };
 
@@ -41,6 +41,7 @@
 #include "libavutil/random_seed.h"
 #include "libavutil/opt.h"
 #include "libavutil/log.h"
+#include "libavutil/thread.h"
 #include "libavutil/time.h"
 #include "libavutil/time_internal.h"
 
@@ -258,6 +259,10 @@ typedef struct HLSContext {
     char *headers;
     int has_default_key; /* has DEFAULT field of var_stream_map */
     int has_video_m3u8; /* has video stream m3u8 list */
+
+    int async_upload;
+    int upload_queue_size;
+    struct HLSUploadQueue *upload; /* NULL unless segments and playlists are written by the upload thread */
 } HLSContext;
 
 static int strftime_expand(const char *fmt, char **dest)
@@ -325,6 +330,47 @@ static int hlsenc_io_close(AVFormatContext *s, AVIOContext **pb, char *filename)
     return ret;
 }
 
+#if HAVE_THREADS
+typedef enum HLSUploadType {
+    HLS_UPLOAD_WRITE,
+    HLS_UPLOAD_RENAME,
+    HLS_UPLOAD_DELETE,
+} HLSUploadType;
+
+typedef struct HLSUploadJob {
+    HLSUploadType type;
+    char *url;
+    char *new_url;          /* destination of a rename */
+    const char *proto;      /* protocol of url, for deletions */
+    uint8_t *data;
+    int size;
+    AVDictionary *options;
+    int64_t queued_time;
+    struct HLSUploadJob *next;
+} HLSUploadJob;
+
+/**
+ * Segments, playlists, renames and deletions run in order by a background
+ * thread, so that a slow output does not block the muxing.
+ */
+typedef struct HLSUploadQueue {
+    AVFormatContext *avf;
+    pthread_t thread;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+    HLSUploadJob *first, *last;
+    int64_t size;           /* bytes of data queued */
+    int depth;              /* jobs queued, including the running one */
+    int exit;
+    int error;              /* first error of a job */
+
+    int max_depth;
+    int64_t nb_jobs;
+    int64_t total_latency;  /* from queuing to completion, in microseconds */
+    int64_t max_latency;
+} HLSUploadQueue;
+#endif
+
 static void set_http_options(AVFormatContext *s, AVDictionary **options, HLSContext *c)
 {
     int http_base_proto = ff_is_http_proto(s->url);
@@ -566,8 +612,8 @@ static void reflush_dynbuf(VariantStream *vs, int *range_length)
 #define SEPARATOR '/'
 #endif
 
-static int hls_delete_file(HLSContext *hls, AVFormatContext *avf,
-                           const char *path, const char *proto)
+static int hls_delete_file_sync(HLSContext *hls, AVFormatContext *avf,
+                                const char *path, const char *proto)
 {
     if (hls->method || (proto && !av_strcasecmp(proto, "http"))) {
         AVDictionary *opt = NULL;
@@ -586,6 +632,314 @@ static int hls_delete_file(HLSContext *hls, AVFormatContext *avf,
     return 0;
 }
 
+#if HAVE_THREADS
+static void hls_upload_free_job(HLSUploadJob **job)
+{
+    if (!*job)
+        return;
+    av_freep(&(*job)->url);
+    av_freep(&(*job)->new_url);
+    av_freep(&(*job)->data);
+    av_dict_free(&(*job)->options);
+    av_freep(job);
+}
+
+static int hls_upload_run(HLSUploadQueue *q, HLSUploadJob *job, AVIOContext **out)
+{
+    AVFormatContext *s = q->avf;
+    HLSContext *hls = s->priv_data;
+    int ret = 0, i;
+
+    switch (job->type) {
+    case HLS_UPLOAD_WRITE:
+        for (i = 0; i < 2; i++) {
+            AVDictionary *options = NULL;
+
+            av_dict_copy(&options, job->options, 0);
+            ret = hlsenc_io_open(s, out, job->url, &options);
+            av_dict_free(&options);
+            if (ret >= 0) {
+                avio_write(*out, job->data, job->size);
+                ret = hlsenc_io_close(s, out, job->url);
+            }
+            if (ret >= 0)
+                break;
+            ff_format_io_close(s, out);
+            if (!i)
+                av_log(s, AV_LOG_WARNING, "upload of '%s' failed,"
+                       " will retry with a new http session.\n", job->url);
+        }
+        if (ret < 0)
+            av_log(s, hls->ignore_io_errors ? AV_LOG_WARNING : AV_LOG_ERROR,
+                   "Failed to upload '%s'\n", job->url);
+        break;
+    case HLS_UPLOAD_RENAME:
+        /* failures are logged and were never fatal */
+        ff_rename(job->url, job->new_url, s);
+        break;
+    case HLS_UPLOAD_DELETE:
+        ret = hls_delete_file_sync(hls, s, job->url, job->proto);
+        break;
+    }
+    return ret;
+}
+
+static void *hls_upload_thread(void *arg)
+{
+    HLSUploadQueue *q = arg;
+    AVIOContext *out = NULL;
+
+    pthread_mutex_lock(&q->lock);
+    while (1) {
+        HLSUploadJob *job;
+        int64_t latency;
+        int ret;
+
+        while (!q->first && !q->exit)
+            pthread_cond_wait(&q->cond, &q->lock);
+        if (!q->first)
+            break;
+        job = q->first;
+        pthread_mutex_unlock(&q->lock);
+
+        ret = hls_upload_run(q, job, &out);
+        latency = av_gettime_relative() - job->queued_time;
+
+        pthread_mutex_lock(&q->lock);
+        q->first = job->next;
+        if (!q->first)
+            q->last = NULL;
+        q->size -= job->size;
+        q->depth--;
+        q->nb_jobs++;
+        q->total_latency += latency;
+        q->max_latency    = FFMAX(q->max_latency, latency);
+        if (ret < 0 && !q->error)
+            q->error = ret;
+        pthread_cond_broadcast(&q->cond);
+        pthread_mutex_unlock(&q->lock);
+
+        hls_upload_free_job(&job);
+        pthread_mutex_lock(&q->lock);
+    }
+    pthread_mutex_unlock(&q->lock);
+
+    ff_format_io_close(q->avf, &out);
+    return NULL;
+}
+
+/**
+ * Add a job to the upload queue, waiting for earlier jobs to complete
+ * while the queued data would exceed upload_queue_size.
+ */
+static int hls_upload_enqueue(HLSContext *hls, HLSUploadJob *job)
+{
+    HLSUploadQueue *q = hls->upload;
+
+    job->queued_time = av_gettime_relative();
+
+    pthread_mutex_lock(&q->lock);
+    if (q->first && q->size + job->size > hls->upload_queue_size)
+        av_log(hls, AV_LOG_DEBUG, "upload queue full, waiting\n");
+    while (q->first && q->size + job->size > hls->upload_queue_size)
+        pthread_cond_wait(&q->cond, &q->lock);
+    if (q->last)
+        q->last->next = job;
+    else
+        q->first = job;
+    q->last = job;
+    q->size += job->size;
+    q->depth++;
+    q->max_depth = FFMAX(q->max_depth, q->depth);
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+
+    return 0;
+}
+
+static HLSUploadJob *hls_upload_alloc_job(HLSUploadType type, const char *url)
+{
+    HLSUploadJob *job = av_mallocz(sizeof(*job));
+
+    if (!job)
+        return NULL;
+    job->type = type;
+    job->url  = av_strdup(url);
+    if (!job->url)
+        av_freep(&job);
+    return job;
+}
+
+static int hls_upload_start(AVFormatContext *s)
+{
+    HLSContext *hls = s->priv_data;
+    HLSUploadQueue *q;
+    int ret;
+
+    q = av_mallocz(sizeof(*q));
+    if (!q)
+        return AVERROR(ENOMEM);
+    q->avf = s;
+
+    if ((ret = pthread_mutex_init(&q->lock, NULL))) {
+        av_free(q);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_cond_init(&q->cond, NULL))) {
+        pthread_mutex_destroy(&q->lock);
+        av_free(q);
+        return AVERROR(ret);
+    }
+    if ((ret = pthread_create(&q->thread, NULL, hls_upload_thread, q))) {
+        av_log(s, AV_LOG_ERROR, "Failed to start the upload thread: %s\n",
+               av_err2str(AVERROR(ret)));
+        pthread_cond_destroy(&q->cond);
+        pthread_mutex_destroy(&q->lock);
+        av_free(q);
+        return AVERROR(ret);
+    }
+    hls->upload = q;
+    return 0;
+}
+
+/**
+ * Wait for all the queued jobs to complete.
+ *
+ * @return the first error of a job, 0 if there was none
+ */
+static int hls_upload_flush(HLSContext *hls)
+{
+    HLSUploadQueue *q = hls->upload;
+    int ret;
+
+    pthread_mutex_lock(&q->lock);
+    while (q->first)
+        pthread_cond_wait(&q->cond, &q->lock);
+    ret = q->error;
+    pthread_mutex_unlock(&q->lock);
+    return ret;
+}
+
+static void hls_upload_stop(HLSContext *hls)
+{
+    HLSUploadQueue *q = hls->upload;
+
+    if (!q)
+        return;
+
+    pthread_mutex_lock(&q->lock);
+    q->exit = 1;
+    pthread_cond_broadcast(&q->cond);
+    pthread_mutex_unlock(&q->lock);
+    pthread_join(q->thread, NULL);
+
+    av_log(hls, AV_LOG_VERBOSE, "upload queue: %"PRId64" jobs, max depth %d, "
+           "latency mean %.1f ms max %.1f ms\n", q->nb_jobs, q->max_depth,
+           q->nb_jobs ? q->total_latency / 1000.0 / q->nb_jobs : 0.0,
+           q->max_latency / 1000.0);
+
+    while (q->first) {
+        HLSUploadJob *job = q->first;
+        q->first = job->next;
+        hls_upload_free_job(&job);
+    }
+    pthread_cond_destroy(&q->cond);
+    pthread_mutex_destroy(&q->lock);
+    av_freep(&hls->upload);
+}
+
+static int hls_upload_error(HLSContext *hls)
+{
+    HLSUploadQueue *q = hls->upload;
+    int ret;
+
+    pthread_mutex_lock(&q->lock);
+    ret = q->error;
+    pthread_mutex_unlock(&q->lock);
+    return hls->ignore_io_errors ? 0 : ret;
+}
+#endif
+
+/**
+ * Open a segment or playlist for writing. With async_upload the data is
+ * buffered in memory and written by the upload thread when closed.
+ */
+static int hls_upload_open(AVFormatContext *s, AVIOContext **pb, char *filename,
+                           AVDictionary **options)
+{
+#if HAVE_THREADS
+    HLSContext *hls = s->priv_data;
+
+    if (hls->upload) {
+        int ret = hls_upload_error(hls);
+        if (ret < 0)
+            return ret;
+        return avio_open_dyn_buf(pb);
+    }
+#endif
+    return hlsenc_io_open(s, pb, filename, options);
+}
+
+static int hls_upload_close(AVFormatContext *s, AVIOContext **pb, char *filename,
+                            AVDictionary *options)
+{
+#if HAVE_THREADS
+    HLSContext *hls = s->priv_data;
+
+    if (hls->upload) {
+        HLSUploadJob *job;
+
+        if (!*pb)
+            return 0;
+        job = hls_upload_alloc_job(HLS_UPLOAD_WRITE, filename);
+        if (!job) {
+            ffio_free_dyn_buf(pb);
+            return AVERROR(ENOMEM);
+        }
+        job->size = avio_close_dyn_buf(*pb, &job->data);
+        *pb = NULL;
+        if (av_dict_copy(&job->options, options, 0) < 0) {
+            hls_upload_free_job(&job);
+            return AVERROR(ENOMEM);
+        }
+        return hls_upload_enqueue(hls, job);
+    }
+#endif
+    return hlsenc_io_close(s, pb, filename);
+}
+
+static int hls_rename(HLSContext *hls, const char *oldpath, const char *newpath)
+{
+#if HAVE_THREADS
+    if (hls->upload) {
+        HLSUploadJob *job = hls_upload_alloc_job(HLS_UPLOAD_RENAME, oldpath);
+
+        if (!job || !(job->new_url = av_strdup(newpath))) {
+            hls_upload_free_job(&job);
+            return AVERROR(ENOMEM);
+        }
+        return hls_upload_enqueue(hls, job);
+    }
+#endif
+    return ff_rename(oldpath, newpath, hls);
+}
+
+static int hls_delete_file(HLSContext *hls, AVFormatContext *avf,
+                           const char *path, const char *proto)
+{
+#if HAVE_THREADS
+    if (hls->upload) {
+        HLSUploadJob *job = hls_upload_alloc_job(HLS_UPLOAD_DELETE, path);
+
+        if (!job)
+            return AVERROR(ENOMEM);
+        job->proto = proto;
+        return hls_upload_enqueue(hls, job);
+    }
+#endif
+    return hls_delete_file_sync(hls, avf, path, proto);
+}
+
 static int hls_delete_old_segments(AVFormatContext *s, HLSContext *hls,
                                    VariantStream *vs)
 {
@@ -1054,7 +1408,7 @@ static int sls_flag_check_duration_size(HLSContext *hls, VariantStream *vs)
 static void sls_flag_file_rename(HLSContext *hls, VariantStream *vs, char *old_filename) {
     if ((hls->flags & (HLS_SECOND_LEVEL_SEGMENT_SIZE | HLS_SECOND_LEVEL_SEGMENT_DURATION)) &&
         strlen(vs->current_segment_final_filename_fmt)) {
-        ff_rename(old_filename, vs->avf->url, hls);
+        hls_rename(hls, old_filename, vs->avf->url);
     }
 }
 
@@ -1323,6 +1677,7 @@ static void hls_free_segments(HLSSegment *p)
 
 static int hls_rename_temp_file(AVFormatContext *s, AVFormatContext *oc)
 {
+    HLSContext *hls = s->priv_data;
     size_t len = strlen(oc->url);
     char *final_filename = av_strdup(oc->url);
     int ret;
@@ -1330,7 +1685,7 @@ static int hls_rename_temp_file(AVFormatContext *s, AVFormatContext *oc)
     if (!final_filename)
         return AVERROR(ENOMEM);
     final_filename[len-4] = '\0';
-    ret = ff_rename(oc->url, final_filename, s);
+    ret = hls_rename(hls, oc->url, final_filename);
     oc->url[len-4] = '\0';
     av_freep(&final_filename);
     return ret;
@@ -1406,8 +1761,7 @@ static int create_master_playlist(AVFormatContext *s,
 
     set_http_options(s, &options, hls);
     snprintf(temp_filename, sizeof(temp_filename), use_temp_file ? "%s.tmp" : "%s", hls->master_m3u8_url);
-    ret = hlsenc_io_open(s, &hls->m3u8_out, temp_filename, &options);
-    av_dict_free(&options);
+    ret = hls_upload_open(s, &hls->m3u8_out, temp_filename, &options);
     if (ret < 0) {
         av_log(s, AV_LOG_ERROR, "Failed to open master play list file '%s'\n",
                 temp_filename);
@@ -1531,9 +1885,10 @@ static int create_master_playlist(AVFormatContext *s,
 fail:
     if (ret >=0)
         hls->master_m3u8_created = 1;
-    hlsenc_io_close(s, &hls->m3u8_out, temp_filename);
+    hls_upload_close(s, &hls->m3u8_out, temp_filename, options);
+    av_dict_free(&options);
     if (use_temp_file)
-        ff_rename(temp_filename, hls->master_m3u8_url, s);
+        hls_rename(hls, temp_filename, hls->master_m3u8_url);
 
     return ret;
 }
@@ -1577,7 +1932,7 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
 
     set_http_options(s, &options, hls);
     snprintf(temp_filename, sizeof(temp_filename), use_temp_file ? "%s.tmp" : "%s", vs->m3u8_name);
-    if ((ret = hlsenc_io_open(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename, &options)) < 0) {
+    if ((ret = hls_upload_open(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename, &options)) < 0) {
         if (hls->ignore_io_errors)
             ret = 0;
         goto fail;
@@ -1633,7 +1988,7 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
 
     if (vs->vtt_m3u8_name) {
         snprintf(temp_vtt_filename, sizeof(temp_vtt_filename), use_temp_file ? "%s.tmp" : "%s", vs->vtt_m3u8_name);
-        if ((ret = hlsenc_io_open(s, &hls->sub_m3u8_out, temp_vtt_filename, &options)) < 0) {
+        if ((ret = hls_upload_open(s, &hls->sub_m3u8_out, temp_vtt_filename, &options)) < 0) {
             if (hls->ignore_io_errors)
                 ret = 0;
             goto fail;
@@ -1655,16 +2010,17 @@ static int hls_window(AVFormatContext *s, int last, VariantStream *vs)
     }
 
 fail:
-    av_dict_free(&options);
-    ret = hlsenc_io_close(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename);
+    ret = hls_upload_close(s, byterange_mode ? &hls->m3u8_out : &vs->out, temp_filename, options);
     if (ret < 0) {
+        av_dict_free(&options);
         return ret;
     }
-    hlsenc_io_close(s, &hls->sub_m3u8_out, vs->vtt_m3u8_name);
+    hls_upload_close(s, &hls->sub_m3u8_out, vs->vtt_m3u8_name, options);
+    av_dict_free(&options);
     if (use_temp_file) {
-        ff_rename(temp_filename, vs->m3u8_name, s);
+        hls_rename(hls, temp_filename, vs->m3u8_name);
         if (vs->vtt_m3u8_name)
-            ff_rename(temp_vtt_filename, vs->vtt_m3u8_name, s);
+            hls_rename(hls, temp_vtt_filename, vs->vtt_m3u8_name);
     }
     if (ret >= 0 && hls->master_pl_name)
         if (create_master_playlist(s, vs) < 0)
@@ -2566,7 +2922,7 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
 
                 set_http_options(s, &options, hls);
 
-                ret = hlsenc_io_open(s, &vs->out, filename, &options);
+                ret = hls_upload_open(s, &vs->out, filename, &options);
                 if (ret < 0) {
                     av_log(s, hls->ignore_io_errors ? AV_LOG_WARNING : AV_LOG_ERROR,
                            "Failed to open file '%s'\n", filename);
@@ -2583,7 +2939,7 @@ static int hls_write_packet(AVFormatContext *s, AVPacket *pkt)
                     av_dict_free(&options);
                     return ret;
                 }
-                ret = hlsenc_io_close(s, &vs->out, filename);
+                ret = hls_upload_close(s, &vs->out, filename, options);
                 if (ret < 0) {
                     av_log(s, AV_LOG_WARNING, "upload segment failed,"
                            " will retry with a new http session.\n");
@@ -2689,6 +3045,10 @@ static void hls_deinit(AVFormatContext *s)
     int i = 0;
     VariantStream *vs = NULL;
 
+#if HAVE_THREADS
+    hls_upload_stop(hls);
+#endif
+
     for (i = 0; i < hls->nb_varstreams; i++) {
         vs = &hls->var_streams[i];
 
@@ -2775,7 +3135,7 @@ static int hls_write_trailer(struct AVFormatContext *s)
         }
         if (!(hls->flags & HLS_SINGLE_FILE)) {
             set_http_options(s, &options, hls);
-            ret = hlsenc_io_open(s, &vs->out, filename, &options);
+            ret = hls_upload_open(s, &vs->out, filename, &options);
             if (ret < 0) {
                 av_log(s, AV_LOG_ERROR, "Failed to open file '%s'\n", oc->url);
                 goto failed;
@@ -2788,7 +3148,7 @@ static int hls_write_trailer(struct AVFormatContext *s)
             goto failed;
 
         vs->size = range_length;
-        ret = hlsenc_io_close(s, &vs->out, filename);
+        ret = hls_upload_close(s, &vs->out, filename, options);
         if (ret < 0) {
             av_log(s, AV_LOG_WARNING, "upload segment failed, will retry with a new http session.\n");
             ff_format_io_close(s, &vs->out);
@@ -2851,6 +3211,14 @@ failed:
         av_free(old_filename);
     }
 
+#if HAVE_THREADS
+    if (hls->upload) {
+        ret = hls_upload_flush(hls);
+        if (ret < 0 && !hls->ignore_io_errors)
+            return ret;
+    }
+#endif
+
     return 0;
 }
 
@@ -2951,6 +3319,20 @@ static int hls_init(AVFormatContext *s)
                "enabled together. Disabling 'independent_segments' flag\n");
     }
 
+    if (hls->async_upload) {
+        if ((hls->flags & HLS_SINGLE_FILE) || hls->max_seg_size > 0) {
+            av_log(s, AV_LOG_WARNING, "async_upload is not supported with "
+                   "byte range segments, disabling it\n");
+        } else {
+#if HAVE_THREADS
+            if ((ret = hls_upload_start(s)) < 0)
+                return ret;
+#else
+            av_log(s, AV_LOG_WARNING, "async_upload requires threads, disabling it\n");
+#endif
+        }
+    }
+
     for (i = 0; i < hls->nb_varstreams; i++) {
         vs = &hls->var_streams[i];
 
@@ -3176,6 +3558,8 @@ static const AVOption options[] = {
     {"timeout", "set timeout for socket I/O operations", OFFSET(timeout), AV_OPT_TYPE_DURATION, { .i64 = -1 }, -1, INT_MAX, .flags = E },
     {"ignore_io_errors", "Ignore IO errors for stable long-duration runs with network output", OFFSET(ignore_io_errors), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
     {"headers", "set custom HTTP headers, can override built in default headers", OFFSET(headers), AV_OPT_TYPE_STRING, { .str = NULL }, 0, 0, E },
+    {"async_upload", "write segments and playlists from a separate thread", OFFSET(async_upload), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
+    {"upload_queue_size", "maximum size in bytes of the data waiting to be uploaded", OFFSET(upload_queue_size), AV_OPT_TYPE_INT, { .i64 = 64 << 20 }, 1, INT_MAX, E },
     { NULL },
 };
 
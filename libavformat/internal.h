@@ -142,6 +142,13 @@ struct AVFormatInternal {
      * Prefer the codec framerate for avg_frame_rate computation.
      */
     int prefer_codec_framerate;
+
+    /**
+     * Store the index entries of the streams created from now on in a
+     * FFCompactIndex. Only for demuxers which do not access
+     * AVStreamInternal.index_entries directly.
+     */
+    int use_compact_index;
 };
 
 struct AVStreamInternal {
@@ -230,6 +237,14 @@ struct AVStreamInternal {
     int nb_index_entries;
     unsigned int index_entries_allocated_size;
 
+    /**
+     * If use_compact_index is set, the index entries are stored in
+     * compact_index instead of index_entries, nb_index_entries is kept
+     * up to date. Use ff_index_get_entry() to access them.
+     */
+    int use_compact_index;
+    struct FFCompactIndex *compact_index;
+
     int64_t interleaver_chunk_size;
     int64_t interleaver_chunk_duration;
 
@@ -530,6 +545,14 @@ int ff_find_stream_index(AVFormatContext *s, int id);
 int ff_index_search_timestamp(const AVIndexEntry *entries, int nb_entries,
                               int64_t wanted_timestamp, int flags);
 
+/**
+ * Get an index entry of a stream, whatever the index is stored in.
+ * The returned pointer is only valid until the next index operation on st.
+ *
+ * @return the entry or NULL if index is out of range
+ */
+const AVIndexEntry *ff_index_get_entry(AVStream *st, int index);
+
 /**
  * Internal version of av_add_index_entry
  */
@@ -155,6 +155,23 @@ typedef struct MOVIndexRange {
     int64_t end;
 } MOVIndexRange;
 
+/**
+ * Position in the sample tables of the next sample to add to a lazily
+ * built index.
+ */
+typedef struct MOVIndexCursor {
+    unsigned int sample;
+    unsigned int chunk;
+    unsigned int chunk_sample; ///< index of the sample in its chunk
+    unsigned int stsc_index;
+    unsigned int stts_index;
+    unsigned int stts_sample;
+    unsigned int stss_index;
+    unsigned int distance;     ///< distance to the previous keyframe
+    int64_t offset;
+    int64_t dts;
+} MOVIndexCursor;
+
 typedef struct MOVStreamContext {
     AVIOContext *pb;
     int pb_is_copied;
@@ -193,6 +210,11 @@ typedef struct MOVStreamContext {
     int64_t current_index;
     MOVIndexRange* index_ranges;
     MOVIndexRange* current_index_range;
+    int lazy_index;       ///< index entries are built on demand from the sample tables
+    int index_base;       ///< sample number of the first entry of the index
+    int lazy_nb_samples;  ///< number of samples described by the sample tables
+    int64_t lazy_start_dts; ///< dts of the first sample
+    MOVIndexCursor index_cursor;
     unsigned int bytes_per_frame;
     unsigned int samples_per_frame;
     int dv_audio_container;
@@ -267,6 +289,7 @@ typedef struct MOVContext {
     int use_absolute_path;
     int ignore_editlist;
     int advanced_editlist;
+    int lazy_index;         ///< maximum number of index entries per stream, 0 for the full index
     int ignore_chapters;
     int seek_individually;
     int64_t next_root_atom; ///< offset of the next root atom
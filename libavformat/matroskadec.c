@@ -44,6 +44,7 @@
 #include "libavutil/opt.h"
 #include "libavutil/time_internal.h"
 #include "libavutil/spherical.h"
+#include "libavutil/thread.h"
 
 #include "libavcodec/bytestream.h"
 #include "libavcodec/flac.h"
@@ -389,6 +390,10 @@ typedef struct MatroskaDemuxContext {
 
     /* Bandwidth value for WebM DASH Manifest */
     int bandwidth;
+
+    /* Threads splitting clusters into blocks, 0 to parse them sequentially */
+    int cluster_threads;
+    struct MatroskaClusterPool *cluster_pool;
 } MatroskaDemuxContext;
 
 #define CHILD_OF(parent) { .def = { .n = parent } }
@@ -772,6 +777,7 @@ static const CodecMime mkv_mime_tags[] = {
 static const char *const matroska_doctypes[] = { "matroska", "webm" };
 
 static int matroska_read_close(AVFormatContext *s);
+static int matroska_cluster_pool_init(MatroskaDemuxContext *matroska);
 
 /*
  * This function prepares the status for parsing of level 1 elements.
@@ -1002,8 +1008,18 @@ static int ebml_read_ascii(AVIOContext *pb, int size, char **str)
 static int ebml_read_binary(AVIOContext *pb, int length,
                             int64_t pos, EbmlBin *bin)
 {
+    AVBufferRef *ref;
     int ret;
 
+    if (length > 0 && ffio_read_buffer_ref(pb, length, &ref) >= 0) {
+        av_buffer_unref(&bin->buf);
+        bin->buf  = ref;
+        bin->data = ref->data;
+        bin->size = length;
+        bin->pos  = pos;
+        return 0;
+    }
+
     ret = av_buffer_realloc(&bin->buf, length + AV_INPUT_BUFFER_PADDING_SIZE);
     if (ret < 0)
         return ret;
@@ -2988,6 +3004,14 @@ static int matroska_read_header(AVFormatContext *s)
 
     matroska_convert_tags(s);
 
+    if (matroska->cluster_threads) {
+        if (!HAVE_THREADS) {
+            av_log(s, AV_LOG_WARNING, "Cluster threads require threads, disabling them\n");
+        } else if ((res = matroska_cluster_pool_init(matroska)) < 0) {
+            goto fail;
+        }
+    }
+
     return 0;
 fail:
     matroska_read_close(s);
@@ -3747,6 +3771,441 @@ static int matroska_parse_cluster(MatroskaDemuxContext *matroska)
     return res;
 }
 
+/*
+ * Parallel cluster parsing: the reading thread reads whole clusters of known
+ * size into memory, and a pool of cluster_threads worker threads splits them
+ * into blocks. The blocks are handed to matroska_parse_block() on the reading
+ * thread in file order, so that the packets are the same as when parsing
+ * sequentially. Clusters of unknown size, too large ones and clusters that
+ * cannot be read in one go are parsed sequentially.
+ */
+enum MatroskaClusterJobState {
+    CLUSTER_JOB_PENDING,
+    CLUSTER_JOB_RUNNING,
+    CLUSTER_JOB_DONE,
+};
+
+typedef struct MatroskaClusterJob {
+    enum MatroskaClusterJobState state;
+    EbmlBin  bin;               ///< contents of the cluster
+    int64_t  pos;               ///< position of the cluster
+    uint64_t timecode;
+    /* blocks of the cluster, the data of their bins points into bin */
+    MatroskaBlock *blocks;
+    int      nb_blocks;
+    unsigned int blocks_allocated_size;
+    int      next_block;        ///< next block to hand to matroska_parse_block()
+    int      ret;
+} MatroskaClusterJob;
+
+typedef struct MatroskaClusterPool {
+#if HAVE_THREADS
+    pthread_t *threads;
+    pthread_mutex_t lock;
+    pthread_cond_t cond;
+#endif
+    int nb_threads;
+    MatroskaClusterJob *jobs;   ///< ring of clusters read ahead
+    int nb_jobs;
+    int first;                  ///< oldest job
+    int nb_queued;
+    int exit;
+} MatroskaClusterPool;
+
+#if HAVE_THREADS
+/*
+ * Read the header of an element inside a cluster held in memory.
+ * The element must fit before end.
+ */
+static int matroska_read_cluster_element(MatroskaDemuxContext *matroska,
+                                         AVIOContext *pb, int64_t end,
+                                         uint32_t *id, uint64_t *length)
+{
+    int64_t pos = avio_tell(pb);
+    uint64_t num;
+    int res;
+
+    if ((res = ebml_read_num(matroska, pb, 4, &num, 1)) < 0)
+        return res;
+    *id = num | 1 << 7 * res;
+    if ((res = ebml_read_length(matroska, pb, length)) < 0)
+        return res;
+    if (*length > end - avio_tell(pb)) {
+        av_log(matroska->ctx, AV_LOG_ERROR,
+               "Element at 0x%"PRIx64" exceeds its containing master element "
+               "ending at 0x%"PRIx64"\n", pos, end);
+        return AVERROR_INVALIDDATA;
+    }
+    return 0;
+}
+
+static int matroska_split_blockgroup(MatroskaDemuxContext *matroska,
+                                     MatroskaClusterJob *job, AVIOContext *pb,
+                                     int64_t end, MatroskaBlock *block)
+{
+    uint64_t length;
+    uint32_t id;
+    int res;
+
+    while (avio_tell(pb) < end) {
+        int64_t pos;
+
+        if ((res = matroska_read_cluster_element(matroska, pb, end, &id, &length)) < 0)
+            return res;
+        pos = avio_tell(pb);
+
+        switch (id) {
+        case MATROSKA_ID_BLOCK:
+        case MATROSKA_ID_BLOCKADDITIONAL:
+        {
+            EbmlBin *bin = id == MATROSKA_ID_BLOCK ? &block->bin : &block->additional;
+            bin->data = job->bin.data + (pos - job->bin.pos);
+            bin->size = length;
+            bin->pos  = pos;
+            break;
+        }
+        case MATROSKA_ID_BLOCKDURATION:
+        case MATROSKA_ID_BLOCKADDID:
+            if (length > 8)
+                return AVERROR_INVALIDDATA;
+            ebml_read_uint(pb, length, id == MATROSKA_ID_BLOCKDURATION ?
+                                       &block->duration : &block->additional_id);
+            break;
+        case MATROSKA_ID_BLOCKREFERENCE:
+        case MATROSKA_ID_DISCARDPADDING:
+            if (length > 8)
+                return AVERROR_INVALIDDATA;
+            ebml_read_sint(pb, length, id == MATROSKA_ID_BLOCKREFERENCE ?
+                                       &block->reference : &block->discard_padding);
+            break;
+        case MATROSKA_ID_BLOCKADDITIONS:
+            /* only the last BlockMore is kept, like matroska_blockmore does */
+            if ((res = matroska_split_blockgroup(matroska, job, pb,
+                                                 pos + length, block)) < 0)
+                return res;
+            break;
+        case MATROSKA_ID_BLOCKMORE:
+            block->additional_id = 1;
+            if ((res = matroska_split_blockgroup(matroska, job, pb,
+                                                 pos + length, block)) < 0)
+                return res;
+            break;
+        }
+        avio_seek(pb, pos + length, SEEK_SET);
+    }
+    return 0;
+}
+
+/*
+ * Split a cluster into blocks, with the same defaults as the
+ * matroska_cluster_parsing syntax. Run by the worker threads.
+ */
+static int matroska_split_cluster(MatroskaDemuxContext *matroska,
+                                  MatroskaClusterJob *job)
+{
+    int64_t end = job->bin.pos + job->bin.size;
+    AVIOContext pb;
+    uint64_t length;
+    uint32_t id;
+    int res;
+
+    ffio_init_context(&pb, job->bin.data, job->bin.size, 0, NULL, NULL, NULL, NULL);
+    /* make avio_tell() return positions in the file */
+    pb.pos += job->bin.pos;
+
+    while (avio_tell(&pb) < end) {
+        MatroskaBlock *block;
+        int64_t pos;
+
+        if ((res = matroska_read_cluster_element(matroska, &pb, end, &id, &length)) < 0)
+            return res;
+        pos = avio_tell(&pb);
+
+        if (id == MATROSKA_ID_CLUSTERTIMECODE) {
+            if (length > 8)
+                return AVERROR_INVALIDDATA;
+            ebml_read_uint(&pb, length, &job->timecode);
+        } else if (id == MATROSKA_ID_SIMPLEBLOCK || id == MATROSKA_ID_BLOCKGROUP) {
+            block = av_fast_realloc(job->blocks, &job->blocks_allocated_size,
+                                    (job->nb_blocks + 1) * sizeof(*job->blocks));
+            if (!block)
+                return AVERROR(ENOMEM);
+            job->blocks = block;
+            block = &job->blocks[job->nb_blocks];
+            memset(block, 0, sizeof(*block));
+
+            if (id == MATROSKA_ID_SIMPLEBLOCK) {
+                block->bin.data = job->bin.data + (pos - job->bin.pos);
+                block->bin.size = length;
+                block->bin.pos  = pos;
+            } else {
+                block->reference  = INT64_MIN;
+                block->non_simple = 1;
+                if ((res = matroska_split_blockgroup(matroska, job, &pb,
+                                                     pos + length, block)) < 0)
+                    return res;
+            }
+            if (block->bin.size > 0)
+                job->nb_blocks++;
+        }
+        avio_seek(&pb, pos + length, SEEK_SET);
+    }
+    return 0;
+}
+
+static void matroska_cluster_job_clear(MatroskaClusterJob *job)
+{
+    av_buffer_unref(&job->bin.buf);
+    av_freep(&job->blocks);
+    memset(job, 0, sizeof(*job));
+}
+
+static void *cluster_worker(void *arg)
+{
+    MatroskaDemuxContext *matroska = arg;
+    MatroskaClusterPool *p = matroska->cluster_pool;
+
+    pthread_mutex_lock(&p->lock);
+    while (!p->exit) {
+        MatroskaClusterJob *job = NULL;
+        int i, ret;
+
+        for (i = 0; i < p->nb_queued && !job; i++) {
+            job = &p->jobs[(p->first + i) % p->nb_jobs];
+            if (job->state != CLUSTER_JOB_PENDING)
+                job = NULL;
+        }
+        if (!job) {
+            pthread_cond_wait(&p->cond, &p->lock);
+            continue;
+        }
+        job->state = CLUSTER_JOB_RUNNING;
+        pthread_mutex_unlock(&p->lock);
+
+        ret = matroska_split_cluster(matroska, job);
+
+        pthread_mutex_lock(&p->lock);
+        job->ret   = ret;
+        job->state = CLUSTER_JOB_DONE;
+        pthread_cond_broadcast(&p->cond);
+    }
+    pthread_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+static int matroska_cluster_pool_init(MatroskaDemuxContext *matroska)
+{
+    MatroskaClusterPool *p;
+    int i, ret;
+
+    if (!(p = av_mallocz(sizeof(*p))))
+        return AVERROR(ENOMEM);
+    p->nb_jobs = 2 * matroska->cluster_threads;
+    p->jobs    = av_mallocz_array(p->nb_jobs, sizeof(*p->jobs));
+    p->threads = av_mallocz_array(matroska->cluster_threads, sizeof(*p->threads));
+    if (!p->jobs || !p->threads) {
+        av_freep(&p->jobs);
+        av_freep(&p->threads);
+        av_freep(&p);
+        return AVERROR(ENOMEM);
+    }
+    pthread_mutex_init(&p->lock, NULL);
+    pthread_cond_init(&p->cond, NULL);
+    matroska->cluster_pool = p;
+
+    for (i = 0; i < matroska->cluster_threads; i++) {
+        ret = pthread_create(&p->threads[i], NULL, cluster_worker, matroska);
+        if (ret) {
+            av_log(matroska->ctx, AV_LOG_ERROR,
+                   "Failed to create cluster thread: %s\n", av_err2str(AVERROR(ret)));
+            return AVERROR(ret);
+        }
+        p->nb_threads++;
+    }
+    return 0;
+}
+
+/*
+ * Drop the clusters read ahead, after waiting for the workers to be done
+ * with them.
+ */
+static void matroska_cluster_pool_flush(MatroskaDemuxContext *matroska)
+{
+    MatroskaClusterPool *p = matroska->cluster_pool;
+
+    if (!p)
+        return;
+
+    pthread_mutex_lock(&p->lock);
+    while (p->nb_queued) {
+        MatroskaClusterJob *job = &p->jobs[p->first];
+        if (job->state == CLUSTER_JOB_RUNNING) {
+            pthread_cond_wait(&p->cond, &p->lock);
+            continue;
+        }
+        matroska_cluster_job_clear(job);
+        p->first = (p->first + 1) % p->nb_jobs;
+        p->nb_queued--;
+    }
+    pthread_mutex_unlock(&p->lock);
+}
+
+static void matroska_cluster_pool_free(MatroskaDemuxContext *matroska)
+{
+    MatroskaClusterPool *p = matroska->cluster_pool;
+    int i;
+
+    if (!p)
+        return;
+
+    matroska_cluster_pool_flush(matroska);
+    pthread_mutex_lock(&p->lock);
+    p->exit = 1;
+    pthread_cond_broadcast(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+    for (i = 0; i < p->nb_threads; i++)
+        pthread_join(p->threads[i], NULL);
+
+    pthread_cond_destroy(&p->cond);
+    pthread_mutex_destroy(&p->lock);
+    av_freep(&p->threads);
+    av_freep(&p->jobs);
+    av_freep(&matroska->cluster_pool);
+}
+
+/*
+ * Read the cluster whose ID has just been read into a new job.
+ *
+ * @return 0 if it was queued, 1 if it is to be parsed sequentially,
+ *         < 0 on error
+ */
+static int matroska_queue_cluster(MatroskaDemuxContext *matroska)
+{
+    MatroskaClusterPool *p = matroska->cluster_pool;
+    MatroskaCluster *cluster = &matroska->current_cluster;
+    MatroskaLevel *level = &matroska->levels[matroska->num_levels - 1];
+    MatroskaClusterJob *job = &p->jobs[(p->first + p->nb_queued) % p->nb_jobs];
+    AVIOContext *pb = matroska->ctx->pb;
+    uint64_t length;
+    int64_t pos;
+    int res;
+
+    cluster->pos = avio_tell(pb) - 4;
+    if ((res = ffio_ensure_seekback(pb, 8)) < 0)
+        return res;
+    if ((res = ebml_read_length(matroska, pb, &length)) < 0)
+        return res;
+    pos = avio_tell(pb);
+
+    if (length == EBML_UNKNOWN_LENGTH || length > 0x10000000 ||
+        (level->length != EBML_UNKNOWN_LENGTH &&
+         pos + length > level->start + level->length)) {
+        avio_seek(pb, -res, SEEK_CUR);
+        return 1;
+    }
+
+    res = ebml_read_binary(pb, length, pos, &job->bin);
+    if (res) {
+        /* truncated, let the sequential parser take what is left */
+        matroska_cluster_job_clear(job);
+        if (res < 0 && res != AVERROR_EOF)
+            return res;
+        if ((res = avio_seek(pb, cluster->pos + 4, SEEK_SET)) < 0)
+            return res;
+        return 1;
+    }
+    job->pos = cluster->pos;
+    matroska->current_id = 0;
+    matroska->resync_pos = cluster->pos;
+
+    pthread_mutex_lock(&p->lock);
+    job->state = CLUSTER_JOB_PENDING;
+    p->nb_queued++;
+    pthread_cond_signal(&p->cond);
+    pthread_mutex_unlock(&p->lock);
+    return 0;
+}
+
+static int matroska_parse_cluster_threaded(MatroskaDemuxContext *matroska)
+{
+    MatroskaClusterPool *p = matroska->cluster_pool;
+    MatroskaClusterJob *job;
+    int res;
+
+    /* Read ahead, unless a cluster is being parsed sequentially. */
+    while (!matroska->done && matroska->num_levels == 1 &&
+           p->nb_queued < p->nb_jobs) {
+        res = ebml_parse(matroska, matroska_segment, NULL);
+        if (res == 1) {
+            res = matroska_queue_cluster(matroska);
+            if (res == 1)
+                res = ebml_parse(matroska, matroska_cluster_enter,
+                                 &matroska->current_cluster);
+        }
+        if (res < 0)
+            return res;
+    }
+
+    if (!p->nb_queued)
+        return matroska_parse_cluster(matroska);
+
+    job = &p->jobs[p->first];
+    pthread_mutex_lock(&p->lock);
+    while (job->state != CLUSTER_JOB_DONE)
+        pthread_cond_wait(&p->cond, &p->lock);
+    pthread_mutex_unlock(&p->lock);
+
+    /* One block at a time, so that the index is built as when parsing
+     * sequentially. An error skips the rest of the cluster, as resyncing
+     * would, but is not returned, as the next clusters are read already. */
+    if (job->next_block < job->nb_blocks) {
+        MatroskaBlock *block = &job->blocks[job->next_block++];
+        int is_keyframe = block->non_simple ? block->reference == INT64_MIN : -1;
+        uint8_t* additional = block->additional.size > 0 ?
+                                block->additional.data : NULL;
+
+        res = matroska_parse_block(matroska, job->bin.buf, block->bin.data,
+                                   block->bin.size, block->bin.pos,
+                                   job->timecode, block->duration,
+                                   is_keyframe, additional, block->additional_id,
+                                   block->additional.size, job->pos,
+                                   block->discard_padding);
+        if (res < 0)
+            job->next_block = job->nb_blocks;
+        else if (job->next_block < job->nb_blocks)
+            return 0;
+    }
+    if (job->ret < 0)
+        av_log(matroska->ctx, AV_LOG_ERROR, "Skipping the rest of the cluster "
+               "at 0x%"PRIx64"\n", job->pos);
+
+    pthread_mutex_lock(&p->lock);
+    matroska_cluster_job_clear(job);
+    p->first = (p->first + 1) % p->nb_jobs;
+    p->nb_queued--;
+    pthread_mutex_unlock(&p->lock);
+    return 0;
+}
+#else
+static int matroska_cluster_pool_init(MatroskaDemuxContext *matroska)
+{
+    return AVERROR(ENOSYS);
+}
+
+static void matroska_cluster_pool_flush(MatroskaDemuxContext *matroska)
+{
+}
+
+static void matroska_cluster_pool_free(MatroskaDemuxContext *matroska)
+{
+}
+
+static int matroska_parse_cluster_threaded(MatroskaDemuxContext *matroska)
+{
+    return matroska_parse_cluster(matroska);
+}
+#endif
+
 static int matroska_read_packet(AVFormatContext *s, AVPacket *pkt)
 {
     MatroskaDemuxContext *matroska = s->priv_data;
@@ -3758,9 +4217,16 @@ static int matroska_read_packet(AVFormatContext *s, AVPacket *pkt)
     }
 
     while (matroska_deliver_packet(matroska, pkt)) {
-        if (matroska->done)
+        int res;
+
+        if (matroska->done &&
+            !(matroska->cluster_pool && matroska->cluster_pool->nb_queued))
             return (ret < 0) ? ret : AVERROR_EOF;
-        if (matroska_parse_cluster(matroska) < 0 && !matroska->done)
+        if (matroska->cluster_pool)
+            res = matroska_parse_cluster_threaded(matroska);
+        else
+            res = matroska_parse_cluster(matroska);
+        if (res < 0 && !matroska->done)
             ret = matroska_resync(matroska, matroska->resync_pos);
     }
 
@@ -3775,6 +4241,9 @@ static int matroska_read_seek(AVFormatContext *s, int stream_index,
     AVStream *st = s->streams[stream_index];
     int i, index;
 
+    /* The clusters read ahead are from before the seek. */
+    matroska_cluster_pool_flush(matroska);
+
     /* Parse the CUES now since we need the index data to seek. */
     if (matroska->cues_parsing_deferred > 0) {
         matroska->cues_parsing_deferred = 0;
@@ -3837,6 +4306,7 @@ static int matroska_read_close(AVFormatContext *s)
     MatroskaTrack *tracks = matroska->tracks.elem;
     int n;
 
+    matroska_cluster_pool_free(matroska);
     matroska_clear_queue(matroska);
 
     for (n = 0; n < matroska->tracks.nb_elem; n++)
@@ -4253,6 +4723,18 @@ static const AVOption options[] = {
     { NULL },
 };
 
+static const AVOption matroska_options[] = {
+    { "cluster_threads", "Number of threads splitting clusters into blocks, 0 to parse them on the reading thread", OFFSET(cluster_threads), AV_OPT_TYPE_INT, {.i64 = 0}, 0, 64, AV_OPT_FLAG_DECODING_PARAM },
+    { NULL },
+};
+
+static const AVClass matroska_class = {
+    .class_name = "matroska,webm demuxer",
+    .item_name  = av_default_item_name,
+    .option     = matroska_options,
+    .version    = LIBAVUTIL_VERSION_INT,
+};
+
 static const AVClass webm_dash_class = {
     .class_name = "WebM DASH Manifest demuxer",
     .item_name  = av_default_item_name,
@@ -4270,7 +4752,8 @@ AVInputFormat ff_matroska_demuxer = {
     .read_packet    = matroska_read_packet,
     .read_close     = matroska_read_close,
     .read_seek      = matroska_read_seek,
-    .mime_type      = "audio/webm,audio/x-matroska,video/webm,video/x-matroska"
+    .mime_type      = "audio/webm,audio/x-matroska,video/webm,video/x-matroska",
+    .priv_class     = &matroska_class,
 };
 
 AVInputFormat ff_webm_dash_manifest_demuxer = {
@@ -3796,6 +3796,374 @@ static void mov_fix_index(MOVContext *mov, AVStream *st)
     msc->current_index = msc->index_ranges[0].start;
 }
 
+/**
+ * Expand the ctts entries such that we have a 1-1 mapping with samples.
+ */
+static int mov_expand_ctts(MOVStreamContext *sc)
+{
+    MOVStts *ctts_data_old = sc->ctts_data;
+    unsigned int ctts_count_old = sc->ctts_count;
+    unsigned int i, j;
+
+    if (sc->sample_count >= UINT_MAX / sizeof(*sc->ctts_data))
+        return AVERROR(ENOMEM);
+    sc->ctts_count = 0;
+    sc->ctts_allocated_size = 0;
+    sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
+                            sc->sample_count * sizeof(*sc->ctts_data));
+    if (!sc->ctts_data) {
+        av_free(ctts_data_old);
+        return AVERROR(ENOMEM);
+    }
+
+    memset((uint8_t*)(sc->ctts_data), 0, sc->ctts_allocated_size);
+
+    for (i = 0; i < ctts_count_old &&
+                sc->ctts_count < sc->sample_count; i++)
+        for (j = 0; j < ctts_data_old[i].count &&
+                    sc->ctts_count < sc->sample_count; j++)
+            add_ctts_entry(&sc->ctts_data, &sc->ctts_count,
+                           &sc->ctts_allocated_size, 1,
+                           ctts_data_old[i].duration);
+    av_free(ctts_data_old);
+    return 0;
+}
+
+/**
+ * Check whether the index of a stream can be built on demand, i.e. whether
+ * mov_build_index() would add one entry per sample in table order, without
+ * rewriting the timestamps.
+ */
+static int mov_lazy_index_possible(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int key_off = sc->keyframe_count && sc->keyframes[0] > 0;
+    unsigned int i;
+
+    if (!mov->lazy_index || !sc->sample_count || !sc->stts_count || !sc->stsc_count ||
+        st->internal->nb_index_entries || sc->stps_count || sc->rap_group_count ||
+        (st->codecpar->codec_type != AVMEDIA_TYPE_VIDEO &&
+         st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO))
+        return 0;
+    /* uncompressed audio is demuxed by chunks */
+    if (st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+        sc->stts_count == 1 && sc->stts_data[0].duration == 1)
+        return 0;
+    if (!sc->sample_sizes &&
+        (!sc->stsz_sample_size || sc->stsz_sample_size != sc->sample_size))
+        return 0;
+
+    /* a single edit only shifts the timestamps */
+    for (i = 0; i < sc->elst_count; i++) {
+        if (i == 0 && sc->elst_data[i].time == -1)
+            continue;
+        if (i != (sc->elst_data[0].time == -1) || sc->elst_data[i].time < 0)
+            return 0;
+    }
+    for (i = 0; i < sc->stts_count; i++)
+        if (sc->stts_data[i].duration < 0 ||
+            (!sc->stts_data[i].count && i + 1 < sc->stts_count))
+            return 0;
+    if (sc->stsc_data[0].first != 1)
+        return 0;
+    for (i = 0; i < sc->stsc_count; i++)
+        if (!sc->stsc_data[i].count ||
+            (i + 1 < sc->stsc_count && sc->stsc_data[i + 1].first <= sc->stsc_data[i].first) ||
+            (sc->pseudo_stream_id != -1 && sc->stsc_data[i].id - 1 != sc->pseudo_stream_id))
+            return 0;
+    for (i = 0; i < sc->keyframe_count; i++)
+        if (sc->keyframes[i] < key_off || (i && sc->keyframes[i] <= sc->keyframes[i - 1]))
+            return 0;
+
+    return 1;
+}
+
+static int mov_lazy_index_size(MOVContext *mov, MOVStreamContext *sc)
+{
+    return FFMIN(FFMAX(mov->lazy_index, 2), sc->lazy_nb_samples);
+}
+
+/**
+ * Return the index in the stss table of the first keyframe at or after the
+ * given sample.
+ */
+static unsigned int mov_lazy_index_find_keyframe(MOVStreamContext *sc, int sample)
+{
+    int key_off = sc->keyframes[0] > 0;
+    unsigned int lo = 0, hi = sc->keyframe_count;
+
+    while (lo < hi) {
+        unsigned int mid = (lo + hi) >> 1;
+        if (sc->keyframes[mid] - key_off < sample)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+    return lo;
+}
+
+/**
+ * Position the index cursor on the given sample, directly from the run-length
+ * coded sample tables.
+ */
+static void mov_lazy_index_seek(MOVStreamContext *sc, int sample)
+{
+    MOVIndexCursor *cur = &sc->index_cursor;
+    unsigned int i, remaining = sample;
+
+    memset(cur, 0, sizeof(*cur));
+    cur->sample = sample;
+    cur->dts    = sc->lazy_start_dts;
+
+    for (i = 0; i + 1 < sc->stts_count && remaining >= sc->stts_data[i].count; i++) {
+        remaining -= sc->stts_data[i].count;
+        cur->dts  += sc->stts_data[i].count * (int64_t)sc->stts_data[i].duration;
+    }
+    cur->stts_index  = i;
+    cur->stts_sample = remaining;
+    cur->dts        += remaining * (int64_t)sc->stts_data[i].duration;
+
+    remaining = sample;
+    for (i = 0; mov_stsc_index_valid(i, sc->stsc_count); i++) {
+        int64_t samples = mov_get_stsc_samples(sc, i);
+        if (remaining < samples)
+            break;
+        remaining -= samples;
+    }
+    cur->stsc_index   = i;
+    cur->chunk        = sc->stsc_data[i].first - 1 + remaining / sc->stsc_data[i].count;
+    cur->chunk_sample = remaining % sc->stsc_data[i].count;
+    if (cur->chunk < sc->chunk_count) {
+        cur->offset = sc->chunk_offsets[cur->chunk];
+        for (i = sample - cur->chunk_sample; i < sample; i++)
+            cur->offset += sc->sample_sizes ? sc->sample_sizes[i] : sc->stsz_sample_size;
+    }
+
+    cur->distance = sample;
+    if (sc->keyframe_count && !sc->keyframe_absent) {
+        cur->stss_index = mov_lazy_index_find_keyframe(sc, sample);
+        if (cur->stss_index)
+            cur->distance = sample - (sc->keyframes[cur->stss_index - 1] - (sc->keyframes[0] > 0));
+    }
+}
+
+/**
+ * Replace the index entries of a lazily indexed stream with the entries of
+ * at most size samples, starting at the given sample.
+ */
+static void mov_lazy_index_fill(MOVContext *mov, AVStream *st, int sample, int size)
+{
+    MOVStreamContext *sc = st->priv_data;
+    MOVIndexCursor *cur = &sc->index_cursor;
+    AVIndexEntry *entries = st->internal->index_entries;
+    int nb = st->internal->nb_index_entries;
+    int key_off = sc->keyframe_count && sc->keyframes[0] > 0;
+
+    if (nb && sample == sc->index_base + nb - 1 && cur->sample == sample + 1) {
+        /* sequential read, continue from the last entry */
+        entries[0] = entries[nb - 1];
+        nb = 1;
+    } else {
+        mov_lazy_index_seek(sc, sample);
+        nb = 0;
+    }
+    sc->index_base = sample;
+
+    while (nb < size && cur->sample < sc->lazy_nb_samples) {
+        unsigned int sample_size = sc->sample_sizes ? sc->sample_sizes[cur->sample] : sc->stsz_sample_size;
+        int keyframe = 0;
+        AVIndexEntry *e;
+
+        if (sc->keyframe_absent) {
+            keyframe = st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO || !cur->sample;
+        } else if (!sc->keyframe_count) {
+            keyframe = 1;
+        } else if (cur->stss_index < sc->keyframe_count &&
+                   cur->sample + key_off == sc->keyframes[cur->stss_index]) {
+            keyframe = 1;
+            cur->stss_index++;
+        }
+        if (keyframe)
+            cur->distance = 0;
+        if (sample_size > 0x3FFFFFFF) {
+            av_log(mov->fc, AV_LOG_ERROR, "Sample size %u is too large\n", sample_size);
+            sc->lazy_nb_samples = cur->sample;
+            break;
+        }
+        e = &entries[nb++];
+        e->pos = cur->offset;
+        e->timestamp = cur->dts;
+        e->size = sample_size;
+        e->min_distance = cur->distance;
+        e->flags = keyframe ? AVINDEX_KEYFRAME : 0;
+
+        cur->offset += sample_size;
+        cur->dts    += sc->stts_data[cur->stts_index].duration;
+        cur->distance++;
+        cur->sample++;
+        if (++cur->stts_sample == sc->stts_data[cur->stts_index].count &&
+            cur->stts_index + 1 < sc->stts_count) {
+            cur->stts_index++;
+            cur->stts_sample = 0;
+        }
+        if (++cur->chunk_sample == sc->stsc_data[cur->stsc_index].count) {
+            cur->chunk++;
+            cur->chunk_sample = 0;
+            if (mov_stsc_index_valid(cur->stsc_index, sc->stsc_count) &&
+                cur->chunk + 1 == sc->stsc_data[cur->stsc_index + 1].first)
+                cur->stsc_index++;
+            if (cur->chunk < sc->chunk_count)
+                cur->offset = sc->chunk_offsets[cur->chunk];
+        }
+    }
+    st->internal->nb_index_entries = nb;
+}
+
+/**
+ * Set up the on demand index of a stream. The sample tables are kept, and
+ * index entries are generated for a window of samples around the current
+ * position.
+ */
+static int mov_lazy_index_init(MOVContext *mov, AVStream *st, int64_t start_dts)
+{
+    MOVStreamContext *sc = st->priv_data;
+    uint64_t samples = 0;
+    int64_t stream_size;
+    int i, size, ret;
+
+    for (i = 0; i < sc->stsc_count; i++)
+        samples += mov_get_stsc_samples(sc, i);
+    if (samples > sc->sample_count)
+        av_log(mov->fc, AV_LOG_ERROR, "wrong sample count\n");
+    sc->lazy_nb_samples = FFMIN3(samples, sc->sample_count, INT_MAX);
+    sc->lazy_start_dts  = start_dts;
+    sc->lazy_index      = 1;
+    if (!sc->lazy_nb_samples)
+        return 0;
+
+    size = mov_lazy_index_size(mov, sc);
+    if ((ret = av_reallocp_array(&st->internal->index_entries, size,
+                                 sizeof(*st->internal->index_entries))) < 0) {
+        st->internal->nb_index_entries = 0;
+        sc->lazy_nb_samples = 0;
+        return ret;
+    }
+    st->internal->index_entries_allocated_size = size * sizeof(*st->internal->index_entries);
+    mov_lazy_index_fill(mov, st, 0, size);
+
+    if (st->codecpar->codec_type == AVMEDIA_TYPE_VIDEO)
+        for (i = 0; i < FFMIN(st->internal->nb_index_entries, 99); i++)
+            ff_rfps_add_frame(mov->fc, st, st->internal->index_entries[i].timestamp);
+
+    stream_size = sc->sample_sizes ? sc->data_size :
+                  sc->stsz_sample_size * (int64_t)sc->lazy_nb_samples;
+    if (st->duration > 0)
+        st->codecpar->bit_rate = stream_size*8*sc->time_scale/st->duration;
+
+    return 0;
+}
+
+/**
+ * Make sure the index of a lazily indexed stream contains the current sample
+ * and the one after it.
+ */
+static void mov_lazy_index_update(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int end = sc->index_base + st->internal->nb_index_entries;
+
+    if (sc->current_sample < 0 || sc->current_sample >= sc->lazy_nb_samples)
+        return;
+    if (sc->current_sample >= sc->index_base &&
+        (sc->current_sample + 1 < end || end == sc->lazy_nb_samples))
+        return;
+    mov_lazy_index_fill(mov, st, sc->current_sample, mov_lazy_index_size(mov, sc));
+}
+
+/**
+ * Lazy index counterpart of av_index_search_timestamp().
+ */
+static int mov_lazy_index_search(AVStream *st, int64_t timestamp, int flags)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int64_t dts = sc->lazy_start_dts, last_dts = AV_NOPTS_VALUE;
+    int sample, n = 0;
+    unsigned int i, k;
+
+    /* count the samples with a dts not after timestamp */
+    for (i = 0; i < sc->stts_count && n < sc->lazy_nb_samples && timestamp >= dts; i++) {
+        int64_t duration = sc->stts_data[i].duration;
+        unsigned int count = sc->lazy_nb_samples - n;
+
+        if (i + 1 < sc->stts_count)
+            count = FFMIN(count, sc->stts_data[i].count);
+        k = duration ? FFMIN((timestamp - dts) / duration + 1, count) : count;
+        n += k;
+        last_dts = dts + (k - 1) * duration;
+        if (k < count)
+            break;
+        dts += count * duration;
+    }
+
+    if ((flags & AVSEEK_FLAG_BACKWARD) || (n && last_dts == timestamp))
+        sample = n - 1;
+    else
+        sample = n < sc->lazy_nb_samples ? n : -1;
+    if (sample < 0 || (flags & AVSEEK_FLAG_ANY))
+        return sample;
+
+    if (sc->keyframe_absent) {
+        if (st->codecpar->codec_type != AVMEDIA_TYPE_AUDIO)
+            sample = (flags & AVSEEK_FLAG_BACKWARD) || !sample ? 0 : -1;
+    } else if (sc->keyframe_count) {
+        int key_off = sc->keyframes[0] > 0;
+
+        k = mov_lazy_index_find_keyframe(sc, sample);
+        if (flags & AVSEEK_FLAG_BACKWARD) {
+            if (k == sc->keyframe_count || sc->keyframes[k] - key_off != sample)
+                sample = k ? sc->keyframes[k - 1] - key_off : -1;
+        } else {
+            sample = k < sc->keyframe_count && sc->keyframes[k] - key_off < sc->lazy_nb_samples ?
+                     sc->keyframes[k] - key_off : -1;
+        }
+    }
+    return sample;
+}
+
+/**
+ * Replace the on demand index of a stream with the full index, for the code
+ * paths that need all the entries, like adding samples from fragments.
+ */
+static int mov_lazy_index_disable(MOVContext *mov, AVStream *st)
+{
+    MOVStreamContext *sc = st->priv_data;
+    int ret;
+
+    if (sc->lazy_nb_samples) {
+        if ((ret = av_reallocp_array(&st->internal->index_entries, sc->lazy_nb_samples,
+                                     sizeof(*st->internal->index_entries))) < 0) {
+            st->internal->nb_index_entries = 0;
+            return ret;
+        }
+        st->internal->index_entries_allocated_size = sc->lazy_nb_samples * sizeof(*st->internal->index_entries);
+        mov_lazy_index_fill(mov, st, 0, sc->lazy_nb_samples);
+    }
+    if (sc->ctts_data) {
+        if ((ret = mov_expand_ctts(sc)) < 0)
+            return ret;
+        sc->ctts_index  = sc->current_sample;
+        sc->ctts_sample = 0;
+    }
+
+    sc->lazy_index = 0;
+    av_freep(&sc->chunk_offsets);
+    av_freep(&sc->sample_sizes);
+    av_freep(&sc->keyframes);
+    av_freep(&sc->stts_data);
+
+    return 0;
+}
+
 static void mov_build_index(MOVContext *mov, AVStream *st)
 {
     MOVStreamContext *sc = st->priv_data;
@@ -3807,8 +4175,8 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
     unsigned int stps_index = 0;
     unsigned int i, j;
     uint64_t stream_size = 0;
-    MOVStts *ctts_data_old = sc->ctts_data;
-    unsigned int ctts_count_old = sc->ctts_count;
+    int lazy = mov_lazy_index_possible(mov, st);
+    int advanced_editlist = mov->advanced_editlist && !lazy;
 
     if (sc->elst_count) {
         int i, edit_start_index = 0, multiple_edits = 0;
@@ -3829,7 +4197,7 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
             }
         }
 
-        if (multiple_edits && !mov->advanced_editlist)
+        if (multiple_edits && !advanced_editlist)
             av_log(mov->fc, AV_LOG_WARNING, "multiple edit list entries, "
                    "Use -advanced_editlist to correctly decode otherwise "
                    "a/v desync might occur\n");
@@ -3840,17 +4208,19 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
                 empty_duration = av_rescale(empty_duration, sc->time_scale, mov->time_scale);
             sc->time_offset = start_time - empty_duration;
             sc->min_corrected_pts = start_time;
-            if (!mov->advanced_editlist)
+            if (!advanced_editlist)
                 current_dts = -sc->time_offset;
         }
 
-        if (!multiple_edits && !mov->advanced_editlist &&
+        if (!multiple_edits && !advanced_editlist &&
             st->codecpar->codec_id == AV_CODEC_ID_AAC && start_time > 0)
             sc->start_pad = start_time;
     }
 
+    if (lazy) {
+        mov_lazy_index_init(mov, st, current_dts - sc->dts_shift);
     /* only use old uncompressed audio chunk demuxing when stts specifies it */
-    if (!(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
+    } else if (!(st->codecpar->codec_type == AVMEDIA_TYPE_AUDIO &&
           sc->stts_count == 1 && sc->stts_data[0].duration == 1)) {
         unsigned int current_sample = 0;
         unsigned int stts_sample = 0;
@@ -3878,30 +4248,8 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
         }
         st->internal->index_entries_allocated_size = (st->internal->nb_index_entries + sc->sample_count) * sizeof(*st->internal->index_entries);
 
-        if (ctts_data_old) {
-            // Expand ctts entries such that we have a 1-1 mapping with samples
-            if (sc->sample_count >= UINT_MAX / sizeof(*sc->ctts_data))
-                return;
-            sc->ctts_count = 0;
-            sc->ctts_allocated_size = 0;
-            sc->ctts_data = av_fast_realloc(NULL, &sc->ctts_allocated_size,
-                                    sc->sample_count * sizeof(*sc->ctts_data));
-            if (!sc->ctts_data) {
-                av_free(ctts_data_old);
-                return;
-            }
-
-            memset((uint8_t*)(sc->ctts_data), 0, sc->ctts_allocated_size);
-
-            for (i = 0; i < ctts_count_old &&
-                        sc->ctts_count < sc->sample_count; i++)
-                for (j = 0; j < ctts_data_old[i].count &&
-                            sc->ctts_count < sc->sample_count; j++)
-                    add_ctts_entry(&sc->ctts_data, &sc->ctts_count,
-                                   &sc->ctts_allocated_size, 1,
-                                   ctts_data_old[i].duration);
-            av_free(ctts_data_old);
-        }
+        if (sc->ctts_data && mov_expand_ctts(sc) < 0)
+            return;
 
         for (i = 0; i < sc->chunk_count; i++) {
             int64_t next_offset = i+1 < sc->chunk_count ? sc->chunk_offsets[i+1] : INT64_MAX;
@@ -4108,7 +4456,7 @@ static void mov_build_index(MOVContext *mov, AVStream *st)
         }
     }
 
-    if (!mov->ignore_editlist && mov->advanced_editlist) {
+    if (!mov->ignore_editlist && advanced_editlist) {
         // Fix index according to edit lists.
         mov_fix_index(mov, st);
     }
@@ -4352,11 +4700,13 @@ static int mov_read_trak(MOVContext *c, AVIOContext *pb, MOVAtom atom)
         && sc->time_scale == st->codecpar->sample_rate) {
             st->need_parsing = AVSTREAM_PARSE_FULL;
     }
-    /* Do not need those anymore. */
-    av_freep(&sc->chunk_offsets);
-    av_freep(&sc->sample_sizes);
-    av_freep(&sc->keyframes);
-    av_freep(&sc->stts_data);
+    /* Do not need those anymore, unless the index is built on demand. */
+    if (!sc->lazy_index) {
+        av_freep(&sc->chunk_offsets);
+        av_freep(&sc->sample_sizes);
+        av_freep(&sc->keyframes);
+        av_freep(&sc->stts_data);
+    }
     av_freep(&sc->stps_data);
     av_freep(&sc->elst_data);
     av_freep(&sc->rap_group);
@@ -4780,7 +5130,7 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     int64_t dts, pts = AV_NOPTS_VALUE;
     int data_offset = 0;
     unsigned entries, first_sample_flags = frag->flags;
-    int flags, distance, i;
+    int flags, distance, i, ret;
     int64_t prev_dts = AV_NOPTS_VALUE;
     int next_frag_index = -1, index_entry_pos;
     size_t requested_size;
@@ -4806,6 +5156,8 @@ static int mov_read_trun(MOVContext *c, AVIOContext *pb, MOVAtom atom)
     sc = st->priv_data;
     if (sc->pseudo_stream_id+1 != frag->stsd_id && sc->pseudo_stream_id != -1)
         return 0;
+    if (sc->lazy_index && (ret = mov_lazy_index_disable(c, st)) < 0)
+        return ret;
 
     // Find the next frag_index index that has a valid index_entry for
     // the current track_id.
@@ -7798,8 +8150,11 @@ static AVIndexEntry *mov_find_next_sample(AVFormatContext *s, AVStream **st)
     for (i = 0; i < s->nb_streams; i++) {
         AVStream *avst = s->streams[i];
         MOVStreamContext *msc = avst->priv_data;
-        if (msc->pb && msc->current_sample < avst->internal->nb_index_entries) {
-            AVIndexEntry *current_sample = &avst->internal->index_entries[msc->current_sample];
+        if (msc->lazy_index)
+            mov_lazy_index_update(s->priv_data, avst);
+        if (msc->pb && msc->current_sample >= msc->index_base &&
+            msc->current_sample - msc->index_base < avst->internal->nb_index_entries) {
+            AVIndexEntry *current_sample = &avst->internal->index_entries[msc->current_sample - msc->index_base];
             int64_t dts = av_rescale(current_sample->timestamp, AV_TIME_BASE, msc->time_scale);
             av_log(s, AV_LOG_TRACE, "stream %d, sample %d, dts %"PRId64"\n", i, msc->current_sample, dts);
             if (!sample || (!(s->pb->seekable & AVIO_SEEKABLE_NORMAL) && current_sample->pos < sample->pos) ||
@@ -8002,8 +8357,8 @@ static int mov_read_packet(AVFormatContext *s, AVPacket *pkt)
             sc->ctts_sample = 0;
         }
     } else {
-        int64_t next_dts = (sc->current_sample < st->internal->nb_index_entries) ?
-            st->internal->index_entries[sc->current_sample].timestamp : st->duration;
+        int64_t next_dts = (sc->current_sample - sc->index_base < st->internal->nb_index_entries) ?
+            st->internal->index_entries[sc->current_sample - sc->index_base].timestamp : st->duration;
 
         if (next_dts >= pkt->dts)
             pkt->duration = next_dts - pkt->dts;
@@ -8082,13 +8437,22 @@ static int mov_seek_stream(AVFormatContext *s, AVStream *st, int64_t timestamp,
     if (ret < 0)
         return ret;
 
-    sample = av_index_search_timestamp(st, timestamp, flags);
-    av_log(s, AV_LOG_TRACE, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
-    if (sample < 0 && st->internal->nb_index_entries && timestamp < st->internal->index_entries[0].timestamp)
-        sample = 0;
+    if (sc->lazy_index) {
+        sample = mov_lazy_index_search(st, timestamp, flags);
+        av_log(s, AV_LOG_TRACE, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
+        if (sample < 0 && sc->lazy_nb_samples && timestamp < sc->lazy_start_dts)
+            sample = 0;
+    } else {
+        sample = av_index_search_timestamp(st, timestamp, flags);
+        av_log(s, AV_LOG_TRACE, "stream %d, timestamp %"PRId64", sample %d\n", st->index, timestamp, sample);
+        if (sample < 0 && st->internal->nb_index_entries && timestamp < st->internal->index_entries[0].timestamp)
+            sample = 0;
+    }
     if (sample < 0) /* not sure what to do */
         return AVERROR_INVALIDDATA;
     mov_current_sample_set(sc, sample);
+    if (sc->lazy_index)
+        mov_lazy_index_fill(s->priv_data, st, sample, mov_lazy_index_size(s->priv_data, sc));
     av_log(s, AV_LOG_TRACE, "stream %d, found sample %d\n", st->index, sc->current_sample);
     /* adjust ctts index */
     if (sc->ctts_data) {
@@ -8139,7 +8503,8 @@ static int mov_read_seek(AVFormatContext *s, int stream_index, int64_t sample_ti
 
     if (mc->seek_individually) {
         /* adjust seek timestamp to found sample timestamp */
-        int64_t seek_timestamp = st->internal->index_entries[sample].timestamp;
+        MOVStreamContext *msc = st->priv_data;
+        int64_t seek_timestamp = st->internal->index_entries[sample - msc->index_base].timestamp;
 
         for (i = 0; i < s->nb_streams; i++) {
             int64_t timestamp;
@@ -8191,6 +8556,10 @@ static const AVOption mov_options[] = {
         "Modify the AVIndex according to the editlists. Use this option to decode in the order specified by the edits.",
         OFFSET(advanced_editlist), AV_OPT_TYPE_BOOL, {.i64 = 1},
         0, 1, FLAGS},
+    {"lazy_index",
+        "Build the index on demand, keeping at most this many entries per stream (0 builds the full index at open)",
+        OFFSET(lazy_index), AV_OPT_TYPE_INT, {.i64 = 0},
+        0, INT_MAX, FLAGS},
     {"ignore_chapters", "", OFFSET(ignore_chapters), AV_OPT_TYPE_BOOL, {.i64 = 0},
         0, 1, FLAGS},
     {"use_mfra_for",
@@ -107,6 +107,8 @@ static const AVOption options[] = {
     { "wallclock", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = MOV_PRFT_SRC_WALLCLOCK}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "prft"},
     { "pts", NULL, 0, AV_OPT_TYPE_CONST, {.i64 = MOV_PRFT_SRC_PTS}, 0, 0, AV_OPT_FLAG_ENCODING_PARAM, "prft"},
     { "empty_hdlr_name", "write zero-length name string in hdlr atoms within mdia and minf atoms", offsetof(MOVMuxContext, empty_hdlr_name), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1, AV_OPT_FLAG_ENCODING_PARAM},
+    { "frag_stream", "Write the samples of fragments as they arrive, reserving this many bytes for the moof in front of them (seekable output only, 0 buffers whole fragments)", offsetof(MOVMuxContext, frag_stream), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
+    { "frag_write_queue", "Write completed fragments progressively while muxing the next one, keeping at most this many bytes queued (0 writes fragments at once)", offsetof(MOVMuxContext, frag_write_queue), AV_OPT_TYPE_INT, {.i64 = 0}, 0, INT_MAX, AV_OPT_FLAG_ENCODING_PARAM},
     { NULL },
 };
 
@@ -4560,7 +4562,7 @@ static int mov_add_tfra_entries(AVIOContext *pb, MOVMuxContext *mov, int tracks,
             track->frag_info_capacity = new_capacity;
         }
         info = &track->frag_info[track->nb_frag_info - 1];
-        info->offset   = avio_tell(pb);
+        info->offset   = avio_tell(pb) + mov->frag_pos_offset;
         info->size     = size;
         // Try to recreate the original pts for the first packet
         // from the fields we have stored
@@ -4651,6 +4653,7 @@ static int mov_write_moof_tag_internal(AVIOContext *pb, MOVMuxContext *mov,
                                        int tracks, int moof_size)
 {
     int64_t pos = avio_tell(pb);
+    int64_t moof_offset = pos + mov->frag_pos_offset;
     int i;
 
     avio_wb32(pb, 0); /* size placeholder */
@@ -4664,7 +4667,7 @@ static int mov_write_moof_tag_internal(AVIOContext *pb, MOVMuxContext *mov,
             continue;
         if (!track->entry)
             continue;
-        mov_write_traf_tag(pb, mov, track, pos, moof_size);
+        mov_write_traf_tag(pb, mov, track, moof_offset, moof_size);
     }
 
     return update_size(pb, pos);
@@ -5230,6 +5233,162 @@ static void mov_parse_truehd_frame(AVPacket *pkt, MOVTrack *trk)
     return;
 }
 
+/* upper bounds of the moof size added by a sample of a streamed fragment */
+#define MOV_FRAG_STREAM_TRAF_SIZE   68 /* traf, tfhd and tfdt */
+#define MOV_FRAG_STREAM_TRUN_SIZE   24
+#define MOV_FRAG_STREAM_SAMPLE_SIZE 16
+#define MOV_FRAG_STREAM_MAX_SAMPLE_SIZE (MOV_FRAG_STREAM_TRAF_SIZE + \
+                                         MOV_FRAG_STREAM_TRUN_SIZE + \
+                                         MOV_FRAG_STREAM_SAMPLE_SIZE)
+
+typedef struct MOVQueuedBuffer {
+    uint8_t *data;
+    int size;
+    int pos;                    ///< bytes already written
+    int64_t marker_time;
+    int marker_type;            ///< data marker written before the buffer, -1 if none
+    int flush_point;            ///< end of a fragment
+} MOVQueuedBuffer;
+
+/**
+ * Write up to max_size bytes of the queued fragments.
+ */
+static void mov_write_queued(AVFormatContext *s, int64_t max_size)
+{
+    MOVMuxContext *mov = s->priv_data;
+
+    while (mov->nb_queued && max_size > 0) {
+        MOVQueuedBuffer *q = &mov->queue[0];
+        int size = FFMIN(q->size - q->pos, max_size);
+
+        if (!q->pos && q->marker_type >= 0)
+            avio_write_marker(s->pb, q->marker_time, q->marker_type);
+        avio_write(s->pb, q->data + q->pos, size);
+        q->pos           += size;
+        max_size         -= size;
+        mov->queued_size -= size;
+        if (q->pos < q->size)
+            break;
+
+        if (q->flush_point)
+            avio_write_marker(s->pb, AV_NOPTS_VALUE, AVIO_DATA_MARKER_FLUSH_POINT);
+        av_free(q->data);
+        memmove(q, q + 1, --mov->nb_queued * sizeof(*q));
+    }
+}
+
+/**
+ * Queue a buffer of a completed fragment, taking ownership of it, and
+ * write out what exceeds the queue size.
+ */
+static int mov_queue_buffer(AVFormatContext *s, uint8_t *data, int size,
+                            int flush_point)
+{
+    MOVMuxContext *mov = s->priv_data;
+    MOVQueuedBuffer *queue, *q;
+
+    queue = av_fast_realloc(mov->queue, &mov->queue_allocated_size,
+                            (mov->nb_queued + 1) * sizeof(*queue));
+    if (!queue) {
+        av_free(data);
+        return AVERROR(ENOMEM);
+    }
+    mov->queue = queue;
+
+    q = &queue[mov->nb_queued++];
+    q->data        = data;
+    q->size        = size;
+    q->pos         = 0;
+    q->marker_time = mov->queue_marker_time;
+    q->marker_type = mov->queue_marker_type;
+    q->flush_point = flush_point;
+    mov->queue_marker_type = -1;
+    mov->queued_size      += size;
+
+    if (mov->queued_size > mov->frag_write_queue)
+        mov_write_queued(s, mov->queued_size - mov->frag_write_queue);
+    return 0;
+}
+
+/**
+ * Start writing the samples of a fragment directly to the output if
+ * possible, after space reserved for its moof.
+ *
+ * @return 1 if the samples of the current fragment are streamed
+ */
+static int mov_frag_stream_begin(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    int i;
+
+    if (mov->frag_stream_pos >= 0)
+        return 1;
+    if (!mov->frag_stream || !mov->moov_written)
+        return 0;
+    /* samples of this fragment are already buffered */
+    for (i = 0; i < mov->nb_streams; i++)
+        if (mov->tracks[i].entry || mov->tracks[i].mdat_buf)
+            return 0;
+
+    mov->frag_stream_pos       = avio_tell(s->pb);
+    mov->frag_stream_moof_size = 16 + 8; /* moof and mfhd */
+    avio_wb32(s->pb, mov->frag_stream);
+    ffio_wfourcc(s->pb, "free");
+    ffio_fill(s->pb, 0, mov->frag_stream - 8);
+    avio_wb32(s->pb, 0); /* size placeholder */
+    ffio_wfourcc(s->pb, "mdat");
+    return 1;
+}
+
+/**
+ * Write the moof of a streamed fragment in the space reserved for it,
+ * followed by a free atom covering the rest of that space.
+ */
+static int mov_flush_fragment_stream(AVFormatContext *s)
+{
+    MOVMuxContext *mov = s->priv_data;
+    AVIOContext *pb = s->pb, *null_buf;
+    int64_t end       = avio_tell(pb);
+    int64_t mdat_pos  = mov->frag_stream_pos + mov->frag_stream;
+    int64_t mdat_size = end - mdat_pos - 8;
+    int i, ret, moof_size, free_size;
+
+    if ((ret = ffio_open_null_buf(&null_buf)) < 0)
+        return ret;
+    mov_write_moof_tag_internal(null_buf, mov, -1, 0);
+    moof_size = ffio_close_null_buf(null_buf);
+    free_size = mov->frag_stream - moof_size;
+    av_assert0(free_size >= 8);
+
+    for (i = 0; i < mov->nb_streams; i++)
+        mov->tracks[i].data_offset = free_size;
+
+    avio_seek(pb, mov->frag_stream_pos, SEEK_SET);
+    if ((ret = mov_write_moof_tag(pb, mov, -1, free_size + mdat_size)) < 0)
+        return ret;
+    mov->fragments++;
+    avio_wb32(pb, free_size);
+    ffio_wfourcc(pb, "free");
+    avio_seek(pb, mdat_pos, SEEK_SET);
+    avio_wb32(pb, mdat_size + 8);
+    avio_seek(pb, end, SEEK_SET);
+
+    for (i = 0; i < mov->nb_streams; i++) {
+        MOVTrack *track = &mov->tracks[i];
+        if (track->entry)
+            track->frag_start += track->start_dts + track->track_duration -
+                                 track->cluster[0].dts;
+        track->entry = 0;
+        track->entries_flushed = 0;
+        track->end_reliable = 0;
+    }
+    mov->mdat_size       = 0;
+    mov->frag_stream_pos = -1;
+
+    avio_write_marker(pb, AV_NOPTS_VALUE, AVIO_DATA_MARKER_FLUSH_POINT);
+    return 0;
+}
+
 static int mov_flush_fragment_interleaving(AVFormatContext *s, MOVTrack *track)
 {
     MOVMuxContext *mov = s->priv_data;
@@ -5260,7 +5419,8 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
     MOVMuxContext *mov = s->priv_data;
     int i, first_track = -1;
     int64_t mdat_size = 0;
-    int ret;
+    int ret, marker_type;
+    int64_t marker_time;
     int has_video = 0, starts_with_key = 0, first_video_track = 1;
 
     if (!(mov->flags & FF_MOV_FLAG_FRAGMENT))
@@ -5367,6 +5527,9 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
         return 0;
     }
 
+    if (mov->frag_stream_pos >= 0)
+        return mov_flush_fragment_stream(s);
+
     if (mov->frag_interleave) {
         for (i = 0; i < mov->nb_streams; i++) {
             MOVTrack *track = &mov->tracks[i];
@@ -5405,9 +5568,14 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
     if (!mdat_size)
         return 0;
 
-    avio_write_marker(s->pb,
-                      av_rescale(mov->tracks[first_track].cluster[0].dts, AV_TIME_BASE, mov->tracks[first_track].timescale),
-                      (has_video ? starts_with_key : mov->tracks[first_track].cluster[0].flags & MOV_SYNC_SAMPLE) ? AVIO_DATA_MARKER_SYNC_POINT : AVIO_DATA_MARKER_BOUNDARY_POINT);
+    marker_time = av_rescale(mov->tracks[first_track].cluster[0].dts, AV_TIME_BASE, mov->tracks[first_track].timescale);
+    marker_type = (has_video ? starts_with_key : mov->tracks[first_track].cluster[0].flags & MOV_SYNC_SAMPLE) ? AVIO_DATA_MARKER_SYNC_POINT : AVIO_DATA_MARKER_BOUNDARY_POINT;
+    if (mov->frag_write_queue) {
+        mov->queue_marker_time = marker_time;
+        mov->queue_marker_type = marker_type;
+    } else {
+        avio_write_marker(s->pb, marker_time, marker_type);
+    }
 
     for (i = 0; i < mov->nb_streams; i++) {
         MOVTrack *track = &mov->tracks[i];
@@ -5428,13 +5596,29 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
         }
 
         if (write_moof) {
-            avio_write_marker(s->pb, AV_NOPTS_VALUE, AVIO_DATA_MARKER_FLUSH_POINT);
+            AVIOContext *pb = s->pb;
+
+            if (mov->frag_write_queue) {
+                if ((ret = avio_open_dyn_buf(&pb)) < 0)
+                    return ret;
+                /* the queued data precedes this buffer in the output */
+                mov->frag_pos_offset = avio_tell(s->pb) + mov->queued_size;
+            }
 
-            mov_write_moof_tag(s->pb, mov, moof_tracks, mdat_size);
+            avio_write_marker(pb, AV_NOPTS_VALUE, AVIO_DATA_MARKER_FLUSH_POINT);
+
+            mov_write_moof_tag(pb, mov, moof_tracks, mdat_size);
             mov->fragments++;
 
-            avio_wb32(s->pb, mdat_size + 8);
-            ffio_wfourcc(s->pb, "mdat");
+            avio_wb32(pb, mdat_size + 8);
+            ffio_wfourcc(pb, "mdat");
+
+            if (pb != s->pb) {
+                mov->frag_pos_offset = 0;
+                buf_size = avio_close_dyn_buf(pb, &buf);
+                if ((ret = mov_queue_buffer(s, buf, buf_size, 0)) < 0)
+                    return ret;
+            }
         }
 
         if (track->entry)
@@ -5454,12 +5638,19 @@ static int mov_flush_fragment(AVFormatContext *s, int force)
             mov->mdat_buf = NULL;
         }
 
-        avio_write(s->pb, buf, buf_size);
-        av_free(buf);
+        if (mov->frag_write_queue) {
+            if ((ret = mov_queue_buffer(s, buf, buf_size, 0)) < 0)
+                return ret;
+        } else {
+            avio_write(s->pb, buf, buf_size);
+            av_free(buf);
+        }
     }
 
     mov->mdat_size = 0;
 
+    if (mov->frag_write_queue)
+        return mov_queue_buffer(s, NULL, 0, 1);
     avio_write_marker(s->pb, AV_NOPTS_VALUE, AVIO_DATA_MARKER_FLUSH_POINT);
     return 0;
 }
@@ -5534,7 +5725,9 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
 
     if (mov->flags & FF_MOV_FLAG_FRAGMENT) {
         int ret;
-        if (mov->moov_written || mov->flags & FF_MOV_FLAG_EMPTY_MOOV) {
+        if (mov_frag_stream_begin(s)) {
+            pb = s->pb;
+        } else if (mov->moov_written || mov->flags & FF_MOV_FLAG_EMPTY_MOOV) {
             if (mov->frag_interleave && mov->fragments > 0) {
                 if (trk->entry - trk->entries_flushed >= mov->frag_interleave) {
                     if ((ret = mov_flush_fragment_interleaving(s, trk)) < 0)
@@ -5725,6 +5918,17 @@ int ff_mov_write_packet(AVFormatContext *s, AVPacket *pkt)
     trk->cluster[trk->entry].entries          = samples_in_chunk;
     trk->cluster[trk->entry].dts              = pkt->dts;
     trk->cluster[trk->entry].pts              = pkt->pts;
+    if (mov->frag_stream_pos >= 0) {
+        /* make the position relative to the mdat payload, as in mdat_buf */
+        MOVIentry *e = &trk->cluster[trk->entry];
+        e->pos -= mov->frag_stream_pos + mov->frag_stream + 8;
+        if (!trk->entry)
+            mov->frag_stream_moof_size += MOV_FRAG_STREAM_TRAF_SIZE +
+                                          MOV_FRAG_STREAM_TRUN_SIZE;
+        else if (e[-1].pos + e[-1].size != e->pos)
+            mov->frag_stream_moof_size += MOV_FRAG_STREAM_TRUN_SIZE;
+        mov->frag_stream_moof_size += MOV_FRAG_STREAM_SAMPLE_SIZE;
+    }
     if (!trk->entry && trk->start_dts != AV_NOPTS_VALUE) {
         if (!trk->frag_discont) {
             /* First packet of a new fragment. We already wrote the duration
@@ -5855,6 +6059,7 @@ static int mov_write_single_packet(AVFormatContext *s, AVPacket *pkt)
     AVCodecParameters *par = trk->par;
     int64_t frag_duration = 0;
     int size = pkt->size;
+    int frag_stream_full;
 
     int ret = check_pkt(s, pkt);
     if (ret < 0)
@@ -5908,14 +6113,19 @@ static int mov_write_single_packet(AVFormatContext *s, AVPacket *pkt)
         frag_duration = av_rescale_q(pkt->dts - trk->cluster[0].dts,
                 s->streams[pkt->stream_index]->time_base,
                 AV_TIME_BASE_Q);
-    if ((mov->max_fragment_duration &&
+    /* the moof of a streamed fragment must fit in the reserved space */
+    frag_stream_full = mov->frag_stream_pos >= 0 &&
+        (mov->frag_stream_moof_size + MOV_FRAG_STREAM_MAX_SAMPLE_SIZE > mov->frag_stream - 8 ||
+         mov->mdat_size + size > UINT32_MAX - 8);
+    if (frag_stream_full ||
+            (mov->max_fragment_duration &&
                 frag_duration >= mov->max_fragment_duration) ||
             (mov->max_fragment_size && mov->mdat_size + size >= mov->max_fragment_size) ||
             (mov->flags & FF_MOV_FLAG_FRAG_KEYFRAME &&
              par->codec_type == AVMEDIA_TYPE_VIDEO &&
              trk->entry && pkt->flags & AV_PKT_FLAG_KEY) ||
             (mov->flags & FF_MOV_FLAG_FRAG_EVERY_FRAME)) {
-        if (frag_duration >= mov->min_fragment_duration) {
+        if (frag_duration >= mov->min_fragment_duration || frag_stream_full) {
             // Set the duration of this track to line up with the next
             // sample in this track. This avoids relying on AVPacket
             // duration, but only helps for this particular track, not
@@ -5930,7 +6140,11 @@ static int mov_write_single_packet(AVFormatContext *s, AVPacket *pkt)
         }
     }
 
-    return ff_mov_write_packet(s, pkt);
+    ret = ff_mov_write_packet(s, pkt);
+    /* write out the queued fragments faster than new data comes in */
+    if (ret >= 0 && mov->nb_queued)
+        mov_write_queued(s, 2 * (int64_t)size);
+    return ret;
 }
 
 static int mov_write_subtitle_end_packet(AVFormatContext *s,
@@ -5961,6 +6175,7 @@ static int mov_write_packet(AVFormatContext *s, AVPacket *pkt)
 
     if (!pkt) {
         mov_flush_fragment(s, 1);
+        mov_write_queued(s, INT64_MAX);
         return 1;
     }
 
@@ -6285,6 +6500,11 @@ static void mov_free(AVFormatContext *s)
 
     av_freep(&mov->tracks);
     ffio_free_dyn_buf(&mov->mdat_buf);
+
+    for (i = 0; i < mov->nb_queued; i++)
+        av_free(mov->queue[i].data);
+    av_freep(&mov->queue);
+    mov->nb_queued = 0;
 }
 
 static uint32_t rgb_to_yuv(uint32_t rgb)
@@ -6462,6 +6682,40 @@ static int mov_init(AVFormatContext *s)
         return AVERROR(EINVAL);
     }
 
+    mov->frag_stream_pos   = -1;
+    mov->queue_marker_type = -1;
+    if (mov->frag_stream) {
+        if (!(mov->flags & FF_MOV_FLAG_FRAGMENT) ||
+            !(s->pb->seekable & AVIO_SEEKABLE_NORMAL)) {
+            av_log(s, AV_LOG_ERROR,
+                   "frag_stream requires fragmented output to a seekable file\n");
+            return AVERROR(EINVAL);
+        }
+        if (mov->frag_stream < 256) {
+            av_log(s, AV_LOG_ERROR, "frag_stream must be at least 256 bytes\n");
+            return AVERROR(EINVAL);
+        }
+        /* These write more than the moof in the reserved space, or
+         * need the samples of the fragment grouped by track. */
+        if (mov->mode == MODE_ISM || mov->frag_interleave || mov->frag_write_queue ||
+            mov->write_prft > MOV_PRFT_NONE || mov->encryption_scheme_str ||
+            mov->flags & (FF_MOV_FLAG_SEPARATE_MOOF | FF_MOV_FLAG_OMIT_TFHD_OFFSET |
+                          FF_MOV_FLAG_RTP_HINT) ||
+            (mov->flags & FF_MOV_FLAG_DASH &&
+             !(mov->flags & (FF_MOV_FLAG_GLOBAL_SIDX | FF_MOV_FLAG_SKIP_SIDX)))) {
+            av_log(s, AV_LOG_ERROR,
+                   "frag_stream is mutually exclusive with ism, frag_interleave, "
+                   "frag_write_queue, write_prft, encryption, separate_moof, "
+                   "omit_tfhd_offset, rtphint and dash without global_sidx or "
+                   "skip_sidx\n");
+            return AVERROR(EINVAL);
+        }
+    }
+    if (mov->frag_write_queue && mov->mode == MODE_ISM) {
+        av_log(s, AV_LOG_ERROR, "frag_write_queue is not supported in ism mode\n");
+        return AVERROR(EINVAL);
+    }
+
     mov->nb_streams = s->nb_streams;
     if (mov->mode & (MODE_MP4|MODE_MOV|MODE_IPOD) && s->nb_chapters)
         mov->chapter_track = mov->nb_streams++;
@@ -7061,6 +7315,7 @@ static int mov_write_trailer(AVFormatContext *s)
         res = 0;
     } else {
         mov_auto_flush_fragment(s, 1);
+        mov_write_queued(s, INT64_MAX);
         for (i = 0; i < mov->nb_streams; i++)
            mov->tracks[i].data_offset = 0;
         if (mov->flags & FF_MOV_FLAG_GLOBAL_SIDX) {
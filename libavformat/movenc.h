@@ -235,6 +235,19 @@ typedef struct MOVMuxContext {
     int write_tmcd;
     MOVPrftBox write_prft;
     int empty_hdlr_name;
+
+    int frag_stream;            ///< bytes reserved for the moof of streamed fragments, 0 to buffer fragments
+    int64_t frag_stream_pos;    ///< position of the reserved space of the current fragment, -1 if none
+    int frag_stream_moof_size;  ///< upper bound of the size of the moof of the current fragment
+    int64_t frag_pos_offset;    ///< output position of the buffer the moof is written to
+
+    int frag_write_queue;       ///< max bytes of completed fragments left to write, 0 to write them at once
+    struct MOVQueuedBuffer *queue;
+    int nb_queued;
+    unsigned int queue_allocated_size;
+    int64_t queued_size;        ///< bytes left to write in the queue
+    int64_t queue_marker_time;
+    int queue_marker_type;      ///< data marker for the next queued buffer, -1 if none
 } MOVMuxContext;
 
 #define FF_MOV_FLAG_RTP_HINT              (1 <<  0)
@@ -131,6 +131,7 @@ static int mpegps_read_header(AVFormatContext *s)
 
     m->header_state = 0xff;
     s->ctx_flags   |= AVFMTCTX_NOHEADER;
+    s->internal->use_compact_index = 1;
 
     avio_get_str(s->pb, 6, buffer, sizeof(buffer));
     if (!memcmp("IMKH", buffer, 4)) {
@@ -2857,6 +2857,20 @@ static int mpegts_resync(AVFormatContext *s, int seekback, const uint8_t *curren
     avio_seek(pb, -back, SEEK_CUR);
 
     for (i = 0; i < ts->resync_size; i++) {
+        int len = FFMIN(pb->buf_end - pb->buf_ptr, ts->resync_size - i);
+
+        /* look for the sync byte in the buffered data first */
+        if (len > 0) {
+            const uint8_t *sync = memchr(pb->buf_ptr, 0x47, len);
+            if (!sync) {
+                pb->buf_ptr += len;
+                i += len - 1;
+                continue;
+            }
+            i += sync - pb->buf_ptr;
+            pb->buf_ptr = (uint8_t *)sync;
+        }
+
         c = avio_r8(pb);
         if (avio_feof(pb))
             return AVERROR_EOF;
@@ -2916,6 +2930,44 @@ static void finished_reading_packet(AVFormatContext *s, int raw_packet_size)
         avio_skip(pb, skip);
 }
 
+/**
+ * Handle up to max_packets packets straight from the IO buffer, stopping at
+ * the first one without a sync byte or when a packet stops the parsing.
+ * Packets of PIDs without a filter, or whose filter discards them, are
+ * skipped without calling handle_packet().
+ *
+ * @return 0 or a negative error code, with the number of packets consumed
+ *         from the buffer in *nb_handled
+ */
+static int handle_buffered_packets(MpegTSContext *ts, int max_packets, int *nb_handled)
+{
+    AVIOContext *pb = ts->stream->pb;
+    const int raw_packet_size = ts->raw_packet_size;
+    const int64_t pos = avio_tell(pb);
+    const uint8_t *packet = pb->buf_ptr;
+    int i, ret = 0, nb_packets = FFMIN((pb->buf_end - pb->buf_ptr) / raw_packet_size,
+                                       max_packets);
+
+    for (i = 0; i < nb_packets && !ts->stop_parse; i++, packet += raw_packet_size) {
+        int pid = AV_RB16(packet + 1) & 0x1fff;
+        int is_start = packet[1] & 0x40;
+        MpegTSFilter *tss = ts->pids[pid];
+
+        if (packet[0] != 0x47)
+            break;
+        pb->buf_ptr += raw_packet_size;
+        if (tss ? tss->discard && !is_start : !(ts->auto_guess && is_start))
+            continue;
+        ret = handle_packet(ts, packet, pos + (int64_t)i * raw_packet_size + TS_PACKET_SIZE);
+        if (ret != 0) {
+            i++;
+            break;
+        }
+    }
+    *nb_handled = i;
+    return ret;
+}
+
 static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
 {
     AVFormatContext *s = ts->stream;
@@ -2957,6 +3009,20 @@ static int handle_packets(MpegTSContext *ts, int64_t nb_packets)
         if (ts->stop_parse > 0)
             break;
 
+        /* handle the packets already buffered in a batch, skipping the
+         * per packet IO calls */
+        if (s->pb->buf_end - s->pb->buf_ptr >= ts->raw_packet_size &&
+            s->pb->buf_ptr[0] == 0x47) {
+            int nb_handled;
+            ret = handle_buffered_packets(ts, nb_packets ? FFMIN(nb_packets - packet_num, INT_MAX) : INT_MAX,
+                                          &nb_handled);
+            packet_num += nb_handled - 1;
+            if (ret != 0)
+                break;
+            if (nb_handled)
+                continue;
+        }
+
         ret = read_packet(s, packet, ts->raw_packet_size, &data);
         if (ret != 0)
             break;
@@ -3055,6 +3121,7 @@ static int mpegts_read_header(AVFormatContext *s)
     int64_t seekback = FFMAX(s->probesize, (int64_t)ts->resync_size + PROBE_PACKET_MAX_BUF);
 
     s->internal->prefer_codec_framerate = 1;
+    s->internal->use_compact_index      = 1;
 
     if (ffio_ensure_seekback(pb, seekback) < 0)
         av_log(s, AV_LOG_WARNING, "Failed to allocate buffers for seekback\n");
@@ -0,0 +1,247 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Fill an AVIndexEntry array and a compact index with the same random
+ * entries, appended in order and inserted out of order, and check that
+ * they hold the same entries and return the same search results.
+ *
+ * Usage: compactindex
+ *        compactindex bench [nb_entries]
+ * The second form builds both indexes with nb_entries (default 10M)
+ * entries and prints their memory use and search speed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/time.h"
+#include "libavformat/compactindex.h"
+#include "libavformat/internal.h"
+
+typedef struct ArrayIndex {
+    AVIndexEntry *entries;
+    int nb_entries;
+    unsigned int allocated_size;
+} ArrayIndex;
+
+static int add_entry(ArrayIndex *ai, FFCompactIndex *ci, int64_t pos,
+                     int64_t timestamp, int size, int distance, int flags)
+{
+    int ret1 = ff_add_index_entry(&ai->entries, &ai->nb_entries,
+                                  &ai->allocated_size, pos, timestamp,
+                                  size, distance, flags);
+    int ret2 = ff_compact_index_add(ci, pos, timestamp, size, distance, flags);
+
+    if (ret1 != ret2) {
+        printf("add %"PRId64": %d != %d\n", timestamp, ret1, ret2);
+        return -1;
+    }
+    return 0;
+}
+
+static int compare(ArrayIndex *ai, FFCompactIndex *ci, AVLFG *lfg,
+                   int nb_searches)
+{
+    static const int search_flags[] = {
+        0, AVSEEK_FLAG_BACKWARD, AVSEEK_FLAG_ANY,
+        AVSEEK_FLAG_ANY | AVSEEK_FLAG_BACKWARD,
+    };
+    int64_t max_ts;
+    int i, j;
+
+    if (ai->nb_entries != ci->nb_entries) {
+        printf("nb_entries %d != %d\n", ai->nb_entries, ci->nb_entries);
+        return -1;
+    }
+    for (i = 0; i < ai->nb_entries; i++) {
+        const AVIndexEntry *e1 = &ai->entries[i];
+        const AVIndexEntry *e2 = ff_compact_index_get(ci, i);
+        if (e1->pos != e2->pos || e1->timestamp != e2->timestamp ||
+            e1->flags != e2->flags || e1->size != e2->size ||
+            e1->min_distance != e2->min_distance) {
+            printf("entry %d differs\n", i);
+            return -1;
+        }
+    }
+
+    max_ts = ai->nb_entries ? ai->entries[ai->nb_entries - 1].timestamp + 10 : 10;
+    for (i = 0; i < nb_searches; i++) {
+        int64_t ts = (int64_t)av_lfg_get(lfg) % (max_ts + 20) - 10;
+        for (j = 0; j < FF_ARRAY_ELEMS(search_flags); j++) {
+            int r1 = ff_index_search_timestamp(ai->entries, ai->nb_entries,
+                                               ts, search_flags[j]);
+            int r2 = ff_compact_index_search(ci, ts, search_flags[j]);
+            if (r1 != r2) {
+                printf("search %"PRId64" flags %d: %d != %d\n",
+                       ts, search_flags[j], r1, r2);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static void reduce(ArrayIndex *ai)
+{
+    int i;
+
+    for (i = 0; 2 * i < ai->nb_entries; i++)
+        ai->entries[i] = ai->entries[2 * i];
+    ai->nb_entries = i;
+}
+
+static int test(void)
+{
+    ArrayIndex ai = { 0 };
+    FFCompactIndex *ci = ff_compact_index_alloc();
+    int64_t ts = 0, pos = 0;
+    AVLFG lfg;
+    int i, ret = -1;
+
+    if (!ci)
+        return -1;
+    av_lfg_init(&lfg, 0xdeadbeef);
+
+    /* in order, with occasional discontinuities */
+    for (i = 0; i < 5000; i++) {
+        int size = av_lfg_get(&lfg) % 100000;
+        ts  += 1 + av_lfg_get(&lfg) % (i % 1000 ? 3600 : 1 << 30);
+        pos += size + (i % 700 ? 0 : (int64_t)av_lfg_get(&lfg) << 10);
+        if (add_entry(&ai, ci, pos, ts, size, av_lfg_get(&lfg) % 5000,
+                      av_lfg_get(&lfg) % 3 ? AVINDEX_KEYFRAME : 0) < 0)
+            goto end;
+    }
+    if (compare(&ai, ci, &lfg, 2000) < 0)
+        goto end;
+    printf("append: %d entries ok\n", ci->nb_entries);
+
+    /* out of order, replacing some entries and splitting blocks */
+    for (i = 0; i < 5000; i++) {
+        int64_t t = av_lfg_get(&lfg) % (ts + 1);
+        if (i % 3 == 0)
+            t = ai.entries[av_lfg_get(&lfg) % ai.nb_entries].timestamp;
+        if (add_entry(&ai, ci, av_lfg_get(&lfg) % (pos + 1), t,
+                      av_lfg_get(&lfg) % 100000, av_lfg_get(&lfg) % 5000,
+                      av_lfg_get(&lfg) % 3 ? AVINDEX_KEYFRAME : 0) < 0)
+            goto end;
+    }
+    if (compare(&ai, ci, &lfg, 2000) < 0)
+        goto end;
+    printf("insert: %d entries ok\n", ci->nb_entries);
+
+    for (i = 0; i < 3; i++) {
+        reduce(&ai);
+        if (ff_compact_index_reduce(ci) < 0 || compare(&ai, ci, &lfg, 500) < 0)
+            goto end;
+        printf("reduce: %d entries ok\n", ci->nb_entries);
+    }
+    ret = 0;
+
+end:
+    av_free(ai.entries);
+    ff_compact_index_free(&ci);
+    return ret;
+}
+
+static int bench(int nb_entries)
+{
+    ArrayIndex ai = { 0 };
+    FFCompactIndex *ci = ff_compact_index_alloc();
+    int64_t t, pos = 0, *queries = NULL;
+    int64_t times[2][2], sum[2] = { 0 };
+    AVLFG lfg;
+    int nb_queries = 1000000, i, j, ret = -1;
+
+    if (!ci)
+        return -1;
+    av_lfg_init(&lfg, 1);
+
+    /* 25 fps video in a 90 kHz time base, a keyframe every 50 frames */
+    t = av_gettime_relative();
+    for (i = 0; i < nb_entries; i++) {
+        int size = 2000 + av_lfg_get(&lfg) % 60000;
+        if (ff_add_index_entry(&ai.entries, &ai.nb_entries, &ai.allocated_size,
+                               pos, i * 3600LL, size, 0,
+                               i % 50 ? 0 : AVINDEX_KEYFRAME) < 0)
+            goto end;
+        pos += size;
+    }
+    times[0][0] = av_gettime_relative() - t;
+
+    t = av_gettime_relative();
+    for (i = 0; i < nb_entries; i++) {
+        const AVIndexEntry *e = &ai.entries[i];
+        if (ff_compact_index_add(ci, e->pos, e->timestamp, e->size,
+                                 e->min_distance, e->flags) < 0)
+            goto end;
+    }
+    times[1][0] = av_gettime_relative() - t;
+
+    queries = av_malloc_array(nb_queries, sizeof(*queries));
+    if (!queries)
+        goto end;
+    for (i = 0; i < nb_queries; i++)
+        queries[i] = (av_lfg_get(&lfg) * (uint64_t)av_lfg_get(&lfg)) %
+                     (nb_entries * 3600LL);
+
+    for (j = 0; j < 2; j++) {
+        t = av_gettime_relative();
+        for (i = 0; i < nb_queries; i++) {
+            if (j)
+                sum[j] += ff_compact_index_search(ci, queries[i], AVSEEK_FLAG_BACKWARD);
+            else
+                sum[j] += ff_index_search_timestamp(ai.entries, ai.nb_entries,
+                                                    queries[i], AVSEEK_FLAG_BACKWARD);
+        }
+        times[j][1] = av_gettime_relative() - t;
+    }
+    if (sum[0] != sum[1]) {
+        printf("search results differ\n");
+        goto end;
+    }
+
+    printf("%d entries, %d keyframe searches\n", nb_entries, nb_queries);
+    printf("array:   %9.1f MB, build %5"PRId64" ms, search %.3f us\n",
+           ai.allocated_size / 1048576.0, times[0][0] / 1000,
+           times[0][1] / (double)nb_queries);
+    printf("compact: %9.1f MB, build %5"PRId64" ms, search %.3f us\n",
+           ff_compact_index_size(ci) / 1048576.0, times[1][0] / 1000,
+           times[1][1] / (double)nb_queries);
+    ret = 0;
+
+end:
+    av_free(queries);
+    av_free(ai.entries);
+    ff_compact_index_free(&ci);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    if (argc > 1 && !strcmp(argv[1], "bench"))
+        ret = bench(argc > 2 ? atoi(argv[2]) : 10000000);
+    else
+        ret = test();
+    return ret < 0;
+}
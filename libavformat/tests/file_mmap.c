@@ -0,0 +1,248 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Write a mov and a matroska file with random packets, then demux them with
+ * and without the mmap option of the file protocol and check that the
+ * packets are identical, that their padding is zeroed and how many of the
+ * mapped ones are referenced rather than copied.
+ *
+ * Usage: file_mmap <prefix>
+ *        file_mmap bench <input> <mmap>
+ * The second form remuxes input to mpegts, discarding the output, and
+ * prints the throughput and peak memory use.
+ */
+
+#include "config.h"
+
+#include <stdio.h>
+#include <string.h>
+#if HAVE_GETRUSAGE
+#include <sys/resource.h>
+#endif
+
+#include "libavutil/adler32.h"
+#include "libavutil/lfg.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+
+#define NB_PACKETS 100
+
+static int write_file(const char *filename, const char *format)
+{
+    AVFormatContext *oc = NULL;
+    AVStream *st;
+    AVPacket pkt;
+    AVLFG lfg;
+    int i, j, ret;
+
+    ret = avformat_alloc_output_context2(&oc, NULL, format, filename);
+    if (ret < 0)
+        return ret;
+    oc->flags |= AVFMT_FLAG_BITEXACT;
+    if (!(st = avformat_new_stream(oc, NULL))) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    st->codecpar->codec_type = AVMEDIA_TYPE_VIDEO;
+    st->codecpar->codec_id   = AV_CODEC_ID_MPEG4;
+    st->codecpar->width      = 320;
+    st->codecpar->height     = 240;
+    st->time_base            = (AVRational){ 1, 25 };
+    if ((ret = avio_open(&oc->pb, filename, AVIO_FLAG_WRITE)) < 0 ||
+        (ret = avformat_write_header(oc, NULL)) < 0)
+        goto end;
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+    for (i = 0; i < NB_PACKETS && ret >= 0; i++) {
+        if ((ret = av_new_packet(&pkt, 1 + av_lfg_get(&lfg) % 60000)) < 0)
+            break;
+        for (j = 0; j < pkt.size; j++)
+            pkt.data[j] = av_lfg_get(&lfg);
+        pkt.pts = pkt.dts = i;
+        pkt.flags = i % 10 ? 0 : AV_PKT_FLAG_KEY;
+        ret = av_interleaved_write_frame(oc, &pkt);
+        av_packet_unref(&pkt);
+    }
+    if (ret >= 0)
+        ret = av_write_trailer(oc);
+
+end:
+    avio_closep(&oc->pb);
+    avformat_free_context(oc);
+    return ret;
+}
+
+static int read_file(const char *filename, int use_mmap,
+                     unsigned long *checksums, int *nb_referenced,
+                     int *nb_unpadded)
+{
+    static const uint8_t zero[AV_INPUT_BUFFER_PADDING_SIZE];
+    AVFormatContext *ic = NULL;
+    AVDictionary *opts = NULL;
+    AVPacket pkt;
+    int nb_packets = 0, ret;
+
+    *nb_referenced = 0;
+    *nb_unpadded   = 0;
+    av_dict_set_int(&opts, "mmap", use_mmap, 0);
+    ret = avformat_open_input(&ic, filename, NULL, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+
+    while ((ret = av_read_frame(ic, &pkt)) >= 0) {
+        if (nb_packets < NB_PACKETS)
+            checksums[nb_packets] = av_adler32_update(0, pkt.data, pkt.size);
+        nb_packets++;
+        /* packets referencing the mapping share it and are not writable */
+        if (pkt.buf && !av_buffer_is_writable(pkt.buf))
+            (*nb_referenced)++;
+        if (memcmp(pkt.data + pkt.size, zero, sizeof(zero)))
+            (*nb_unpadded)++;
+        av_packet_unref(&pkt);
+    }
+    avformat_close_input(&ic);
+    return ret == AVERROR_EOF ? nb_packets : ret;
+}
+
+static int test(const char *prefix, const char *format, const char *ext)
+{
+    unsigned long checksums[2][NB_PACKETS];
+    int nb_packets[2], nb_referenced[2], nb_unpadded[2];
+    char filename[1024];
+    int i, ret;
+
+    snprintf(filename, sizeof(filename), "%s.%s", prefix, ext);
+    if ((ret = write_file(filename, format)) < 0)
+        return ret;
+    for (i = 0; i < 2; i++) {
+        nb_packets[i] = read_file(filename, i, checksums[i],
+                                  &nb_referenced[i], &nb_unpadded[i]);
+        if (nb_packets[i] < 0)
+            return nb_packets[i];
+    }
+
+    printf("%s: packets %d, %s, padding %s, referenced %d\n", format, nb_packets[1],
+           nb_packets[0] == nb_packets[1] && nb_packets[0] == NB_PACKETS &&
+           !memcmp(checksums[0], checksums[1], sizeof(checksums[0])) ?
+           "identical" : "different",
+           nb_unpadded[0] || nb_unpadded[1] ? "not zeroed" : "zeroed",
+           nb_referenced[1]);
+    return 0;
+}
+
+static int write_discard(void *opaque, uint8_t *buf, int size)
+{
+    return size;
+}
+
+static int bench(const char *filename, int use_mmap)
+{
+    AVFormatContext *ic = NULL, *oc = NULL;
+    AVDictionary *opts = NULL;
+    AVPacket pkt;
+    uint8_t *io_buffer;
+    int64_t t, nb_bytes = 0;
+    int i, nb_packets = 0, ret;
+
+    t = av_gettime_relative();
+    av_dict_set_int(&opts, "mmap", use_mmap, 0);
+    ret = avformat_open_input(&ic, filename, NULL, &opts);
+    av_dict_free(&opts);
+    if (ret < 0 || (ret = avformat_find_stream_info(ic, NULL)) < 0)
+        goto end;
+
+    if ((ret = avformat_alloc_output_context2(&oc, NULL, "mpegts", NULL)) < 0)
+        goto end;
+    if (!(io_buffer = av_malloc(32768)) ||
+        !(oc->pb = avio_alloc_context(io_buffer, 32768, 1, NULL, NULL,
+                                      write_discard, NULL))) {
+        av_free(io_buffer);
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    for (i = 0; i < ic->nb_streams; i++) {
+        AVStream *st = avformat_new_stream(oc, NULL);
+        if (!st) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        if ((ret = avcodec_parameters_copy(st->codecpar, ic->streams[i]->codecpar)) < 0)
+            goto end;
+        st->codecpar->codec_tag = 0;
+        st->time_base = ic->streams[i]->time_base;
+    }
+    if ((ret = avformat_write_header(oc, NULL)) < 0)
+        goto end;
+
+    while ((ret = av_read_frame(ic, &pkt)) >= 0) {
+        nb_packets++;
+        nb_bytes += pkt.size;
+        av_packet_rescale_ts(&pkt, ic->streams[pkt.stream_index]->time_base,
+                             oc->streams[pkt.stream_index]->time_base);
+        if ((ret = av_interleaved_write_frame(oc, &pkt)) < 0)
+            goto end;
+    }
+    if ((ret = av_write_trailer(oc)) < 0)
+        goto end;
+    t = av_gettime_relative() - t;
+
+    printf("mmap %d: %d packets, %"PRId64" bytes in %.3fs, %.1f MB/s",
+           use_mmap, nb_packets, nb_bytes, t / 1000000.0,
+           nb_bytes / (double)FFMAX(t, 1));
+#if HAVE_GETRUSAGE && HAVE_STRUCT_RUSAGE_RU_MAXRSS
+    {
+        struct rusage rusage;
+        getrusage(RUSAGE_SELF, &rusage);
+        printf(", maxrss %ldkB", (long)rusage.ru_maxrss);
+    }
+#endif
+    printf("\n");
+
+end:
+    if (oc) {
+        if (oc->pb)
+            av_freep(&oc->pb->buffer);
+        avio_context_free(&oc->pb);
+        avformat_free_context(oc);
+    }
+    avformat_close_input(&ic);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int ret;
+
+    if (argc > 3 && !strcmp(argv[1], "bench")) {
+        ret = bench(argv[2], atoi(argv[3]));
+    } else if (argc > 1) {
+        if ((ret = test(argv[1], "mov", "mov")) >= 0)
+            ret = test(argv[1], "matroska", "mkv");
+    } else {
+        fprintf(stderr, "Usage: %s <prefix> | bench <input> <mmap>\n", argv[0]);
+        return 1;
+    }
+
+    if (ret < 0) {
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}
@@ -784,6 +784,18 @@ int main(int argc, char **argv)
     mux_gops(2);
     finish();
     close_out();
+    memcpy(content, hash, HASH_SIZE);
+
+    // Write the same file through a write queue smaller than a fragment,
+    // the output should be identical.
+    init_out("empty-moov-neg-cts-write-queue");
+    av_dict_set(&opts, "movflags", "frag_keyframe+empty_moov+negative_cts_offsets", 0);
+    av_dict_set(&opts, "frag_write_queue", "1000", 0);
+    init(1, 0);
+    mux_gops(2);
+    finish();
+    close_out();
+    check(!memcmp(hash, content, HASH_SIZE), "frag_write_queue output differs");
 
     av_free(md5);
 
@@ -0,0 +1,275 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Write a multi-program transport stream with random packets, make a copy of
+ * it with garbage inserted between some TS packets, and demux both with all
+ * the streams and with all the programs but the first one discarded. The
+ * packet counts and checksums of each stream are printed.
+ *
+ * Usage: mpegts <prefix>
+ *        mpegts bench <input>
+ * The second form demuxes input with all the streams and with only the
+ * first program, and prints the throughput.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/lfg.h"
+#include "libavutil/time.h"
+#include "libavformat/avformat.h"
+#include "libavformat/avio.h"
+
+#define NB_PROGRAMS 3
+#define NB_PACKETS  200
+#define MAX_STREAMS 16
+
+typedef struct DemuxStats {
+    int nb_streams;
+    int nb_packets[MAX_STREAMS];
+    unsigned long checksums[MAX_STREAMS];
+    int64_t bytes;
+} DemuxStats;
+
+static int write_file(const char *filename)
+{
+    AVFormatContext *oc = NULL;
+    AVPacket pkt;
+    AVLFG lfg;
+    uint8_t data[4096];
+    int i, j, ret;
+
+    ret = avformat_alloc_output_context2(&oc, NULL, "mpegts", filename);
+    if (ret < 0)
+        return ret;
+    oc->flags |= AVFMT_FLAG_BITEXACT;
+
+    for (i = 0; i < NB_PROGRAMS; i++) {
+        if (!av_new_program(oc, i + 1)) {
+            ret = AVERROR(ENOMEM);
+            goto end;
+        }
+        for (j = 0; j < 2; j++) {
+            AVStream *st = avformat_new_stream(oc, NULL);
+            if (!st) {
+                ret = AVERROR(ENOMEM);
+                goto end;
+            }
+            st->codecpar->codec_type = j ? AVMEDIA_TYPE_AUDIO : AVMEDIA_TYPE_VIDEO;
+            st->codecpar->codec_id   = j ? AV_CODEC_ID_MP2 : AV_CODEC_ID_MPEG2VIDEO;
+            if (j) {
+                st->codecpar->sample_rate = 48000;
+                st->codecpar->channels    = 2;
+            } else {
+                st->codecpar->width  = 320;
+                st->codecpar->height = 240;
+            }
+            st->time_base = (AVRational){ 1, 25 };
+            av_program_add_stream_index(oc, i + 1, st->index);
+        }
+    }
+
+    if ((ret = avio_open(&oc->pb, filename, AVIO_FLAG_WRITE)) < 0)
+        goto end;
+    if ((ret = avformat_write_header(oc, NULL)) < 0)
+        goto end;
+
+    av_lfg_init(&lfg, 0xdeadbeef);
+    for (i = 0; i < NB_PACKETS; i++) {
+        for (j = 0; j < oc->nb_streams; j++) {
+            int size = 100 + av_lfg_get(&lfg) % (sizeof(data) - 100), k;
+            for (k = 0; k < size; k++)
+                data[k] = av_lfg_get(&lfg);
+            av_init_packet(&pkt);
+            pkt.data         = data;
+            pkt.size         = size;
+            pkt.stream_index = j;
+            pkt.pts = pkt.dts = av_rescale_q(i, (AVRational){ 1, 25 },
+                                             oc->streams[j]->time_base);
+            pkt.flags        = AV_PKT_FLAG_KEY;
+            if ((ret = av_write_frame(oc, &pkt)) < 0)
+                goto end;
+        }
+    }
+    ret = av_write_trailer(oc);
+
+end:
+    if (oc)
+        avio_closep(&oc->pb);
+    avformat_free_context(oc);
+    return ret;
+}
+
+/**
+ * Copy src to dst, inserting garbage without sync bytes after some of the
+ * TS packets.
+ */
+static int corrupt_file(const char *src, const char *dst)
+{
+    AVIOContext *in = NULL, *out = NULL;
+    uint8_t packet[188], garbage[300];
+    AVLFG lfg;
+    int i, ret;
+
+    av_lfg_init(&lfg, 0xc0ffee);
+    for (i = 0; i < sizeof(garbage); i++)
+        garbage[i] = av_lfg_get(&lfg) % 0x40;
+
+    if ((ret = avio_open(&in, src, AVIO_FLAG_READ)) < 0)
+        return ret;
+    if ((ret = avio_open(&out, dst, AVIO_FLAG_WRITE)) < 0)
+        goto end;
+    for (i = 0; avio_read(in, packet, sizeof(packet)) == sizeof(packet); i++) {
+        avio_write(out, packet, sizeof(packet));
+        if (i % 97 == 50)
+            avio_write(out, garbage, 1 + i % sizeof(garbage));
+    }
+
+end:
+    avio_closep(&in);
+    if (out)
+        ret = avio_closep(&out);
+    return ret;
+}
+
+/**
+ * Discard all the programs but the first one. A program is only discarded
+ * once its PMT has been parsed, the demuxer would guess its streams otherwise.
+ */
+static void discard_programs(AVFormatContext *ic)
+{
+    int i, j;
+
+    for (i = 0; i < ic->nb_programs; i++) {
+        AVProgram *program = ic->programs[i];
+        if (program->id == 1 || !program->nb_stream_indexes)
+            continue;
+        program->discard = AVDISCARD_ALL;
+        for (j = 0; j < program->nb_stream_indexes; j++)
+            ic->streams[program->stream_index[j]]->discard = AVDISCARD_ALL;
+    }
+}
+
+static int demux_file(const char *filename, int first_program_only, DemuxStats *stats)
+{
+    AVFormatContext *ic = NULL;
+    AVDictionary *opts = NULL;
+    AVPacket pkt;
+    int ret;
+
+    memset(stats, 0, sizeof(*stats));
+    /* return the PES packets as they are, the payloads are random */
+    av_dict_set(&opts, "fflags", "+noparse+nofillin", 0);
+    ret = avformat_open_input(&ic, filename, NULL, &opts);
+    av_dict_free(&opts);
+    if (ret < 0)
+        return ret;
+
+    while ((ret = av_read_frame(ic, &pkt)) >= 0) {
+        if (first_program_only)
+            discard_programs(ic);
+        if (ic->streams[pkt.stream_index]->discard == AVDISCARD_ALL) {
+            av_packet_unref(&pkt);
+            continue;
+        }
+        if (pkt.stream_index < MAX_STREAMS) {
+            stats->nb_packets[pkt.stream_index]++;
+            stats->checksums[pkt.stream_index] =
+                av_adler32_update(stats->checksums[pkt.stream_index], pkt.data, pkt.size);
+        }
+        stats->bytes += pkt.size;
+        av_packet_unref(&pkt);
+    }
+    if (ret == AVERROR_EOF)
+        ret = 0;
+
+    stats->nb_streams = FFMIN(ic->nb_streams, MAX_STREAMS);
+    avformat_close_input(&ic);
+    return ret;
+}
+
+static int bench(const char *filename)
+{
+    DemuxStats stats;
+    int64_t size = 0, t;
+    AVIOContext *pb;
+    int i, ret;
+
+    if (avio_open(&pb, filename, AVIO_FLAG_READ) >= 0) {
+        size = avio_size(pb);
+        avio_closep(&pb);
+    }
+
+    for (i = 0; i < 2; i++) {
+        int nb_packets = 0, j;
+
+        t = av_gettime_relative();
+        if ((ret = demux_file(filename, i, &stats)) < 0)
+            return ret;
+        t = FFMAX(av_gettime_relative() - t, 1);
+        for (j = 0; j < stats.nb_streams; j++)
+            nb_packets += stats.nb_packets[j];
+        printf("%s: %d packets, %.1f MB/s, %.0f packets/s\n",
+               i ? "first program" : "all streams", nb_packets,
+               size / (double)t, nb_packets * 1000000.0 / t);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    DemuxStats stats;
+    char filenames[2][1024];
+    int i, j, k, ret;
+
+    if (argc > 2 && !strcmp(argv[1], "bench")) {
+        ret = bench(argv[2]);
+        goto end;
+    }
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <prefix> | bench <input>\n", argv[0]);
+        return 1;
+    }
+
+    snprintf(filenames[0], sizeof(filenames[0]), "%s.ts", argv[1]);
+    snprintf(filenames[1], sizeof(filenames[1]), "%s-corrupt.ts", argv[1]);
+    if ((ret = write_file(filenames[0])) < 0)
+        goto end;
+    if ((ret = corrupt_file(filenames[0], filenames[1])) < 0)
+        goto end;
+
+    for (i = 0; i < 2; i++) {
+        for (j = 0; j < 2; j++) {
+            if ((ret = demux_file(filenames[i], j, &stats)) < 0)
+                goto end;
+            printf("%s, %s:\n", i ? "corrupt" : "clean", j ? "first program" : "all streams");
+            for (k = 0; k < stats.nb_streams; k++)
+                printf("    stream %d: %d packets, checksum 0x%08lx\n",
+                       k, stats.nb_packets[k], stats.checksums[k]);
+        }
+    }
+
+end:
+    if (ret < 0) {
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}
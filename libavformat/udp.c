@@ -26,6 +26,9 @@
 
 #define _DEFAULT_SOURCE
 #define _BSD_SOURCE     /* Needed for using struct ip_mreq with recent glibc */
+#define _GNU_SOURCE     /* Needed for recvmmsg() and sendmmsg() */
+
+#include <stdatomic.h>
 
 #include "avformat.h"
 #include "avio_internal.h"
@@ -70,6 +73,10 @@
 #include "libavutil/thread.h"
 #endif
 
+#if HAVE_SENDMMSG
+#include <netinet/udp.h>
+#endif
+
 #ifndef IPV6_ADD_MEMBERSHIP
 #define IPV6_ADD_MEMBERSHIP IPV6_JOIN_GROUP
 #define IPV6_DROP_MEMBERSHIP IPV6_LEAVE_GROUP
@@ -79,6 +86,22 @@
 #define UDP_RX_BUF_SIZE 393216
 #define UDP_MAX_PKT_SIZE 65536
 #define UDP_HEADER_SIZE 8
+#define UDP_MAX_RECV_BATCH 1024
+#define UDP_MAX_SEND_BATCH 1024
+#define UDP_MAX_GSO_SEGMENTS 64
+#define UDP_MAX_GSO_SIZE 65000
+
+#if HAVE_RECVMMSG && defined(SO_TIMESTAMPNS)
+#define UDP_RECV_CONTROL_SIZE CMSG_SPACE(sizeof(struct timespec))
+#else
+#define UDP_RECV_CONTROL_SIZE 0
+#endif
+
+#if HAVE_SENDMMSG && defined(UDP_SEGMENT)
+#define UDP_SEND_CONTROL_SIZE CMSG_SPACE(sizeof(uint16_t))
+#else
+#define UDP_SEND_CONTROL_SIZE 0
+#endif
 
 typedef struct UDPContext {
     const AVClass *class;
@@ -109,6 +132,53 @@ typedef struct UDPContext {
     pthread_cond_t cond;
     int thread_started;
 #endif
+
+    /* recvmmsg() batches, received into a single producer single consumer
+     * ring of datagram slots instead of the fifo */
+    int recv_batch;
+    int recv_timestamps;
+    uint8_t *ring;
+    int *ring_len;
+    int64_t *ring_timestamps;
+    int ring_nb_slots;      /* a power of two, so the free running indexes wrap */
+    unsigned ring_mask;
+    int ring_slot_size;
+    atomic_uint ring_head;
+    atomic_uint ring_tail;
+    atomic_int ring_waiting;
+#if HAVE_RECVMMSG
+    struct mmsghdr *msgs;
+    struct iovec *iov;
+    struct sockaddr_storage *msg_addrs;
+    uint8_t *msg_control;
+#endif
+
+    /* sendmmsg() batches, optionally with UDP GSO, sent by the circular
+     * buffer thread and paced by a token bucket */
+    int send_batch;
+    int gso;
+    int tx_waiting;
+    uint8_t *tx_buf;
+    int tx_buf_size;
+    int *tx_len;
+#if HAVE_SENDMMSG
+    struct mmsghdr *tx_msgs;
+    struct iovec *tx_iov;
+    int *tx_msg_first;
+    uint8_t *tx_control;
+#endif
+
+    /* receive statistics, updated by the thread and exported by udp_read() */
+    atomic_uint_least64_t nb_overruns;
+    atomic_uint_least64_t nb_batches;
+    atomic_uint_least64_t nb_packets;
+    atomic_int max_batch;
+    int64_t rx_overruns;
+    int64_t rx_batches;
+    int64_t rx_packets;
+    int64_t rx_max_batch;
+    int64_t rx_timestamp;
+
     uint8_t tmp[UDP_MAX_PKT_SIZE+4];
     int remaining_in_dg;
     char *localaddr;
@@ -138,6 +208,15 @@ static const AVOption options[] = {
     { "connect",        "set if connect() should be called on socket",     OFFSET(is_connected),   AV_OPT_TYPE_BOOL,   { .i64 =  0 },     0, 1,       .flags = D|E },
     { "fifo_size",      "set the UDP receiving circular buffer size, expressed as a number of packets with size of 188 bytes", OFFSET(circular_buffer_size), AV_OPT_TYPE_INT, {.i64 = 7*4096}, 0, INT_MAX, D },
     { "overrun_nonfatal", "survive in case of UDP receiving circular buffer overrun", OFFSET(overrun_nonfatal), AV_OPT_TYPE_BOOL, {.i64 = 0}, 0, 1,    D },
+    { "send_batch",     "send up to this many datagrams per system call in the circular buffer thread", OFFSET(send_batch), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, UDP_MAX_SEND_BATCH, E },
+    { "gso",            "send batched datagrams of the same size with UDP generic segmentation offload", OFFSET(gso), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, E },
+    { "recv_batch",     "receive up to this many datagrams per system call in the circular buffer thread", OFFSET(recv_batch), AV_OPT_TYPE_INT, { .i64 = 0 }, 0, UDP_MAX_RECV_BATCH, D },
+    { "recv_timestamps", "keep the kernel receive timestamps of the batched datagrams", OFFSET(recv_timestamps), AV_OPT_TYPE_BOOL, { .i64 = 0 }, 0, 1, D },
+    { "rx_overruns",    "number of datagrams dropped on circular buffer overrun", OFFSET(rx_overruns), AV_OPT_TYPE_INT64, { .i64 = 0 }, 0, INT64_MAX, D|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
+    { "rx_batches",     "number of batches received",                      OFFSET(rx_batches),     AV_OPT_TYPE_INT64,  { .i64 = 0 },     0, INT64_MAX, D|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
+    { "rx_packets",     "number of datagrams received in batches",         OFFSET(rx_packets),     AV_OPT_TYPE_INT64,  { .i64 = 0 },     0, INT64_MAX, D|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
+    { "rx_max_batch",   "largest number of datagrams received in a batch", OFFSET(rx_max_batch),   AV_OPT_TYPE_INT64,  { .i64 = 0 },     0, INT64_MAX, D|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
+    { "rx_timestamp",   "kernel receive timestamp of the last datagram read, in microseconds", OFFSET(rx_timestamp), AV_OPT_TYPE_INT64, { .i64 = AV_NOPTS_VALUE }, INT64_MIN, INT64_MAX, D|AV_OPT_FLAG_EXPORT|AV_OPT_FLAG_READONLY },
     { "timeout",        "set raise error timeout, in microseconds (only in read mode)",OFFSET(timeout),         AV_OPT_TYPE_INT,  {.i64 = 0}, 0, INT_MAX, D },
     { "sources",        "Source list",                                     OFFSET(sources),        AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
     { "block",          "Block list",                                      OFFSET(block),          AV_OPT_TYPE_STRING, { .str = NULL },               .flags = D|E },
@@ -459,6 +538,27 @@ static int udp_get_file_handle(URLContext *h)
     return s->udp_fd;
 }
 
+static void udp_batch_free(UDPContext *s)
+{
+    av_freep(&s->ring);
+    av_freep(&s->ring_len);
+    av_freep(&s->ring_timestamps);
+#if HAVE_RECVMMSG
+    av_freep(&s->msgs);
+    av_freep(&s->iov);
+    av_freep(&s->msg_addrs);
+    av_freep(&s->msg_control);
+#endif
+    av_freep(&s->tx_buf);
+    av_freep(&s->tx_len);
+#if HAVE_SENDMMSG
+    av_freep(&s->tx_msgs);
+    av_freep(&s->tx_iov);
+    av_freep(&s->tx_msg_first);
+    av_freep(&s->tx_control);
+#endif
+}
+
 #if HAVE_PTHREAD_CANCEL
 static void *circular_buffer_task_rx( void *_URLContext)
 {
@@ -499,6 +599,7 @@ static void *circular_buffer_task_rx( void *_URLContext)
 
         if(av_fifo_space(s->fifo) < len + 4) {
             /* No Space left */
+            atomic_fetch_add_explicit(&s->nb_overruns, 1, memory_order_relaxed);
             if (s->overrun_nonfatal) {
                 av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
                         "Surviving due to overrun_nonfatal option\n");
@@ -521,6 +622,166 @@ end:
     return NULL;
 }
 
+#if HAVE_RECVMMSG
+static int64_t recv_timestamp(struct msghdr *msg)
+{
+#ifdef SO_TIMESTAMPNS
+    struct cmsghdr *cmsg;
+
+    for (cmsg = CMSG_FIRSTHDR(msg); cmsg; cmsg = CMSG_NXTHDR(msg, cmsg)) {
+        if (cmsg->cmsg_level == SOL_SOCKET && cmsg->cmsg_type == SCM_TIMESTAMPNS) {
+            struct timespec ts;
+            memcpy(&ts, CMSG_DATA(cmsg), sizeof(ts));
+            return ts.tv_sec * INT64_C(1000000) + ts.tv_nsec / 1000;
+        }
+    }
+#endif
+    return AV_NOPTS_VALUE;
+}
+
+static void *circular_buffer_task_rx_batch(void *_URLContext)
+{
+    URLContext *h = _URLContext;
+    UDPContext *s = h->priv_data;
+    int old_cancelstate, ret = 0;
+
+    pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
+    if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
+        av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
+        ret = AVERROR(EIO);
+        goto end;
+    }
+    while (1) {
+        unsigned head = atomic_load_explicit(&s->ring_head, memory_order_acquire);
+        unsigned tail = atomic_load_explicit(&s->ring_tail, memory_order_relaxed);
+        int nb_msgs = FFMIN(s->recv_batch, s->ring_nb_slots - (int)(tail - head));
+        int overrun = !nb_msgs, nb_packets = 0, i, n;
+
+        /* with the ring full, receive into the spare slot and drop */
+        if (overrun)
+            nb_msgs = 1;
+        for (i = 0; i < nb_msgs; i++) {
+            int slot = overrun ? s->ring_nb_slots : (tail + i) & s->ring_mask;
+            struct msghdr *hdr = &s->msgs[i].msg_hdr;
+
+            s->iov[i].iov_base  = s->ring + (size_t)slot * s->ring_slot_size;
+            s->iov[i].iov_len   = s->ring_slot_size;
+            memset(hdr, 0, sizeof(*hdr));
+            hdr->msg_name       = &s->msg_addrs[i];
+            hdr->msg_namelen    = sizeof(s->msg_addrs[i]);
+            hdr->msg_iov        = &s->iov[i];
+            hdr->msg_iovlen     = 1;
+            if (s->recv_timestamps) {
+                hdr->msg_control    = s->msg_control + i * UDP_RECV_CONTROL_SIZE;
+                hdr->msg_controllen = UDP_RECV_CONTROL_SIZE;
+            }
+        }
+
+        /* Blocking operations are always cancellation points */
+        pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, &old_cancelstate);
+        n = recvmmsg(s->udp_fd, s->msgs, nb_msgs, MSG_WAITFORONE, NULL);
+        pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, &old_cancelstate);
+        if (n < 0) {
+            if (ff_neterrno() != AVERROR(EAGAIN) && ff_neterrno() != AVERROR(EINTR)) {
+                ret = ff_neterrno();
+                goto end;
+            }
+            continue;
+        }
+
+        if (overrun) {
+            atomic_fetch_add_explicit(&s->nb_overruns, n, memory_order_relaxed);
+            if (s->overrun_nonfatal) {
+                av_log(h, AV_LOG_WARNING, "Circular buffer overrun. "
+                        "Surviving due to overrun_nonfatal option\n");
+                continue;
+            }
+            av_log(h, AV_LOG_ERROR, "Circular buffer overrun. "
+                    "To avoid, increase fifo_size URL option. "
+                    "To survive in such case, use overrun_nonfatal option\n");
+            ret = AVERROR(EIO);
+            goto end;
+        }
+
+        for (i = 0; i < n; i++) {
+            int slot = (tail + nb_packets) & s->ring_mask;
+            uint8_t *dst = s->ring + (size_t)slot * s->ring_slot_size;
+
+            if (ff_ip_check_source_lists(&s->msg_addrs[i], &s->filters))
+                continue;
+            if (s->msgs[i].msg_hdr.msg_flags & MSG_TRUNC)
+                av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient "
+                       "buffer size, increase the pkt_size option\n");
+            if (dst != s->iov[i].iov_base)
+                memmove(dst, s->iov[i].iov_base, s->msgs[i].msg_len);
+            s->ring_len[slot] = s->msgs[i].msg_len;
+            s->ring_timestamps[slot] = s->recv_timestamps ?
+                recv_timestamp(&s->msgs[i].msg_hdr) : AV_NOPTS_VALUE;
+            nb_packets++;
+        }
+
+        atomic_fetch_add_explicit(&s->nb_batches, 1, memory_order_relaxed);
+        atomic_fetch_add_explicit(&s->nb_packets, n, memory_order_relaxed);
+        if (n > atomic_load_explicit(&s->max_batch, memory_order_relaxed))
+            atomic_store_explicit(&s->max_batch, n, memory_order_relaxed);
+
+        /* publish the batch, the sequentially consistent store and load
+         * pair with the ones of udp_read_ring() so no wakeup is lost */
+        atomic_store(&s->ring_tail, tail + nb_packets);
+        if (atomic_load(&s->ring_waiting)) {
+            pthread_mutex_lock(&s->mutex);
+            pthread_cond_signal(&s->cond);
+            pthread_mutex_unlock(&s->mutex);
+        }
+    }
+
+end:
+    pthread_mutex_lock(&s->mutex);
+    s->circular_buffer_error = ret;
+    pthread_cond_signal(&s->cond);
+    pthread_mutex_unlock(&s->mutex);
+    return NULL;
+}
+
+static int udp_ring_alloc(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+
+    s->ring_slot_size = s->pkt_size > 0 ? s->pkt_size : UDP_MAX_PKT_SIZE;
+    s->ring_nb_slots  = FFMAX(s->circular_buffer_size / s->ring_slot_size,
+                              2 * s->recv_batch);
+    s->ring_nb_slots  = 1 << av_ceil_log2(FFMIN(s->ring_nb_slots, 1 << 30));
+    s->ring_mask      = s->ring_nb_slots - 1;
+    /* one more slot to receive the datagrams dropped on overrun */
+    s->ring            = av_malloc_array(s->ring_nb_slots + 1, s->ring_slot_size);
+    s->ring_len        = av_malloc_array(s->ring_nb_slots, sizeof(*s->ring_len));
+    s->ring_timestamps = av_malloc_array(s->ring_nb_slots, sizeof(*s->ring_timestamps));
+    s->msgs            = av_mallocz_array(s->recv_batch, sizeof(*s->msgs));
+    s->iov             = av_mallocz_array(s->recv_batch, sizeof(*s->iov));
+    s->msg_addrs       = av_mallocz_array(s->recv_batch, sizeof(*s->msg_addrs));
+    if (!s->ring || !s->ring_len || !s->ring_timestamps ||
+        !s->msgs || !s->iov || !s->msg_addrs)
+        return AVERROR(ENOMEM);
+
+    if (s->recv_timestamps) {
+#ifdef SO_TIMESTAMPNS
+        int on = 1;
+        s->msg_control = av_mallocz_array(s->recv_batch, UDP_RECV_CONTROL_SIZE);
+        if (!s->msg_control)
+            return AVERROR(ENOMEM);
+        if (setsockopt(s->udp_fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on)) < 0) {
+            ff_log_net_error(h, AV_LOG_WARNING, "setsockopt(SO_TIMESTAMPNS)");
+            s->recv_timestamps = 0;
+        }
+#else
+        av_log(h, AV_LOG_WARNING, "Receive timestamps are not supported on this system\n");
+        s->recv_timestamps = 0;
+#endif
+    }
+    return 0;
+}
+#endif
+
 static void *circular_buffer_task_tx( void *_URLContext)
 {
     URLContext *h = _URLContext;
@@ -618,6 +879,198 @@ end:
     return NULL;
 }
 
+#if HAVE_SENDMMSG
+/**
+ * Send the datagrams of the tx buffer from first to nb, p pointing to the
+ * first one. With GSO, consecutive datagrams of the same size are sent as
+ * one message.
+ */
+static int udp_send_batch(URLContext *h, int first, int nb, uint8_t *p)
+{
+    UDPContext *s = h->priv_data;
+    int nb_msgs = 0, sent = 0, i = first;
+
+    while (i < nb) {
+        struct msghdr *hdr = &s->tx_msgs[nb_msgs].msg_hdr;
+        int len = s->tx_len[i], n = 1;
+
+        while (s->gso && i + n < nb && n < UDP_MAX_GSO_SEGMENTS &&
+               s->tx_len[i + n] == len && (n + 1) * len <= UDP_MAX_GSO_SIZE)
+            n++;
+
+        s->tx_iov[nb_msgs].iov_base = p;
+        s->tx_iov[nb_msgs].iov_len  = n * len;
+        memset(hdr, 0, sizeof(*hdr));
+        hdr->msg_iov    = &s->tx_iov[nb_msgs];
+        hdr->msg_iovlen = 1;
+        if (!s->is_connected) {
+            hdr->msg_name    = &s->dest_addr;
+            hdr->msg_namelen = s->dest_addr_len;
+        }
+#ifdef UDP_SEGMENT
+        if (n > 1) {
+            uint16_t segment_size = len;
+            struct cmsghdr *cmsg;
+
+            hdr->msg_control    = s->tx_control + nb_msgs * UDP_SEND_CONTROL_SIZE;
+            hdr->msg_controllen = UDP_SEND_CONTROL_SIZE;
+            cmsg = CMSG_FIRSTHDR(hdr);
+            cmsg->cmsg_level = SOL_UDP;
+            cmsg->cmsg_type  = UDP_SEGMENT;
+            cmsg->cmsg_len   = CMSG_LEN(sizeof(segment_size));
+            memcpy(CMSG_DATA(cmsg), &segment_size, sizeof(segment_size));
+        }
+#endif
+        s->tx_msg_first[nb_msgs++] = i;
+        p += n * len;
+        i += n;
+    }
+
+    while (sent < nb_msgs) {
+        int ret = sendmmsg(s->udp_fd, s->tx_msgs + sent, nb_msgs - sent, 0);
+        if (ret < 0) {
+            ret = ff_neterrno();
+            if (ret == AVERROR(EAGAIN) || ret == AVERROR(EINTR))
+                continue;
+            if (s->tx_msgs[sent].msg_hdr.msg_controllen) {
+                /* the route may not support GSO, send the rest without it */
+                av_log(h, AV_LOG_WARNING, "Sending with UDP GSO failed: %s, "
+                       "disabling it\n", av_err2str(ret));
+                s->gso = 0;
+                return udp_send_batch(h, s->tx_msg_first[sent], nb,
+                                      s->tx_iov[sent].iov_base);
+            }
+            return ret;
+        }
+        sent += ret;
+    }
+    return 0;
+}
+
+static void *circular_buffer_task_tx_batch(void *_URLContext)
+{
+    URLContext *h = _URLContext;
+    UDPContext *s = h->priv_data;
+    /* token bucket in bits scaled by 1000000, refilled with bitrate bits
+     * per microsecond. The thread sleeps until the bucket covers burst_bits
+     * or what is queued, so the datagrams leave in evenly spaced batches of
+     * at most burst_bits, one datagram by default. After an idle period the
+     * bucket holds at most burst_bits. While busy it keeps up to twice that
+     * or 1 ms worth of what oversleeping accumulated, so the next batch
+     * catches up with the bitrate. */
+    int64_t bucket = FFMAX(FFMIN(s->burst_bits, INT64_MAX / 1000000 / 2),
+                           h->max_packet_size * 8) * 1000000;
+    int64_t tokens = bucket, last = av_gettime_relative();
+    int ret, idle = 0;
+
+    pthread_mutex_lock(&s->mutex);
+
+    if (ff_socket_nonblock(s->udp_fd, 0) < 0) {
+        av_log(h, AV_LOG_ERROR, "Failed to set blocking mode");
+        s->circular_buffer_error = AVERROR(EIO);
+        goto end;
+    }
+
+    for (;;) {
+        uint8_t tmp[4];
+        int nb = 0, size = 0;
+
+        while (av_fifo_size(s->fifo) < 4) {
+            if (s->close_req)
+                goto end;
+            if (pthread_cond_wait(&s->cond, &s->mutex) < 0)
+                goto end;
+            idle = 1;
+        }
+
+        if (s->bitrate) {
+            int64_t now = av_gettime_relative(), cost;
+
+            tokens += FFMIN(now - last, 1000000) * s->bitrate;
+            tokens  = FFMIN(tokens, idle ? bucket : FFMAX(2 * bucket, s->bitrate * 1000));
+            last = now;
+            idle = 0;
+            av_fifo_generic_peek(s->fifo, tmp, 4, NULL);
+            cost = FFMAX(AV_RL32(tmp), av_fifo_size(s->fifo)) * INT64_C(8000000);
+            cost = FFMIN(cost, bucket);
+            if (tokens < cost) {
+                pthread_mutex_unlock(&s->mutex);
+                av_usleep((cost - tokens + s->bitrate - 1) / s->bitrate);
+                pthread_mutex_lock(&s->mutex);
+                continue;
+            }
+        }
+
+        /* take the datagrams the buffer and the bucket allow, at least one */
+        while (nb < s->send_batch && av_fifo_size(s->fifo) >= 4) {
+            int len;
+
+            av_fifo_generic_peek(s->fifo, tmp, 4, NULL);
+            len = AV_RL32(tmp);
+            av_assert0(len >= 0 && len <= UDP_MAX_PKT_SIZE);
+            if (nb && (size + len > s->tx_buf_size ||
+                       (s->bitrate && len * INT64_C(8000000) > tokens)))
+                break;
+            av_fifo_drain(s->fifo, 4);
+            av_fifo_generic_read(s->fifo, s->tx_buf + size, len, NULL);
+            s->tx_len[nb++] = len;
+            size   += len;
+            tokens -= s->bitrate ? len * INT64_C(8000000) : 0;
+        }
+        /* wake up udp_write() if it waits for space */
+        if (s->tx_waiting)
+            pthread_cond_signal(&s->cond);
+        pthread_mutex_unlock(&s->mutex);
+
+        ret = udp_send_batch(h, 0, nb, s->tx_buf);
+
+        pthread_mutex_lock(&s->mutex);
+        if (ret < 0) {
+            s->circular_buffer_error = ret;
+            pthread_cond_signal(&s->cond);
+            goto end;
+        }
+    }
+
+end:
+    pthread_mutex_unlock(&s->mutex);
+    return NULL;
+}
+
+static int udp_tx_batch_alloc(URLContext *h)
+{
+    UDPContext *s = h->priv_data;
+
+    s->tx_buf_size  = FFMAX(s->send_batch * h->max_packet_size, UDP_MAX_PKT_SIZE);
+    s->tx_buf       = av_malloc(s->tx_buf_size);
+    s->tx_len       = av_malloc_array(s->send_batch, sizeof(*s->tx_len));
+    s->tx_msgs      = av_mallocz_array(s->send_batch, sizeof(*s->tx_msgs));
+    s->tx_iov       = av_mallocz_array(s->send_batch, sizeof(*s->tx_iov));
+    s->tx_msg_first = av_malloc_array(s->send_batch, sizeof(*s->tx_msg_first));
+    if (!s->tx_buf || !s->tx_len || !s->tx_msgs || !s->tx_iov || !s->tx_msg_first)
+        return AVERROR(ENOMEM);
+
+    if (s->gso) {
+#ifdef UDP_SEGMENT
+        int segment_size;
+        socklen_t optlen = sizeof(segment_size);
+
+        if (getsockopt(s->udp_fd, SOL_UDP, UDP_SEGMENT, &segment_size, &optlen) < 0) {
+            ff_log_net_error(h, AV_LOG_WARNING, "getsockopt(UDP_SEGMENT)");
+            s->gso = 0;
+            return 0;
+        }
+        s->tx_control = av_mallocz_array(s->send_batch, UDP_SEND_CONTROL_SIZE);
+        if (!s->tx_control)
+            return AVERROR(ENOMEM);
+#else
+        av_log(h, AV_LOG_WARNING, "UDP GSO is not supported on this system\n");
+        s->gso = 0;
+#endif
+    }
+    return 0;
+}
+#endif
 
 #endif
 
@@ -635,6 +1088,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     socklen_t len;
 
     h->is_streamed = 1;
+    s->rx_timestamp = AV_NOPTS_VALUE;
 
     is_output = !(flags & AVIO_FLAG_READ);
     if (s->buffer_size < 0)
@@ -698,6 +1152,18 @@ static int udp_open(URLContext *h, const char *uri, int flags)
                        "'circular_buffer_size' option was set but it is not supported "
                        "on this build (pthread support is required)\n");
         }
+        if (av_find_info_tag(buf, sizeof(buf), "send_batch", p)) {
+            s->send_batch = av_clip(strtol(buf, NULL, 10), 0, UDP_MAX_SEND_BATCH);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "gso", p)) {
+            s->gso = strtol(buf, NULL, 10);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "recv_batch", p)) {
+            s->recv_batch = av_clip(strtol(buf, NULL, 10), 0, UDP_MAX_RECV_BATCH);
+        }
+        if (av_find_info_tag(buf, sizeof(buf), "recv_timestamps", p)) {
+            s->recv_timestamps = strtol(buf, NULL, 10);
+        }
         if (av_find_info_tag(buf, sizeof(buf), "bitrate", p)) {
             s->bitrate = strtoll(buf, NULL, 10);
             if (!HAVE_PTHREAD_CANCEL)
@@ -726,6 +1192,22 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     }
     /* handling needed to support options picking from both AVOption and URL */
     s->circular_buffer_size *= 188;
+    if (s->recv_batch && (is_output || !s->circular_buffer_size ||
+                          !HAVE_RECVMMSG || !HAVE_PTHREAD_CANCEL)) {
+        if (!is_output && s->circular_buffer_size)
+            av_log(h, AV_LOG_WARNING,
+                   "'recv_batch' option was set but it is not supported "
+                   "on this build (recvmmsg() and pthread support are required)\n");
+        s->recv_batch = 0;
+    }
+    if (s->send_batch && (!is_output || !s->circular_buffer_size ||
+                          !HAVE_SENDMMSG || !HAVE_PTHREAD_CANCEL)) {
+        if (is_output && s->circular_buffer_size)
+            av_log(h, AV_LOG_WARNING,
+                   "'send_batch' option was set but it is not supported "
+                   "on this build (sendmmsg() and pthread support are required)\n");
+        s->send_batch = 0;
+    }
     if (flags & AVIO_FLAG_WRITE) {
         h->max_packet_size = s->pkt_size;
     } else {
@@ -879,7 +1361,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     /*
       Create thread in case of:
       1. Input and circular_buffer_size is set
-      2. Output and bitrate and circular_buffer_size is set
+      2. Output and bitrate or send_batch and circular_buffer_size is set
     */
 
     if (is_output && s->bitrate && !s->circular_buffer_size) {
@@ -887,11 +1369,21 @@ static int udp_open(URLContext *h, const char *uri, int flags)
         av_log(h, AV_LOG_WARNING,"'bitrate' option was set but 'circular_buffer_size' is not, but required\n");
     }
 
-    if ((!is_output && s->circular_buffer_size) || (is_output && s->bitrate && s->circular_buffer_size)) {
+    if ((!is_output && s->circular_buffer_size) ||
+        (is_output && (s->bitrate || s->send_batch) && s->circular_buffer_size)) {
         int ret;
 
         /* start the task going */
-        s->fifo = av_fifo_alloc(s->circular_buffer_size);
+#if HAVE_RECVMMSG
+        if (s->recv_batch && udp_ring_alloc(h) < 0)
+            goto fail;
+#endif
+#if HAVE_SENDMMSG
+        if (s->send_batch && udp_tx_batch_alloc(h) < 0)
+            goto fail;
+#endif
+        if (!s->recv_batch)
+            s->fifo = av_fifo_alloc(s->circular_buffer_size);
         ret = pthread_mutex_init(&s->mutex, NULL);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_mutex_init failed : %s\n", strerror(ret));
@@ -902,7 +1394,15 @@ static int udp_open(URLContext *h, const char *uri, int flags)
             av_log(h, AV_LOG_ERROR, "pthread_cond_init failed : %s\n", strerror(ret));
             goto cond_fail;
         }
-        ret = pthread_create(&s->circular_buffer_thread, NULL, is_output?circular_buffer_task_tx:circular_buffer_task_rx, h);
+        ret = pthread_create(&s->circular_buffer_thread, NULL,
+#if HAVE_SENDMMSG
+                             s->send_batch ? circular_buffer_task_tx_batch :
+#endif
+                             is_output    ? circular_buffer_task_tx       :
+#if HAVE_RECVMMSG
+                             s->recv_batch ? circular_buffer_task_rx_batch :
+#endif
+                                             circular_buffer_task_rx, h);
         if (ret != 0) {
             av_log(h, AV_LOG_ERROR, "pthread_create failed : %s\n", strerror(ret));
             goto thread_fail;
@@ -922,6 +1422,7 @@ static int udp_open(URLContext *h, const char *uri, int flags)
     if (udp_fd >= 0)
         closesocket(udp_fd);
     av_fifo_freep(&s->fifo);
+    udp_batch_free(s);
     ff_ip_reset_filters(&s->filters);
     return AVERROR(EIO);
 }
@@ -936,6 +1437,68 @@ static int udplite_open(URLContext *h, const char *uri, int flags)
     return udp_open(h, uri, flags);
 }
 
+#if HAVE_PTHREAD_CANCEL
+static void udp_update_stats(UDPContext *s)
+{
+    s->rx_overruns  = atomic_load_explicit(&s->nb_overruns, memory_order_relaxed);
+    s->rx_batches   = atomic_load_explicit(&s->nb_batches,  memory_order_relaxed);
+    s->rx_packets   = atomic_load_explicit(&s->nb_packets,  memory_order_relaxed);
+    s->rx_max_batch = atomic_load_explicit(&s->max_batch,   memory_order_relaxed);
+}
+
+static int udp_read_ring(URLContext *h, uint8_t *buf, int size)
+{
+    UDPContext *s = h->priv_data;
+    int nonblock = h->flags & AVIO_FLAG_NONBLOCK;
+
+    do {
+        unsigned head = atomic_load_explicit(&s->ring_head, memory_order_relaxed);
+        unsigned tail = atomic_load_explicit(&s->ring_tail, memory_order_acquire);
+        int err = 0;
+
+        if (head != tail) {
+            int slot = head & s->ring_mask;
+            int len  = s->ring_len[slot];
+
+            if (len > size) {
+                av_log(h, AV_LOG_WARNING, "Part of datagram lost due to insufficient buffer size\n");
+                len = size;
+            }
+            memcpy(buf, s->ring + (size_t)slot * s->ring_slot_size, len);
+            s->rx_timestamp = s->ring_timestamps[slot];
+            atomic_store_explicit(&s->ring_head, head + 1, memory_order_release);
+            udp_update_stats(s);
+            return len;
+        }
+
+        /* the ring is empty, sleep until the thread publishes a batch */
+        pthread_mutex_lock(&s->mutex);
+        atomic_store(&s->ring_waiting, 1);
+        if (atomic_load(&s->ring_tail) == head) {
+            if (s->circular_buffer_error) {
+                err = s->circular_buffer_error;
+            } else if (nonblock) {
+                err = AVERROR(EAGAIN);
+            } else {
+                int64_t t = av_gettime() + 100000;
+                struct timespec tv = { .tv_sec  =  t / 1000000,
+                                       .tv_nsec = (t % 1000000) * 1000 };
+                err = pthread_cond_timedwait(&s->cond, &s->mutex, &tv);
+                if (err)
+                    err = AVERROR(err == ETIMEDOUT ? EAGAIN : err);
+                nonblock = 1;
+            }
+        }
+        atomic_store(&s->ring_waiting, 0);
+        pthread_mutex_unlock(&s->mutex);
+        if (err) {
+            udp_update_stats(s);
+            return err;
+        }
+    } while (1);
+}
+#endif
+
 static int udp_read(URLContext *h, uint8_t *buf, int size)
 {
     UDPContext *s = h->priv_data;
@@ -945,7 +1508,10 @@ static int udp_read(URLContext *h, uint8_t *buf, int size)
 #if HAVE_PTHREAD_CANCEL
     int avail, nonblock = h->flags & AVIO_FLAG_NONBLOCK;
 
+    if (s->ring)
+        return udp_read_ring(h, buf, size);
     if (s->fifo) {
+        s->rx_overruns = atomic_load_explicit(&s->nb_overruns, memory_order_relaxed);
         pthread_mutex_lock(&s->mutex);
         do {
             avail = av_fifo_size(s->fifo);
@@ -1011,6 +1577,16 @@ static int udp_write(URLContext *h, const uint8_t *buf, int size)
 
         pthread_mutex_lock(&s->mutex);
 
+        /* with send_batch, wait for the thread to make room instead of failing */
+        while (s->send_batch && !s->circular_buffer_error &&
+               !(h->flags & AVIO_FLAG_NONBLOCK) &&
+               av_fifo_space(s->fifo) < size + 4 &&
+               av_fifo_space(s->fifo) + av_fifo_size(s->fifo) >= size + 4) {
+            s->tx_waiting = 1;
+            pthread_cond_wait(&s->cond, &s->mutex);
+            s->tx_waiting = 0;
+        }
+
         /*
           Return error if last tx failed.
           Here we can't know on which packet error was, but it needs to know that error exists.
@@ -1090,6 +1666,7 @@ static int udp_close(URLContext *h)
 #endif
     closesocket(s->udp_fd);
     av_fifo_freep(&s->fifo);
+    udp_batch_free(s);
     ff_ip_reset_filters(&s->filters);
     return 0;
 }
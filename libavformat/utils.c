@@ -42,6 +42,7 @@
 
 #include "avformat.h"
 #include "avio_internal.h"
+#include "compactindex.h"
 #include "id3v2.h"
 #include "internal.h"
 #if CONFIG_NETWORK
@@ -311,6 +312,12 @@ int av_get_packet(AVIOContext *s, AVPacket *pkt, int size)
     pkt->size = 0;
     pkt->pos  = avio_tell(s);
 
+    if (size > 0 && ffio_read_buffer_ref(s, size, &pkt->buf) >= 0) {
+        pkt->data = pkt->buf->data;
+        pkt->size = size;
+        return size;
+    }
+
     return append_packet_chunked(s, pkt, size);
 }
 
@@ -1916,6 +1923,14 @@ void ff_reduce_index(AVFormatContext *s, int stream_index)
     AVStream *st             = s->streams[stream_index];
     unsigned int max_entries = s->max_index_size / sizeof(AVIndexEntry);
 
+    if (st->internal->compact_index) {
+        FFCompactIndex *ci = st->internal->compact_index;
+        if (ff_compact_index_size(ci) >= s->max_index_size &&
+            ff_compact_index_reduce(ci) >= 0)
+            st->internal->nb_index_entries = ci->nb_entries;
+        return;
+    }
+
     if ((unsigned) st->internal->nb_index_entries >= max_entries) {
         int i;
         for (i = 0; 2 * i < st->internal->nb_index_entries; i++)
@@ -1987,6 +2002,26 @@ int av_add_index_entry(AVStream *st, int64_t pos, int64_t timestamp,
                        int size, int distance, int flags)
 {
     timestamp = wrap_timestamp(st, timestamp);
+
+    if (st->internal->use_compact_index) {
+        FFCompactIndex *ci = st->internal->compact_index;
+        int ret;
+
+        if (timestamp == AV_NOPTS_VALUE)
+            return AVERROR(EINVAL);
+        if (is_relative(timestamp))
+            timestamp -= RELATIVE_TS_BASE;
+
+        if (!ci) {
+            ci = st->internal->compact_index = ff_compact_index_alloc();
+            if (!ci)
+                return AVERROR(ENOMEM);
+        }
+        ret = ff_compact_index_add(ci, pos, timestamp, size, distance, flags);
+        st->internal->nb_index_entries = ci->nb_entries;
+        return ret;
+    }
+
     return ff_add_index_entry(&st->internal->index_entries, &st->internal->nb_index_entries,
                               &st->internal->index_entries_allocated_size, pos,
                               timestamp, size, distance, flags);
@@ -2065,12 +2100,12 @@ void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
                 continue;
 
             for (i1 = i2 = 0; i1 < st1->internal->nb_index_entries; i1++) {
-                AVIndexEntry *e1 = &st1->internal->index_entries[i1];
+                const AVIndexEntry *e1 = ff_index_get_entry(st1, i1);
                 int64_t e1_pts = av_rescale_q(e1->timestamp, st1->time_base, AV_TIME_BASE_Q);
 
                 skip = FFMAX(skip, e1->size);
                 for (; i2 < st2->internal->nb_index_entries; i2++) {
-                    AVIndexEntry *e2 = &st2->internal->index_entries[i2];
+                    const AVIndexEntry *e2 = ff_index_get_entry(st2, i2);
                     int64_t e2_pts = av_rescale_q(e2->timestamp, st2->time_base, AV_TIME_BASE_Q);
                     if (e2_pts < e1_pts || e2_pts - (uint64_t)e1_pts < time_tolerance)
                         continue;
@@ -2100,8 +2135,20 @@ void ff_configure_buffers_for_index(AVFormatContext *s, int64_t time_tolerance)
     }
 }
 
+const AVIndexEntry *ff_index_get_entry(AVStream *st, int index)
+{
+    if (st->internal->compact_index)
+        return ff_compact_index_get(st->internal->compact_index, index);
+    if (index < 0 || index >= st->internal->nb_index_entries)
+        return NULL;
+    return &st->internal->index_entries[index];
+}
+
 int av_index_search_timestamp(AVStream *st, int64_t wanted_timestamp, int flags)
 {
+    if (st->internal->compact_index)
+        return ff_compact_index_search(st->internal->compact_index,
+                                       wanted_timestamp, flags);
     return ff_index_search_timestamp(st->internal->index_entries, st->internal->nb_index_entries,
                                      wanted_timestamp, flags);
 }
@@ -2135,15 +2182,15 @@ int ff_seek_frame_binary(AVFormatContext *s, int stream_index,
     pos_limit = -1; // GCC falsely says it may be uninitialized.
 
     st = s->streams[stream_index];
-    if (st->internal->index_entries) {
-        AVIndexEntry *e;
+    if (st->internal->nb_index_entries) {
+        const AVIndexEntry *e;
 
         /* FIXME: Whole function must be checked for non-keyframe entries in
          * index case, especially read_timestamp(). */
         index = av_index_search_timestamp(st, target_ts,
                                           flags | AVSEEK_FLAG_BACKWARD);
         index = FFMAX(index, 0);
-        e     = &st->internal->index_entries[index];
+        e     = ff_index_get_entry(st, index);
 
         if (e->timestamp <= target_ts || e->pos == e->min_distance) {
             pos_min = e->pos;
@@ -2158,7 +2205,7 @@ int ff_seek_frame_binary(AVFormatContext *s, int stream_index,
                                           flags & ~AVSEEK_FLAG_BACKWARD);
         av_assert0(index < st->internal->nb_index_entries);
         if (index >= 0) {
-            e = &st->internal->index_entries[index];
+            e = ff_index_get_entry(st, index);
             av_assert1(e->timestamp >= target_ts);
             pos_max   = e->pos;
             ts_max    = e->timestamp;
@@ -2353,14 +2400,14 @@ static int seek_frame_generic(AVFormatContext *s, int stream_index,
     int index;
     int64_t ret;
     AVStream *st;
-    AVIndexEntry *ie;
+    const AVIndexEntry *ie;
 
     st = s->streams[stream_index];
 
     index = av_index_search_timestamp(st, timestamp, flags);
 
     if (index < 0 && st->internal->nb_index_entries &&
-        timestamp < st->internal->index_entries[0].timestamp)
+        timestamp < ff_index_get_entry(st, 0)->timestamp)
         return -1;
 
     if (index < 0 || index == st->internal->nb_index_entries - 1) {
@@ -2368,8 +2415,8 @@ static int seek_frame_generic(AVFormatContext *s, int stream_index,
         int nonkey = 0;
 
         if (st->internal->nb_index_entries) {
-            av_assert0(st->internal->index_entries);
-            ie = &st->internal->index_entries[st->internal->nb_index_entries - 1];
+            ie = ff_index_get_entry(st, st->internal->nb_index_entries - 1);
+            av_assert0(ie);
             if ((ret = avio_seek(s->pb, ie->pos, SEEK_SET)) < 0)
                 return ret;
             ff_update_cur_dts(s, st, ie->timestamp);
@@ -2406,7 +2453,7 @@ static int seek_frame_generic(AVFormatContext *s, int stream_index,
     if (s->iformat->read_seek)
         if (s->iformat->read_seek(s, stream_index, timestamp, flags) >= 0)
             return 0;
-    ie = &st->internal->index_entries[index];
+    ie = ff_index_get_entry(st, index);
     if ((ret = avio_seek(s->pb, ie->pos, SEEK_SET)) < 0)
         return ret;
     ff_update_cur_dts(s, st, ie->timestamp);
@@ -4345,6 +4392,7 @@ static void free_stream(AVStream **pst)
         av_bsf_free(&st->internal->bsfc);
         av_freep(&st->internal->priv_pts);
         av_freep(&st->internal->index_entries);
+        ff_compact_index_free(&st->internal->compact_index);
         av_freep(&st->internal->probe_data.buf);
 
         av_bsf_free(&st->internal->extract_extradata.bsf);
@@ -4540,6 +4588,7 @@ FF_ENABLE_DEPRECATION_WARNINGS
     st->internal->info->fps_last_dts  = AV_NOPTS_VALUE;
 
     st->internal->inject_global_side_data = s->internal->inject_global_side_data;
+    st->internal->use_compact_index       = s->internal->use_compact_index;
 
     st->internal->need_context_update = 1;
 
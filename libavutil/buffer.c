@@ -259,6 +259,7 @@ AVBufferPool *av_buffer_pool_init2(int size, void *opaque,
     pool->pool_free = pool_free;
 
     atomic_init(&pool->refcount, 1);
+    atomic_init(&pool->free_head, 0);
 
     return pool;
 }
@@ -275,23 +276,32 @@ AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size))
     pool->alloc    = alloc ? alloc : av_buffer_alloc;
 
     atomic_init(&pool->refcount, 1);
+    atomic_init(&pool->free_head, 0);
 
     return pool;
 }
 
+static BufferPoolEntry *pool_entry(AVBufferPool *pool, unsigned slot)
+{
+    int chunk = av_log2(slot);
+    return &pool->chunks[chunk][slot - (1U << chunk)];
+}
+
 /*
  * This function gets called when the pool has been uninited and
  * all the buffers returned to it.
  */
 static void buffer_pool_free(AVBufferPool *pool)
 {
-    while (pool->pool) {
-        BufferPoolEntry *buf = pool->pool;
-        pool->pool = buf->next;
+    unsigned slot;
+    int i;
 
+    for (slot = 1; slot <= pool->nb_entries; slot++) {
+        BufferPoolEntry *buf = pool_entry(pool, slot);
         buf->free(buf->opaque, buf->data);
-        av_freep(&buf);
     }
+    for (i = 0; i < FF_ARRAY_ELEMS(pool->chunks); i++)
+        av_freep(&pool->chunks[i]);
     ff_mutex_destroy(&pool->mutex);
 
     if (pool->pool_free)
@@ -313,6 +323,38 @@ void av_buffer_pool_uninit(AVBufferPool **ppool)
         buffer_pool_free(pool);
 }
 
+static void pool_push(AVBufferPool *pool, BufferPoolEntry *buf)
+{
+    uintptr_t head = atomic_load_explicit(&pool->free_head, memory_order_relaxed);
+
+    do {
+        atomic_store_explicit(&buf->next, head & POOL_SLOT_MASK, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_head, &head,
+                                                    (head & ~POOL_SLOT_MASK) | buf->slot,
+                                                    memory_order_release,
+                                                    memory_order_relaxed));
+}
+
+static BufferPoolEntry *pool_pop(AVBufferPool *pool)
+{
+    uintptr_t head = atomic_load_explicit(&pool->free_head, memory_order_acquire);
+    uintptr_t next;
+    BufferPoolEntry *buf;
+
+    do {
+        if (!(head & POOL_SLOT_MASK))
+            return NULL;
+        buf  = pool_entry(pool, head & POOL_SLOT_MASK);
+        /* if buf is popped concurrently, the tag of the head changes and
+         * the compare-and-swap below fails */
+        next = ((head & ~POOL_SLOT_MASK) + POOL_SLOT_MASK + 1) |
+               atomic_load_explicit(&buf->next, memory_order_relaxed);
+    } while (!atomic_compare_exchange_weak_explicit(&pool->free_head, &head, next,
+                                                    memory_order_acquire,
+                                                    memory_order_acquire));
+    return buf;
+}
+
 static void pool_release_buffer(void *opaque, uint8_t *data)
 {
     BufferPoolEntry *buf = opaque;
@@ -321,39 +363,46 @@ static void pool_release_buffer(void *opaque, uint8_t *data)
     if(CONFIG_MEMORY_POISONING)
         memset(buf->data, FF_MEMORY_POISON, pool->size);
 
-    ff_mutex_lock(&pool->mutex);
-    buf->next = pool->pool;
-    pool->pool = buf;
-    ff_mutex_unlock(&pool->mutex);
+    pool_push(pool, buf);
 
     if (atomic_fetch_sub_explicit(&pool->refcount, 1, memory_order_acq_rel) == 1)
         buffer_pool_free(pool);
 }
 
 /* allocate a new buffer and override its free() callback so that
- * it is returned to the pool on free */
+ * it is returned to the pool on free, called with the pool mutex held */
 static AVBufferRef *pool_alloc_buffer(AVBufferPool *pool)
 {
     BufferPoolEntry *buf;
     AVBufferRef     *ret;
+    unsigned slot = pool->nb_entries + 1;
+    int chunk;
 
     av_assert0(pool->alloc || pool->alloc2);
 
+    if (pool->nb_entries >= POOL_MAX_ENTRIES)
+        return NULL;
+
+    chunk = av_log2(slot);
+    if (!pool->chunks[chunk]) {
+        pool->chunks[chunk] = av_mallocz_array(1U << chunk, sizeof(*buf));
+        if (!pool->chunks[chunk])
+            return NULL;
+    }
+
     ret = pool->alloc2 ? pool->alloc2(pool->opaque, pool->size) :
                          pool->alloc(pool->size);
     if (!ret)
         return NULL;
 
-    buf = av_mallocz(sizeof(*buf));
-    if (!buf) {
-        av_buffer_unref(&ret);
-        return NULL;
-    }
-
+    buf = pool_entry(pool, slot);
     buf->data   = ret->buffer->data;
     buf->opaque = ret->buffer->opaque;
     buf->free   = ret->buffer->free;
     buf->pool   = pool;
+    buf->slot   = slot;
+    atomic_init(&buf->next, 0);
+    pool->nb_entries++;
 
     ret->buffer->opaque = buf;
     ret->buffer->free   = pool_release_buffer;
@@ -366,19 +415,17 @@ AVBufferRef *av_buffer_pool_get(AVBufferPool *pool)
     AVBufferRef *ret;
     BufferPoolEntry *buf;
 
-    ff_mutex_lock(&pool->mutex);
-    buf = pool->pool;
+    buf = pool_pop(pool);
     if (buf) {
         ret = av_buffer_create(buf->data, pool->size, pool_release_buffer,
                                buf, 0);
-        if (ret) {
-            pool->pool = buf->next;
-            buf->next = NULL;
-        }
+        if (!ret)
+            pool_push(pool, buf);
     } else {
+        ff_mutex_lock(&pool->mutex);
         ret = pool_alloc_buffer(pool);
+        ff_mutex_unlock(&pool->mutex);
     }
-    ff_mutex_unlock(&pool->mutex);
 
     if (ret)
         atomic_fetch_add_explicit(&pool->refcount, 1, memory_order_relaxed);
@@ -261,6 +261,10 @@ typedef struct AVBufferPool AVBufferPool;
  * pool is empty. May be NULL, then the default allocator will be used
  * (av_buffer_alloc()).
  * @return newly created buffer pool on success, NULL on error.
+ *
+ * @note The pool never allocates more than 65535 buffers on 32-bit targets,
+ *       or 4294967295 on 64-bit ones, and av_buffer_pool_get() returns NULL
+ *       while that many are in use.
  */
 AVBufferPool *av_buffer_pool_init(int size, AVBufferRef* (*alloc)(int size));
 
@@ -297,7 +301,9 @@ void av_buffer_pool_uninit(AVBufferPool **pool);
  * Allocate a new AVBuffer, reusing an old buffer from the pool when available.
  * This function may be called simultaneously from multiple threads.
  *
- * @return a reference to the new buffer on success, NULL on error.
+ * @return a reference to the new buffer on success, NULL on error, including
+ *         when the pool is empty and already holds its maximum number of
+ *         buffers (see av_buffer_pool_init()).
  */
 AVBufferRef *av_buffer_pool_get(AVBufferPool *pool);
 
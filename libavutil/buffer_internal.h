@@ -60,6 +60,26 @@ struct AVBuffer {
     int flags_internal;
 };
 
+/*
+ * The free entries of a pool are kept in a lock-free stack. Entries are
+ * addressed by slot (index + 1, 0 meaning none) so that the head of the
+ * stack can carry a tag next to the slot; the tag is bumped on every pop,
+ * which prevents the ABA problem without double-width compare-and-swap.
+ *
+ * Both fit in a uintptr_t, as the compat atomics cannot be relied on for
+ * anything wider. On 32-bit targets this limits a pool to 65535 entries,
+ * as documented for av_buffer_pool_init(), and leaves a 16-bit tag: a pop
+ * can only be fooled if it is preempted between its load and its
+ * compare-and-swap while exactly a multiple of 65536 other pops complete.
+ */
+#if UINTPTR_MAX > UINT32_MAX
+#define POOL_SLOT_BITS 32
+#else
+#define POOL_SLOT_BITS 16
+#endif
+#define POOL_SLOT_MASK   (((uintptr_t)1 << POOL_SLOT_BITS) - 1)
+#define POOL_MAX_ENTRIES POOL_SLOT_MASK
+
 typedef struct BufferPoolEntry {
     uint8_t *data;
 
@@ -71,12 +91,28 @@ typedef struct BufferPoolEntry {
     void (*free)(void *opaque, uint8_t *data);
 
     AVBufferPool *pool;
-    struct BufferPoolEntry *next;
+
+    unsigned    slot;
+    /* slot of the next free entry while this one is in the stack */
+    atomic_uint next;
 } BufferPoolEntry;
 
 struct AVBufferPool {
+    /*
+     * Serializes the allocation of new buffers, the alloc callbacks may
+     * rely on this. Getting and releasing pooled buffers is lock-free.
+     */
     AVMutex mutex;
-    BufferPoolEntry *pool;
+
+    /* slot of the top free entry in the low POOL_SLOT_BITS, tag above */
+    atomic_uintptr_t free_head;
+
+    /*
+     * The entries are allocated in chunks of growing size which never move,
+     * chunks[i] holds the entries of slots [1 << i, 2 << i).
+     */
+    BufferPoolEntry *chunks[POOL_SLOT_BITS];
+    unsigned nb_entries;
 
     /*
      * This is used to track when the pool is to be freed.
@@ -0,0 +1,149 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Get and release buffers from one AVBufferPool in several threads at once
+ * and check that no buffer is ever handed out twice. When run with "bench"
+ * as argument, also print the get/release throughput for each thread count.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/buffer.h"
+#include "libavutil/buffer_internal.h"
+#include "libavutil/common.h"
+#include "libavutil/intreadwrite.h"
+#include "libavutil/thread.h"
+#include "libavutil/time.h"
+
+#define MAX_THREADS 32
+#define NB_HELD      4
+#define BUFFER_SIZE 64
+
+typedef struct ThreadArg {
+    AVBufferPool *pool;
+    int id;
+    int iterations;
+    int errors;
+} ThreadArg;
+
+static void *thread_main(void *opaque)
+{
+    ThreadArg *arg = opaque;
+    AVBufferRef *held[NB_HELD];
+    int i, j;
+
+    for (i = 0; i < arg->iterations; i++) {
+        uint32_t tag = (arg->id << 24) | (i & 0xffffff);
+
+        for (j = 0; j < NB_HELD; j++) {
+            held[j] = av_buffer_pool_get(arg->pool);
+            if (!held[j]) {
+                arg->errors++;
+                break;
+            }
+            AV_WN32(held[j]->data, tag + j);
+        }
+        while (j--) {
+            if (AV_RN32(held[j]->data) != tag + j)
+                arg->errors++;
+            av_buffer_unref(&held[j]);
+        }
+    }
+    return NULL;
+}
+
+static int run(int nb_threads, int iterations, int64_t *time)
+{
+    AVBufferPool *pool = av_buffer_pool_init(BUFFER_SIZE, NULL);
+    pthread_t threads[MAX_THREADS];
+    ThreadArg args[MAX_THREADS];
+    int i, ret, errors = 0;
+
+    if (!pool)
+        return AVERROR(ENOMEM);
+
+    *time = av_gettime_relative();
+    for (i = 0; i < nb_threads; i++) {
+        args[i].pool       = pool;
+        args[i].id         = i;
+        args[i].iterations = iterations;
+        args[i].errors     = 0;
+        if ((ret = pthread_create(&threads[i], NULL, thread_main, &args[i]))) {
+            fprintf(stderr, "pthread_create failed: %s.\n", strerror(ret));
+            nb_threads = i;
+            errors++;
+            break;
+        }
+    }
+    for (i = 0; i < nb_threads; i++) {
+        pthread_join(threads[i], NULL);
+        errors += args[i].errors;
+    }
+    *time = av_gettime_relative() - *time;
+
+    /* no more buffers than were ever held at once may have been allocated */
+    if (pool->nb_entries > nb_threads * NB_HELD)
+        errors++;
+
+    av_buffer_pool_uninit(&pool);
+    return errors;
+}
+
+int main(int argc, char **argv)
+{
+    static const int nb_threads[] = { 1, 2, 4, 8, 16, 32 };
+    int bench = argc > 1 && !strcmp(argv[1], "bench");
+    int iterations = bench ? 1000000 : 10000;
+    AVBufferPool *pool;
+    AVBufferRef *buf, *buf2;
+    uint8_t *data;
+    int64_t time;
+    int i, errors;
+
+    /* released buffers are reused most recently released first */
+    pool = av_buffer_pool_init(BUFFER_SIZE, NULL);
+    if (!pool)
+        return 1;
+    buf  = av_buffer_pool_get(pool);
+    buf2 = av_buffer_pool_get(pool);
+    if (!buf || !buf2 || buf->data == buf2->data)
+        return 1;
+    data = buf2->data;
+    av_buffer_unref(&buf2);
+    buf2 = av_buffer_pool_get(pool);
+    printf("reuse: %s\n", buf2 && buf2->data == data ? "ok" : "failed");
+    /* the pool outlives its uninit until all buffers are released */
+    av_buffer_pool_uninit(&pool);
+    av_buffer_unref(&buf);
+    av_buffer_unref(&buf2);
+
+    for (i = 0; i < FF_ARRAY_ELEMS(nb_threads); i++) {
+        errors = run(nb_threads[i], iterations, &time);
+        printf("threads %2d: %s", nb_threads[i], errors ? "failed" : "ok");
+        if (bench)
+            printf(" %10.0f get/release/s",
+                   nb_threads[i] * (double)iterations * NB_HELD * 1000000.0 / FFMAX(time, 1));
+        printf("\n");
+        if (errors)
+            return 1;
+    }
+
+    return 0;
+}
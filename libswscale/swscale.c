@@ -235,14 +235,20 @@ static void lumRangeFromJpeg16_c(int16_t *_dst, int width)
     if (DEBUG_SWSCALE_BUFFERS)                  \
         av_log(c, AV_LOG_DEBUG, __VA_ARGS__)
 
-static int swscale(SwsContext *c, const uint8_t *src[],
-                   int srcStride[], int srcSliceY,
-                   int srcSliceH, uint8_t *dst[], int dstStride[])
+/*
+ * Scale the input slice, outputting as many lines as possible. If dstSliceH
+ * is not 0, the whole source frame must be given and only the output lines
+ * from dstSliceY to dstSliceY + dstSliceH are scaled.
+ */
+static int swscale_lines(SwsContext *c, const uint8_t *src[],
+                         int srcStride[], int srcSliceY, int srcSliceH,
+                         uint8_t *dst[], int dstStride[],
+                         int dstSliceY, int dstSliceH)
 {
     /* load a few things into local vars to make the code more readable?
      * and faster */
     const int dstW                   = c->dstW;
-    const int dstH                   = c->dstH;
+    const int dstH                   = dstSliceH ? dstSliceY + dstSliceH : c->dstH;
 
     const enum AVPixelFormat dstFormat = c->dstFormat;
     const int flags                  = c->flags;
@@ -331,10 +337,14 @@ static int swscale(SwsContext *c, const uint8_t *src[],
         }
     }
 
-    /* Note the user might start scaling the picture in the middle so this
-     * will not get executed. This is not really intended but works
-     * currently, so people might do it. */
-    if (srcSliceY == 0) {
+    if (dstSliceH) {
+        dstY         = dstSliceY;
+        lastInLumBuf = -1;
+        lastInChrBuf = -1;
+    } else if (srcSliceY == 0) {
+        /* Note the user might start scaling the picture in the middle so this
+         * will not get executed. This is not really intended but works
+         * currently, so people might do it. */
         dstY         = 0;
         lastInLumBuf = -1;
         lastInChrBuf = -1;
@@ -351,9 +361,14 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     ff_init_slice_from_src(src_slice, (uint8_t**)src, srcStride, c->srcW,
             srcSliceY, srcSliceH, chrSrcSliceY, chrSrcSliceH, 1);
 
-    ff_init_slice_from_src(vout_slice, (uint8_t**)dst, dstStride, c->dstW,
-            dstY, dstH, dstY >> c->chrDstVSubSample,
-            AV_CEIL_RSHIFT(dstH, c->chrDstVSubSample), 0);
+    if (dstSliceH)
+        ff_init_slice_from_src(vout_slice, (uint8_t**)dst, dstStride, c->dstW,
+                dstY, dstSliceH, dstY >> c->chrDstVSubSample,
+                AV_CEIL_RSHIFT(dstH, c->chrDstVSubSample) - (dstY >> c->chrDstVSubSample), 0);
+    else
+        ff_init_slice_from_src(vout_slice, (uint8_t**)dst, dstStride, c->dstW,
+                dstY, dstH, dstY >> c->chrDstVSubSample,
+                AV_CEIL_RSHIFT(dstH, c->chrDstVSubSample), 0);
     if (srcSliceY == 0) {
         hout_slice->plane[0].sliceY = lastInLumBuf + 1;
         hout_slice->plane[1].sliceY = lastInChrBuf + 1;
@@ -373,7 +388,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
 
         // First line needed as input
         const int firstLumSrcY  = FFMAX(1 - vLumFilterSize, vLumFilterPos[dstY]);
-        const int firstLumSrcY2 = FFMAX(1 - vLumFilterSize, vLumFilterPos[FFMIN(dstY | ((1 << c->chrDstVSubSample) - 1), dstH - 1)]);
+        const int firstLumSrcY2 = FFMAX(1 - vLumFilterSize, vLumFilterPos[FFMIN(dstY | ((1 << c->chrDstVSubSample) - 1), c->dstH - 1)]);
         // First line needed as input
         const int firstChrSrcY  = FFMAX(1 - vChrFilterSize, vChrFilterPos[chrDstY]);
 
@@ -477,7 +492,7 @@ static int swscale(SwsContext *c, const uint8_t *src[],
             c->chrDither8 = ff_dither_8x8_128[chrDstY & 7];
             c->lumDither8 = ff_dither_8x8_128[dstY    & 7];
         }
-        if (dstY >= dstH - 2) {
+        if (dstY >= c->dstH - 2) {
             /* hmm looks like we can't use MMX here without overwriting
              * this array's tail */
             ff_sws_init_output_funcs(c, &yuv2plane1, &yuv2planeX, &yuv2nv12cX,
@@ -524,6 +539,50 @@ static int swscale(SwsContext *c, const uint8_t *src[],
     return dstY - lastDstY;
 }
 
+static int swscale(SwsContext *c, const uint8_t *src[],
+                   int srcStride[], int srcSliceY,
+                   int srcSliceH, uint8_t *dst[], int dstStride[])
+{
+    return swscale_lines(c, src, srcStride, srcSliceY, srcSliceH,
+                         dst, dstStride, 0, 0);
+}
+
+int ff_sws_slice_threading_supported(SwsContext *c)
+{
+    /* error diffusion carries state from one output line to the next */
+    return c->swscale == swscale && !c->cascaded_context[0] &&
+           c->dither != SWS_DITHER_ED;
+}
+
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads)
+{
+    SwsContext *parent = priv;
+    SwsContext *c      = parent->slice_ctx[jobnr];
+    /* slices must start on a chroma line */
+    const int slice_h  = FFALIGN((parent->dstH + nb_jobs - 1) / nb_jobs,
+                                 1 << parent->chrDstVSubSample);
+    const int dst_y    = jobnr * slice_h;
+    const uint8_t *src[4];
+    uint8_t *dst[4];
+    int srcStride[4], dstStride[4];
+
+    if (dst_y >= parent->dstH)
+        return;
+
+    memcpy(src, parent->thread_src, sizeof(src));
+    memcpy(dst, parent->thread_dst, sizeof(dst));
+    memcpy(srcStride, parent->thread_src_stride, sizeof(srcStride));
+    memcpy(dstStride, parent->thread_dst_stride, sizeof(dstStride));
+    if (usePal(c->srcFormat)) {
+        memcpy(c->pal_yuv, parent->pal_yuv, sizeof(c->pal_yuv));
+        memcpy(c->pal_rgb, parent->pal_rgb, sizeof(c->pal_rgb));
+    }
+
+    swscale_lines(c, src, srcStride, 0, c->srcH, dst, dstStride,
+                  dst_y, FFMIN(slice_h, parent->dstH - dst_y));
+}
+
 av_cold void ff_sws_init_range_convert(SwsContext *c)
 {
     c->lumConvertRange = NULL;
@@ -967,7 +1026,15 @@ int attribute_align_arg sws_scale(struct SwsContext *c,
     /* reset slice direction at end of frame */
     if (srcSliceY_internal + srcSliceH == c->srcH)
         c->sliceDir = 0;
-    ret = c->swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH, dst2, dstStride2);
+    if (c->slicethread && srcSliceY_internal == 0 && srcSliceH == c->srcH) {
+        memcpy(c->thread_src, src2, sizeof(src2));
+        memcpy(c->thread_dst, dst2, sizeof(dst2));
+        memcpy(c->thread_src_stride, srcStride2, sizeof(srcStride2));
+        memcpy(c->thread_dst_stride, dstStride2, sizeof(dstStride2));
+        avpriv_slicethread_execute(c->slicethread, c->nb_slice_ctx, 0);
+        c->dstY = ret = c->dstH;
+    } else
+        ret = c->swscale(c, src2, srcStride2, srcSliceY_internal, srcSliceH, dst2, dstStride2);
 
     if (c->dstXYZ && !(c->srcXYZ && c->srcW==c->dstW && c->srcH==c->dstH)) {
         int dstY = c->dstY ? c->dstY : srcSliceY + srcSliceH;
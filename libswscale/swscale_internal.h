@@ -32,6 +32,7 @@
 #include "libavutil/mem_internal.h"
 #include "libavutil/pixfmt.h"
 #include "libavutil/pixdesc.h"
+#include "libavutil/slicethread.h"
 #include "libavutil/ppc/util_altivec.h"
 
 #define STR(s) AV_TOSTRING(s) // AV_STRINGIFY is too long
@@ -324,6 +325,18 @@ typedef struct SwsContext {
     uint8_t *cascaded1_tmp[4];
     int cascaded_mainindex;
 
+    /* Slice threading: a whole frame is scaled by splitting the output
+     * lines between slice_ctx, one per job, which are full contexts with
+     * the same parameters as this one. */
+    int nb_threads;               ///< Number of threads requested, 0 for auto.
+    AVSliceThread *slicethread;
+    struct SwsContext **slice_ctx;
+    int nb_slice_ctx;
+    const uint8_t *thread_src[4]; ///< Frame being scaled by the slice threads.
+    int thread_src_stride[4];
+    uint8_t *thread_dst[4];
+    int thread_dst_stride[4];
+
     double gamma_value;
     int gamma_flag;
     int is_internal_gamma;
@@ -872,6 +885,15 @@ void ff_get_unscaled_swscale_aarch64(SwsContext *c);
  */
 SwsFunc ff_getSwsFunc(SwsContext *c);
 
+/**
+ * Return 1 if the frames scaled by c can be split into slices of output
+ * lines scaled independently, with identical results.
+ */
+int ff_sws_slice_threading_supported(SwsContext *c);
+
+void ff_sws_slice_worker(void *priv, int jobnr, int threadnr,
+                         int nb_jobs, int nb_threads);
+
 void ff_sws_init_input_funcs(SwsContext *c);
 void ff_sws_init_output_funcs(SwsContext *c,
                               yuv2planar1_fn *yuv2plane1,
@@ -0,0 +1,183 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Scale random images with several thread counts and check that the output
+ * of every threaded context is identical to the single threaded one.
+ * When run with "bench" as argument, print the time taken by a 2160p to
+ * 1080p conversion for each thread count instead.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/lfg.h"
+#include "libavutil/mem.h"
+#include "libavutil/opt.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/time.h"
+
+#include "libswscale/swscale.h"
+
+typedef struct TestCase {
+    int src_w, src_h;
+    enum AVPixelFormat src_fmt;
+    int dst_w, dst_h;
+    enum AVPixelFormat dst_fmt;
+    int flags;
+} TestCase;
+
+static const TestCase tests[] = {
+    { 1920, 1080, AV_PIX_FMT_YUV420P,     1280, 720, AV_PIX_FMT_YUV420P, SWS_BICUBIC  },
+    { 1920, 1080, AV_PIX_FMT_YUV420P,     1280, 720, AV_PIX_FMT_RGB24,   SWS_BILINEAR },
+    {  720,  576, AV_PIX_FMT_YUV422P10LE, 1024, 768, AV_PIX_FMT_YUV420P, SWS_LANCZOS  },
+    {  640,  480, AV_PIX_FMT_RGB24,        352, 288, AV_PIX_FMT_YUV420P, SWS_AREA     },
+    {  352,  288, AV_PIX_FMT_PAL8,         704, 577, AV_PIX_FMT_BGRA,    SWS_POINT    },
+};
+
+static const TestCase bench_test =
+    { 3840, 2160, AV_PIX_FMT_YUV420P, 1920, 1080, AV_PIX_FMT_YUV420P, SWS_BICUBIC };
+
+static const int thread_counts[] = { 1, 2, 3, 4, 8 };
+
+static int scale(const TestCase *t, int threads, uint8_t *const src[4],
+                 const int src_stride[4], uint8_t *dst[4],
+                 const int dst_stride[4], int iterations, int64_t *time)
+{
+    struct SwsContext *c = sws_alloc_context();
+    int i, ret;
+
+    if (!c)
+        return AVERROR(ENOMEM);
+    av_opt_set_int(c, "srcw",       t->src_w,   0);
+    av_opt_set_int(c, "srch",       t->src_h,   0);
+    av_opt_set_int(c, "src_format", t->src_fmt, 0);
+    av_opt_set_int(c, "dstw",       t->dst_w,   0);
+    av_opt_set_int(c, "dsth",       t->dst_h,   0);
+    av_opt_set_int(c, "dst_format", t->dst_fmt, 0);
+    av_opt_set_int(c, "sws_flags",  t->flags | SWS_BITEXACT, 0);
+    av_opt_set_int(c, "threads",    threads, 0);
+    if ((ret = sws_init_context(c, NULL, NULL)) < 0)
+        goto end;
+
+    *time = av_gettime_relative();
+    for (i = 0; i < iterations; i++) {
+        ret = sws_scale(c, (const uint8_t * const *)src, src_stride, 0,
+                        t->src_h, dst, dst_stride);
+        if (ret != t->dst_h) {
+            ret = AVERROR_BUG;
+            goto end;
+        }
+    }
+    *time = av_gettime_relative() - *time;
+    ret = 0;
+
+end:
+    sws_freeContext(c);
+    return ret;
+}
+
+static uint32_t checksum(uint8_t *const data[4], const int linesize[4],
+                         enum AVPixelFormat fmt, int w, int h)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(fmt);
+    uint32_t crc = 0;
+    int p, y;
+
+    for (p = 0; p < 4 && data[p]; p++) {
+        int bytes = av_image_get_linesize(fmt, w, p);
+        int lines = p == 1 || p == 2 ? AV_CEIL_RSHIFT(h, desc->log2_chroma_h) : h;
+
+        if (desc->flags & AV_PIX_FMT_FLAG_PAL && p == 1)
+            break;
+        for (y = 0; y < lines; y++)
+            crc = av_adler32_update(crc, data[p] + y * linesize[p], bytes);
+    }
+    return crc;
+}
+
+static int run(const TestCase *t, int bench, AVLFG *lfg)
+{
+    uint8_t *src[4], *dst[4];
+    int src_stride[4], dst_stride[4];
+    int i, j, ret, size, dst_size, iterations = bench ? 20 : 1;
+    uint32_t ref = 0, crc;
+    int64_t time;
+
+    ret = av_image_alloc(src, src_stride, t->src_w, t->src_h,
+                         t->src_fmt, 16);
+    if (ret < 0)
+        return ret;
+    size = ret;
+    ret = av_image_alloc(dst, dst_stride, t->dst_w, t->dst_h,
+                         t->dst_fmt, 16);
+    if (ret < 0) {
+        av_freep(&src[0]);
+        return ret;
+    }
+    dst_size = ret;
+    for (j = 0; j < size; j++)
+        src[0][j] = av_lfg_get(lfg);
+
+    printf("%s %dx%d -> %s %dx%d:",
+           av_get_pix_fmt_name(t->src_fmt), t->src_w, t->src_h,
+           av_get_pix_fmt_name(t->dst_fmt), t->dst_w, t->dst_h);
+    for (i = 0; i < FF_ARRAY_ELEMS(thread_counts); i++) {
+        memset(dst[0], 0, dst_size);
+        ret = scale(t, thread_counts[i], src, src_stride, dst, dst_stride,
+                    iterations, &time);
+        if (ret < 0)
+            break;
+        crc = checksum(dst, dst_stride, t->dst_fmt,
+                       t->dst_w, t->dst_h);
+        if (!i)
+            ref = crc;
+        if (bench)
+            printf(" %d:%.2fms", thread_counts[i], time / (1000.0 * iterations));
+        else if (i)
+            printf(" %d %s", thread_counts[i], crc == ref ? "ok" : "differs");
+        if (crc != ref)
+            ret = AVERROR_BUG;
+    }
+    printf("\n");
+
+    av_freep(&src[0]);
+    av_freep(&dst[0]);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    int bench = argc > 1 && !strcmp(argv[1], "bench");
+    AVLFG lfg;
+    int i, ret = 0;
+
+    av_lfg_init(&lfg, 0xC0FFEE);
+    if (bench)
+        ret = run(&bench_test, 1, &lfg);
+    for (i = 0; i < FF_ARRAY_ELEMS(tests) && ret >= 0; i++)
+        ret = run(&tests[i], bench, &lfg);
+
+    if (ret < 0) {
+        fprintf(stderr, "Error: %s\n", av_err2str(ret));
+        return 1;
+    }
+    return 0;
+}
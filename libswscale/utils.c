@@ -876,6 +876,7 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     const AVPixFmtDescriptor *desc_dst;
     const AVPixFmtDescriptor *desc_src;
     int need_reinit = 0;
+    int i;
 
     handle_formats(c);
     desc_dst = av_pix_fmt_desc_get(c->dstFormat);
@@ -915,6 +916,13 @@ int sws_setColorspaceDetails(struct SwsContext *c, const int inv_table[4],
     c->dstFormatBpp = av_get_bits_per_pixel(desc_dst);
     c->srcFormatBpp = av_get_bits_per_pixel(desc_src);
 
+    for (i = 0; i < c->nb_slice_ctx; i++) {
+        int ret = sws_setColorspaceDetails(c->slice_ctx[i], inv_table, srcRange, table,
+                                           dstRange, brightness, contrast, saturation);
+        if (ret < 0)
+            return ret;
+    }
+
     if (c->cascaded_context[c->cascaded_mainindex])
         return sws_setColorspaceDetails(c->cascaded_context[c->cascaded_mainindex],inv_table, srcRange,table, dstRange, brightness,  contrast, saturation);
 
@@ -1176,8 +1184,8 @@ static enum AVPixelFormat alphaless_fmt(enum AVPixelFormat fmt)
     }
 }
 
-av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
-                             SwsFilter *dstFilter)
+static av_cold int context_init_single(SwsContext *c, SwsFilter *srcFilter,
+                                       SwsFilter *dstFilter)
 {
     int i;
     int usesVFilter, usesHFilter;
@@ -1889,6 +1897,69 @@ fail: // FIXME replace things by appropriate error codes
     return ret;
 }
 
+/* Create the per slice contexts from the options originally set on c. */
+static av_cold int context_init_threaded(SwsContext *c, SwsContext *opts,
+                                         SwsFilter *srcFilter, SwsFilter *dstFilter)
+{
+    int i, ret, nb_slices;
+    int nb_threads = c->nb_threads ? c->nb_threads : av_cpu_count();
+
+    /* keep at least 16 output lines per slice */
+    nb_slices = FFMIN(nb_threads, c->dstH / 16);
+    if (nb_slices < 2 || !ff_sws_slice_threading_supported(c))
+        return 0;
+
+    ret = avpriv_slicethread_create(&c->slicethread, c, ff_sws_slice_worker,
+                                    NULL, nb_slices);
+    if (ret == AVERROR(ENOSYS))
+        return 0;
+    if (ret < 0)
+        return ret;
+
+    c->slice_ctx = av_mallocz_array(nb_slices, sizeof(*c->slice_ctx));
+    if (!c->slice_ctx)
+        return AVERROR(ENOMEM);
+
+    for (i = 0; i < nb_slices; i++) {
+        SwsContext *slice = sws_alloc_context();
+        if (!slice)
+            return AVERROR(ENOMEM);
+        c->slice_ctx[c->nb_slice_ctx++] = slice;
+
+        if ((ret = av_opt_copy(slice, opts)) < 0)
+            return ret;
+        slice->nb_threads = 1;
+        if ((ret = context_init_single(slice, srcFilter, dstFilter)) < 0)
+            return ret;
+    }
+
+    return 0;
+}
+
+av_cold int sws_init_context(SwsContext *c, SwsFilter *srcFilter,
+                             SwsFilter *dstFilter)
+{
+    SwsContext *opts = NULL;
+    int ret;
+
+    /* initializing c may change its options, keep them for the slices */
+    if (c->nb_threads != 1) {
+        opts = sws_alloc_context();
+        if (!opts)
+            return AVERROR(ENOMEM);
+        if ((ret = av_opt_copy(opts, c)) < 0)
+            goto end;
+    }
+
+    ret = context_init_single(c, srcFilter, dstFilter);
+    if (ret >= 0 && opts)
+        ret = context_init_threaded(c, opts, srcFilter, dstFilter);
+
+end:
+    sws_freeContext(opts);
+    return ret;
+}
+
 SwsContext *sws_alloc_set_opts(int srcW, int srcH, enum AVPixelFormat srcFormat,
                                int dstW, int dstH, enum AVPixelFormat dstFormat,
                                int flags, const double *param)
@@ -2340,6 +2411,11 @@ void sws_freeContext(SwsContext *c)
     if (!c)
         return;
 
+    avpriv_slicethread_free(&c->slicethread);
+    for (i = 0; i < c->nb_slice_ctx; i++)
+        sws_freeContext(c->slice_ctx[i]);
+    av_freep(&c->slice_ctx);
+
     for (i = 0; i < 4; i++)
         av_freep(&c->dither_error[i]);
 
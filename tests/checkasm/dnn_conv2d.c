@@ -0,0 +1,72 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or modify
+ * it under the terms of the GNU General Public License as published by
+ * the Free Software Foundation; either version 2 of the License, or
+ * (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License along
+ * with FFmpeg; if not, write to the Free Software Foundation, Inc.,
+ * 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA.
+ */
+
+#include <string.h>
+#include "checkasm.h"
+#include "libavfilter/dnn/dnn_backend_native_layer_conv2d.h"
+#include "libavutil/mem_internal.h"
+
+#define MAX_PIXELS      64
+#define MAX_PATCH_SIZE  (3 * 3 * 16)
+#define MAX_OUTPUT_NUM  32
+
+#define randomize_buffer(buf, size)                         \
+    do {                                                    \
+        for (int j = 0; j < size; j++)                      \
+            buf[j] = (float)(rnd() & 0xFFFF) / 0x8000 - 1.0f; \
+    } while (0)
+
+void checkasm_check_dnn_conv2d(void)
+{
+    static const int patch_sizes[] = { 3 * 3 * 1, 3 * 3 * 8, 3 * 3 * 16, 1 };
+    static const int output_nums[] = { 8, 16, 32 };
+    DNNConv2DDSPContext dsp;
+    LOCAL_ALIGNED_32(float, patches, [MAX_PIXELS * MAX_PATCH_SIZE]);
+    LOCAL_ALIGNED_32(float, kernel,  [MAX_PATCH_SIZE * MAX_OUTPUT_NUM]);
+    LOCAL_ALIGNED_32(float, bias,    [MAX_OUTPUT_NUM]);
+    LOCAL_ALIGNED_32(float, dst_ref, [MAX_PIXELS * MAX_OUTPUT_NUM]);
+    LOCAL_ALIGNED_32(float, dst_new, [MAX_PIXELS * MAX_OUTPUT_NUM]);
+    declare_func(void, float *dst, const float *patches, const float *kernel,
+                 const float *bias, int nb_pixels, int patch_size, int output_num);
+
+    randomize_buffer(patches, MAX_PIXELS * MAX_PATCH_SIZE);
+    randomize_buffer(kernel,  MAX_PATCH_SIZE * MAX_OUTPUT_NUM);
+    randomize_buffer(bias,    MAX_OUTPUT_NUM);
+
+    ff_dnn_conv2d_dsp_init(&dsp);
+
+    for (int i = 0; i < FF_ARRAY_ELEMS(patch_sizes); i++) {
+        for (int j = 0; j < FF_ARRAY_ELEMS(output_nums); j++) {
+            int patch_size = patch_sizes[i], output_num = output_nums[j];
+
+            if (check_func(dsp.gemm, "dnn_conv2d_gemm_%dx%d", patch_size, output_num)) {
+                int nb_pixels = 1 + rnd() % MAX_PIXELS;
+
+                memset(dst_ref, 0, MAX_PIXELS * MAX_OUTPUT_NUM * sizeof(*dst_ref));
+                memset(dst_new, 0, MAX_PIXELS * MAX_OUTPUT_NUM * sizeof(*dst_new));
+                call_ref(dst_ref, patches, kernel, bias, nb_pixels, patch_size, output_num);
+                call_new(dst_new, patches, kernel, bias, nb_pixels, patch_size, output_num);
+                if (!float_near_abs_eps_array(dst_ref, dst_new, 1e-4f,
+                                              MAX_PIXELS * MAX_OUTPUT_NUM))
+                    fail();
+                bench_new(dst_new, patches, kernel, bias, MAX_PIXELS, patch_size, output_num);
+            }
+        }
+    }
+    report("gemm");
+}
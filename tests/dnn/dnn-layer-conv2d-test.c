@@ -98,9 +98,9 @@ static int test_with_same_dilate(void)
     };
     float bias[2] = { -1.6574852, -0.72915393 };
 
-    NativeContext ctx;
+    NativeContext ctx = { 0 };
     ctx.class = &dnn_native_class;
-    ctx.options.conv2d_threads = 1;
+    ctx.options.threads = 1;
 
     params.activation = TANH;
     params.has_bias = 1;
@@ -120,7 +120,10 @@ static int test_with_same_dilate(void)
     operands[1].data = NULL;
 
     input_indexes[0] = 0;
+    if (dnn_init_layer_conv2d(&params) < 0)
+        return 1;
     dnn_execute_layer_conv2d(operands, input_indexes, 1, &params, &ctx);
+    dnn_uninit_layer_conv2d(&params);
 
     output = operands[1].data;
     for (int i = 0; i < sizeof(expected_output) / sizeof(float); i++) {
@@ -202,9 +205,9 @@ static int test_with_valid(void)
     };
     float bias[2] = { -0.4773722, -0.19620377 };
 
-    NativeContext ctx;
+    NativeContext ctx = { 0 };
     ctx.class = &dnn_native_class;
-    ctx.options.conv2d_threads = 1;
+    ctx.options.threads = 1;
 
     params.activation = TANH;
     params.has_bias = 1;
@@ -224,7 +227,10 @@ static int test_with_valid(void)
     operands[1].data = NULL;
 
     input_indexes[0] = 0;
+    if (dnn_init_layer_conv2d(&params) < 0)
+        return 1;
     dnn_execute_layer_conv2d(operands, input_indexes, 1, &params, &ctx);
+    dnn_uninit_layer_conv2d(&params);
 
     output = operands[1].data;
     for (int i = 0; i < sizeof(expected_output) / sizeof(float); i++) {
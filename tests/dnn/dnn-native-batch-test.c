@@ -0,0 +1,255 @@
+/*
+ * This file is part of FFmpeg.
+ *
+ * FFmpeg is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU Lesser General Public
+ * License as published by the Free Software Foundation; either
+ * version 2.1 of the License, or (at your option) any later version.
+ *
+ * FFmpeg is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the GNU
+ * Lesser General Public License for more details.
+ *
+ * You should have received a copy of the GNU Lesser General Public
+ * License along with FFmpeg; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA 02110-1301 USA
+ */
+
+/*
+ * Write a small processing model and a small super resolution model in the
+ * native format, run them through dnn_processing and sr with one thread and
+ * one frame per model run and with several threads and batched frames, and
+ * check that the outputs are identical.
+ *
+ * Usage: dnn-native-batch-test <prefix>
+ *        dnn-native-batch-test bench <prefix> [threads]
+ * The second form uses larger frames and prints the frames per second of
+ * each configuration.
+ */
+
+#include <stdio.h>
+#include <string.h>
+
+#include "libavutil/adler32.h"
+#include "libavutil/frame.h"
+#include "libavutil/imgutils.h"
+#include "libavutil/intfloat.h"
+#include "libavutil/lfg.h"
+#include "libavutil/pixdesc.h"
+#include "libavutil/time.h"
+#include "libavfilter/avfilter.h"
+#include "libavfilter/buffersink.h"
+#include "libavfilter/dnn/dnn_backend_native.h"
+
+#define MAX_FRAMES 100
+
+typedef struct RunOutput {
+    int nb_frames;
+    unsigned long checksums[MAX_FRAMES];
+} RunOutput;
+
+static void write_conv2d(AVIOContext *pb, AVLFG *lfg, int input_num, int output_num,
+                         DNNActivationFunc activation, int input_index, int output_index)
+{
+    int i, kernel_size = 3;
+
+    avio_wl32(pb, DLT_CONV2D);
+    avio_wl32(pb, 1);                   // dilation
+    avio_wl32(pb, SAME);
+    avio_wl32(pb, activation);
+    avio_wl32(pb, input_num);
+    avio_wl32(pb, output_num);
+    avio_wl32(pb, kernel_size);
+    avio_wl32(pb, 1);                   // has_bias
+    for (i = 0; i < input_num * output_num * kernel_size * kernel_size; i++)
+        avio_wl32(pb, av_float2int(av_lfg_get(lfg) / (float)UINT32_MAX - 0.5f));
+    for (i = 0; i < output_num; i++)
+        avio_wl32(pb, av_float2int(av_lfg_get(lfg) / (float)UINT32_MAX * 0.1f));
+    avio_wl32(pb, input_index);
+    avio_wl32(pb, output_index);
+}
+
+static void write_operand(AVIOContext *pb, int index, const char *name,
+                          DNNOperandType type, int channels)
+{
+    avio_wl32(pb, index);
+    avio_wl32(pb, strlen(name) + 1);
+    avio_put_str(pb, name);
+    avio_wl32(pb, type);
+    avio_wl32(pb, DNN_FLOAT);
+    avio_wl32(pb, 1);
+    avio_wl32(pb, -1);
+    avio_wl32(pb, -1);
+    avio_wl32(pb, channels);
+}
+
+/**
+ * Write a model with two 3x3 convolutions mapping the input x to the output
+ * y, followed by a depth to space layer doubling the frame size if upscale
+ * is set.
+ */
+static int write_model(const char *filename, int upscale)
+{
+    AVIOContext *pb;
+    AVLFG lfg;
+    int ret;
+
+    if ((ret = avio_open(&pb, filename, AVIO_FLAG_WRITE)) < 0)
+        return ret;
+    av_lfg_init(&lfg, 0x5eed);
+
+    avio_write(pb, "FFMPEGDNNNATIVE", 15);
+    avio_wl32(pb, 1);                   // major version
+    avio_wl32(pb, 0);                   // minor version
+
+    write_conv2d(pb, &lfg, 1, 8, RELU, 0, 1);
+    if (upscale) {
+        write_conv2d(pb, &lfg, 8, 4, SIGMOID, 1, 2);
+        avio_wl32(pb, DLT_DEPTH_TO_SPACE);
+        avio_wl32(pb, 2);
+        avio_wl32(pb, 2);
+        avio_wl32(pb, 3);
+    } else {
+        write_conv2d(pb, &lfg, 8, 1, SIGMOID, 1, 2);
+    }
+
+    write_operand(pb, 0, "x", DOT_INPUT, 1);
+    write_operand(pb, 1, "conv1", DOT_INTERMEDIATE, 8);
+    if (upscale) {
+        write_operand(pb, 2, "conv2", DOT_INTERMEDIATE, 4);
+        write_operand(pb, 3, "y", DOT_OUTPUT, 1);
+    } else {
+        write_operand(pb, 2, "y", DOT_OUTPUT, 1);
+    }
+
+    avio_wl32(pb, upscale ? 3 : 2);     // layers_num
+    avio_wl32(pb, upscale ? 4 : 3);     // operands_num
+    return avio_closep(&pb);
+}
+
+static unsigned long frame_checksum(const AVFrame *frame)
+{
+    const AVPixFmtDescriptor *desc = av_pix_fmt_desc_get(frame->format);
+    unsigned long checksum = 0;
+    int plane, y;
+
+    for (plane = 0; plane < 4 && frame->data[plane]; plane++) {
+        int h = plane == 1 || plane == 2 ?
+                AV_CEIL_RSHIFT(frame->height, desc->log2_chroma_h) : frame->height;
+        int linesize = av_image_get_linesize(frame->format, frame->width, plane);
+        for (y = 0; y < h; y++)
+            checksum = av_adler32_update(checksum,
+                                         frame->data[plane] + y * frame->linesize[plane],
+                                         linesize);
+    }
+    return checksum;
+}
+
+static int run_graph(const char *filter, int w, int h, int nb_frames, RunOutput *output)
+{
+    AVFilterGraph *graph;
+    AVFilterContext *sink;
+    AVFilterInOut *inputs = NULL, *outputs = NULL;
+    AVFrame *frame = NULL;
+    char desc[2048];
+    int ret;
+
+    memset(output, 0, sizeof(*output));
+
+    graph = avfilter_graph_alloc();
+    if (!graph)
+        return AVERROR(ENOMEM);
+
+    snprintf(desc, sizeof(desc), "testsrc2=size=%dx%d:rate=25,trim=end_frame=%d,"
+             "format=yuv420p,%s,buffersink@out", w, h, nb_frames, filter);
+    ret = avfilter_graph_parse2(graph, desc, &inputs, &outputs);
+    if (ret < 0)
+        goto end;
+    if (inputs || outputs) {
+        ret = AVERROR(EINVAL);
+        goto end;
+    }
+    ret = avfilter_graph_config(graph, NULL);
+    if (ret < 0)
+        goto end;
+    sink = avfilter_graph_get_filter(graph, "buffersink@out");
+
+    frame = av_frame_alloc();
+    if (!frame) {
+        ret = AVERROR(ENOMEM);
+        goto end;
+    }
+    while ((ret = av_buffersink_get_frame(sink, frame)) >= 0) {
+        if (output->nb_frames < MAX_FRAMES)
+            output->checksums[output->nb_frames] = frame_checksum(frame);
+        output->nb_frames++;
+        av_frame_unref(frame);
+    }
+    if (ret == AVERROR_EOF)
+        ret = 0;
+
+end:
+    av_frame_free(&frame);
+    avfilter_inout_free(&inputs);
+    avfilter_inout_free(&outputs);
+    avfilter_graph_free(&graph);
+    return ret;
+}
+
+int main(int argc, char **argv)
+{
+    static const char *const filters[] = {
+        "dnn_processing=dnn_backend=native:model=%s.proc:input=x:output=y:options=threads=%d&batch_size=%d",
+        "sr=dnn_backend=native:model=%s.sr:options=threads=%d&batch_size=%d",
+    };
+    int bench = argc > 2 && !strcmp(argv[1], "bench");
+    const char *prefix;
+    int threads = bench && argc > 3 ? atoi(argv[3]) : 4;
+    int w = bench ? 640 : 64, h = bench ? 360 : 48, nb_frames = bench ? 50 : 10;
+    int configs[][2] = { { 1, 1 }, { threads, 1 }, { threads, threads } };
+    RunOutput outputs[FF_ARRAY_ELEMS(configs)];
+    char filename[1024], filter[1024];
+    int64_t t;
+    int i, j, ret;
+
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <prefix> | bench <prefix> [threads]\n", argv[0]);
+        return 1;
+    }
+    prefix = argv[bench ? 2 : 1];
+
+    snprintf(filename, sizeof(filename), "%s.proc", prefix);
+    if ((ret = write_model(filename, 0)) < 0)
+        goto fail;
+    snprintf(filename, sizeof(filename), "%s.sr", prefix);
+    if ((ret = write_model(filename, 1)) < 0)
+        goto fail;
+
+    for (i = 0; i < FF_ARRAY_ELEMS(filters); i++) {
+        int identical = 1;
+
+        for (j = 0; j < FF_ARRAY_ELEMS(configs); j++) {
+            snprintf(filter, sizeof(filter), filters[i], prefix, configs[j][0], configs[j][1]);
+            t = av_gettime_relative();
+            if ((ret = run_graph(filter, w, h, nb_frames, &outputs[j])) < 0)
+                goto fail;
+            t = av_gettime_relative() - t;
+            if (bench)
+                printf("%s threads %d batch %d: %.2f fps\n", i ? "sr" : "dnn_processing",
+                       configs[j][0], configs[j][1],
+                       outputs[j].nb_frames * 1000000.0 / FFMAX(t, 1));
+            identical &= outputs[j].nb_frames == outputs[0].nb_frames &&
+                         !memcmp(outputs[j].checksums, outputs[0].checksums,
+                                 sizeof(outputs[0].checksums));
+        }
+        printf("%s: frames %d, %s\n", i ? "sr" : "dnn_processing",
+               outputs[0].nb_frames, identical ? "identical" : "different");
+    }
+
+    return 0;
+
+fail:
+    fprintf(stderr, "Error: %s\n", av_err2str(ret));
+    return 1;
+}
@@ -158,6 +158,13 @@ fate-aac-aref-encode: CMP_TARGET = 596
 fate-aac-aref-encode: SIZE_TOLERANCE = 2464
 fate-aac-aref-encode: FUZZ = 89
 
+# the threaded encoder must give the same bitstream as the unthreaded one
+FATE_AAC_ENCODE_THREADS = fate-aac-5ch-encode fate-aac-5ch-encode-threads
+fate-aac-5ch-encode fate-aac-5ch-encode-threads: ./tests/data/asynth-44100-5.wav
+fate-aac-5ch-encode: CMD = md5 -i $(TARGET_PATH)/tests/data/asynth-44100-5.wav -c:a aac -aac_pns 1 -aac_tns 1 -aac_is 1 -b:a 320k -threads 1 -f adts -fflags +bitexact -flags +bitexact -af aresample
+fate-aac-5ch-encode-threads: CMD = md5 -i $(TARGET_PATH)/tests/data/asynth-44100-5.wav -c:a aac -aac_pns 1 -aac_tns 1 -aac_is 1 -b:a 320k -threads 3 -thread_type slice -f adts -fflags +bitexact -flags +bitexact -af aresample
+fate-aac-5ch-encode-threads: REF = $(SRC_PATH)/tests/ref/fate/aac-5ch-encode
+
 FATE_AAC_ENCODE += fate-aac-ln-encode
 fate-aac-ln-encode: CMD = enc_dec_pcm adts wav s16le $(TARGET_SAMPLES)/audio-reference/luckynight_2ch_44kHz_s16.wav -c:a aac -aac_is 0 -aac_pns 0 -aac_ms 0 -aac_tns 0 -b:a 512k -fflags +bitexact -flags +bitexact
 fate-aac-ln-encode: CMP = stddev
@@ -254,10 +261,12 @@ $(FATE_AAC_ALL): CMP  = oneoff
 $(FATE_AAC_ALL): FUZZ = 2
 
 FATE_AAC_ENCODE-$(call ENCMUX, AAC, ADTS) += $(FATE_AAC_ENCODE)
+FATE_AAC_ENCODE_THREADS-$(call ALLYES, WAV_DEMUXER PCM_S16LE_DECODER AAC_ENCODER ADTS_MUXER) += $(FATE_AAC_ENCODE_THREADS)
 
 FATE_AAC_BSF-$(call ALLYES, AAC_DEMUXER AAC_ADTSTOASC_BSF MATROSKA_MUXER) += fate-aac-autobsf-adtstoasc
 
 FATE_SAMPLES_FFMPEG += $(FATE_AAC_ALL) $(FATE_AAC_ENCODE-yes) $(FATE_AAC_BSF-yes)
+FATE_FFMPEG += $(FATE_AAC_ENCODE_THREADS-yes)
 
-fate-aac: $(FATE_AAC_ALL) $(FATE_AAC_ENCODE) $(FATE_AAC_BSF-yes)
+fate-aac: $(FATE_AAC_ALL) $(FATE_AAC_ENCODE) $(FATE_AAC_ENCODE_THREADS-yes) $(FATE_AAC_BSF-yes)
 fate-aac-latm: $(FATE_AAC_LATM-yes)
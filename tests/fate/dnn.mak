@@ -33,6 +33,11 @@ fate-dnn-layer-avgpool: $(DNNTESTSDIR)/dnn-layer-avgpool-test$(EXESUF)
 fate-dnn-layer-avgpool: CMD = run $(DNNTESTSDIR)/dnn-layer-avgpool-test$(EXESUF)
 fate-dnn-layer-avgpool: CMP = null
 
+FATE_DNN_NATIVE_BATCH-$(call ALLYES, TESTSRC2_FILTER TRIM_FILTER FORMAT_FILTER DNN_PROCESSING_FILTER SR_FILTER) += fate-dnn-native-batch
+fate-dnn-native-batch: $(DNNTESTSDIR)/dnn-native-batch-test$(EXESUF)
+fate-dnn-native-batch: CMD = run $(DNNTESTSDIR)/dnn-native-batch-test$(EXESUF) $(TARGET_PATH)/tests/data/fate/dnn-native-batch
+FATE_DNN += $(FATE_DNN_NATIVE_BATCH-yes)
+
 FATE-$(CONFIG_DNN) += $(FATE_DNN)
 
 fate-dnn: $(FATE_DNN)
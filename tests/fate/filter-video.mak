@@ -858,6 +858,16 @@ fate-filter-refcmp-ssim-rgb: CMD = refcmp_metadata ssim rgb24 0.015
 FATE_FILTER_SAMPLES-$(call ALLYES, $(REFCMP_DEPS) SSIM_FILTER) += fate-filter-refcmp-ssim-yuv
 fate-filter-refcmp-ssim-yuv: CMD = refcmp_metadata ssim yuv422p 0.015
 
+FATE_FILTER-$(call ALLYES, NULLSRC_FILTER NULL_FILTER TESTSRC2_FILTER SPLIT_FILTER SCALE_FILTER) += fate-filter-scheduler
+fate-filter-scheduler: libavfilter/tests/scheduler$(EXESUF)
+fate-filter-scheduler: CMD = run libavfilter/tests/scheduler$(EXESUF)
+
+FRAME_THREADS_DEPS = TESTSRC2_FILTER SCALE_FILTER LUTRGB_FILTER COLORCHANNELMIXER_FILTER \
+                     LUT3D_FILTER COLORBALANCE_FILTER LUT1D_FILTER NEGATE_FILTER V360_FILTER
+FATE_FILTER-$(call ALLYES, $(FRAME_THREADS_DEPS)) += fate-filter-frame-threads
+fate-filter-frame-threads: libavfilter/tests/frame_threads$(EXESUF)
+fate-filter-frame-threads: CMD = run libavfilter/tests/frame_threads$(EXESUF)
+
 FATE_SAMPLES_FFPROBE += $(FATE_METADATA_FILTER-yes)
 FATE_SAMPLES_FFMPEG += $(FATE_FILTER_SAMPLES-yes)
 FATE_FFMPEG += $(FATE_FILTER-yes)
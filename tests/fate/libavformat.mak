@@ -2,6 +2,15 @@
 #fate-async: libavformat/tests/async$(EXESUF)
 #fate-async: CMD = run libavformat/tests/async
 
+FATE_LIBAVFORMAT-yes += fate-compactindex
+fate-compactindex: libavformat/tests/compactindex$(EXESUF)
+fate-compactindex: CMD = run libavformat/tests/compactindex$(EXESUF)
+
+FATE_FILE_MMAP-$(call ALLYES, FILE_PROTOCOL MOV_MUXER MOV_DEMUXER MATROSKA_MUXER MATROSKA_DEMUXER) += fate-file_mmap
+FATE_LIBAVFORMAT-$(HAVE_MMAP) += $(FATE_FILE_MMAP-yes)
+fate-file_mmap: libavformat/tests/file_mmap$(EXESUF)
+fate-file_mmap: CMD = run libavformat/tests/file_mmap$(EXESUF) $(TARGET_PATH)/tests/data/fate/file_mmap
+
 FATE_LIBAVFORMAT-$(CONFIG_NETWORK) += fate-noproxy
 fate-noproxy: libavformat/tests/noproxy$(EXESUF)
 fate-noproxy: CMD = run libavformat/tests/noproxy$(EXESUF)
@@ -18,6 +27,10 @@ FATE_LIBAVFORMAT-yes += fate-url
 fate-url: libavformat/tests/url$(EXESUF)
 fate-url: CMD = run libavformat/tests/url$(EXESUF)
 
+FATE_LIBAVFORMAT-$(call ALLYES, MPEGTS_MUXER MPEGTS_DEMUXER FILE_PROTOCOL) += fate-mpegts-demux
+fate-mpegts-demux: libavformat/tests/mpegts$(EXESUF)
+fate-mpegts-demux: CMD = run libavformat/tests/mpegts$(EXESUF) $(TARGET_PATH)/tests/data/fate/mpegts-demux
+
 FATE_LIBAVFORMAT-$(CONFIG_MOV_MUXER) += fate-movenc
 fate-movenc: libavformat/tests/movenc$(EXESUF)
 fate-movenc: CMD = run libavformat/tests/movenc$(EXESUF)